@@ -0,0 +1,525 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "corpus.hpp"
+#include "weights.hpp"
+#include "../src/ai/genetic/Agent.hpp"
+#include "../src/ai/genetic/RolloutEvaluator.hpp"
+#include "../src/ai/genetic/surface.hpp"
+#include "../src/ai/genetic/train.hpp"
+#include "../src/ai/PackedPosition.hpp"
+#include "../src/ai/ValueNet.hpp"
+#include "../src/util/ShardReader.hpp"
+#include "../src/util/ShardWriter.hpp"
+
+// Weights used everywhere a benchmark needs an Agent
+
+/* A corpus board along with the random engine it depends on */
+struct BenchBoard {
+    RandomEngine random_engine;
+    Board board;
+
+    explicit BenchBoard (const corpus::Layout& layout)
+        : random_engine(0)
+        , board(250, random_engine)
+    {
+        corpus::load(board, layout);
+    }
+};
+
+/* Every spawn position of a piece, like generate_moves tries */
+struct StartPos {
+    uint8_t piece;
+    uint16_t anchor;
+    uint8_t rot;
+};
+
+static std::vector<StartPos> start_positions (uint8_t piece) {
+    std::vector<StartPos> positions;
+    for (uint8_t rot = 0; rot < 4; rot++) {
+        tetromino_data::Bounds bounds =
+            tetromino_data::get_piece_bounds(piece, rot);
+        for (int pos = bounds.left_bound; pos <= bounds.right_bound; pos++)
+            positions.push_back({piece, (uint16_t) (pos + Board::BUFFER_SQUARES), rot});
+    }
+    return positions;
+}
+
+static void BM_ValidMove (benchmark::State& state) {
+    BenchBoard b(corpus::LAYOUTS[state.range(0)]);
+    std::vector<StartPos> positions;
+    for (uint8_t piece = 1; piece <= 7; piece++) {
+        std::vector<StartPos> p = start_positions(piece);
+        positions.insert(positions.end(), p.begin(), p.end());
+    }
+
+    for (auto _ : state) {
+        for (const StartPos& p : positions) {
+            // One row down from every spawn position
+            benchmark::DoNotOptimize(
+                b.board.valid_move(p.piece, p.anchor, p.rot, 0, Board::WIDTH)
+            );
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * positions.size());
+    state.SetLabel(corpus::LAYOUTS[state.range(0)].name);
+}
+BENCHMARK(BM_ValidMove)->DenseRange(0, corpus::LAYOUT_COUNT - 1);
+
+static void BM_GetGhost (benchmark::State& state) {
+    BenchBoard b(corpus::LAYOUTS[state.range(0)]);
+    std::vector<StartPos> positions;
+    for (uint8_t piece = 1; piece <= 7; piece++) {
+        std::vector<StartPos> p = start_positions(piece);
+        positions.insert(positions.end(), p.begin(), p.end());
+    }
+
+    for (auto _ : state) {
+        for (const StartPos& p : positions) {
+            benchmark::DoNotOptimize(
+                b.board.get_ghost(p.piece, p.anchor, p.rot)
+            );
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * positions.size());
+    state.SetLabel(corpus::LAYOUTS[state.range(0)].name);
+}
+BENCHMARK(BM_GetGhost)->DenseRange(0, corpus::LAYOUT_COUNT - 1);
+
+/*
+ * Locks a vertical I piece into a well, which runs clear_lines.
+ * The copy of the board is part of the measurement, it's only 250 bytes.
+ */
+static void BM_ClearLines (benchmark::State& state) {
+    const uint8_t lines = state.range(0);
+
+    // Find a seed where the first piece is an I piece
+    RandomEngine random_engine;
+    uint32_t seed = 0;
+    while (true) {
+        random_engine.seed(seed);
+        Board probe(250, random_engine);
+        corpus::load_well(probe, lines);
+        if (probe.get_falling_piece() == I_PIECE)
+            break;
+        seed++;
+    }
+    random_engine.seed(seed);
+    Board prepared(250, random_engine);
+    corpus::load_well(prepared, lines);
+
+    // Vertical I in the leftmost column
+    const uint8_t rot = 3;
+    const uint16_t anchor = prepared.get_ghost(
+        I_PIECE,
+        tetromino_data::get_piece_bounds(I_PIECE, rot).left_bound +
+            Board::BUFFER_SQUARES,
+        rot
+    );
+
+    for (auto _ : state) {
+        Board board = prepared;
+        board.place_piece(anchor, rot, false);
+        benchmark::DoNotOptimize(board.get_lines_cleared());
+    }
+
+    Board check = prepared;
+    check.place_piece(anchor, rot, false);
+    if (check.get_lines_cleared() != lines)
+        state.SkipWithError("Well did not clear the expected number of lines");
+}
+BENCHMARK(BM_ClearLines)->DenseRange(1, 4);
+
+static void BM_GenerateMoves (benchmark::State& state) {
+    BenchBoard b(corpus::LAYOUTS[state.range(0)]);
+    uint8_t current_piece = b.board.get_falling_piece();
+    uint8_t next_piece = b.board.nth_piece(0);
+
+    size_t moves = 0;
+    for (auto _ : state) {
+        std::vector<Move> move_list = generate_moves(
+            &b.board, current_piece, next_piece
+        );
+        moves += move_list.size();
+        benchmark::DoNotOptimize(move_list.data());
+    }
+    state.SetItemsProcessed(moves);
+    state.SetLabel(corpus::LAYOUTS[state.range(0)].name);
+}
+BENCHMARK(BM_GenerateMoves)->DenseRange(0, corpus::LAYOUT_COUNT - 1);
+
+static void BM_AnalyzeBoard (benchmark::State& state) {
+    BenchBoard b(corpus::LAYOUTS[state.range(0)]);
+    uint8_t current_piece = b.board.get_falling_piece();
+    uint8_t next_piece = b.board.nth_piece(0);
+    std::vector<Move> move_list = generate_moves(
+        &b.board, current_piece, next_piece
+    );
+
+    for (auto _ : state) {
+        for (const Move& move : move_list) {
+            BoardAnalysis analysis = analyze_board(
+                &b.board, move.position,
+                move.hold ? next_piece : current_piece, move.rotation
+            );
+            benchmark::DoNotOptimize(analysis);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * move_list.size());
+    state.SetLabel(corpus::LAYOUTS[state.range(0)].name);
+}
+BENCHMARK(BM_AnalyzeBoard)->DenseRange(0, corpus::LAYOUT_COUNT - 1);
+
+/* Same as BM_AnalyzeBoard from the surface fit table, reading the surface
+ * once per board like best_move() does */
+static void BM_AnalyzeSurface (benchmark::State& state) {
+    BenchBoard b(corpus::LAYOUTS[state.range(0)]);
+    uint8_t current_piece = b.board.get_falling_piece();
+    uint8_t next_piece = b.board.nth_piece(0);
+    std::vector<Move> move_list = generate_moves(
+        &b.board, current_piece, next_piece
+    );
+
+    for (auto _ : state) {
+        Surface surface = read_surface(&b.board);
+        for (const Move& move : move_list) {
+            BoardAnalysis analysis;
+            int piece = move.hold ? next_piece : current_piece;
+            if (!analyze_surface(surface, move.position, piece, move.rotation, analysis))
+                analysis = analyze_board(&b.board, move.position, piece, move.rotation);
+            benchmark::DoNotOptimize(analysis);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * move_list.size());
+    state.SetLabel(corpus::LAYOUTS[state.range(0)].name);
+}
+BENCHMARK(BM_AnalyzeSurface)->DenseRange(0, corpus::LAYOUT_COUNT - 1);
+
+static void BM_BestMove (benchmark::State& state) {
+    BenchBoard b(corpus::LAYOUTS[state.range(0)]);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(best_move(&b.board, TEST_WEIGHTS));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(corpus::LAYOUTS[state.range(0)].name);
+}
+BENCHMARK(BM_BestMove)->DenseRange(0, corpus::LAYOUT_COUNT - 1);
+
+/* Move generation and placement together, items/s is nodes per second */
+static void BM_Perft (benchmark::State& state) {
+    BenchBoard b(corpus::LAYOUTS[2]);
+    const uint8_t depth = state.range(0);
+
+    size_t nodes = 0;
+    for (auto _ : state) {
+        nodes += perft(&b.board, depth);
+    }
+    state.SetItemsProcessed(nodes);
+    state.SetLabel(corpus::LAYOUTS[2].name);
+}
+BENCHMARK(BM_Perft)->DenseRange(1, 4)->Unit(benchmark::kMillisecond);
+
+/* One rollout decision with up to range(0) rollouts per candidate, on
+ * every core. The counters show how many were played before a candidate
+ * pulled ahead */
+static void BM_RolloutMove (benchmark::State& state) {
+    BenchBoard b(corpus::LAYOUTS[state.range(1)]);
+    RolloutSettings settings = RolloutEvaluator::DEFAULT_SETTINGS;
+    settings.rollouts = state.range(0);
+    RolloutEvaluator evaluator(TEST_WEIGHTS, settings);
+
+    size_t rollouts = 0, separated = 0;
+    for (auto _ : state) {
+        RolloutResult result = evaluator.evaluate(&b.board);
+        rollouts += result.rollouts;
+        separated += result.separated;
+    }
+    state.counters["rollouts"] = (double) rollouts / state.iterations();
+    state.counters["separated"] = (double) separated / state.iterations();
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(corpus::LAYOUTS[state.range(1)].name);
+}
+BENCHMARK(BM_RolloutMove)->ArgsProduct({{16, 64}, {2, 4}})->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+/* How deep the anytime search gets with a budget of range(0) milliseconds */
+static void BM_AnytimeSearch (benchmark::State& state) {
+    BenchBoard b(corpus::LAYOUTS[2]);
+    const auto budget = std::chrono::milliseconds(state.range(0));
+
+    size_t nodes = 0, depth = 0;
+    for (auto _ : state) {
+        SearchResult result = anytime_search(
+            &b.board, TEST_WEIGHTS, 7, std::chrono::steady_clock::now() + budget
+        );
+        nodes += result.nodes;
+        depth += result.depth;
+    }
+    state.SetItemsProcessed(nodes);
+    state.counters["depth"] = (double) depth / state.iterations();
+    state.SetLabel(corpus::LAYOUTS[2].name);
+}
+BENCHMARK(BM_AnytimeSearch)->Arg(1)->Arg(5)->Arg(20)->Arg(100)
+    ->Unit(benchmark::kMillisecond);
+
+/* Full games through Agent::gen_input and Board::update, no window */
+static void BM_HeadlessGame (benchmark::State& state) {
+    const size_t max_pieces = state.range(0);
+    uint32_t seed = 0;
+    size_t pieces = 0;
+
+    for (auto _ : state) {
+        Agent agent(true, TEST_WEIGHTS);
+        GameResult result = play_game(agent, seed++, max_pieces);
+        pieces += result.pieces_placed;
+        benchmark::DoNotOptimize(result);
+    }
+    // items/s is pieces per second
+    state.SetItemsProcessed(pieces);
+}
+BENCHMARK(BM_HeadlessGame)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+/*
+ * Same games, searching each next position while the piece is steered.
+ * Steering only takes a few inputs here, so this mostly measures the cost
+ * of handing searches to the other thread. Real time, since the searches
+ * don't count as this thread's CPU time.
+ */
+static void BM_HeadlessGameThinkAhead (benchmark::State& state) {
+    const size_t max_pieces = state.range(0);
+    uint32_t seed = 0;
+    size_t pieces = 0;
+    uint64_t decisions = 0, predicted = 0;
+
+    for (auto _ : state) {
+        Agent agent(true, TEST_WEIGHTS, true);
+        GameResult result = play_game(agent, seed++, max_pieces);
+        pieces += result.pieces_placed;
+        decisions += agent.get_decision_stats().decisions;
+        predicted += agent.get_decision_stats().predicted;
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(pieces);
+    state.counters["predicted"] = decisions > 0 ? (double) predicted / decisions : 0;
+}
+BENCHMARK(BM_HeadlessGameThinkAhead)->Arg(100)->Arg(1000)->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+/* 500 piece games searching up to 4 deep, picking the depth from the danger
+ * with an average budget of range(0) microseconds per piece. search_us
+ * should stay close to the budget, and depth shows how deep it got */
+static void BM_AdaptiveDepthGame (benchmark::State& state) {
+    uint32_t seed = 0;
+    size_t pieces = 0;
+    uint64_t decisions = 0, search_ns = 0;
+
+    for (auto _ : state) {
+        Agent agent(true, TEST_WEIGHTS, false, 4);
+        agent.set_compute_budget(state.range(0) * 1000);
+        GameResult result = play_game(agent, seed++, 500);
+        pieces += result.pieces_placed;
+        decisions += agent.get_decision_stats().decisions;
+        search_ns += agent.get_decision_stats().total_search_ns;
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(pieces);
+    state.counters["search_us"] = decisions > 0 ? search_ns / 1000.0 / decisions : 0;
+}
+BENCHMARK(BM_AdaptiveDepthGame)->Arg(50)->Arg(500)->Arg(5000)
+    ->Unit(benchmark::kMillisecond);
+
+/* 500 piece games placing best_move() picks with Board::place_piece(), one
+ * game at a time, to compare BM_BatchGames with */
+static void BM_PlacedGames (benchmark::State& state) {
+    uint32_t seed = 0;
+    size_t pieces = 0;
+
+    for (auto _ : state) {
+        for (int64_t game = 0; game < state.range(0); game++) {
+            RandomEngine random_engine(seed++);
+            Board board(250, random_engine);
+            Input input = {};
+            board.update(input, 0);
+            while (!board.game_over() && board.get_pieces_placed() < 500) {
+                Move move = best_move(&board, TEST_WEIGHTS);
+                board.place_piece(move.position, move.rotation, move.hold);
+            }
+            pieces += board.get_pieces_placed();
+        }
+    }
+    state.SetItemsProcessed(pieces);
+}
+BENCHMARK(BM_PlacedGames)->Arg(64)->Unit(benchmark::kMillisecond);
+
+/* The same games, range(0) of them at a time in a BoardBatch */
+static void BM_BatchGames (benchmark::State& state) {
+    uint32_t seed = 0;
+    size_t pieces = 0;
+    std::vector<uint32_t> seeds(state.range(0));
+
+    for (auto _ : state) {
+        for (uint32_t& game_seed : seeds)
+            game_seed = seed++;
+        std::vector<GameResult> results = play_games(
+            TEST_WEIGHTS, seeds.data(), seeds.size(), 500
+        );
+        for (const GameResult& result : results)
+            pieces += result.pieces_placed;
+    }
+    state.SetItemsProcessed(pieces);
+}
+BENCHMARK(BM_BatchGames)->Arg(16)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
+
+/* Positions from one game, packed before each move */
+static std::vector<PackedPosition> bench_positions () {
+    RandomEngine random_engine(0);
+    Board board(250, random_engine);
+    Input input = {};
+    board.update(input, 0);
+    std::vector<PackedPosition> positions;
+    while (!board.game_over() && positions.size() < 1000) {
+        Move move = best_move(&board, TEST_WEIGHTS);
+        positions.push_back(PackedPosition::pack(board));
+        positions.back().set_move(move);
+        board.place_piece(move.position, move.rotation, move.hold);
+    }
+    return positions;
+}
+
+/*
+ * Writing a whole shard of positions, 1 with compression and 0 without.
+ * Real time, since compressing and writing happen on the background thread.
+ * Positions come in far faster than any game makes them, so the background
+ * thread can fall behind and drop some, which the counter shows.
+ */
+static void BM_ShardWrite (benchmark::State& state) {
+    const bool compress = state.range(0) != 0;
+    const std::vector<PackedPosition> positions = bench_positions();
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "bench_shard.tsh").string();
+    ShardWriter writer(PackedPosition::BYTES, 4096, compress);
+
+    size_t dropped = 0;
+    for (auto _ : state) {
+        writer.open(path);
+        for (int repeat = 0; repeat < 100; repeat++) {
+            for (const PackedPosition& position : positions)
+                writer.write(&position);
+        }
+        writer.close();
+        dropped += writer.get_dropped();
+    }
+    state.counters["dropped"] = (double) dropped / state.iterations();
+    state.SetItemsProcessed(state.iterations() * 100 * positions.size());
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_ShardWrite)->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/* Reading every position back out of a mapped shard */
+static void BM_ShardRead (benchmark::State& state) {
+    const bool compress = state.range(0) != 0;
+    const std::vector<PackedPosition> positions = bench_positions();
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "bench_shard.tsh").string();
+    ShardWriter writer(PackedPosition::BYTES, 4096, compress);
+    writer.open(path);
+    for (int repeat = 0; repeat < 100; repeat++) {
+        for (const PackedPosition& position : positions)
+            writer.write(&position);
+    }
+    writer.close();
+
+    ShardReader reader;
+    reader.open(path);
+    for (auto _ : state) {
+        size_t squares = 0;
+        reader.for_each_record([&] (const uint8_t* record) {
+            squares += record[0];
+        });
+        benchmark::DoNotOptimize(squares);
+    }
+    state.SetItemsProcessed(state.iterations() * reader.get_record_count());
+    reader.close();
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_ShardRead)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+/* Value network forward passes over every candidate of a board, range(0)
+ * picks the batched kernels (1) or the scalar path (0), items/s is evals */
+static void BM_ValueNet (benchmark::State& state) {
+    BenchBoard b(corpus::LAYOUTS[2]);
+    RandomEngine random_engine(0);
+    ValueNet net;
+    net.randomize(random_engine);
+
+    uint8_t current_piece = b.board.get_falling_piece();
+    uint8_t next_piece = b.board.nth_piece(0);
+    std::vector<Move> move_list = generate_moves(
+        &b.board, current_piece, next_piece
+    );
+    uint16_t rows[Board::HEIGHT];
+    ValueNet::board_rows(b.board, rows);
+    std::vector<uint8_t> inputs(move_list.size() * ValueNet::INPUTS);
+    for (size_t i = 0; i < move_list.size(); i++) {
+        ValueNet::features(
+            rows, move_list[i].position,
+            move_list[i].hold ? next_piece : current_piece,
+            move_list[i].rotation, &inputs[i * ValueNet::INPUTS]
+        );
+    }
+
+    std::vector<float> scores(move_list.size());
+    for (auto _ : state) {
+        if (state.range(0))
+            net.evaluate(inputs.data(), move_list.size(), scores.data());
+        else
+            net.evaluate_scalar(inputs.data(), move_list.size(), scores.data());
+        benchmark::DoNotOptimize(scores.data());
+    }
+    state.SetItemsProcessed(state.iterations() * move_list.size());
+    state.SetLabel(corpus::LAYOUTS[2].name);
+}
+BENCHMARK(BM_ValueNet)->Arg(0)->Arg(1);
+
+/* Same as BM_BestMove, scoring the candidates with a value network */
+static void BM_BestMoveNet (benchmark::State& state) {
+    BenchBoard b(corpus::LAYOUTS[state.range(0)]);
+    RandomEngine random_engine(0);
+    ValueNet net;
+    net.randomize(random_engine);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(best_move_net(&b.board, net));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(corpus::LAYOUTS[state.range(0)].name);
+}
+BENCHMARK(BM_BestMoveNet)->DenseRange(0, corpus::LAYOUT_COUNT - 1);
+
+int main (int argc, char** argv) {
+    // Default to JSON so results can be stored and compared between runs,
+    // pass --benchmark_format=console for a readable table
+    std::vector<char*> args(argv, argv + argc);
+    bool format_given = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--benchmark_format", 18) == 0)
+            format_given = true;
+    }
+    static char json_format[] = "--benchmark_format=json";
+    if (!format_given)
+        args.push_back(json_format);
+
+    int args_count = (int) args.size();
+    benchmark::Initialize(&args_count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(args_count, args.data()))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/game/Board.hpp"
+
+/*
+ * A fixed set of mid-game boards at different stack heights.
+ * Rows are listed top to bottom and sit on the floor of the board,
+ * '#' is a locked square and '.' is empty.
+ */
+namespace corpus
+{
+    struct Layout {
+        const char* name;
+        std::vector<const char*> rows;
+    };
+
+    const Layout LAYOUTS[] =
+    {
+        {"empty", {}},
+        {"low", {
+            "......##..",
+            "#.....###.",
+            "##.#.#####",
+            "####.#####",
+        }},
+        {"mid", {
+            "....#.....",
+            "...###...#",
+            "#.#####.##",
+            "##.######.",
+            "######.###",
+            "#####.####",
+            "####.#####",
+            "#########.",
+        }},
+        {"high", {
+            "...#......",
+            "..###...#.",
+            "#.####.###",
+            "#######.##",
+            "##.#######",
+            "####.#####",
+            "#.########",
+            "######.###",
+            "###.######",
+            "#######.##",
+            ".#########",
+            "#####.####",
+        }},
+        {"danger", {
+            "....##....",
+            "#..###.#..",
+            "##.#####.#",
+            "###.######",
+            "#.########",
+            "######.###",
+            "##.#######",
+            "#######.##",
+            "####.#####",
+            ".#########",
+            "########.#",
+            "###.######",
+            "#####.####",
+            "#.########",
+            "######.###",
+            "##.#######",
+        }},
+    };
+
+    constexpr size_t LAYOUT_COUNT = sizeof(LAYOUTS) / sizeof(LAYOUTS[0]);
+
+    /**
+     * Fills in a board from a layout and spawns the first piece.
+     * @param board A freshly constructed board.
+     * @param layout Which layout to copy onto the board.
+     */
+    inline void load (Board& board, const Layout& layout)
+    {
+        const size_t height = layout.rows.size();
+        for (size_t i = 0; i < height; i++) {
+            uint8_t y = Board::HEIGHT - height + i;
+            for (uint8_t x = 0; x < Board::WIDTH; x++) {
+                if (layout.rows[i][x] == '#')
+                    board.set_square(x, y, (int8_t) (x % 7 + 1));
+            }
+        }
+
+        Input input = {};
+        board.update(input, 0);
+    }
+
+    /**
+     * Fills the bottom rows so that a vertical I piece in the leftmost
+     * column completes all of them.
+     * @param board A freshly constructed board.
+     * @param lines How many lines the I piece should clear (1-4).
+     */
+    inline void load_well (Board& board, uint8_t lines)
+    {
+        for (uint8_t y = Board::HEIGHT - 6; y < Board::HEIGHT; y++) {
+            for (uint8_t x = 1; x < Board::WIDTH; x++)
+                board.set_square(x, y, (int8_t) (x % 7 + 1));
+        }
+        // Plug the well below the lines that should be cleared
+        for (uint8_t y = Board::HEIGHT - 6 + lines; y < Board::HEIGHT; y++)
+            board.set_square(0, y, I_PIECE);
+
+        Input input = {};
+        board.update(input, 0);
+    }
+}
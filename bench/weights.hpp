@@ -0,0 +1,7 @@
+#pragma once
+
+#include "../src/ai/genetic/eval.hpp"
+
+// Hand-picked weights that play a decent game, shared by the tests and
+// benchmarks so they all play the same moves
+const Weights TEST_WEIGHTS = {-20.0, -10.0, 50.0, -1.0, -20.0, -10.0};
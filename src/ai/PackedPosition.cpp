@@ -0,0 +1,157 @@
+#include <cstring>
+
+#include "PackedPosition.hpp"
+
+static constexpr uint16_t FALLING_BIT = Board::TOTAL_SIZE;
+static constexpr uint16_t HELD_BIT = FALLING_BIT + 3;
+static constexpr uint16_t QUEUE_BIT = HELD_BIT + 3;
+static constexpr uint16_t HAS_MOVE_BIT = QUEUE_BIT + 3 * PackedPosition::QUEUE_SIZE;
+static constexpr uint16_t HAS_OUTCOME_BIT = HAS_MOVE_BIT + 1;
+static constexpr uint16_t HOLD_BIT = HAS_OUTCOME_BIT + 1;
+static constexpr uint16_t ROTATION_BIT = HOLD_BIT + 1;
+static constexpr uint16_t ANCHOR_BIT = ROTATION_BIT + 2;
+static constexpr uint16_t ANCHOR_BITS = 9;
+static constexpr uint16_t HAS_SCORE_BIT = ANCHOR_BIT + ANCHOR_BITS;
+static constexpr size_t OUTCOME_BYTE = 36;
+static constexpr size_t SCORE_BYTE = 40;
+// Anchors can be a little left of the first square, keep them positive
+static constexpr int ANCHOR_OFFSET = 16;
+
+static_assert(HAS_SCORE_BIT < OUTCOME_BYTE * 8);
+static_assert(Board::TOTAL_SIZE + ANCHOR_OFFSET < 1 << ANCHOR_BITS);
+
+/**
+ * @param bits The packed bits.
+ * @param first The first bit of the field.
+ * @param count How many bits the field takes.
+ * @return The field.
+ */
+static uint32_t get_bits (const uint8_t* bits, uint16_t first, uint8_t count) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        uint16_t bit = first + i;
+        value |= (uint32_t) ((bits[bit / 8] >> (bit % 8)) & 1) << i;
+    }
+    return value;
+}
+
+/**
+ * @param bits The packed bits.
+ * @param first The first bit of the field.
+ * @param count How many bits the field takes.
+ * @param value What to set the field to.
+ */
+static void set_bits (uint8_t* bits, uint16_t first, uint8_t count, uint32_t value) {
+    for (uint8_t i = 0; i < count; i++) {
+        uint16_t bit = first + i;
+        if ((value >> i) & 1)
+            bits[bit / 8] |= 1 << (bit % 8);
+        else
+            bits[bit / 8] &= ~(1 << (bit % 8));
+    }
+}
+
+PackedPosition PackedPosition::pack (const Board& board) {
+    PackedPosition position = {};
+    // Locked squares are positive, the falling piece is negative
+    for (uint16_t i = 0; i < Board::TOTAL_SIZE; i++) {
+        if (board.get_square(i) > 0)
+            position.bits[i / 8] |= 1 << (i % 8);
+    }
+    set_bits(position.bits, FALLING_BIT, 3, board.get_falling_piece());
+    set_bits(position.bits, HELD_BIT, 3, board.get_held_piece());
+    for (uint8_t i = 0; i < QUEUE_SIZE; i++)
+        set_bits(position.bits, QUEUE_BIT + 3 * i, 3, board.nth_piece(i));
+    return position;
+}
+
+void PackedPosition::unpack (Board& board) const {
+    for (uint8_t y = 0; y < Board::HEIGHT; y++) {
+        for (uint8_t x = 0; x < Board::WIDTH; x++) {
+            // Locked squares don't keep their piece, any will do
+            if (get_square(x, y))
+                board.set_square(x, y, (int8_t) (x % 7 + 1));
+        }
+    }
+
+    uint8_t pieces[1 + QUEUE_SIZE] = {get_falling_piece()};
+    for (uint8_t i = 0; i < QUEUE_SIZE; i++)
+        pieces[i + 1] = get_queue(i);
+    board.set_pieces(pieces, sizeof(pieces), get_held_piece());
+
+    Input input = {};
+    board.update(input, 0);
+}
+
+bool PackedPosition::get_square (uint8_t x, uint8_t y) const {
+    return get_bits(bits, Board::convert_idx(x, y), 1) != 0;
+}
+
+uint8_t PackedPosition::get_falling_piece () const {
+    return (uint8_t) get_bits(bits, FALLING_BIT, 3);
+}
+
+uint8_t PackedPosition::get_held_piece () const {
+    return (uint8_t) get_bits(bits, HELD_BIT, 3);
+}
+
+uint8_t PackedPosition::get_queue (uint8_t n) const {
+    return (uint8_t) get_bits(bits, QUEUE_BIT + 3 * n, 3);
+}
+
+void PackedPosition::set_move (const Move& move) {
+    set_bits(bits, HAS_MOVE_BIT, 1, 1);
+    set_bits(bits, HOLD_BIT, 1, move.hold);
+    set_bits(bits, ROTATION_BIT, 2, move.rotation);
+    set_bits(bits, ANCHOR_BIT, ANCHOR_BITS, move.position + ANCHOR_OFFSET);
+}
+
+bool PackedPosition::has_move () const {
+    return get_bits(bits, HAS_MOVE_BIT, 1) != 0;
+}
+
+Move PackedPosition::get_move () const {
+    return {
+        .position = (int) get_bits(bits, ANCHOR_BIT, ANCHOR_BITS) - ANCHOR_OFFSET,
+        .rotation = (int) get_bits(bits, ROTATION_BIT, 2),
+        .hold = get_bits(bits, HOLD_BIT, 1) != 0
+    };
+}
+
+void PackedPosition::set_outcome (uint32_t outcome) {
+    set_bits(bits, HAS_OUTCOME_BIT, 1, 1);
+    for (size_t i = 0; i < 4; i++)
+        bits[OUTCOME_BYTE + i] = (uint8_t) (outcome >> (8 * i));
+}
+
+bool PackedPosition::has_outcome () const {
+    return get_bits(bits, HAS_OUTCOME_BIT, 1) != 0;
+}
+
+uint32_t PackedPosition::get_outcome () const {
+    uint32_t outcome = 0;
+    for (size_t i = 0; i < 4; i++)
+        outcome |= (uint32_t) bits[OUTCOME_BYTE + i] << (8 * i);
+    return outcome;
+}
+
+void PackedPosition::set_score (float score) {
+    set_bits(bits, HAS_SCORE_BIT, 1, 1);
+    uint32_t value;
+    std::memcpy(&value, &score, sizeof(value));
+    for (size_t i = 0; i < 4; i++)
+        bits[SCORE_BYTE + i] = (uint8_t) (value >> (8 * i));
+}
+
+bool PackedPosition::has_score () const {
+    return get_bits(bits, HAS_SCORE_BIT, 1) != 0;
+}
+
+float PackedPosition::get_score () const {
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; i++)
+        value |= (uint32_t) bits[SCORE_BYTE + i] << (8 * i);
+    float score;
+    std::memcpy(&score, &value, sizeof(score));
+    return score;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "genetic/eval.hpp"
+#include "../game/Board.hpp"
+
+/*
+ * A position packed into 44 bytes for datasets, so millions of them fit in
+ * memory and on disk.
+ * Only what an evaluator looks at is kept: which squares are locked, the
+ * falling piece, the held piece and the queue. Scores, timers and the
+ * colors of locked squares aren't. A position can come with the move that
+ * was played from it, the score the search gave that move and an outcome,
+ * whatever number the dataset wants to learn.
+ *
+ * Bit layout, lowest bit of the first byte first:
+ *   0-249    locked squares, row by row from the top (all 25 rows)
+ *   250-252  falling piece, 253-255 held piece (0 for none)
+ *   256-270  the next QUEUE_SIZE pieces
+ *   271      has a move, 272 has an outcome, 285 has a score
+ *   273      move holds, 274-275 move rotation, 276-284 move anchor + 16
+ *   bytes 36-39  outcome, little endian
+ *   bytes 40-43  score, a little endian float
+ */
+struct PackedPosition {
+    static constexpr size_t BYTES = 44;
+    static constexpr uint8_t QUEUE_SIZE = 5;
+
+    uint8_t bits[BYTES];
+
+    /**
+     * Packs a board while its piece is falling, with no move or outcome.
+     * @param board The board to pack.
+     * @return The packed position.
+     */
+    static PackedPosition pack (const Board& board);
+
+    /**
+     * Sets up the position on a board.
+     * The board has to be freshly constructed, and has its first update
+     * done so the falling piece spawns.
+     * @param board The board to set up.
+     */
+    void unpack (Board& board) const;
+
+    /**
+     * @param x The horizontal coordinate.
+     * @param y The vertical coordinate.
+     * @return True if the square is locked.
+     */
+    [[nodiscard]] bool get_square (uint8_t x, uint8_t y) const;
+
+    /**
+     * @return The falling piece type.
+     */
+    [[nodiscard]] uint8_t get_falling_piece () const;
+
+    /**
+     * @return The held piece, or 0 for none.
+     */
+    [[nodiscard]] uint8_t get_held_piece () const;
+
+    /**
+     * @param n Which piece up after the falling one, 0 for the next.
+     * @return The piece type.
+     */
+    [[nodiscard]] uint8_t get_queue (uint8_t n) const;
+
+    /**
+     * @param move The move that was played from this position.
+     */
+    void set_move (const Move& move);
+
+    /**
+     * @return True if the position has a move.
+     */
+    [[nodiscard]] bool has_move () const;
+
+    /**
+     * @return The move that was played, only if has_move().
+     */
+    [[nodiscard]] Move get_move () const;
+
+    /**
+     * @param outcome What came of the position.
+     */
+    void set_outcome (uint32_t outcome);
+
+    /**
+     * @return True if the position has an outcome.
+     */
+    [[nodiscard]] bool has_outcome () const;
+
+    /**
+     * @return What came of the position, only if has_outcome().
+     */
+    [[nodiscard]] uint32_t get_outcome () const;
+
+    /**
+     * @param score What the search scored the move at.
+     */
+    void set_score (float score);
+
+    /**
+     * @return True if the position has a score.
+     */
+    [[nodiscard]] bool has_score () const;
+
+    /**
+     * @return What the search scored the move at, only if has_score().
+     */
+    [[nodiscard]] float get_score () const;
+};
+
+static_assert(sizeof(PackedPosition) == PackedPosition::BYTES);
@@ -1,7 +1,19 @@
 #pragma once
 
+#include <cstdint>
+
 #include "../game/Board.hpp"
 
+/* How long a player spent deciding on its moves */
+struct DecisionStats {
+    uint64_t decisions;        // How many moves have been decided so far
+    uint64_t last_ns;          // How long the last one took
+    uint32_t last_candidates;  // How many moves were looked at for it
+    uint64_t predicted;        // How many were searched before their piece spawned
+    uint8_t last_depth;        // How many pieces ahead the last one looked
+    uint64_t total_search_ns;  // Time spent searching for every move so far
+};
+
 /**
  * PURE ABSTRACT CLASS.
  * An object that can make a move given the current board state.
@@ -17,5 +29,19 @@ public:
      */
     virtual Input gen_input (Board* current_board) = 0;
 
+    /**
+     * When the player needs gen_input() to be called next even if nothing
+     * else happens, like a held key repeating.
+     * @return A time from SDL_GetTicksNS(), or UINT64_MAX if there's nothing
+     * to wait for.
+     */
+    virtual uint64_t next_deadline_ns () const { return UINT64_MAX; }
+
+    /**
+     * @return How long the player spent on its last decision, all zeroes
+     * for players that don't think about their moves.
+     */
+    virtual DecisionStats get_decision_stats () const { return {}; }
+
     virtual ~Player() = default;
 };
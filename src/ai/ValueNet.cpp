@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+// Only the kernels are compiled for AVX2, and evaluate() checks the CPU
+// before running them
+#if defined(TETRIS_AVX2) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define VALUE_NET_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+#include "ValueNet.hpp"
+#include "../game/tetrominoes.hpp"
+#include "../util/bytes.hpp"
+
+static constexpr char MAGIC[4] = {'T', 'V', 'N', 'N'};
+static constexpr uint32_t FORMAT_VERSION = 1;
+static constexpr uint16_t FULL_ROW = (1 << Board::WIDTH) - 1;
+// Rows of the top of the stack given as bits
+static constexpr int SURFACE_ROWS = 4;
+
+static_assert(ValueNet::INPUTS % 32 == 0 && ValueNet::HIDDEN % 32 == 0);
+static_assert(
+    ValueNet::FEATURES == 3 * Board::WIDTH - 1 + 1 + SURFACE_ROWS * Board::WIDTH + 2
+);
+static_assert(ValueNet::FEATURES <= ValueNet::INPUTS);
+
+/**
+ * @param sum A hidden neuron's sum.
+ * @return Its activation.
+ */
+static uint8_t activate (int32_t sum) {
+    return (uint8_t) std::clamp(sum >> ValueNet::ACTIVATION_SHIFT, 0, 127);
+}
+
+#ifdef VALUE_NET_AVX2
+
+/**
+ * @return True if the CPU and OS can run AVX2 instructions.
+ */
+static bool has_avx2 () {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    // The OS has to save the AVX registers too
+    bool os_saves_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+        (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return os_saves_avx && (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+/**
+ * @param sums 8 vectors of 8 int32.
+ * @return The sum of each vector, in order.
+ */
+AVX2_TARGET static __m256i sum8 (const __m256i sums[8]) {
+    __m256i s01 = _mm256_hadd_epi32(sums[0], sums[1]);
+    __m256i s23 = _mm256_hadd_epi32(sums[2], sums[3]);
+    __m256i s45 = _mm256_hadd_epi32(sums[4], sums[5]);
+    __m256i s67 = _mm256_hadd_epi32(sums[6], sums[7]);
+    // Each half now has the sums of its own half of every vector
+    __m256i s0123 = _mm256_hadd_epi32(s01, s23);
+    __m256i s4567 = _mm256_hadd_epi32(s45, s67);
+    return _mm256_add_epi32(
+        _mm256_permute2x128_si256(s0123, s4567, 0x20),
+        _mm256_permute2x128_si256(s0123, s4567, 0x31)
+    );
+}
+
+/**
+ * Runs a hidden layer, 8 neurons at a time.
+ * @param in The layer's inputs, a multiple of 32 of them.
+ * @param in_size How many inputs there are.
+ * @param weights in_size weights per neuron.
+ * @param biases One per neuron.
+ * @param out Set to the activations of HIDDEN neurons.
+ */
+AVX2_TARGET static void hidden_layer (
+    const uint8_t* in, size_t in_size, const int8_t* weights,
+    const int32_t* biases, uint8_t* out
+) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (size_t o = 0; o < ValueNet::HIDDEN; o += 8) {
+        __m256i sums[8];
+        for (__m256i& sum : sums)
+            sum = _mm256_setzero_si256();
+        for (size_t i = 0; i < in_size; i += 32) {
+            __m256i x = _mm256_loadu_si256((const __m256i*) (in + i));
+            for (size_t k = 0; k < 8; k++) {
+                __m256i w = _mm256_loadu_si256((const __m256i*) (weights + (o + k) * in_size + i));
+                // Byte pairs to int16, which can't saturate since inputs
+                // are 127 at most, then int16 pairs to int32
+                __m256i pairs = _mm256_maddubs_epi16(x, w);
+                sums[k] = _mm256_add_epi32(sums[k], _mm256_madd_epi16(pairs, ones));
+            }
+        }
+
+        __m256i sum = _mm256_add_epi32(
+            sum8(sums), _mm256_loadu_si256((const __m256i*) (biases + o))
+        );
+        sum = _mm256_srai_epi32(sum, ValueNet::ACTIVATION_SHIFT);
+        sum = _mm256_min_epi32(_mm256_max_epi32(sum, _mm256_setzero_si256()), _mm256_set1_epi32(127));
+        alignas(32) int32_t activations[8];
+        _mm256_store_si256((__m256i*) activations, sum);
+        for (size_t k = 0; k < 8; k++)
+            out[o + k] = (uint8_t) activations[k];
+    }
+}
+
+/**
+ * @param in HIDDEN activations.
+ * @param weights HIDDEN int16 weights.
+ * @return The weighted sum.
+ */
+AVX2_TARGET static int32_t output_layer (const uint8_t* in, const int16_t* weights) {
+    __m256i sum = _mm256_setzero_si256();
+    for (size_t i = 0; i < ValueNet::HIDDEN; i += 16) {
+        __m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (in + i)));
+        __m256i w = _mm256_loadu_si256((const __m256i*) (weights + i));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, w));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+}
+
+#endif
+
+ValueNet::ValueNet ()
+    : m_w1{}
+    , m_b1{}
+    , m_w2{}
+    , m_b2{}
+    , m_w3{}
+    , m_b3(0)
+    , m_scale(1)
+{}
+
+bool ValueNet::load (const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "ERR: Could not open value net " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> data(
+        (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()
+    );
+
+    const size_t expected = sizeof(MAGIC) + 3 * 4 + sizeof(m_w1) + sizeof(m_b1) +
+        sizeof(m_w2) + sizeof(m_b2) + sizeof(m_w3) + 4 + 4;
+    if (data.size() != expected ||
+        std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0 ||
+        get_le(&data[4], 4) != FORMAT_VERSION ||
+        get_le(&data[8], 4) != INPUTS || get_le(&data[12], 4) != HIDDEN) {
+        std::cout << "ERR: " << path << " isn't a value net of this size" << std::endl;
+        return false;
+    }
+
+    const uint8_t* at = &data[16];
+    auto read = [&] (size_t size) {
+        uint64_t value = get_le(at, size);
+        at += size;
+        return value;
+    };
+    for (auto& neuron : m_w1) {
+        for (int8_t& weight : neuron)
+            weight = (int8_t) read(1);
+    }
+    for (int32_t& bias : m_b1)
+        bias = (int32_t) read(4);
+    for (auto& neuron : m_w2) {
+        for (int8_t& weight : neuron)
+            weight = (int8_t) read(1);
+    }
+    for (int32_t& bias : m_b2)
+        bias = (int32_t) read(4);
+    for (int16_t& weight : m_w3)
+        weight = (int16_t) read(2);
+    m_b3 = (int32_t) read(4);
+    auto scale = (uint32_t) read(4);
+    std::memcpy(&m_scale, &scale, sizeof(m_scale));
+    return true;
+}
+
+bool ValueNet::save (const std::string& path) const {
+    std::vector<uint8_t> data(MAGIC, MAGIC + sizeof(MAGIC));
+    put_le(data, FORMAT_VERSION, 4);
+    put_le(data, INPUTS, 4);
+    put_le(data, HIDDEN, 4);
+    for (const auto& neuron : m_w1) {
+        for (int8_t weight : neuron)
+            put_le(data, (uint8_t) weight, 1);
+    }
+    for (int32_t bias : m_b1)
+        put_le(data, (uint32_t) bias, 4);
+    for (const auto& neuron : m_w2) {
+        for (int8_t weight : neuron)
+            put_le(data, (uint8_t) weight, 1);
+    }
+    for (int32_t bias : m_b2)
+        put_le(data, (uint32_t) bias, 4);
+    for (int16_t weight : m_w3)
+        put_le(data, (uint16_t) weight, 2);
+    put_le(data, (uint32_t) m_b3, 4);
+    uint32_t scale;
+    std::memcpy(&scale, &m_scale, sizeof(scale));
+    put_le(data, scale, 4);
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*) data.data(), (std::streamsize) data.size());
+    return (bool) file.flush();
+}
+
+void ValueNet::randomize (RandomEngine& random_engine) {
+    std::uniform_int_distribution<int> weight(-64, 64);
+    std::uniform_int_distribution<int> bias(-512, 512);
+    std::uniform_int_distribution<int> output(-1000, 1000);
+    for (size_t o = 0; o < HIDDEN; o++) {
+        // The padding stays zero
+        for (size_t i = 0; i < FEATURES; i++)
+            m_w1[o][i] = (int8_t) weight(random_engine);
+        for (int8_t& w : m_w2[o])
+            w = (int8_t) weight(random_engine);
+        m_b1[o] = bias(random_engine);
+        m_b2[o] = bias(random_engine);
+        m_w3[o] = (int16_t) output(random_engine);
+    }
+    m_b3 = 0;
+    m_scale = 1000;
+}
+
+int32_t ValueNet::forward_scalar (const uint8_t* inputs) const {
+    uint8_t hidden1[HIDDEN], hidden2[HIDDEN];
+    for (size_t o = 0; o < HIDDEN; o++) {
+        int32_t sum = m_b1[o];
+        for (size_t i = 0; i < INPUTS; i++)
+            sum += inputs[i] * m_w1[o][i];
+        hidden1[o] = activate(sum);
+    }
+    for (size_t o = 0; o < HIDDEN; o++) {
+        int32_t sum = m_b2[o];
+        for (size_t i = 0; i < HIDDEN; i++)
+            sum += hidden1[i] * m_w2[o][i];
+        hidden2[o] = activate(sum);
+    }
+    int32_t sum = m_b3;
+    for (size_t i = 0; i < HIDDEN; i++)
+        sum += hidden2[i] * m_w3[i];
+    return sum;
+}
+
+void ValueNet::evaluate (const uint8_t* inputs, size_t count, float* scores) const {
+#ifdef VALUE_NET_AVX2
+    static const bool avx2 = has_avx2();
+    if (avx2) {
+        evaluate_avx2(inputs, count, scores);
+        return;
+    }
+#endif
+    evaluate_scalar(inputs, count, scores);
+}
+
+#ifdef VALUE_NET_AVX2
+AVX2_TARGET void ValueNet::evaluate_avx2 (const uint8_t* inputs, size_t count, float* scores) const {
+    alignas(32) uint8_t hidden1[HIDDEN];
+    alignas(32) uint8_t hidden2[HIDDEN];
+    for (size_t n = 0; n < count; n++) {
+        hidden_layer(inputs + n * INPUTS, INPUTS, &m_w1[0][0], m_b1, hidden1);
+        hidden_layer(hidden1, HIDDEN, &m_w2[0][0], m_b2, hidden2);
+        scores[n] = (float) (output_layer(hidden2, m_w3) + m_b3) / m_scale;
+    }
+}
+#endif
+
+void ValueNet::evaluate_scalar (const uint8_t* inputs, size_t count, float* scores) const {
+    for (size_t n = 0; n < count; n++)
+        scores[n] = (float) forward_scalar(inputs + n * INPUTS) / m_scale;
+}
+
+void ValueNet::board_rows (const Board& board, uint16_t rows[Board::HEIGHT]) {
+    for (uint8_t y = 0; y < Board::HEIGHT; y++) {
+        uint16_t row = 0;
+        for (uint8_t x = 0; x < Board::WIDTH; x++) {
+            if (board.get_square(x, y) > 0)
+                row |= 1 << x;
+        }
+        rows[y] = row;
+    }
+}
+
+void ValueNet::features (
+    const uint16_t board_rows[Board::HEIGHT], int anchor, int piece, int rot,
+    uint8_t* inputs
+) {
+    uint16_t rows[Board::HEIGHT];
+    std::memcpy(rows, board_rows, sizeof(rows));
+    for (uint8_t i = 0; i < 4; i++) {
+        int idx = anchor + tetromino_data::get_piece_map(piece, rot, i);
+        rows[Board::row(idx)] |= 1 << Board::col(idx);
+    }
+
+    // Clear full rows, moving everything above them down
+    int lines = 0;
+    int to = Board::HEIGHT - 1;
+    for (int y = Board::HEIGHT - 1; y >= 0; y--) {
+        if (rows[y] == FULL_ROW)
+            lines++;
+        else
+            rows[to--] = rows[y];
+    }
+    for (; to >= 0; to--)
+        rows[to] = 0;
+
+    int top = 0;
+    while (top < Board::HEIGHT && rows[top] == 0)
+        top++;
+
+    // Going down from the top, a column's first square is its height and
+    // every empty square after that is a hole
+    uint8_t heights[Board::WIDTH] = {};
+    uint8_t holes[Board::WIDTH] = {};
+    uint16_t covered = 0;
+    for (int y = top; y < Board::HEIGHT; y++) {
+        for (uint16_t bits = rows[y] & ~covered; bits != 0; bits &= bits - 1)
+            heights[std::countr_zero(bits)] = (uint8_t) (Board::HEIGHT - y);
+        for (uint16_t bits = covered & ~rows[y]; bits != 0; bits &= bits - 1)
+            holes[std::countr_zero(bits)]++;
+        covered |= rows[y];
+    }
+
+    std::memset(inputs, 0, INPUTS);
+    uint8_t* at = inputs;
+    int total_holes = 0;
+    for (int x = 0; x < Board::WIDTH; x++) {
+        *at++ = heights[x];
+        *at++ = holes[x];
+        total_holes += holes[x];
+    }
+    for (int x = 0; x + 1 < Board::WIDTH; x++)
+        *at++ = (uint8_t) std::abs(heights[x + 1] - heights[x]);
+    *at++ = (uint8_t) lines;
+    // The floor counts as filled
+    for (int y = top; y < top + SURFACE_ROWS; y++) {
+        uint16_t row = y < Board::HEIGHT ? rows[y] : FULL_ROW;
+        for (int x = 0; x < Board::WIDTH; x++)
+            *at++ = (row >> x) & 1;
+    }
+    *at++ = (uint8_t) (Board::HEIGHT - top);
+    *at++ = (uint8_t) std::min(total_holes, 127);
+}
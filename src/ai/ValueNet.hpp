@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "../game/Board.hpp"
+
+/*
+ * A small quantized neural network that scores a board after a placement,
+ * as an alternative to the linear Weights.
+ * Its inputs are features of the board: the height and holes of every
+ * column, the differences between neighbouring heights, the lines the
+ * placement clears and the top rows of the stack as bits. Two hidden layers
+ * of HIDDEN int8 weights feed an int16 output layer. Activations are
+ * clamped to 0-127 so they fit in a byte, which lets the AVX2 kernels
+ * multiply 32 of them at a time without ever saturating. On CPUs without
+ * AVX2, or built without the kernels (see TETRIS_AVX2), the same integer
+ * math runs one value at a time and gives exactly the same scores.
+ *
+ * Weight file layout, little endian:
+ *   "TVNN", format version (u32), inputs, hidden (u32 each),
+ *   layer 1 weights (i8, hidden x inputs), layer 1 biases (i32 x hidden),
+ *   layer 2 weights (i8, hidden x hidden), layer 2 biases (i32 x hidden),
+ *   output weights (i16 x hidden), output bias (i32), output scale (f32).
+ * Scores are the output divided by the output scale.
+ */
+class ValueNet {
+public:
+    // Features that mean something, the rest of the inputs are zero
+    static constexpr size_t FEATURES = 72;
+    // Padded to a multiple of 32 for the kernels
+    static constexpr size_t INPUTS = 96;
+    static constexpr size_t HIDDEN = 32;
+    // How far the hidden layers' sums are shifted before clamping
+    static constexpr int ACTIVATION_SHIFT = 6;
+
+    /**
+     * Creates a network with every weight zero, so every board scores 0.
+     * Run load() or randomize() afterwards.
+     */
+    ValueNet ();
+
+    /**
+     * Reads the weights from a file.
+     * @param path Where the weights are.
+     * @return True if the file could be read and fits this network, false
+     * otherwise.
+     */
+    bool load (const std::string& path);
+
+    /**
+     * Writes the weights to a file.
+     * @param path Where to write the weights.
+     * @return True if the whole file was written, false otherwise.
+     */
+    bool save (const std::string& path) const;
+
+    /**
+     * Gives every weight a random value, for testing and benchmarks.
+     * @param random_engine The engine to generate the weights with.
+     */
+    void randomize (RandomEngine& random_engine);
+
+    /**
+     * Scores a batch of boards.
+     * @param inputs INPUTS bytes of features per board, from features().
+     * @param count How many boards there are.
+     * @param scores Set to each board's score, higher is better.
+     */
+    void evaluate (const uint8_t* inputs, size_t count, float* scores) const;
+
+    /**
+     * Same as evaluate(), one value at a time, even on CPUs with AVX2.
+     */
+    void evaluate_scalar (const uint8_t* inputs, size_t count, float* scores) const;
+
+    /**
+     * Gets the locked squares of a board as one bitmask per row, which is
+     * what features() works from.
+     * @param board The board.
+     * @param rows Set to each row's squares, bit x for column x.
+     */
+    static void board_rows (const Board& board, uint16_t rows[Board::HEIGHT]);
+
+    /**
+     * Gets the network's inputs for the board a placement leaves.
+     * @param rows The board from board_rows().
+     * @param anchor Where the piece locks.
+     * @param piece What kind of piece.
+     * @param rot The rotation of the piece.
+     * @param inputs Set to the INPUTS bytes of features.
+     */
+    static void features (
+        const uint16_t rows[Board::HEIGHT], int anchor, int piece, int rot,
+        uint8_t* inputs
+    );
+
+private:
+    /**
+     * Runs the network on one board, one value at a time.
+     * @param inputs The board's features.
+     * @return The output before scaling.
+     */
+    int32_t forward_scalar (const uint8_t* inputs) const;
+
+    /**
+     * evaluate() on the AVX2 kernels. Only compiled in with TETRIS_AVX2, and
+     * only called on CPUs that have AVX2.
+     */
+    void evaluate_avx2 (const uint8_t* inputs, size_t count, float* scores) const;
+
+    alignas(32) int8_t m_w1[HIDDEN][INPUTS];
+    alignas(32) int32_t m_b1[HIDDEN];
+    alignas(32) int8_t m_w2[HIDDEN][HIDDEN];
+    alignas(32) int32_t m_b2[HIDDEN];
+    alignas(32) int16_t m_w3[HIDDEN];
+    int32_t m_b3;
+    float m_scale;
+};
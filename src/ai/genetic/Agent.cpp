@@ -1,20 +1,94 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
 #include "Agent.hpp"
+#include "finesse.hpp"
+#include "surface.hpp"
+#include "../../util/instrument.hpp"
+
+/**
+ * @param a One board.
+ * @param b Another board.
+ * @return True if best_move() would see the same thing on both boards.
+ */
+static bool same_position (const Board& a, const Board& b) {
+    if (a.get_falling_piece() != b.get_falling_piece() ||
+        a.get_falling_piece_rot() != b.get_falling_piece_rot() ||
+        a.get_falling_piece_anchor() != b.get_falling_piece_anchor() ||
+        a.get_held_piece() != b.get_held_piece() ||
+        a.nth_piece(0) != b.nth_piece(0) ||
+        a.get_highest_row() != b.get_highest_row() ||
+        a.game_over() != b.game_over())
+        return false;
+
+    for (uint16_t i = 0; i < Board::TOTAL_SIZE; i++) {
+        if (a.get_square(i) != b.get_square(i))
+            return false;
+    }
+    return true;
+}
 
-Agent::Agent (bool hard_drop, Weights weights)
+Agent::Agent (
+    bool hard_drop, Weights weights, bool think_ahead, uint8_t max_depth
+)
     : m_weights(weights)
     , m_working_move({})
+    , m_last_move({})
+    , m_last_score(0)
     , m_current_piece_num(14)
     , m_fitness()
     , m_hard_drop(hard_drop)
+    , m_max_depth(max_depth)
+    , m_compute_budget_ns(0)
+    , m_bank_ns(0)
+    , m_path_found(false)
+    , m_path_step(0)
+    , m_path_anchor(0)
+    , m_path_rot(0)
+    , m_decision_stats()
+    , m_thinker(think_ahead ? std::make_unique<ThreadPool>(1) : nullptr)
 {}
 
 Input Agent::gen_input (Board* current_board)
 {
+    INSTRUMENT_SCOPE(AGENT_GEN_INPUT);
     Input input = {};
+    // Nothing to place until the board spawns a piece
+    if (current_board->get_falling_piece() == 0)
+        return input;
     if (m_current_piece_num != current_board->get_piece_num())
     {
-        m_working_move = best_move(current_board, m_weights);
+        auto start = std::chrono::steady_clock::now();
+        m_bank_ns = credit_bank(m_bank_ns);
+        Plan plan = {};
+        if (take_prediction(*current_board, plan)) {
+            m_decision_stats.predicted++;
+        } else {
+            uint64_t budget_ns;
+            uint8_t max_depth = choose_depth(current_board, m_bank_ns, budget_ns);
+            plan = plan_move(
+                current_board, m_weights, max_depth, budget_ns,
+                m_net.get(), m_rollouts.get()
+            );
+        }
+        m_bank_ns -= (int64_t) plan.search_ns;
+        m_working_move = plan.move;
+        m_last_move = plan.move;
+        m_last_score = plan.score;
+        m_decision_stats.last_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start
+        ).count();
+        m_decision_stats.last_candidates = (uint32_t) plan.candidates;
+        m_decision_stats.last_depth = plan.depth;
+        m_decision_stats.total_search_ns += plan.search_ns;
+        m_decision_stats.decisions++;
         m_current_piece_num = current_board->get_piece_num();
+
+        m_path_found = false;
+
+        if (m_thinker)
+            think_ahead(*current_board);
     }
 
     if (m_working_move.hold)
@@ -24,6 +98,39 @@ Input Agent::gen_input (Board* current_board)
         return input;
     }
 
+    // Plan again if the piece isn't where the path left it, like after
+    // gravity moved it or a new piece spawned
+    uint16_t anchor = current_board->get_falling_piece_anchor();
+    uint8_t rot = current_board->get_falling_piece_rot();
+    if (!m_path_found || anchor != m_path_anchor || rot != m_path_rot)
+    {
+        m_path_found = plan_path(current_board, m_working_move, m_path);
+        m_path_step = 0;
+    }
+    if (!m_path_found)
+        return steer_greedy(current_board);
+
+    if (m_path_step < m_path.size())
+    {
+        const PathStep& step = m_path[m_path_step++];
+        m_path_anchor = step.anchor;
+        m_path_rot = step.rotation;
+        return step.input;
+    }
+
+    // A hard drop goes before shifts and rotations in an update, so it
+    // gets an update to itself at the end
+    if (m_hard_drop)
+        input.hard_drop = true;
+    else
+        input.soft_drop = true;
+    m_path_found = false;
+    return input;
+}
+
+Input Agent::steer_greedy (Board* current_board)
+{
+    Input input = {};
     uint8_t current_piece = current_board->get_falling_piece();
     uint8_t current_rot = current_board->get_falling_piece_rot();
 
@@ -69,10 +176,170 @@ Input Agent::gen_input (Board* current_board)
         }
     }
 
-
     return input;
 }
 
+void Agent::think_ahead (const Board& current_board) {
+    // Holding spawns a piece that gets its own decision before this move is
+    // placed, so that's the one to think ahead from
+    if (m_working_move.hold) {
+        m_prediction.reset();
+        return;
+    }
+
+    // Play the working move out on a copy, like a hard drop would
+    Board predicted(current_board, m_predict_random);
+    predicted.place_piece(
+        m_working_move.position, m_working_move.rotation, m_working_move.hold
+    );
+    if (predicted.game_over()) {
+        m_prediction.reset();
+        return;
+    }
+    m_prediction = std::make_unique<Board>(predicted);
+
+    // A shared_ptr since the pool only takes copyable tasks. The task gets
+    // its own copies of everything, so it can outlive a prediction that
+    // turned out wrong.
+    auto promise = std::make_shared<std::promise<Plan>>();
+    m_pending = promise->get_future();
+    auto cancel = std::make_shared<std::atomic<bool>>(false);
+    m_pending_cancel = cancel;
+    Weights weights = m_weights;
+    uint64_t budget_ns;
+    // The search is for the next piece, which brings its own budget
+    uint8_t max_depth = choose_depth(&predicted, credit_bank(m_bank_ns), budget_ns);
+    std::shared_ptr<const ValueNet> net = m_net;
+    std::shared_ptr<RolloutEvaluator> rollouts = m_rollouts;
+    m_thinker->submit(
+        [promise, predicted, weights, max_depth, budget_ns, net, rollouts, cancel] () mutable {
+            promise->set_value(plan_move(
+                &predicted, weights, max_depth, budget_ns, net.get(), rollouts.get(),
+                cancel.get()
+            ));
+        }
+    );
+}
+
+Agent::Plan Agent::plan_move (
+    Board* current_board, Weights weights, uint8_t max_depth,
+    uint64_t budget_ns, const ValueNet* net, RolloutEvaluator* rollouts,
+    const std::atomic<bool>* cancel
+) {
+    auto start = std::chrono::steady_clock::now();
+    Plan plan = plan_search(
+        current_board, weights, max_depth, budget_ns, net, rollouts, cancel
+    );
+    plan.search_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+    return plan;
+}
+
+Agent::Plan Agent::plan_search (
+    Board* current_board, Weights weights, uint8_t max_depth,
+    uint64_t budget_ns, const ValueNet* net, RolloutEvaluator* rollouts,
+    const std::atomic<bool>* cancel
+) {
+    Plan plan = {};
+    if (rollouts != nullptr) {
+        RolloutResult result = rollouts->evaluate(current_board, cancel);
+        plan.move = result.move;
+        plan.candidates = result.candidates;
+        plan.depth = (uint8_t) std::min<size_t>(rollouts->get_settings().pieces + 1, UINT8_MAX);
+        plan.score = result.score;
+        return plan;
+    }
+    if (net != nullptr) {
+        plan.move = best_move_net(
+            current_board, *net, &plan.candidates, &plan.score
+        );
+        plan.depth = 1;
+        return plan;
+    }
+    if (max_depth <= 1) {
+        plan.move = best_move(
+            current_board, weights, &plan.candidates, &plan.score
+        );
+        plan.depth = 1;
+        return plan;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::nanoseconds(budget_ns);
+    SearchResult result = anytime_search(
+        current_board, weights, max_depth, deadline
+    );
+    plan.move = result.move;
+    plan.candidates = result.candidates;
+    plan.depth = result.depth;
+    plan.score = result.score;
+    return plan;
+}
+
+uint64_t Agent::search_budget_ns (Board* current_board) {
+    const uint64_t max_ns = MAX_SEARCH_MS * 1000000ull;
+    if (current_board->get_falling_piece() == 0)
+        return max_ns;
+
+    uint8_t rows = Board::row(current_board->get_ghost()) -
+        Board::row(current_board->get_falling_piece_anchor());
+    uint64_t fall_ns = (uint64_t) rows * current_board->get_fall_rate() * 1000000ull;
+    return std::min(fall_ns / 2, max_ns);
+}
+
+int64_t Agent::credit_bank (int64_t bank_ns) const {
+    if (m_compute_budget_ns == 0)
+        return 0;
+    return std::min(
+        bank_ns + (int64_t) m_compute_budget_ns,
+        BANK_PIECES * (int64_t) m_compute_budget_ns
+    );
+}
+
+uint8_t Agent::choose_depth (
+    Board* current_board, int64_t bank_ns, uint64_t& budget_ns
+) const {
+    budget_ns = search_budget_ns(current_board);
+    if (m_compute_budget_ns == 0 || m_max_depth <= 1)
+        return m_max_depth;
+
+    // Overspent, so only the current piece until the bank recovers
+    if (bank_ns <= 0)
+        return 1;
+    budget_ns = std::min(budget_ns, (uint64_t) bank_ns);
+    return 1 + (uint8_t) std::lround(danger(current_board) * (m_max_depth - 1));
+}
+
+double Agent::danger (Board* current_board) {
+    if (current_board->spawns_high())
+        return 1;
+
+    int rows = Board::HEIGHT - current_board->get_highest_row();
+    double height = (double) (rows - SAFE_ROWS) / (Board::VISIBLE_HEIGHT - SAFE_ROWS);
+    double holes = read_surface(current_board).holes_count * HOLE_DANGER;
+    return std::clamp(height + holes, 0.0, 1.0);
+}
+
+bool Agent::take_prediction (const Board& current_board, Plan& plan) {
+    if (!m_prediction || !m_pending.valid())
+        return false;
+
+    bool matches = same_position(*m_prediction, current_board);
+    m_prediction.reset();
+    if (!matches) {
+        // Rollouts hold the evaluator the next search needs, so stop them.
+        // Anything else finishes in the background, nothing waits for it.
+        m_pending_cancel->store(true, std::memory_order_relaxed);
+        m_pending = {};
+        return false;
+    }
+
+    // Usually done already, otherwise still closer than starting over
+    plan = m_pending.get();
+    return true;
+}
+
 void Agent::set_fitness (size_t fitness) {
     m_fitness = fitness;
 }
@@ -84,3 +351,28 @@ size_t Agent::get_fitness () const {
 Weights Agent::get_weights () const {
     return m_weights;
 }
+
+void Agent::set_value_net (std::shared_ptr<const ValueNet> net) {
+    m_net = std::move(net);
+}
+
+void Agent::set_rollouts (std::shared_ptr<RolloutEvaluator> rollouts) {
+    m_rollouts = std::move(rollouts);
+}
+
+void Agent::set_compute_budget (uint64_t average_ns) {
+    m_compute_budget_ns = average_ns;
+    m_bank_ns = 0;
+}
+
+Move Agent::get_last_move () const {
+    return m_last_move;
+}
+
+double Agent::get_last_score () const {
+    return m_last_score;
+}
+
+DecisionStats Agent::get_decision_stats () const {
+    return m_decision_stats;
+}
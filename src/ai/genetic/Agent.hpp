@@ -1,20 +1,117 @@
 #pragma once
 
+#include <atomic>
+#include <future>
+#include <memory>
+#include <random>
+
 #include "eval.hpp"
+#include "finesse.hpp"
+#include "RolloutEvaluator.hpp"
 #include "../Player.hpp"
+#include "../ValueNet.hpp"
+#include "../../util/ThreadPool.hpp"
 
-/* The player in the genetic algorithm */
+/*
+ * The player in the genetic algorithm.
+ * An agent that thinks ahead searches the board its current move will leave
+ * on a background thread while the piece is being steered there. When the
+ * next piece spawns, the board is checked against that prediction, and the
+ * search is only used if they match exactly, so the moves are the same as
+ * without thinking ahead.
+ * An agent with a max depth above 1 uses anytime_search(), with a deadline
+ * that depends on how long the piece takes to fall.
+ * Given a compute budget, the agent picks each piece's depth from how much
+ * danger the board is in instead, searching shallow on a low clean stack and
+ * as deep as it's allowed near the top. Every piece adds the budget to a
+ * time bank and every search takes what it used out of it, so deep searches
+ * are paid for by the shallow ones and the average stays within the budget.
+ * Pieces are steered along the shortest path from plan_path(), rotating and
+ * shifting in the same input where it can.
+ * An agent given a value network scores moves with it instead of its
+ * weights, one piece deep. One given a rollout evaluator leaves every
+ * decision to it instead.
+ */
 class Agent : public Player {
 public:
     /**
      * Creates a new Agent with specific weights.
      * @param hard_drop Whether the agent should always hard drop or always soft drop.
      * @param weights This agent's weights.
+     * @param think_ahead Whether to search the next position on a background
+     * thread while the current piece falls.
+     * @param max_depth How many pieces ahead to search at most, 1 to only
+     * look at the current one.
      */
-    Agent (bool hard_drop, Weights weights);
+    Agent (
+        bool hard_drop, Weights weights, bool think_ahead = false,
+        uint8_t max_depth = 1
+    );
 
     Input gen_input (Board* current_board) override;
 
+    DecisionStats get_decision_stats () const override;
+
+    /**
+     * Scores moves with a value network from now on, instead of the weights.
+     * @param net The network, shared so many agents can use one copy, or
+     * nullptr to go back to the weights.
+     */
+    void set_value_net (std::shared_ptr<const ValueNet> net);
+
+    /**
+     * Decides moves by playing candidates out from now on. Meant for slow
+     * gravity, since each decision takes many whole rollouts.
+     * @param rollouts The evaluator, or nullptr to go back to searching.
+     */
+    void set_rollouts (std::shared_ptr<RolloutEvaluator> rollouts);
+
+    /**
+     * Picks the depth of every search from the danger the board is in, up
+     * to the max depth, spending about a set time per piece on average.
+     * @param average_ns The time to spend per piece, 0 to always search as
+     * deep as the max depth.
+     */
+    void set_compute_budget (uint64_t average_ns);
+
+    /**
+     * Adds a piece's compute budget to a time bank.
+     * @param bank_ns What's in the bank.
+     * @return What's in it after, no more than BANK_PIECES pieces' worth.
+     */
+    int64_t credit_bank (int64_t bank_ns) const;
+
+    /**
+     * Picks how deep to search a board and for how long.
+     * @param current_board The board to search.
+     * @param bank_ns What's in the time bank for the search.
+     * @param budget_ns Set to how long a deeper search can take.
+     * @return How many pieces ahead to search at most.
+     */
+    uint8_t choose_depth (
+        Board* current_board, int64_t bank_ns, uint64_t& budget_ns
+    ) const;
+
+    /**
+     * How close a board is to topping out, from how high the stack is, how
+     * many holes it has and whether pieces spawn in the vanish zone.
+     * @param current_board The board.
+     * This method does not modify the Board object.
+     * @return 0 for a low stack without holes, up to 1 for one about to top
+     * out.
+     */
+    static double danger (Board* current_board);
+
+    /**
+     * @return The move the agent last decided on.
+     */
+    Move get_last_move () const;
+
+    /**
+     * @return What the search scored the last move at, higher is better.
+     */
+    double get_last_score () const;
+
     /**
     * Set the Agent's fitness score.
     * @param fitness the fitness core.
@@ -31,11 +128,119 @@ public:
     */
     Weights get_weights () const;
 
+    /**
+     * How long a deeper search can take for the falling piece: half the time
+     * it takes to fall to where it would land, leaving the rest for steering
+     * it, and no more than MAX_SEARCH_MS.
+     * @param current_board The board with the piece to search for.
+     * @return The time budget in nanoseconds.
+     */
+    static uint64_t search_budget_ns (Board* current_board);
+
+    // Longest a single search can take, even at low gravity
+    static constexpr uint32_t MAX_SEARCH_MS = 100;
+
+    // Rows a stack can reach before it counts as any danger
+    static constexpr uint8_t SAFE_ROWS = 6;
+    // Danger each hole adds
+    static constexpr double HOLE_DANGER = 0.05;
+    // Most unused budget the time bank keeps, in pieces
+    static constexpr int64_t BANK_PIECES = 10;
+
 private:
+    /* The result of a search */
+    struct Plan {
+        Move move;
+        size_t candidates;
+        uint8_t depth;
+        double score;
+        uint64_t search_ns;
+    };
+
+    /**
+     * Searches a board as deep as the agent is set to.
+     * @param current_board The board to search.
+     * @param weights The weights to score boards with.
+     * @param max_depth How many pieces ahead to search at most.
+     * @param budget_ns How long a deeper search can take.
+     * @param net The network to score boards with instead, or nullptr.
+     * @param rollouts The evaluator to decide with instead, or nullptr.
+     * @param cancel Stops the rollouts of a search nobody needs anymore, or
+     * nullptr. Other searches are short enough to finish.
+     * @return The best move found.
+     */
+    static Plan plan_move (
+        Board* current_board, Weights weights, uint8_t max_depth,
+        uint64_t budget_ns, const ValueNet* net, RolloutEvaluator* rollouts,
+        const std::atomic<bool>* cancel = nullptr
+    );
+
+    /**
+     * Same as plan_move(), without timing the search.
+     */
+    static Plan plan_search (
+        Board* current_board, Weights weights, uint8_t max_depth,
+        uint64_t budget_ns, const ValueNet* net, RolloutEvaluator* rollouts,
+        const std::atomic<bool>* cancel
+    );
+
+    /**
+     * Steers one step at a time by comparing the piece to the working move,
+     * for when there's no path to it.
+     * @param current_board The current board state.
+     * @return The input for this step.
+     */
+    Input steer_greedy (Board* current_board);
+
+    /**
+     * Starts searching the board the working move will leave, on the
+     * background thread.
+     * @param current_board The current board state.
+     */
+    void think_ahead (const Board& current_board);
+
+    /**
+     * Takes the search started by think_ahead() if it was for this board.
+     * @param current_board The board with a new piece that needs a move.
+     * @param plan Set to the search result if it could be used.
+     * @return True if the prediction matched the board, false otherwise.
+     */
+    bool take_prediction (const Board& current_board, Plan& plan);
+
     Weights m_weights;
     size_t m_fitness;
 
     Move m_working_move;
+    Move m_last_move;
+    double m_last_score;
     uint8_t m_current_piece_num;
     bool m_hard_drop;
+    uint8_t m_max_depth;
+    // 0 unless the depth is picked from the danger
+    uint64_t m_compute_budget_ns;
+    // Budget left over from earlier pieces, below 0 after overrunning it
+    int64_t m_bank_ns;
+    std::shared_ptr<const ValueNet> m_net;
+    std::shared_ptr<RolloutEvaluator> m_rollouts;
+
+    // The inputs steering the falling piece to the working move
+    bool m_path_found;
+    std::vector<PathStep> m_path;
+    size_t m_path_step;
+    // Where the last input given should have left the piece
+    uint16_t m_path_anchor;
+    uint8_t m_path_rot;
+
+    DecisionStats m_decision_stats;
+
+    // Only shuffles bags on predicted boards, so the real game isn't affected
+    RandomEngine m_predict_random;
+    // The board the pending search is for
+    std::unique_ptr<Board> m_prediction;
+    std::future<Plan> m_pending;
+    // Set when the pending search turns out to be for the wrong board
+    std::shared_ptr<std::atomic<bool>> m_pending_cancel;
+    // Only set up when thinking ahead. Last so it's destroyed first, before
+    // anything a running search could still see.
+    std::unique_ptr<ThreadPool> m_thinker;
 };
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "RolloutEvaluator.hpp"
+#include "../../game/BoardSnapshot.hpp"
+#include "../../util/mix.hpp"
+#include "../../util/trace.hpp"
+
+/* The rollouts of one candidate so far */
+struct CandidateStats {
+    Move move;
+    double sum;
+    double sum_squares;
+    size_t survived;
+    size_t count;
+    bool dropped;
+
+    [[nodiscard]] double mean () const {
+        return sum / (double) count;
+    }
+
+    [[nodiscard]] double standard_error () const {
+        if (count < 2)
+            return INFINITY;
+        double variance = (sum_squares - sum * sum / (double) count) / (double) (count - 1);
+        return std::sqrt(std::max(variance, 0.0) / (double) count);
+    }
+};
+
+RolloutEvaluator::RolloutEvaluator (
+    Weights weights, RolloutSettings settings, size_t thread_count
+)
+    : m_weights(weights)
+    , m_settings(settings)
+    , m_evaluations(0)
+    , m_pool(thread_count)
+{
+    m_settings.batch = std::max<size_t>(m_settings.batch, 1);
+}
+
+RolloutResult RolloutEvaluator::evaluate (
+    Board* current_board, const std::atomic<bool>* cancel
+) {
+    TRACE_SCOPE("rollouts", "eval");
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t evaluation_seed = mix(m_settings.seed + m_evaluations++);
+    auto cancelled = [cancel] () {
+        return cancel != nullptr && cancel->load(std::memory_order_relaxed);
+    };
+
+    RolloutResult result = {};
+    std::vector<ScoredMove> ranked = rank_moves(
+        current_board, m_weights, std::max<size_t>(m_settings.candidates, 1)
+    );
+    if (ranked.empty())
+        return result;
+    result.move = ranked[0].move;
+    result.score = ranked[0].score;
+    result.survival = 1;
+    // Nothing to compare
+    if (ranked.size() == 1 || m_settings.rollouts == 0 || cancelled())
+        return result;
+
+    std::vector<CandidateStats> candidates;
+    for (const ScoredMove& scored : ranked)
+        candidates.push_back({scored.move, 0, 0, 0, 0, false});
+    result.candidates = candidates.size();
+
+    std::vector<Sample> samples;
+    size_t played = 0, remaining = candidates.size();
+    while (played < m_settings.rollouts && remaining > 1) {
+        const size_t batch = std::min(m_settings.batch, m_settings.rollouts - played);
+        samples.assign(candidates.size() * batch, {});
+        for (size_t c = 0; c < candidates.size(); c++) {
+            if (candidates[c].dropped)
+                continue;
+            for (size_t b = 0; b < batch; b++) {
+                auto seed = (uint32_t) mix(evaluation_seed + played + b);
+                // Every task has its own board copy and its own sample, and
+                // they're all done before wait() returns
+                m_pool.submit([this, current_board, &candidates, &samples, c, b, batch, seed, cancelled] () {
+                    if (!cancelled())
+                        samples[c * batch + b] = rollout(*current_board, candidates[c].move, seed);
+                });
+            }
+        }
+        m_pool.wait();
+        // Part of the batch never ran, so its samples mean nothing
+        if (cancelled())
+            return result;
+        played += batch;
+
+        double best_floor = -INFINITY;
+        for (size_t c = 0; c < candidates.size(); c++) {
+            CandidateStats& stats = candidates[c];
+            if (stats.dropped)
+                continue;
+            for (size_t b = 0; b < batch; b++) {
+                const Sample& sample = samples[c * batch + b];
+                double value = sample.lines - (sample.survived ? 0 : m_settings.death_penalty);
+                stats.sum += value;
+                stats.sum_squares += value * value;
+                stats.survived += sample.survived;
+                stats.count++;
+            }
+            result.rollouts += batch;
+            best_floor = std::max(
+                best_floor, stats.mean() - m_settings.confidence * stats.standard_error()
+            );
+        }
+
+        // Drop anything that can't catch up with the best candidate
+        for (CandidateStats& stats : candidates) {
+            if (!stats.dropped &&
+                stats.mean() + m_settings.confidence * stats.standard_error() < best_floor) {
+                stats.dropped = true;
+                remaining--;
+            }
+        }
+    }
+    result.separated = remaining == 1 && played < m_settings.rollouts;
+
+    // Ties go to the candidate the weights liked best
+    const CandidateStats* best = nullptr;
+    for (const CandidateStats& stats : candidates) {
+        if (!stats.dropped && (best == nullptr || stats.mean() > best->mean()))
+            best = &stats;
+    }
+    result.move = best->move;
+    result.score = best->mean();
+    result.survival = (double) best->survived / (double) best->count;
+    return result;
+}
+
+RolloutEvaluator::Sample RolloutEvaluator::rollout (
+    const Board& current_board, const Move& move, uint32_t seed
+) const {
+    RandomEngine random_engine(seed);
+    Board board(current_board, random_engine);
+    // Only the queue a player sees is known, the rest of the bags could be
+    // in any order
+    board.shuffle_unseen(BoardSnapshot::QUEUE_SIZE);
+    board.place_piece(move.position, move.rotation, move.hold);
+
+    Weights weights = m_weights;
+    for (uint16_t i = 0; i < m_settings.pieces && !board.game_over(); i++) {
+        Move next = best_move(&board, weights);
+        board.place_piece(next.position, next.rotation, next.hold);
+    }
+    return {
+        (double) (board.get_lines_cleared() - current_board.get_lines_cleared()),
+        !board.game_over()
+    };
+}
+
+const RolloutSettings& RolloutEvaluator::get_settings () const {
+    return m_settings;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "eval.hpp"
+#include "../../game/Board.hpp"
+#include "../../util/ThreadPool.hpp"
+
+/* How RolloutEvaluator plays its candidates out */
+struct RolloutSettings {
+    size_t candidates;     // How many of best_move()'s top moves to try
+    size_t rollouts;       // Most rollouts per candidate
+    size_t batch;          // Rollouts per candidate between checks for a clear winner
+    uint16_t pieces;       // Pieces placed in each rollout after the candidate
+    double death_penalty;  // Lines a rollout loses for topping out
+    double confidence;     // Standard errors apart candidates need to be to drop one
+    uint32_t seed;
+};
+
+/* What RolloutEvaluator settled on */
+struct RolloutResult {
+    Move move;
+    size_t candidates;  // Moves that were played out
+    size_t rollouts;    // Rollouts played over every candidate
+    double score;       // Average lines of the move's rollouts, less deaths
+    double survival;    // How many of its rollouts didn't top out, 0-1
+    bool separated;     // Whether one candidate pulled clearly ahead before the last rollout
+};
+
+/*
+ * Scores the best few candidates of best_move() by playing each of them out
+ * a number of times and averaging how they went, which catches trouble that
+ * only shows up a few pieces later.
+ * Each rollout places the candidate on its own copy of the board, then
+ * keeps placing pieces with best_move() as a cheap greedy policy. Copies get
+ * their own random engine and reshuffle every piece past the visible queue,
+ * so each rollout plays a different 7-bag future the player couldn't rule
+ * out. Rollout n uses the same pieces for every candidate, so candidates are
+ * compared on equal terms.
+ * Rollouts run on a thread pool in batches. After every batch, candidates
+ * whose average is confidence standard errors below the best one's are
+ * dropped, and the evaluation stops once only one is left.
+ * Much too slow for fast games, this is for measuring how good moves are
+ * offline and for playing at low gravity.
+ */
+class RolloutEvaluator {
+public:
+    /**
+     * Creates an evaluator and starts its threads.
+     * @param weights The weights to rank candidates and play rollouts with.
+     * @param settings How to play candidates out.
+     * @param thread_count How many threads to run rollouts on, 0 for one per
+     * core.
+     */
+    RolloutEvaluator (
+        Weights weights, RolloutSettings settings, size_t thread_count = 0
+    );
+
+    /**
+     * Picks a move for a board.
+     * Safe to call from many threads, the calls take turns.
+     * @param current_board The current board state.
+     * This method does not modify the Board object.
+     * @param cancel Set by another thread to stop an evaluation nobody needs
+     * anymore, so it lets go of the evaluator. Rollouts not started yet are
+     * skipped and the best ranked candidate is returned. May be nullptr.
+     * @return The best candidate and how its rollouts went.
+     */
+    RolloutResult evaluate (Board* current_board, const std::atomic<bool>* cancel = nullptr);
+
+    /**
+     * @return The settings the evaluator plays with.
+     */
+    [[nodiscard]] const RolloutSettings& get_settings () const;
+
+    // Rollouts per candidate and the other defaults for live play
+    static constexpr RolloutSettings DEFAULT_SETTINGS = {
+        .candidates = 4,
+        .rollouts = 64,
+        .batch = 8,
+        .pieces = 20,
+        .death_penalty = 20,
+        .confidence = 3,
+        .seed = 0
+    };
+
+private:
+    /* How one rollout went */
+    struct Sample {
+        double lines;
+        bool survived;
+    };
+
+    /**
+     * Plays one candidate out.
+     * @param current_board The board before the candidate.
+     * @param move The candidate.
+     * @param seed Picks the pieces after the visible queue.
+     * @return How it went.
+     */
+    Sample rollout (const Board& current_board, const Move& move, uint32_t seed) const;
+
+    Weights m_weights;
+    RolloutSettings m_settings;
+    // Evaluations so far, so every one samples different pieces
+    uint64_t m_evaluations;
+    std::mutex m_mutex;
+
+    ThreadPool m_pool;
+};
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <vector>
+
+#include "batch.hpp"
+#include "surface.hpp"
+#include "../../util/trace.hpp"
+
+/**
+ * @param piece Which piece.
+ * @return How many rotations generate_moves() tries for the piece.
+ */
+static uint8_t rotations (uint8_t piece) {
+    switch (piece) {
+        case O_PIECE:
+            return 1;
+        case S_PIECE:
+        case Z_PIECE:
+        case I_PIECE:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+/**
+ * analyze_board() on a game of a batch, for the candidates that don't rest
+ * on the surface.
+ * @param batch The games.
+ * @param lane Which game.
+ * @param piece_anchor Where the proposed move would end.
+ * @param piece Which piece the move is with.
+ * @param piece_rot The rotation of the piece after the move.
+ * @return The same heuristics as analyze_board().
+ */
+static BoardAnalysis analyze_lane (
+    const BoardBatch& batch, size_t lane, int piece_anchor, int piece, int piece_rot
+) {
+    uint16_t piece_rows[Board::HEIGHT] = {};
+    for (int i = 0; i < 4; i++) {
+        int idx = piece_anchor + tetromino_data::get_piece_map(piece, piece_rot, i);
+        piece_rows[Board::row(idx)] |= 1 << Board::col(idx);
+    }
+
+    BoardAnalysis vals = {};
+    vals.highest_point = std::min(batch.get_highest_row(lane), Board::row(piece_anchor));
+
+    int column_heights[Board::WIDTH];
+    int column_holes[Board::WIDTH] = {};
+    std::fill_n(column_heights, Board::WIDTH, Board::HEIGHT);
+    for (int y = vals.highest_point; y < Board::HEIGHT; y++) {
+        uint16_t bits = batch.get_row(y)[lane] | piece_rows[y];
+        for (int x = 0; x < Board::WIDTH; x++) {
+            bool square_filled = (bits >> x) & 1;
+            if (square_filled && column_heights[x] == Board::HEIGHT)
+                column_heights[x] = y;
+
+            if (square_filled) {
+                vals.aggregate_height++;
+            } else if (column_heights[x] < 24) {
+                column_holes[x]++;
+                vals.blocks_over_holes += (y - column_heights[x]) - column_holes[x];
+            }
+        }
+        if (bits == BoardBatch::FULL_ROW)
+            vals.complete_lines++;
+    }
+
+    for (int holes : column_holes)
+        vals.holes_count += holes;
+    vals.height_std_dev = get_height_std_dev(column_heights);
+    vals.highest_point = Board::HEIGHT - vals.highest_point;
+    return vals;
+}
+
+/**
+ * read_surface() for every running game of a batch at once.
+ * @param batch The games.
+ * @param surfaces Set to the surface of each lane.
+ */
+static void read_surfaces (const BoardBatch& batch, std::vector<Surface>& surfaces) {
+    const size_t lanes = batch.get_running();
+    surfaces.assign(lanes, {});
+    std::vector<uint8_t> holes(Board::WIDTH * lanes, 0);
+    std::vector<uint8_t> blocks_over_holes(lanes, 0);
+
+    for (uint8_t y = 0; y < Board::HEIGHT; y++) {
+        const uint16_t* bits = batch.get_row(y);
+        for (uint8_t x = 0; x < Board::WIDTH; x++) {
+            const uint8_t* heights = batch.get_heights(x);
+            uint8_t* column_holes = &holes[x * lanes];
+            for (size_t lane = 0; lane < lanes; lane++) {
+                // Open and under the top of the column, counted like
+                // read_surface() does
+                bool hole = ((bits[lane] >> x) & 1) == 0 && heights[lane] > Board::HEIGHT - y;
+                column_holes[lane] += hole;
+                blocks_over_holes[lane] += hole
+                    ? (y - (Board::HEIGHT - heights[lane])) - column_holes[lane]
+                    : 0;
+            }
+        }
+        for (size_t lane = 0; lane < lanes; lane++)
+            surfaces[lane].row_fill[y] = std::popcount(bits[lane]);
+    }
+
+    for (size_t lane = 0; lane < lanes; lane++) {
+        Surface& surface = surfaces[lane];
+        for (uint8_t x = 0; x < Board::WIDTH; x++) {
+            surface.heights[x] = batch.get_heights(x)[lane];
+            surface.holes[x] = holes[x * lanes + lane];
+            surface.holes_count += surface.holes[x];
+        }
+        for (uint8_t y = 0; y < Board::HEIGHT; y++)
+            surface.filled += surface.row_fill[y];
+        surface.blocks_over_holes = blocks_over_holes[lane];
+        surface.highest_row = batch.get_highest_row(lane);
+    }
+}
+
+void best_moves (BoardBatch& batch, const Weights& weights, BatchMove* moves) {
+    TRACE_SCOPE("best_moves", "eval");
+    const size_t lanes = batch.get_running();
+    std::vector<Surface> surfaces;
+    read_surfaces(batch, surfaces);
+
+    // Treat the next piece up as the held piece if nothing is held
+    std::vector<uint8_t> current_pieces(lanes), held_pieces(lanes);
+    for (size_t lane = 0; lane < lanes; lane++) {
+        current_pieces[lane] = batch.get_falling_piece(lane);
+        held_pieces[lane] = batch.get_held_piece(lane);
+        if (held_pieces[lane] == 0)
+            held_pieces[lane] = batch.nth_piece(lane, 0);
+    }
+
+    std::vector<uint8_t> pieces(lanes);
+    std::vector<BatchMove> candidates(lanes);
+    std::vector<int8_t> rows(lanes);
+    std::vector<double> best_scores(lanes, -DBL_MAX);
+    std::fill_n(moves, lanes, BatchMove{});
+
+    // Slots go in the same order as generate_moves(), so ties go the same way
+    for (int hold = 0; hold < 2; hold++) {
+        for (uint8_t rot = 0; rot < 4; rot++) {
+            for (int8_t column = -2; column < Board::WIDTH - 1; column++) {
+                for (size_t lane = 0; lane < lanes; lane++) {
+                    pieces[lane] = hold ? held_pieces[lane] : current_pieces[lane];
+                    // Rotations past the piece's count are out of bounds
+                    bool skip = rot >= rotations(pieces[lane]) ||
+                        (hold && held_pieces[lane] == current_pieces[lane]);
+                    candidates[lane] = {
+                        .rotation = skip ? (uint8_t) 4 : rot,
+                        .column = column,
+                        .hold = hold == 1
+                    };
+                }
+                batch.drop(pieces.data(), candidates.data(), rows.data());
+
+                for (size_t lane = 0; lane < lanes; lane++) {
+                    if (rows[lane] < 0)
+                        continue;
+                    int anchor = rows[lane] * Board::WIDTH + column;
+                    BoardAnalysis analysis;
+                    if (!analyze_surface(surfaces[lane], anchor, pieces[lane], rot, analysis))
+                        analysis = analyze_lane(batch, lane, anchor, pieces[lane], rot);
+                    double score = score_analysis(analysis, weights);
+                    if (score > best_scores[lane]) {
+                        best_scores[lane] = score;
+                        moves[lane] = candidates[lane];
+                    }
+                }
+            }
+        }
+    }
+}
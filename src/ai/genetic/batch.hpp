@@ -0,0 +1,15 @@
+#pragma once
+
+#include "eval.hpp"
+#include "../../game/BoardBatch.hpp"
+
+/**
+ * best_move() for every running game of a batch at once.
+ * Candidates are dropped in all the games together, slot by slot, and
+ * scored from surfaces read from the whole batch in one pass. Each game gets
+ * the move best_move() would pick on the same board.
+ * @param batch The games.
+ * @param weights The set of weights to use for each eval parameter.
+ * @param moves Set to the best move of each lane below get_running().
+ */
+void best_moves (BoardBatch& batch, const Weights& weights, BatchMove* moves);
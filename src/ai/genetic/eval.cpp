@@ -1,19 +1,18 @@
+#include <algorithm>
 #include <cmath>
+#include <random>
 #include <vector>
 #include <cfloat>
 
 #include "eval.hpp"
+#include "surface.hpp"
+#include "../PackedPosition.hpp"
+#include "../ValueNet.hpp"
 #include "../../game/Board.hpp"
 #include "../../game/tetrominoes.hpp"
-
-struct BoardAnalysis {
-    uint8_t holes_count;         // Open squares with filled squares above
-    uint16_t aggregate_height;   // The total number of filled squares
-    uint8_t complete_lines;      // Amount of lines to be cleared
-    double height_std_dev;       // Flatter board = better
-    uint8_t highest_point;       // Highest point reached
-    uint8_t blocks_over_holes;   // How many blocks are above holes in the board
-};
+#include "../../util/ShardReader.hpp"
+#include "../../util/instrument.hpp"
+#include "../../util/trace.hpp"
 
 /**
  * @param highest_points An array of the highest points in each column.
@@ -34,18 +33,10 @@ double get_height_std_dev (const int highest_points[Board::WIDTH]) {
     return std::sqrt(standard_dev / Board::WIDTH);
 }
 
-/**
- * Runs each of the heuristics on the current board with a hypothetical move.
- * @param current_board The current board state.
- * This method does not modify the Board object.
- * @param piece_anchor Where the proposed move would end.
- * @param piece Which piece the move is with.
- * @param piece_rot The rotation of the piece after the move.
- * @return A BoardAnalysis object with various heuristics
- */
 BoardAnalysis analyze_board (
     Board* current_board, int piece_anchor, int piece, int piece_rot
 ) {
+    INSTRUMENT_SCOPE(ANALYZE_BOARD);
     int piece_squares[4] = {};
     int square_idx = 0;
     for (int i = 0; i < 4; i++) {
@@ -126,18 +117,10 @@ bool valid_start (
     return true;
 }
 
-/**
- * Gets all possible "hard drop" moves on the current board
- * @param current_board The current board state.
- * This method does not modify the Board object.
- * @param current_piece The current falling piece.
- * @param held_piece The held piece or the next piece up if no piece is held.
- * @return A vec of Move objects, each with an ending anchor, 
- * rotation, and if it includes a hold
- */
 std::vector<Move> generate_moves (
     Board* current_board, uint8_t current_piece, uint8_t held_piece
 ) {
+    INSTRUMENT_SCOPE(GENERATE_MOVES);
     std::vector<Move> move_list;
     for (int8_t piece : {current_piece, held_piece}) {
         uint8_t num_rot;
@@ -171,18 +154,82 @@ std::vector<Move> generate_moves (
                 move_list.push_back({
                     .position = ending_pos,
                     .rotation = rot,
-                    .hold = piece == held_piece
+                    .hold = piece != current_piece
                 });
             }
         }
-        if (current_piece == held_piece)
+        // A hold move after a hold would place the falling piece where the
+        // held one fits
+        if (current_piece == held_piece || !current_board->can_hold())
             break;
     }
 
+    INSTRUMENT_COUNT(CANDIDATE_MOVES, move_list.size());
     return move_list;
 }
 
-Move best_move (Board* current_board, Weights& weights) {
+size_t perft (Board* current_board, uint8_t depth) {
+    if (depth == 0 || current_board->game_over())
+        return depth == 0;
+
+    uint8_t current_piece = current_board->get_falling_piece();
+    uint8_t held_piece = current_board->get_held_piece();
+    if (held_piece == 0)
+        held_piece = current_board->nth_piece(0);
+
+    std::vector<Move> move_list = generate_moves(
+        current_board, current_piece, held_piece
+    );
+    // Every move is one position, no need to play them out
+    if (depth == 1)
+        return move_list.size();
+
+    size_t nodes = 0;
+    for (Move& move : move_list) {
+        // Every child shuffles from where this board's engine is, and leaves
+        // the engine as it was
+        RandomEngine random_engine = current_board->get_random_engine();
+        Board next_board(*current_board, random_engine);
+        next_board.place_piece(move.position, move.rotation, move.hold);
+        nodes += perft(&next_board, depth - 1);
+    }
+    return nodes;
+}
+
+double score_analysis (const BoardAnalysis& analysis, const Weights& weights) {
+    return analysis.holes_count * weights.holes_count +
+           analysis.aggregate_height * weights.aggregate_height +
+           analysis.complete_lines * weights.complete_lines +
+           analysis.height_std_dev * weights.height_std_dev +
+           analysis.highest_point * weights.highest_point +
+           analysis.blocks_over_holes * weights.blocks_over_holes;
+}
+
+/**
+ * Scores a candidate from the board's surface, or the board itself if it
+ * doesn't rest on the surface.
+ * @param current_board The current board state.
+ * @param surface The board's surface from read_surface().
+ * @param move The candidate.
+ * @param piece Which piece the move is with.
+ * @param weights How much each heuristic counts.
+ * @return The weighted score of the board the move leaves.
+ */
+static double score_move (
+    Board* current_board, const Surface& surface, const Move& move, int piece,
+    const Weights& weights
+) {
+    BoardAnalysis analysis;
+    if (!analyze_surface(surface, move.position, piece, move.rotation, analysis))
+        analysis = analyze_board(current_board, move.position, piece, move.rotation);
+    return score_analysis(analysis, weights);
+}
+
+Move best_move (
+    Board* current_board, const Weights& weights, size_t* candidate_count, double* score
+) {
+    INSTRUMENT_SCOPE(BEST_MOVE);
+    TRACE_SCOPE("best_move", "eval");
     uint8_t current_piece = current_board->get_falling_piece();
     uint8_t held_piece = current_board->get_held_piece();
     // Treat the next piece up as the held piece if nothing is held
@@ -192,26 +239,221 @@ Move best_move (Board* current_board, Weights& weights) {
     std::vector<Move> move_list = generate_moves(
         current_board, current_piece, held_piece
     );
+    if (candidate_count != nullptr)
+        *candidate_count = move_list.size();
     Move best_move = {};
     double best_score = -DBL_MAX;
 
+    // Most candidates can be scored from the surface alone
+    Surface surface = read_surface(current_board);
     for (Move& move : move_list) {
         int piece = move.hold ? held_piece : current_piece;
-        BoardAnalysis analysis = analyze_board(
-            current_board, move.position, piece, move.rotation
+        double move_score = score_move(current_board, surface, move, piece, weights);
+        if (move_score > best_score) {
+            best_score = move_score;
+            best_move = move;
+        }
+    }
+
+    if (score != nullptr)
+        *score = best_score;
+    return best_move;
+}
+
+std::vector<ScoredMove> rank_moves (
+    Board* current_board, const Weights& weights, size_t count
+) {
+    uint8_t current_piece = current_board->get_falling_piece();
+    uint8_t held_piece = current_board->get_held_piece();
+    if (held_piece == 0)
+        held_piece = current_board->nth_piece(0);
+
+    std::vector<Move> move_list = generate_moves(
+        current_board, current_piece, held_piece
+    );
+    std::vector<ScoredMove> ranked;
+    ranked.reserve(move_list.size());
+    Surface surface = read_surface(current_board);
+    for (const Move& move : move_list) {
+        int piece = move.hold ? held_piece : current_piece;
+        ranked.push_back({move, score_move(current_board, surface, move, piece, weights)});
+    }
+
+    // Stable, so the first of equal moves stays first like in best_move()
+    std::stable_sort(ranked.begin(), ranked.end(), [] (const ScoredMove& a, const ScoredMove& b) {
+        return a.score > b.score;
+    });
+    if (ranked.size() > count)
+        ranked.resize(count);
+    return ranked;
+}
+
+Move best_move_net (
+    Board* current_board, const ValueNet& net, size_t* candidate_count, double* score
+) {
+    TRACE_SCOPE("best_move_net", "eval");
+    uint8_t current_piece = current_board->get_falling_piece();
+    uint8_t held_piece = current_board->get_held_piece();
+    if (held_piece == 0)
+        held_piece = current_board->nth_piece(0);
+
+    std::vector<Move> move_list = generate_moves(
+        current_board, current_piece, held_piece
+    );
+    if (candidate_count != nullptr)
+        *candidate_count = move_list.size();
+
+    // Kept between calls so scoring a board doesn't allocate
+    thread_local std::vector<uint8_t> inputs;
+    thread_local std::vector<float> scores;
+    inputs.resize(move_list.size() * ValueNet::INPUTS);
+    scores.resize(move_list.size());
+    uint16_t rows[Board::HEIGHT];
+    ValueNet::board_rows(*current_board, rows);
+    for (size_t i = 0; i < move_list.size(); i++) {
+        const Move& move = move_list[i];
+        ValueNet::features(
+            rows, move.position, move.hold ? held_piece : current_piece,
+            move.rotation, &inputs[i * ValueNet::INPUTS]
         );
+    }
+    net.evaluate(inputs.data(), move_list.size(), scores.data());
+
+    Move best_move = {};
+    double best_score = -DBL_MAX;
+    for (size_t i = 0; i < move_list.size(); i++) {
+        if (scores[i] > best_score) {
+            best_score = scores[i];
+            best_move = move_list[i];
+        }
+    }
+    if (score != nullptr)
+        *score = best_score;
+    return best_move;
+}
+
+/* Everything the levels of one anytime search share */
+struct SearchState {
+    const Weights& weights;
+    std::chrono::steady_clock::time_point deadline;
+    size_t nodes;
+    bool stopped;
+    // Shuffles bags on the copies, so searching never changes the real
+    // game's pieces
+    RandomEngine random;
+};
+
+// Leaf placements scored between looking at the clock
+constexpr size_t DEADLINE_CHECK_NODES = 256;
+
+/**
+ * Finds the best score reachable by placing a number of pieces.
+ * @param current_board The board to place pieces on.
+ * @param state The search this is part of.
+ * @param depth How many more pieces to place.
+ * @param best If not nullptr, set to the first move of the best placements.
+ * @return The best score, or -DBL_MAX if every way tops out.
+ * Meaningless once state.stopped is set.
+ */
+static double search (
+    Board* current_board, SearchState& state, uint8_t depth, Move* best
+) {
+    uint8_t current_piece = current_board->get_falling_piece();
+    uint8_t held_piece = current_board->get_held_piece();
+    if (held_piece == 0)
+        held_piece = current_board->nth_piece(0);
 
-        double score = analysis.holes_count * weights.holes_count +
-                       analysis.aggregate_height * weights.aggregate_height +
-                       analysis.complete_lines * weights.complete_lines +
-                       analysis.height_std_dev * weights.height_std_dev +
-                       analysis.highest_point * weights.highest_point +
-                       analysis.blocks_over_holes * weights.blocks_over_holes;
+    std::vector<Move> move_list = generate_moves(
+        current_board, current_piece, held_piece
+    );
+    double best_score = -DBL_MAX;
+    Surface surface = {};
+    if (depth == 1)
+        surface = read_surface(current_board);
+
+    for (Move& move : move_list) {
+        double score;
+        if (depth == 1) {
+            int piece = move.hold ? held_piece : current_piece;
+            score = score_move(current_board, surface, move, piece, state.weights);
+            if (++state.nodes % DEADLINE_CHECK_NODES == 0 &&
+                std::chrono::steady_clock::now() >= state.deadline)
+                state.stopped = true;
+        } else {
+            Board next_board(*current_board, state.random);
+            next_board.place_piece(move.position, move.rotation, move.hold);
+            if (next_board.game_over())
+                continue;
+            size_t lines = next_board.get_lines_cleared() - 
+                current_board->get_lines_cleared();
+            score = lines * state.weights.complete_lines +
+                search(&next_board, state, depth - 1, nullptr);
+        }
+
+        if (state.stopped)
+            return best_score;
         if (score > best_score) {
             best_score = score;
-            best_move = move;
+            if (best != nullptr)
+                *best = move;
         }
     }
 
-    return best_move;
+    return best_score;
+}
+
+SearchResult anytime_search (
+    Board* current_board, const Weights& weights, uint8_t max_depth,
+    std::chrono::steady_clock::time_point deadline
+) {
+    TRACE_SCOPE("anytime_search", "eval");
+    SearchResult result = {};
+    result.move = best_move(
+        current_board, weights, &result.candidates, &result.score
+    );
+    result.depth = 1;
+    result.nodes = result.candidates;
+
+    SearchState state = {weights, deadline, result.nodes, false, {}};
+    // Past 7 the last pieces would come from a bag that isn't shuffled yet
+    max_depth = std::min<uint8_t>(max_depth, 7);
+    for (uint8_t depth = 2; depth <= max_depth; depth++) {
+        if (std::chrono::steady_clock::now() >= deadline)
+            break;
+        Move move = {};
+        double score = search(current_board, state, depth, &move);
+        // Keep the last move if this depth was cut off or every move loses
+        if (state.stopped || score == -DBL_MAX)
+            break;
+        result.move = move;
+        result.depth = depth;
+        result.score = score;
+    }
+
+    result.nodes = state.nodes;
+    return result;
+}
+
+DatasetAgreement dataset_agreement (const ShardReader& reader, const Weights& weights) {
+    TRACE_SCOPE("dataset_agreement", "eval");
+    DatasetAgreement agreement = {};
+    if (reader.get_record_size() != PackedPosition::BYTES)
+        return agreement;
+
+    RandomEngine random_engine;
+    reader.for_each_record([&] (const uint8_t* record) {
+        // Records are only ever bytes, so they can be read in place
+        auto position = reinterpret_cast<const PackedPosition*>(record);
+        if (!position->has_move())
+            return;
+        Board board(250, random_engine);
+        position->unpack(board);
+        Move move = best_move(&board, weights);
+        Move recorded = position->get_move();
+        agreement.positions++;
+        if (move.position == recorded.position &&
+            move.rotation == recorded.rotation && move.hold == recorded.hold)
+            agreement.matches++;
+    });
+    return agreement;
 }
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <chrono>
+#include <vector>
+
 #include "../../game/Board.hpp"
 
+class ShardReader;
+class ValueNet;
+
 /* A "move" made up of the final position, rotation, and if a hold was involved */
 struct Move {
     int position;
@@ -19,11 +25,154 @@ struct Weights {
     double blocks_over_holes;
 };
 
+/* The heuristics measured on a board after a hypothetical move */
+struct BoardAnalysis {
+    uint8_t holes_count;         // Open squares with filled squares above
+    uint16_t aggregate_height;   // The total number of filled squares
+    uint8_t complete_lines;      // Amount of lines to be cleared
+    double height_std_dev;       // Flatter board = better
+    uint8_t highest_point;       // Highest point reached
+    uint8_t blocks_over_holes;   // How many blocks are above holes in the board
+};
+
+/* A candidate move and what the weights scored it at */
+struct ScoredMove {
+    Move move;
+    double score;
+};
+
+/* What an anytime search settled on */
+struct SearchResult {
+    Move move;          // The best move of the deepest finished search
+    uint8_t depth;      // How many pieces ahead that search looked
+    size_t nodes;       // Placements scored over every depth
+    size_t candidates;  // Moves for the current piece
+    double score;       // What the search scored the move at
+};
+
+/**
+ * @param highest_points An array of the highest points in each column.
+ * @return The standard deviation of heights.
+ */
+double get_height_std_dev (const int highest_points[Board::WIDTH]);
+
+/**
+ * Runs each of the heuristics on the current board with a hypothetical move.
+ * @param current_board The current board state.
+ * This method does not modify the Board object.
+ * @param piece_anchor Where the proposed move would end.
+ * @param piece Which piece the move is with.
+ * @param piece_rot The rotation of the piece after the move.
+ * @return A BoardAnalysis object with various heuristics
+ */
+BoardAnalysis analyze_board (
+    Board* current_board, int piece_anchor, int piece, int piece_rot
+);
+
+/**
+ * @param analysis The heuristics of a board.
+ * @param weights How much each heuristic counts.
+ * @return The weighted score of the board, higher is better.
+ */
+double score_analysis (const BoardAnalysis& analysis, const Weights& weights);
+
+/**
+ * Gets all possible "hard drop" moves on the current board
+ * @param current_board The current board state.
+ * This method does not modify the Board object.
+ * @param current_piece The current falling piece.
+ * @param held_piece The held piece or the next piece up if no piece is held.
+ * @return A vec of Move objects, each with an ending anchor,
+ * rotation, and if it includes a hold
+ */
+std::vector<Move> generate_moves (
+    Board* current_board, uint8_t current_piece, uint8_t held_piece
+);
+
+/**
+ * Counts the positions reachable after a number of placements, like perft
+ * in chess engines. Used to check that move generation doesn't lose or
+ * duplicate placements, and to time it.
+ * @param current_board The board to start from.
+ * This method does not modify the Board object.
+ * @param depth How many pieces to place.
+ * @return The number of positions after the last placement.
+ */
+size_t perft (Board* current_board, uint8_t depth);
+
 /**
  * Given the current board state, gets the best possible move.
  * @param current_board The current board state.
  * This method does not modify the Board object.
  * @param weights The set of weights to use for each eval parameter.
+ * @param candidate_count If not nullptr, set to how many moves were looked at.
+ * @param score If not nullptr, set to the score of the best move.
  * @return A "Move" with the anchor position, rotation, and whether it's with the held piece.
  */
-Move best_move (Board* current_board, Weights& weights);
+Move best_move (
+    Board* current_board, const Weights& weights, size_t* candidate_count = nullptr,
+    double* score = nullptr
+);
+
+/**
+ * Scores every candidate like best_move() and keeps the best few.
+ * @param current_board The current board state.
+ * This method does not modify the Board object.
+ * @param weights The set of weights to use for each eval parameter.
+ * @param count How many moves to keep at most.
+ * @return The best moves, best first, in the order best_move() sees them
+ * when scores tie.
+ */
+std::vector<ScoredMove> rank_moves (
+    Board* current_board, const Weights& weights, size_t count
+);
+
+/**
+ * Like best_move(), but scores every candidate with a value network
+ * instead of the weights, all in one batch.
+ * @param current_board The current board state.
+ * This method does not modify the Board object.
+ * @param net The network to score boards with.
+ * @param candidate_count If not nullptr, set to how many moves were looked at.
+ * @param score If not nullptr, set to the score of the best move.
+ * @return The best move.
+ */
+Move best_move_net (
+    Board* current_board, const ValueNet& net, size_t* candidate_count = nullptr,
+    double* score = nullptr
+);
+
+/**
+ * Searches deeper and deeper until it runs out of time, always keeping the
+ * best move of the deepest search that finished.
+ * Depth 1 is best_move() and always finishes, so there's a move even if the
+ * deadline has already passed. Each depth after that places one more of the
+ * upcoming pieces, scoring the last placement with the weights plus the
+ * lines cleared on the way there. A depth that's cut off is thrown away.
+ * @param current_board The current board state.
+ * This method does not modify the Board object.
+ * @param weights The set of weights to use for each eval parameter.
+ * @param max_depth The deepest to search, at most 7 so every piece placed
+ * is already known.
+ * @param deadline When to stop searching.
+ * @return The best move, and how deep the search got.
+ */
+SearchResult anytime_search (
+    Board* current_board, const Weights& weights, uint8_t max_depth,
+    std::chrono::steady_clock::time_point deadline
+);
+
+/* How a set of weights compares to the moves in a dataset */
+struct DatasetAgreement {
+    size_t positions;   // Positions that came with a move
+    size_t matches;     // How many of those best_move() picks too
+};
+
+/**
+ * Plays best_move() on every position in a shard of PackedPositions and
+ * counts how often it picks the move that was recorded.
+ * @param reader An open shard of PackedPositions.
+ * @param weights The set of weights to use for each eval parameter.
+ * @return The counts, all zeroes if the shard doesn't hold positions.
+ */
+DatasetAgreement dataset_agreement (const ShardReader& reader, const Weights& weights);
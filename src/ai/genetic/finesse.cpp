@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <deque>
+
+#include "finesse.hpp"
+#include "../../game/tetrominoes.hpp"
+#include "../../util/instrument.hpp"
+
+/* A place the piece can be in, and how the search got there */
+struct PathNode {
+    Board board;
+    size_t parent;
+    Input input;
+};
+
+// Every shift and rotation Board can take in one update
+static const Input STEER_INPUTS[] = {
+    {
+        .move_left = true, .move_right = false, .rot_clockwise = false, .rot_count_clockwise = false,
+        .soft_drop = false, .hard_drop = false, .hold_piece = false
+    },
+    {
+        .move_left = false, .move_right = true, .rot_clockwise = false, .rot_count_clockwise = false,
+        .soft_drop = false, .hard_drop = false, .hold_piece = false
+    },
+    {
+        .move_left = false, .move_right = false, .rot_clockwise = true, .rot_count_clockwise = false,
+        .soft_drop = false, .hard_drop = false, .hold_piece = false
+    },
+    {
+        .move_left = false, .move_right = false, .rot_clockwise = false, .rot_count_clockwise = true,
+        .soft_drop = false, .hard_drop = false, .hold_piece = false
+    },
+    {
+        .move_left = true, .move_right = false, .rot_clockwise = true, .rot_count_clockwise = false,
+        .soft_drop = false, .hard_drop = false, .hold_piece = false
+    },
+    {
+        .move_left = true, .move_right = false, .rot_clockwise = false, .rot_count_clockwise = true,
+        .soft_drop = false, .hard_drop = false, .hold_piece = false
+    },
+    {
+        .move_left = false, .move_right = true, .rot_clockwise = true, .rot_count_clockwise = false,
+        .soft_drop = false, .hard_drop = false, .hold_piece = false
+    },
+    {
+        .move_left = false, .move_right = true, .rot_clockwise = false, .rot_count_clockwise = true,
+        .soft_drop = false, .hard_drop = false, .hold_piece = false
+    },
+};
+
+/**
+ * Gives one input to a board without letting gravity in.
+ * @param board The board to steer the piece on.
+ * @param input What to press.
+ */
+static void apply_input (Board& board, Input input) {
+    // The tick the piece last fell at, so it doesn't fall again
+    uint32_t ticks = board.get_next_fall_ticks() - board.get_fall_rate();
+    board.update(input, ticks);
+}
+
+/**
+ * @param piece The type of piece.
+ * @param anchor Where the piece's anchor is.
+ * @param rotation The rotation of the piece.
+ * @return The column of the piece's left edge.
+ */
+static uint8_t left_column (uint8_t piece, uint16_t anchor, uint8_t rotation) {
+    int8_t offset = tetromino_data::get_piece_bounds(piece, rotation).left_bound;
+    return Board::col(anchor - offset);
+}
+
+/**
+ * Runs the search from a board's falling piece.
+ * @param start The board to search on.
+ * @param nodes Filled with every position the piece can reach, in the order
+ * they were found, so the path to each one is as short as it can be.
+ * @param done Stops the search early once it returns true for a node.
+ * @return The index of the node done() accepted, or nodes.size() if none.
+ */
+template <typename Done>
+static size_t explore (const Board& start, std::vector<PathNode>& nodes, Done done) {
+    // Rows never change without gravity, but kicks can move the piece up
+    // or down, so positions are told apart by anchor and rotation
+    std::vector<bool> seen(Board::TOTAL_SIZE * 4, false);
+    auto key = [] (const Board& board) {
+        return board.get_falling_piece_anchor() * 4 + board.get_falling_piece_rot();
+    };
+
+    nodes.clear();
+    nodes.push_back({start, SIZE_MAX, {}});
+    seen[key(start)] = true;
+    const uint8_t piece = start.get_falling_piece();
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (done(nodes[i].board))
+            return i;
+        for (const Input& input : STEER_INPUTS) {
+            bool rotates = input.rot_clockwise || input.rot_count_clockwise;
+            if (rotates && piece == O_PIECE)
+                continue;
+            Board next = nodes[i].board;
+            apply_input(next, input);
+            if (seen[key(next)])
+                continue;
+            seen[key(next)] = true;
+            nodes.push_back({next, i, input});
+        }
+    }
+    return nodes.size();
+}
+
+/**
+ * Follows the parents of a node back to the start.
+ * @param nodes The nodes of a search.
+ * @param end The node the path should end at.
+ * @param path Set to the steps from the start to end.
+ */
+static void trace_path (
+    const std::vector<PathNode>& nodes, size_t end, std::vector<PathStep>& path
+) {
+    path.clear();
+    for (size_t i = end; nodes[i].parent != SIZE_MAX; i = nodes[i].parent) {
+        const Board& board = nodes[i].board;
+        path.push_back({
+            nodes[i].input,
+            board.get_falling_piece_anchor(),
+            board.get_falling_piece_rot()
+        });
+    }
+    std::reverse(path.begin(), path.end());
+}
+
+/* Shortest paths from spawn on an empty board, for every piece and target */
+struct FinesseTable {
+    // Indexed by piece, rotation, then the column of the piece's left edge
+    std::vector<Input> paths[8][4][Board::WIDTH];
+    bool reachable[8][4][Board::WIDTH];
+    // The spawn column of each piece's left edge
+    uint8_t spawn_column[8];
+};
+
+static const FinesseTable& finesse_table () {
+    static const FinesseTable TABLE = [] () {
+        FinesseTable table = {};
+        RandomEngine random_engine(0);
+        std::vector<PathNode> nodes;
+        std::vector<PathStep> path;
+        for (uint8_t piece = I_PIECE; piece <= T_PIECE; piece++) {
+            Board board(250, random_engine);
+            // Start the game so there's a falling piece, then swap it out
+            Input input = {};
+            board.update(input, 0);
+            while (board.get_falling_piece() != piece) {
+                board = Board(250, random_engine);
+                board.update(input, 0);
+            }
+            table.spawn_column[piece] = left_column(
+                piece, board.get_falling_piece_anchor(), 0
+            );
+
+            explore(board, nodes, [] (Board&) { return false; });
+            for (size_t i = 0; i < nodes.size(); i++) {
+                const Board& node = nodes[i].board;
+                uint8_t rot = node.get_falling_piece_rot();
+                uint8_t column = left_column(
+                    piece, node.get_falling_piece_anchor(), rot
+                );
+                if (table.reachable[piece][rot][column])
+                    continue;
+                table.reachable[piece][rot][column] = true;
+                trace_path(nodes, i, path);
+                for (const PathStep& step : path)
+                    table.paths[piece][rot][column].push_back(step.input);
+            }
+        }
+        return table;
+    }();
+    return TABLE;
+}
+
+/**
+ * @param board A board with a falling piece.
+ * @param move Where the piece should land.
+ * @return True if hard dropping the piece would land it there.
+ */
+static bool lands_at (Board& board, const Move& move) {
+    return board.get_falling_piece_rot() == move.rotation &&
+        board.get_ghost() == move.position;
+}
+
+bool finesse_path (
+    Board* current_board, const Move& move, std::vector<PathStep>& path
+) {
+    const FinesseTable& table = finesse_table();
+    const uint8_t piece = current_board->get_falling_piece();
+    if (piece == 0 || current_board->get_falling_piece_rot() != 0)
+        return false;
+    uint16_t anchor = current_board->get_falling_piece_anchor();
+    if (left_column(piece, anchor, 0) != table.spawn_column[piece])
+        return false;
+    uint8_t column = left_column(piece, move.position, move.rotation);
+    if (!table.reachable[piece][move.rotation][column])
+        return false;
+
+    // The table doesn't know about the stack, so play the path out here
+    Board board = *current_board;
+    path.clear();
+    for (const Input& input : table.paths[piece][move.rotation][column]) {
+        apply_input(board, input);
+        path.push_back({
+            input, board.get_falling_piece_anchor(), board.get_falling_piece_rot()
+        });
+    }
+    return lands_at(board, move);
+}
+
+bool search_path (
+    Board* current_board, const Move& move, std::vector<PathStep>& path
+) {
+    if (current_board->get_falling_piece() == 0)
+        return false;
+    std::vector<PathNode> nodes;
+    size_t end = explore(*current_board, nodes, [&move] (Board& board) {
+        return lands_at(board, move);
+    });
+    if (end == nodes.size())
+        return false;
+    trace_path(nodes, end, path);
+    return true;
+}
+
+bool plan_path (
+    Board* current_board, const Move& move, std::vector<PathStep>& path
+) {
+    INSTRUMENT_SCOPE(PLAN_PATH);
+    return finesse_path(current_board, move, path) ||
+        search_path(current_board, move, path);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include "eval.hpp"
+#include "../../game/Board.hpp"
+
+/*
+ * Plans the inputs that steer the falling piece to where a Move needs it.
+ * Board takes one shift and one rotation per update, and does the shift
+ * first, so a path is a list of those pairs followed by a hard drop, which
+ * has to go in an update of its own.
+ * Paths are found by a breadth-first search over where the piece can be,
+ * playing every input out on a copy of the board so wall kicks behave
+ * exactly like they do in the game. The paths from the spawn position on an
+ * empty board are searched once and kept in a finesse table, which most
+ * pieces can use as is.
+ */
+
+/* One input on the way to a placement, and where it should leave the piece */
+struct PathStep {
+    Input input;
+    uint16_t anchor;
+    uint8_t rotation;
+};
+
+/**
+ * Looks the path up in the finesse table, which only works if the piece is
+ * still where it spawned and nothing is in the way.
+ * @param current_board The board with the piece to steer.
+ * This method does not modify the Board object.
+ * @param move Where the falling piece should land, without a hold.
+ * @param path Set to the inputs to give, one per update.
+ * @return True if the table's path gets the piece there on this board.
+ */
+bool finesse_path (
+    Board* current_board, const Move& move, std::vector<PathStep>& path
+);
+
+/**
+ * Searches for the shortest path from wherever the piece is.
+ * @param current_board The board with the piece to steer.
+ * This method does not modify the Board object.
+ * @param move Where the falling piece should land, without a hold.
+ * @param path Set to the inputs to give, one per update.
+ * @return True if the piece can be steered there, false otherwise.
+ */
+bool search_path (
+    Board* current_board, const Move& move, std::vector<PathStep>& path
+);
+
+/**
+ * Finds the shortest path, from the finesse table if it can.
+ * @param current_board The board with the piece to steer.
+ * This method does not modify the Board object.
+ * @param move Where the falling piece should land, without a hold.
+ * @param path Set to the inputs to give, one per update.
+ * @return True if the piece can be steered there, false otherwise.
+ */
+bool plan_path (
+    Board* current_board, const Move& move, std::vector<PathStep>& path
+);
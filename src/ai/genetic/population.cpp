@@ -0,0 +1,58 @@
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "population.hpp"
+
+bool load_population (const std::string& path, std::vector<Weights>& population) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "Failed to open population file " << path << std::endl;
+        return false;
+    }
+
+    population.clear();
+    std::string line;
+    for (size_t line_num = 1; std::getline(file, line); line_num++) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        Weights weights = {};
+        fields >> weights.holes_count >> weights.aggregate_height
+               >> weights.complete_lines >> weights.height_std_dev
+               >> weights.highest_point >> weights.blocks_over_holes;
+        std::string extra;
+        if (fields.fail() || (fields >> extra)) {
+            std::cout << path << ":" << line_num
+                      << ": expected 6 weights" << std::endl;
+            return false;
+        }
+        population.push_back(weights);
+    }
+    return true;
+}
+
+bool save_population (
+    const std::string& path, const std::vector<Weights>& population
+) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cout << "Failed to open population file " << path << std::endl;
+        return false;
+    }
+
+    // Enough digits that weights survive being written and read back
+    file.precision(std::numeric_limits<double>::max_digits10);
+    file << "# holes_count aggregate_height complete_lines height_std_dev "
+            "highest_point blocks_over_holes\n";
+    for (const Weights& weights : population) {
+        file << weights.holes_count << ' ' << weights.aggregate_height << ' '
+             << weights.complete_lines << ' ' << weights.height_std_dev << ' '
+             << weights.highest_point << ' ' << weights.blocks_over_holes
+             << '\n';
+    }
+    return (bool) file.flush();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "eval.hpp"
+
+/*
+ * Population files hold one agent per line, as its six weights separated by
+ * spaces in the same order as Weights. Blank lines and lines starting with
+ * '#' are skipped.
+ */
+
+/**
+ * Reads the agents out of a population file.
+ * @param path Where the file is.
+ * @param population Filled with the weights of every agent in the file.
+ * @return True if the whole file was read, false otherwise.
+ */
+bool load_population (const std::string& path, std::vector<Weights>& population);
+
+/**
+ * Writes agents to a population file, replacing anything already there.
+ * @param path Where the file should go.
+ * @param population The weights of every agent.
+ * @return True if the whole file was written, false otherwise.
+ */
+bool save_population (
+    const std::string& path, const std::vector<Weights>& population
+);
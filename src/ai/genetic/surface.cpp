@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+#include "surface.hpp"
+#include "../../game/tetrominoes.hpp"
+
+/* The columns of a piece, measured up from its bottom row */
+struct PieceShape {
+    uint8_t width;
+    uint8_t bottom[4];  // Lowest square of each column
+    uint8_t top[4];     // Highest square of each column
+};
+
+// Differences between neighbouring columns, for the widest pieces
+constexpr int PROFILE_DIFFS = 3;
+constexpr int PROFILE_STEPS = 2 * SURFACE_CLAMP + 1;
+constexpr int PROFILES = PROFILE_STEPS * PROFILE_STEPS * PROFILE_STEPS;
+
+/**
+ * @param piece Which piece.
+ * @param rot The rotation of the piece.
+ * @return Its columns, from its piece map.
+ */
+static constexpr PieceShape make_shape (int piece, int rot) {
+    int min_col = 3, max_row = 0;
+    for (uint8_t offset : tetromino_data::MAPS[piece - 1][rot]) {
+        min_col = std::min(min_col, offset % Board::WIDTH);
+        max_row = std::max(max_row, offset / Board::WIDTH);
+    }
+
+    PieceShape shape = {0, {255, 255, 255, 255}, {0, 0, 0, 0}};
+    for (uint8_t offset : tetromino_data::MAPS[piece - 1][rot]) {
+        int column = offset % Board::WIDTH - min_col;
+        auto up = (uint8_t) (max_row - offset / Board::WIDTH);
+        shape.width = (uint8_t) std::max<int>(shape.width, column + 1);
+        shape.bottom[column] = std::min(shape.bottom[column], up);
+        shape.top[column] = std::max(shape.top[column], up);
+    }
+    return shape;
+}
+
+constexpr auto SHAPES = [] () {
+    std::array<std::array<PieceShape, 4>, 7> shapes = {};
+    for (int piece = 1; piece <= 7; piece++) {
+        for (int rot = 0; rot < 4; rot++)
+            shapes[piece - 1][rot] = make_shape(piece, rot);
+    }
+    return shapes;
+}();
+
+/**
+ * Drops a piece onto some columns.
+ * @param shape The piece.
+ * @param heights The height of each of its columns, relative to the first.
+ * @return How it fits.
+ */
+static constexpr SurfaceFit fit_profile (const PieceShape& shape, const int* heights) {
+    // The piece stops on whichever column it reaches first
+    int landing = heights[0] - shape.bottom[0];
+    for (int i = 1; i < shape.width; i++)
+        landing = std::max(landing, heights[i] - shape.bottom[i]);
+
+    int holes = 0, height_delta = 0, bumpiness_delta = 0;
+    int placed[4] = {};
+    for (int i = 0; i < shape.width; i++) {
+        holes += landing + shape.bottom[i] - heights[i];
+        placed[i] = landing + shape.top[i] + 1;
+        height_delta += placed[i] - heights[i];
+    }
+    for (int i = 0; i + 1 < shape.width; i++) {
+        int before = heights[i + 1] - heights[i];
+        int after = placed[i + 1] - placed[i];
+        bumpiness_delta += (after < 0 ? -after : after) - (before < 0 ? -before : before);
+    }
+    return {
+        (int8_t) landing, (uint8_t) holes,
+        (int8_t) height_delta, (int8_t) bumpiness_delta
+    };
+}
+
+// Every piece and rotation on every profile within the clamp, indexed by
+// (piece - 1, rotation, profile) with each difference offset by the clamp
+constexpr auto FIT_TABLE = [] () {
+    std::array<SurfaceFit, 7 * 4 * PROFILES> table = {};
+    for (int piece = 1; piece <= 7; piece++) {
+        for (int rot = 0; rot < 4; rot++) {
+            for (int profile = 0; profile < PROFILES; profile++) {
+                int heights[4] = {};
+                for (int i = 1, rest = profile; i <= PROFILE_DIFFS; i++) {
+                    int step = PROFILES;
+                    for (int j = 0; j < i; j++)
+                        step /= PROFILE_STEPS;
+                    heights[i] = heights[i - 1] + rest / step - SURFACE_CLAMP;
+                    rest %= step;
+                }
+                table[((piece - 1) * 4 + rot) * PROFILES + profile] =
+                    fit_profile(SHAPES[piece - 1][rot], heights);
+            }
+        }
+    }
+    return table;
+}();
+
+// A vertical I on an empty column, and an O over a step it can't reach
+static_assert(FIT_TABLE[(0 * 4 + 1) * PROFILES + PROFILES / 2].holes == 0);
+static_assert(FIT_TABLE[(0 * 4 + 1) * PROFILES + PROFILES / 2].height_delta == 4);
+static_assert(
+    FIT_TABLE[(3 * 4 + 0) * PROFILES + (SURFACE_CLAMP + 2) * PROFILE_STEPS * PROFILE_STEPS +
+        SURFACE_CLAMP * PROFILE_STEPS + SURFACE_CLAMP].holes == 2
+);
+
+Surface read_surface (Board* current_board) {
+    Surface surface = {};
+    surface.highest_row = current_board->get_highest_row();
+    for (uint8_t y = 0; y < Board::HEIGHT; y++) {
+        for (uint8_t x = 0; x < Board::WIDTH; x++) {
+            if (current_board->get_square(x, y) > 0) {
+                surface.row_fill[y]++;
+                surface.filled++;
+                if (surface.heights[x] == 0)
+                    surface.heights[x] = Board::HEIGHT - y;
+            } else if (surface.heights[x] > 0) {
+                // Same as analyze_board(), the filled squares above a hole
+                surface.holes[x]++;
+                surface.holes_count++;
+                surface.blocks_over_holes +=
+                    (y - (Board::HEIGHT - surface.heights[x])) - surface.holes[x];
+            }
+        }
+    }
+    return surface;
+}
+
+SurfaceFit surface_fit (int piece, int rot, const uint8_t* heights) {
+    const PieceShape& shape = SHAPES[piece - 1][rot];
+    int profile = 0;
+    bool in_table = true;
+    for (int i = 1; i <= PROFILE_DIFFS; i++) {
+        int diff = i < shape.width ? heights[i] - heights[i - 1] : 0;
+        in_table &= std::abs(diff) <= SURFACE_CLAMP;
+        profile = profile * PROFILE_STEPS + diff + SURFACE_CLAMP;
+    }
+    if (in_table)
+        return FIT_TABLE[((piece - 1) * 4 + rot) * PROFILES + profile];
+
+    int relative[4] = {};
+    for (int i = 1; i < shape.width; i++)
+        relative[i] = heights[i] - heights[0];
+    return fit_profile(shape, relative);
+}
+
+bool analyze_surface (
+    const Surface& surface, int piece_anchor, int piece, int piece_rot,
+    BoardAnalysis& analysis
+) {
+    const PieceShape& shape = SHAPES[piece - 1][piece_rot];
+    int first_column = Board::WIDTH, bottom_row = 0;
+    uint8_t piece_rows[Board::HEIGHT] = {};
+    for (int i = 0; i < 4; i++) {
+        int idx = piece_anchor + tetromino_data::get_piece_map(piece, piece_rot, i);
+        first_column = std::min<int>(first_column, Board::col(idx));
+        bottom_row = std::max<int>(bottom_row, Board::row(idx));
+        piece_rows[Board::row(idx)]++;
+    }
+
+    const uint8_t* heights = &surface.heights[first_column];
+    SurfaceFit fit = surface_fit(piece, piece_rot, heights);
+    // Pieces stopped before they reach the stack don't fit the profile
+    if (heights[0] + fit.landing != Board::HEIGHT - 1 - bottom_row)
+        return false;
+
+    analysis = {};
+    analysis.holes_count = surface.holes_count + fit.holes;
+    analysis.aggregate_height = surface.filled + 4;
+    for (int y = Board::row(piece_anchor); y <= bottom_row; y++) {
+        if (piece_rows[y] > 0 && surface.row_fill[y] + piece_rows[y] == Board::WIDTH)
+            analysis.complete_lines++;
+    }
+
+    // analyze_board() measures columns as the row of their top square
+    int column_tops[Board::WIDTH];
+    for (int x = 0; x < Board::WIDTH; x++)
+        column_tops[x] = Board::HEIGHT - surface.heights[x];
+    uint8_t blocks_over_holes = surface.blocks_over_holes;
+    for (int i = 0; i < shape.width; i++) {
+        int x = first_column + i;
+        int landing = heights[0] + fit.landing;
+        int gap = landing + shape.bottom[i] - heights[i];
+        column_tops[x] = Board::HEIGHT - (landing + shape.top[i] + 1);
+        // Old holes get the whole piece column over them, and analyze_board()
+        // doesn't count the square right above a hole, so new ones get one less
+        int squares = shape.top[i] - shape.bottom[i] + 1;
+        blocks_over_holes += squares * surface.holes[x] + (squares - 1) * gap;
+    }
+    analysis.blocks_over_holes = blocks_over_holes;
+    analysis.height_std_dev = get_height_std_dev(column_tops);
+
+    int highest_row = std::min<int>(surface.highest_row, Board::row(piece_anchor));
+    analysis.highest_point = Board::HEIGHT - highest_row;
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+
+#include "eval.hpp"
+#include "../../game/Board.hpp"
+
+/*
+ * Scores placements from the surface of the stack instead of the grid.
+ * Where a hard dropped piece lands and what it leaves under itself only
+ * depend on the heights of the columns below it, so how every piece and
+ * rotation fits every height profile is worked out at compile time into a
+ * table. A board is read into a Surface once, and every candidate after that
+ * is a table lookup plus some arithmetic on the column heights.
+ * Profiles are the differences between neighbouring heights under the
+ * piece. Ones steeper than SURFACE_CLAMP are past the edge of the table and
+ * get worked out on the spot, the same way the table was.
+ */
+
+// Largest difference between neighbouring columns the table covers
+constexpr int SURFACE_CLAMP = 4;
+
+/* How a piece fits onto the columns under it */
+struct SurfaceFit {
+    int8_t landing;          // Height of the piece's bottom, relative to its first column
+    uint8_t holes;           // Empty squares sealed under the piece
+    int8_t height_delta;     // How much the heights of its columns grow in total
+    int8_t bumpiness_delta;  // Change in the differences between those heights
+};
+
+/* Everything about a board that analyze_board() needs besides the move */
+struct Surface {
+    uint8_t heights[Board::WIDTH];    // Rows from the floor to the top of each column
+    uint8_t holes[Board::WIDTH];      // Open squares under the top of each column
+    uint8_t row_fill[Board::HEIGHT];  // Filled squares in each row
+    uint8_t holes_count;
+    uint16_t filled;
+    uint8_t blocks_over_holes;
+    uint8_t highest_row;              // From Board::get_highest_row()
+};
+
+/**
+ * Reads the surface of a board, once for all of its candidates.
+ * @param current_board The current board state.
+ * This method does not modify the Board object.
+ * @return The surface of the locked squares.
+ */
+Surface read_surface (Board* current_board);
+
+/**
+ * Looks up how a piece fits a height profile.
+ * @param piece Which piece.
+ * @param rot The rotation of the piece.
+ * @param heights The heights of the columns under the piece, starting with
+ * its leftmost one.
+ * @return The fit, from the table if the profile is in it.
+ */
+SurfaceFit surface_fit (int piece, int rot, const uint8_t* heights);
+
+/**
+ * Same as analyze_board(), from a surface instead of the grid.
+ * @param surface The board's surface from read_surface().
+ * @param piece_anchor Where the proposed move would end.
+ * @param piece Which piece the move is with.
+ * @param piece_rot The rotation of the piece after the move.
+ * @param analysis Set to the heuristics, exactly as analyze_board() gives
+ * them.
+ * @return False if the piece doesn't rest on the surface there, like when
+ * it's stopped above the stack, and analyze_board() has to be used instead.
+ */
+bool analyze_surface (
+    const Surface& surface, int piece_anchor, int piece, int piece_rot,
+    BoardAnalysis& analysis
+);
@@ -1,4 +1,55 @@
+#include <random>
+
 #include "train.hpp"
+#include "batch.hpp"
+#include "../../util/trace.hpp"
+
+GameResult play_game (Agent& agent, uint32_t seed, size_t max_pieces) {
+    TRACE_SCOPE("game", "task");
+    RandomEngine random_engine(seed);
+    Board board(250, random_engine);
+
+    // Fake clock so the game runs as fast as the agent can think,
+    // while gravity still locks a piece the agent can't steer
+    uint32_t ticks = 0;
+    Input input = {};
+    board.update(input, ticks);
+
+    while (!board.game_over() && board.get_pieces_placed() < max_pieces) {
+        input = agent.gen_input(&board);
+        board.update(input, ++ticks);
+    }
+
+    return {
+        .score = board.get_score(),
+        .lines_cleared = board.get_lines_cleared(),
+        .pieces_placed = board.get_pieces_placed()
+    };
+}
+
+std::vector<GameResult> play_games (
+    const Weights& weights, const uint32_t* seeds, size_t count, size_t max_pieces
+) {
+    TRACE_SCOPE("games", "task");
+    BoardBatch batch(count);
+    batch.reset(seeds, count, max_pieces);
+    std::vector<BatchMove> moves(count);
+    // Finished games are left behind, every step is only the ones still going
+    while (batch.compact() > 0) {
+        best_moves(batch, weights, moves.data());
+        batch.step(moves.data());
+    }
+
+    std::vector<GameResult> results(count);
+    for (size_t lane = 0; lane < batch.get_count(); lane++) {
+        results[batch.get_game(lane)] = {
+            .score = batch.get_score(lane),
+            .lines_cleared = batch.get_lines_cleared(lane),
+            .pieces_placed = batch.get_pieces_placed(lane)
+        };
+    }
+    return results;
+}
 
 Agent train (TrainingSettings settings) {
     return Agent(false, {}); // STUB
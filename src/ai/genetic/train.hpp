@@ -11,6 +11,37 @@ struct TrainingSettings {
     const uint8_t CROSSOVER;
 };
 
+/* The outcome of a game played without a window */
+struct GameResult {
+    size_t score;
+    size_t lines_cleared;
+    size_t pieces_placed;
+};
+
+/**
+* Plays a full game of Tetris without rendering, as fast as possible.
+* @param agent The Agent playing the game.
+* @param seed The seed for the piece randomizer.
+* @param max_pieces Stop the game after this many pieces have been placed.
+* @return The score, lines, and pieces placed when the game ended
+*/
+GameResult play_game (Agent& agent, uint32_t seed, size_t max_pieces);
+
+/**
+ * Plays many games at once in a BoardBatch, placing whatever best_move()
+ * picks with Board::place_piece(). Faster per game than play_game(), for
+ * scoring weights over a lot of seeds.
+ * @param weights The weights every game is played with.
+ * @param seeds The seed for each game's piece randomizer.
+ * @param count How many games to play.
+ * @param max_pieces Stop each game after this many pieces have been placed.
+ * @return The score, lines, and pieces placed of each game, in the order of
+ * the seeds.
+ */
+std::vector<GameResult> play_games (
+    const Weights& weights, const uint32_t* seeds, size_t count, size_t max_pieces
+);
+
 /**
 * @param settings that affect how the algorithm runs
 * @return the best Agent after training
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <random>
+#include <algorithm>
 #include <chrono>
 
 #include <SDL3/SDL.h>
@@ -8,16 +9,35 @@
 #include "App.hpp"
 #include "HumanPlayer.hpp"
 #include "../game/Board.hpp"
+#include "../util/trace.hpp"
 
-App::App (Player* player)
+App::App (Player* player, bool unthrottled, uint16_t fall_rate)
     : m_board(nullptr)
     , m_window()
-    , m_randomgen(std::chrono::system_clock::now().time_since_epoch().count())
+    , m_randomgen()
+    , m_next_seed((uint32_t) std::chrono::system_clock::now().time_since_epoch().count())
     , m_user_input(false)
-    , m_player(player) 
+    , m_unthrottled(unthrottled)
+    , m_fall_rate(fall_rate)
+    , m_player(player)
+    , m_running(false)
+    , m_start_ns(0)
+    , m_next_ai_input_ns(0)
+    , m_snapshot_count(0)
+    , m_published_generation(UINT64_MAX)
+    , m_replay_header()
+    , m_wake_pending(false)
+    , m_keystate{}
+    , m_key_presses{}
+    , m_seen_decisions(0)
+    , m_show_overlay(false)
+    , m_rate_sample_ns(0)
+    , m_rate_sample_pieces(0)
+    , m_pieces_per_sec(0)
 {}
 
-App::App () : App(new HumanPlayer()) {
+// The HumanPlayer reads the key state the simulation thread keeps
+App::App () : App(new HumanPlayer(m_keystate, m_key_presses)) {
     m_user_input = true;
 }
 
@@ -26,64 +46,254 @@ bool App::init () {
     return m_window.init();
 }
 
+void App::record_replays (const std::string& directory, const Weights* weights) {
+    m_replay_directory = directory;
+    m_replay_header.has_weights = weights != nullptr;
+    if (weights != nullptr)
+        m_replay_header.weights = *weights;
+}
+
 void App::new_game () {
+    uint32_t seed = m_next_seed++;
+    m_randomgen.seed(seed);
     delete m_board;
-    m_board = new Board(250, m_randomgen);
+    m_board = new Board(m_fall_rate, m_randomgen);
+    if (!m_replay_directory.empty()) {
+        m_replay_header.seed = seed;
+        m_replay_header.fall_rate = m_fall_rate;
+        m_replay_header.rules_version = Board::RULES_VERSION;
+        m_recorder.start(replay_path(m_replay_directory, seed), m_replay_header);
+    }
+    // The new board starts counting generations again
+    m_published_generation = UINT64_MAX;
+}
+
+// Longest the simulation sleeps for, even with nothing due
+constexpr uint64_t MAX_WAIT_NS = 100 * SDL_NS_PER_MS;
+
+void App::step (uint64_t now_ns) {
+    TRACE_SCOPE("step", "sim");
+    bool hold_piece = false;
+    bool hard_drop = false;
+
+    KeyEvent event = {};
+    while (m_key_events.pop(event)) {
+        m_keystate[event.scancode] = event.down;
+        if (!event.down)
+            continue;
+        if (m_user_input) {
+            if (!event.repeat)
+                m_key_presses[event.scancode] = true;
+            if (event.key == SDLK_C)
+                hold_piece = true;
+            if (event.key == SDLK_SPACE)
+                hard_drop = true;
+        }
+        if (event.key == SDLK_R)
+            new_game();
+    }
+
+    // Prevents automated input from going at insane speeds
+    bool ai_input_due = m_unthrottled || now_ns >= m_next_ai_input_ns;
+    if (ai_input_due && !m_unthrottled) {
+        // Skip any inputs we were too late for, keeping the same cadence
+        const uint64_t interval_ns = AI_INPUT_INTERVAL_MS * SDL_NS_PER_MS;
+        m_next_ai_input_ns += 
+            ((now_ns - m_next_ai_input_ns) / interval_ns + 1) * interval_ns;
+    }
+
+    Input input = {};
+    if (m_user_input || ai_input_due) {
+        TRACE_SCOPE("eval", "sim");
+        input = m_player->gen_input(m_board);
+        if (m_player->get_decision_stats().decisions != m_seen_decisions)
+            publish_sim_stats();
+    }
+    input.hold_piece |= hold_piece;
+    input.hard_drop |= hard_drop;
+
+    auto ticks = (uint32_t) ((now_ns - m_start_ns) / SDL_NS_PER_MS);
+    m_recorder.update(*m_board, input, ticks);
+
+    // Nothing to draw if nothing changed
+    if (m_board->get_generation() == m_published_generation)
+        return;
+    m_published_generation = m_board->get_generation();
+
+    BoardSnapshot& snapshot = m_snapshots.write_buffer();
+    snapshot.capture(*m_board, ++m_snapshot_count);
+    m_snapshots.publish();
 }
 
-/**
- * Prevents automated input from going at insane speeds
- * @return True if input should be generated.
- */
-bool filter_ai_input () {
-    static const uint8_t delay_ms = 20;
-    static uint8_t current_delay = 0;
-
-    SDL_Delay(1);
-    current_delay++;
-    if (current_delay >= delay_ms) {
-        current_delay = 0;
+void App::publish_sim_stats () {
+    DecisionStats decision = m_player->get_decision_stats();
+    m_seen_decisions = decision.decisions;
+    m_best_move_ns.add(decision.last_ns);
+
+    SimStats& stats = m_sim_stats.write_buffer();
+    stats.best_move_last_ns = decision.last_ns;
+    stats.best_move_p99_ns = m_best_move_ns.percentile(99);
+    stats.search_avg_ns = decision.total_search_ns / std::max<uint64_t>(decision.decisions, 1);
+    stats.candidates = decision.last_candidates;
+    stats.search_depth = decision.last_depth;
+    stats.pieces_placed = m_board->get_pieces_placed();
+    m_sim_stats.publish();
+}
+
+OverlayStats App::collect_overlay_stats () {
+    m_sim_stats.update();
+    const SimStats& sim = m_sim_stats.read_buffer();
+
+    // Pieces per second over about the last second
+    uint64_t now_ns = SDL_GetTicksNS();
+    if (sim.pieces_placed < m_rate_sample_pieces) {
+        // A new game started
+        m_rate_sample_ns = now_ns;
+        m_rate_sample_pieces = sim.pieces_placed;
+    } else if (now_ns - m_rate_sample_ns >= SDL_NS_PER_SECOND) {
+        m_pieces_per_sec = (sim.pieces_placed - m_rate_sample_pieces) * 
+            (double) SDL_NS_PER_SECOND / (now_ns - m_rate_sample_ns);
+        m_rate_sample_ns = now_ns;
+        m_rate_sample_pieces = sim.pieces_placed;
     }
-    return current_delay == 0;
+
+    return {
+        .best_move_last_ns = sim.best_move_last_ns,
+        .best_move_p99_ns = sim.best_move_p99_ns,
+        .search_avg_ns = sim.search_avg_ns,
+        .candidates = sim.candidates,
+        .search_depth = sim.search_depth,
+        .pieces_per_sec = m_pieces_per_sec
+    };
 }
 
+uint64_t App::next_deadline_ns (uint64_t now_ns) const {
+    uint64_t deadline = m_player->next_deadline_ns();
+    if (!m_user_input && !m_board->game_over())
+        deadline = std::min(deadline, m_unthrottled ? now_ns : m_next_ai_input_ns);
+
+    // Gravity, which only runs while there's a piece falling
+    if (m_board->get_falling_piece() == 0) {
+        deadline = now_ns;
+    } else if (!m_board->game_over()) {
+        uint64_t fall_ns = 
+            m_start_ns + m_board->get_next_fall_ticks() * SDL_NS_PER_MS;
+        deadline = std::min(deadline, fall_ns);
+    }
+    return deadline;
+}
+
+void App::wake_simulation () {
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        m_wake_pending = true;
+    }
+    m_wake.notify_one();
+}
+
+void App::simulate () {
+    TRACE_THREAD_NAME("sim");
+    m_start_ns = SDL_GetTicksNS();
+    m_next_ai_input_ns = m_start_ns;
+
+    while (m_running.load(std::memory_order_relaxed)) {
+        uint64_t now_ns = SDL_GetTicksNS();
+        step(now_ns);
+
+        uint64_t deadline_ns = next_deadline_ns(now_ns);
+        now_ns = SDL_GetTicksNS();
+        if (deadline_ns <= now_ns)
+            continue;
+        // Nothing may be due at all, e.g. after a game over
+        uint64_t wait_ns = std::min(deadline_ns - now_ns, MAX_WAIT_NS);
+
+        TRACE_SCOPE("wait", "sim");
+        std::unique_lock<std::mutex> lock(m_wake_mutex);
+        m_wake.wait_for(
+            lock, std::chrono::nanoseconds(wait_ns),
+            [this] () { return m_wake_pending || !m_running; }
+        );
+        m_wake_pending = false;
+    }
+}
 
 void App::run () {
+    TRACE_THREAD_NAME("main");
+    m_running = true;
+    m_sim_thread = std::thread(&App::simulate, this);
+
+    const uint32_t frame_ms = m_window.get_frame_interval_ms();
+    // Draw the first frame even if the game hasn't started yet
+    bool redraw = true;
     bool end = false;
     while (!end) {
-        SDL_Event event;
-
-        Input input = {};
-        if (m_user_input || filter_ai_input()) {
-            input = m_player->gen_input(m_board);
-        }
+        TRACE_SCOPE("frame", "frame");
 
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_EVENT_QUIT) {
-                end = true;
-            }
-            if (event.type == SDL_EVENT_KEY_DOWN) {
-                if (m_user_input) {
-                    if (event.key.key == SDLK_C)
-                        input.hold_piece = true;
-                    if (event.key.key == SDLK_SPACE)
-                        input.hard_drop = true;
+        {
+            TRACE_SCOPE("events", "frame");
+            bool key_event = false;
+            SDL_Event event;
+            while (SDL_PollEvent(&event)) {
+                if (event.type == SDL_EVENT_QUIT) {
+                    end = true;
+                }
+                if (event.type == SDL_EVENT_WINDOW_EXPOSED) {
+                    redraw = true;
                 }
-                if (event.key.key == SDLK_R) {
-                    new_game();
-                    continue;
+                if (event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_F3) {
+                    m_show_overlay = !m_show_overlay;
+                    redraw = true;
+                }
+                if (
+                    event.type == SDL_EVENT_KEY_DOWN || 
+                    event.type == SDL_EVENT_KEY_UP
+                ) {
+                    // If the simulation is that far behind, dropping a key is fine
+                    m_key_events.push({
+                        event.key.scancode, event.key.key, event.key.down,
+                        event.key.repeat
+                    });
+                    key_event = true;
                 }
             }
+            if (key_event)
+                wake_simulation();
         }
 
-        uint64_t current_time_ms = SDL_GetTicks();
-        m_board->update(input, current_time_ms);
-
-        m_window.draw(m_board);
+        // The simulation only publishes snapshots when the board changes,
+        // so no new one means the last frame is still right.
+        // Presenting waits for vsync, skipped frames wait for the same time
+        // but wake up early for input.
+        redraw |= m_snapshots.update();
+        // The overlay's frame graph needs every frame
+        redraw |= m_show_overlay;
+        if (redraw) {
+            TRACE_SCOPE("render", "frame");
+            OverlayStats overlay = {};
+            if (m_show_overlay)
+                overlay = collect_overlay_stats();
+            m_window.draw(
+                m_snapshots.read_buffer(), m_show_overlay ? &overlay : nullptr
+            );
+            redraw = false;
+        } else {
+            TRACE_SCOPE("idle", "frame");
+            SDL_WaitEventTimeout(nullptr, (Sint32) frame_ms);
+        }
     }
+
+    m_running = false;
+    wake_simulation();
+    m_sim_thread.join();
+    m_recorder.finish();
 }
 
 App::~App () {
+    if (m_sim_thread.joinable()) {
+        m_running = false;
+        wake_simulation();
+        m_sim_thread.join();
+    }
     delete m_board;
     delete m_player;
 }
@@ -1,15 +1,53 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
 #include <random>
+#include <thread>
 
 #include <SDL3/SDL.h>
 
 #include "../game/Board.hpp"
+#include "../game/BoardSnapshot.hpp"
 #include "../ai/Player.hpp"
+#include "../util/RollingWindow.hpp"
+#include "../util/SpscQueue.hpp"
+#include "../util/TripleBuffer.hpp"
+#include "Replay.hpp"
 #include "gfx/Window.hpp"
 
-/* Controls the game loop. */
+/* A key press or release, passed from the window to the simulation */
+struct KeyEvent {
+    SDL_Scancode scancode;
+    SDL_Keycode key;
+    bool down;
+    // Sent again by the OS while the key stays down
+    bool repeat;
+};
+
+/* Performance numbers from the simulation thread, for the overlay */
+struct SimStats {
+    uint64_t best_move_last_ns;
+    uint64_t best_move_p99_ns;
+    uint64_t search_avg_ns;
+    uint32_t candidates;
+    uint8_t search_depth;
+    size_t pieces_placed;
+};
+
+/*
+ * Controls the game loop.
+ * The game and the player run on their own thread, the main thread handles
+ * SDL events and draws the newest snapshot of the board, so neither can slow
+ * the other down.
+ * The simulation thread sleeps until the next thing is due (gravity, the
+ * agent's next input, a held key repeating) or a key event arrives.
+ * Snapshots are only published when the board changes and the main thread
+ * only draws when there's a new one, at most once per display refresh.
+ * F3 shows a performance overlay, which draws every refresh while it's up.
+ */
 class App {
 public:
     /**
@@ -22,16 +60,29 @@ public:
     /**
      * Creates a new App with a certain kind of player.
      * @param player An object that can generate moves from the board state.
+     * @param unthrottled Whether the player gets to give inputs as fast as
+     * it can, instead of once every AI_INPUT_INTERVAL_MS.
+     * @param fall_rate How many milliseconds a piece takes to fall a row.
      *
      * APP TAKES CONTROL OF AND DELETES PLAYER IN DESTRUCTOR.
      *
      * Run App.Init() afterwards.
      */
-    explicit App (Player* player);
+    explicit App (
+        Player* player, bool unthrottled = false, uint16_t fall_rate = 250
+    );
 
     /* Resets the game state. */
     void new_game ();
 
+    /**
+     * Records every game from now on to a replay in a directory.
+     * Call before init() to get the first game too.
+     * @param directory Where to save the replays, which has to exist.
+     * @param weights The weights of the agent playing, or nullptr for a human.
+     */
+    void record_replays (const std::string& directory, const Weights* weights);
+
     /**
      * Initializes the Window part of the App.
      * @return True if everything goes well, false otherwise.
@@ -44,6 +95,9 @@ public:
      */
     void run ();
 
+    // Time between the agent's inputs
+    static constexpr uint32_t AI_INPUT_INTERVAL_MS = 20;
+
     /**
      * Destructor: cleans stuff up.
      */
@@ -51,9 +105,86 @@ public:
 
 private:
 
-    std::default_random_engine m_randomgen;
+    /**
+     * The simulation thread's loop.
+     * Runs step() whenever something is due, until the app closes.
+     */
+    void simulate ();
+
+    /**
+     * Advances the game: handles key events, asks the player for input,
+     * updates the board and publishes a snapshot.
+     * @param now_ns The current time from SDL_GetTicksNS().
+     */
+    void step (uint64_t now_ns);
+
+    /**
+     * @param now_ns The current time from SDL_GetTicksNS().
+     * @return When step() needs to run next.
+     */
+    uint64_t next_deadline_ns (uint64_t now_ns) const;
+
+    /**
+     * Wakes the simulation thread up early, e.g. for a key event.
+     */
+    void wake_simulation ();
+
+    /**
+     * SIMULATION THREAD ONLY.
+     * Publishes the player's latest decision time for the overlay.
+     */
+    void publish_sim_stats ();
+
+    /**
+     * MAIN THREAD ONLY.
+     * @return The numbers for the performance overlay.
+     */
+    OverlayStats collect_overlay_stats ();
+
+    RandomEngine m_randomgen;
+    // Every game gets its own seed so it can be replayed
+    uint32_t m_next_seed;
+    // Only touched by the simulation thread once run() has started
     Board* m_board;
     GameWindow m_window;
     bool m_user_input;
+    bool m_unthrottled;
+    uint16_t m_fall_rate;
     Player* m_player;
+
+    std::thread m_sim_thread;
+    std::atomic<bool> m_running;
+    // The time the simulation started, board ticks are milliseconds since then
+    uint64_t m_start_ns;
+    uint64_t m_next_ai_input_ns;
+    uint64_t m_snapshot_count;
+    // The board generation of the newest snapshot, to skip unchanged ones
+    uint64_t m_published_generation;
+
+    // Empty if replays aren't recorded
+    std::string m_replay_directory;
+    ReplayHeader m_replay_header;
+    ReplayRecorder m_recorder;
+
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    bool m_wake_pending;
+    // Which keys are held down, as seen by the simulation thread
+    bool m_keystate[SDL_SCANCODE_COUNT];
+    // Keys pressed since the HumanPlayer last looked, so a tap that's
+    // released before the next step still counts
+    bool m_key_presses[SDL_SCANCODE_COUNT];
+
+    SpscQueue<KeyEvent, 256> m_key_events;
+    TripleBuffer<BoardSnapshot> m_snapshots;
+
+    // Performance overlay, simulation side
+    RollingWindow<uint64_t, 256> m_best_move_ns;
+    uint64_t m_seen_decisions;
+    TripleBuffer<SimStats> m_sim_stats;
+    // Performance overlay, main thread side
+    bool m_show_overlay;
+    uint64_t m_rate_sample_ns;
+    size_t m_rate_sample_pieces;
+    double m_pieces_per_sec;
 };
@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include "FrameExporter.hpp"
+#include "../util/png.hpp"
+#include "../util/trace.hpp"
+
+FrameExporter::FrameExporter (
+    std::string directory, FrameFormat format, size_t thread_count
+)
+    : m_directory(std::move(directory))
+    , m_format(format)
+    , m_frame_count(0)
+    , m_pending(0)
+    , m_max_pending(0)
+    , m_failed(false)
+    , m_pool(thread_count)
+{
+    // Enough to keep every thread busy while the next frames are drawn
+    m_max_pending = 2 * m_pool.get_thread_count();
+}
+
+void FrameExporter::add_frame (
+    std::vector<uint8_t>& rgba, uint32_t width, uint32_t height
+) {
+    {
+        std::unique_lock<std::mutex> lock(m_pending_mutex);
+        m_frame_written.wait(lock, [this] () {
+            return m_pending < m_max_pending;
+        });
+        m_pending++;
+    }
+
+    // std::function has to be copyable, so the pixels go in a shared_ptr
+    auto pixels = std::make_shared<std::vector<uint8_t>>(std::move(rgba));
+    rgba.clear();
+    size_t frame_num = m_frame_count++;
+    m_pool.submit([this, pixels, frame_num, width, height] () {
+        if (!write_frame(frame_num, *pixels, width, height))
+            m_failed = true;
+        {
+            std::lock_guard<std::mutex> lock(m_pending_mutex);
+            m_pending--;
+        }
+        m_frame_written.notify_one();
+    });
+}
+
+bool FrameExporter::write_frame (
+    size_t frame_num, const std::vector<uint8_t>& rgba,
+    uint32_t width, uint32_t height
+) const {
+    TRACE_SCOPE("encode frame", "io");
+    char name[32];
+    std::snprintf(
+        name, sizeof(name), "/frame_%06zu.%s", frame_num,
+        m_format == FrameFormat::PNG ? "png" : "rgba"
+    );
+    std::string path = m_directory + name;
+
+    bool written;
+    if (m_format == FrameFormat::PNG) {
+        written = png::write_rgba(path, rgba.data(), width, height);
+    } else {
+        std::ofstream out(path, std::ios::binary);
+        out.write((const char*) rgba.data(), (std::streamsize) rgba.size());
+        written = (bool) out.flush();
+    }
+
+    if (!written)
+        std::cout << "Failed to write frame " << path << std::endl;
+    return written;
+}
+
+bool FrameExporter::finish () {
+    m_pool.wait();
+    return !m_failed;
+}
+
+size_t FrameExporter::get_frame_count () const {
+    return m_frame_count;
+}
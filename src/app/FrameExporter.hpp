@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../util/ThreadPool.hpp"
+
+/* How exported frames are stored */
+enum class FrameFormat {
+    RGBA, // Raw pixels, 4 bytes each, row by row with no header
+    PNG
+};
+
+/*
+ * Writes a sequence of frames to numbered files in a directory
+ * (frame_000000.png, frame_000001.png, ...).
+ * Frames are encoded and written on a thread pool so whoever draws them can
+ * keep going. If the pool falls too far behind, add_frame() waits for it so
+ * memory use stays bounded.
+ */
+class FrameExporter {
+public:
+    /**
+     * @param directory Where to write the frames, which has to exist.
+     * @param format How to store the frames.
+     * @param thread_count How many threads encode frames, 0 for one per core.
+     */
+    FrameExporter (std::string directory, FrameFormat format, size_t thread_count = 0);
+
+    /**
+     * Queues a frame to be written.
+     * @param rgba The pixels, 4 bytes each, row by row with no padding.
+     * Taken over by the exporter, it's left empty.
+     * @param width The width of the frame in pixels.
+     * @param height The height of the frame in pixels.
+     */
+    void add_frame (std::vector<uint8_t>& rgba, uint32_t width, uint32_t height);
+
+    /**
+     * Blocks until every frame has been written.
+     * @return True if every frame was written, false otherwise.
+     */
+    bool finish ();
+
+    /**
+     * @return How many frames have been added.
+     */
+    [[nodiscard]] size_t get_frame_count () const;
+
+private:
+    /**
+     * Encodes and writes one frame, runs on the pool.
+     * @return True if the frame was written, false otherwise.
+     */
+    bool write_frame (
+        size_t frame_num, const std::vector<uint8_t>& rgba,
+        uint32_t width, uint32_t height
+    ) const;
+
+    std::string m_directory;
+    FrameFormat m_format;
+    size_t m_frame_count;
+
+    // Frames that have been added but not written yet
+    size_t m_pending;
+    size_t m_max_pending;
+    std::mutex m_pending_mutex;
+    std::condition_variable m_frame_written;
+    std::atomic<bool> m_failed;
+
+    // Last, so it's destroyed (and finishes its tasks) before the rest
+    ThreadPool m_pool;
+};
@@ -1,41 +1,53 @@
+#include <algorithm>
+
 #include <SDL3/SDL.h>
 
 #include "HumanPlayer.hpp"
 
-bool HumanPlayer::persistent_key (const bool* keystate, KeyHandler& k) {
-    bool ret = false;
-    if (keystate[k.scancode])
+HumanPlayer::HumanPlayer (const bool* keystate, bool* presses)
+    : m_keystate(keystate)
+    , m_presses(presses)
+{}
+
+bool HumanPlayer::persistent_key (
+    const bool* keystate, bool* presses, KeyHandler& k, uint64_t now_ns
+) {
+    // A tap that was already released by now still fires once
+    bool pressed = presses[k.scancode];
+    presses[k.scancode] = false;
+    if (!keystate[k.scancode])
     {
-        if (k.current_delay == 0)
-        {
-            ret = true;
-            k.input_count++;
-        }
-        SDL_Delay(1); // Delay one millisecond for framerate-independence
-        k.current_delay++;
-        if (k.input_count == 1)
-        {
-            if (k.current_delay >= k.first_delay)
-                k.current_delay = 0;
-        }
-        else if (k.current_delay >= k.delay)
-            k.current_delay = 0;
+        k.held = false;
+        return pressed;
     }
-    else
+
+    // Pressed again since the last input, so the delays start over
+    if (!k.held || pressed)
     {
-        k.current_delay = 0;
-        k.input_count = 0;
+        k.held = true;
+        k.next_input_ns = now_ns + k.first_delay * SDL_NS_PER_MS;
+        return true;
     }
-    return ret;
+
+    if (now_ns >= k.next_input_ns)
+    {
+        // Step from the deadline rather than from now, so repeats
+        // stay evenly spaced even if we woke up late. Repeats missed
+        // during a stall are skipped rather than fired in a burst
+        uint64_t delay_ns = k.delay * SDL_NS_PER_MS;
+        k.next_input_ns += ((now_ns - k.next_input_ns) / delay_ns + 1) * delay_ns;
+        return true;
+    }
+    return false;
 }
 
-Input HumanPlayer::user_input_from_keys (const bool* keystate) {
+Input HumanPlayer::user_input_from_keys (const bool* keystate, bool* presses, uint64_t now_ns) {
     Input input = {
-        .move_left           = persistent_key(keystate, m_move_left),
-        .move_right          = persistent_key(keystate, m_move_right),
-        .rot_clockwise       = persistent_key(keystate, m_rot_clockwise),
-        .rot_count_clockwise = persistent_key(keystate, m_rot_count_clockwise),
-        .soft_drop           = persistent_key(keystate, m_soft_drop),
+        .move_left           = persistent_key(keystate, presses, m_move_left, now_ns),
+        .move_right          = persistent_key(keystate, presses, m_move_right, now_ns),
+        .rot_clockwise       = persistent_key(keystate, presses, m_rot_clockwise, now_ns),
+        .rot_count_clockwise = persistent_key(keystate, presses, m_rot_count_clockwise, now_ns),
+        .soft_drop           = persistent_key(keystate, presses, m_soft_drop, now_ns),
     };
 
 
@@ -43,5 +55,17 @@ Input HumanPlayer::user_input_from_keys (const bool* keystate) {
 }
 
 Input HumanPlayer::gen_input([[maybe_unused]] Board* board) {
-    return user_input_from_keys(SDL_GetKeyboardState(nullptr));
+    return user_input_from_keys(m_keystate, m_presses, SDL_GetTicksNS());
+}
+
+uint64_t HumanPlayer::next_deadline_ns () const {
+    uint64_t deadline = UINT64_MAX;
+    for (const KeyHandler* k : {
+        &m_move_left, &m_move_right, &m_soft_drop,
+        &m_rot_clockwise, &m_rot_count_clockwise
+    }) {
+        if (k->held)
+            deadline = std::min(deadline, k->next_input_ns);
+    }
+    return deadline;
 }
@@ -2,39 +2,68 @@
 
 #include "../ai/Player.hpp"
 
-/* Holds data corresponding to an input */
+/*
+ * Holds data corresponding to an input
+ * A held key fires once when pressed, again after first_delay (DAS),
+ * then every delay (ARR). Delays are in milliseconds.
+ */
 struct KeyHandler {
     uint16_t scancode;
     uint8_t delay;
     uint8_t first_delay; // Add more input buffer between the first and second input
-    uint8_t current_delay;
-    uint8_t input_count;
+    bool held;
+    uint64_t next_input_ns; // When the key fires next if it's still held
 };
 
 class HumanPlayer : public Player {
 public:
+    /**
+     * Creates a new HumanPlayer.
+     * @param keystate Which keys are down, indexed by SDL scancode.
+     * Must outlive the player.
+     * @param presses Which keys were pressed since the last input, indexed
+     * by SDL scancode. The player clears them as it reads them. Must outlive
+     * the player.
+     */
+    HumanPlayer (const bool* keystate, bool* presses);
+
     Input gen_input ([[maybe_unused]] Board* board) override;
 
+    /**
+     * @return When the next held key repeats.
+     */
+    uint64_t next_deadline_ns () const override;
+
 private:
 
     /**
-     * Uses SDL to get game input from the keyboard.
-     * @param keystate the return of SDL_GetKeyboardState().
+     * Gets game input from the keyboard.
+     * @param keystate Which keys are down, indexed by SDL scancode.
+     * @param presses Which keys were pressed since the last input.
+     * @param now_ns The current time from SDL_GetTicksNS().
      * @return An Input object.
      */
-    Input user_input_from_keys (const bool* keystate);
+    Input user_input_from_keys (const bool* keystate, bool* presses, uint64_t now_ns);
 
     /**
      * Prevents a "held" key from firing over and over again
-     * @param keystate The return of SDL_GetKeyboardState()
+     * @param keystate Which keys are down, indexed by SDL scancode.
+     * @param presses Which keys were pressed since the last input, cleared
+     * for this key.
      * @param k Which KeyHandler to use.
+     * @param now_ns The current time from SDL_GetTicksNS().
      * @return True if the input should be active.
      */
-    static bool persistent_key (const bool* keystate, KeyHandler& k);
+    static bool persistent_key (
+        const bool* keystate, bool* presses, KeyHandler& k, uint64_t now_ns
+    );
+
+    const bool* m_keystate;
+    bool* m_presses;
 
-    KeyHandler m_move_left = {SDL_SCANCODE_LEFT, 25, 50, 0, 0};
-    KeyHandler m_move_right = {SDL_SCANCODE_RIGHT, 25, 50, 0, 0};
-    KeyHandler m_soft_drop = {SDL_SCANCODE_DOWN, 20, 20, 0, 0};
-    KeyHandler m_rot_clockwise = {SDL_SCANCODE_UP, 75, 75, 0, 0};
-    KeyHandler m_rot_count_clockwise = {SDL_SCANCODE_Z, 75, 75, 0, 0};
+    KeyHandler m_move_left = {SDL_SCANCODE_LEFT, 25, 50, false, 0};
+    KeyHandler m_move_right = {SDL_SCANCODE_RIGHT, 25, 50, false, 0};
+    KeyHandler m_soft_drop = {SDL_SCANCODE_DOWN, 20, 20, false, 0};
+    KeyHandler m_rot_clockwise = {SDL_SCANCODE_UP, 75, 75, false, 0};
+    KeyHandler m_rot_count_clockwise = {SDL_SCANCODE_Z, 75, 75, false, 0};
 };
@@ -0,0 +1,222 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "Replay.hpp"
+#include "../util/bytes.hpp"
+
+static constexpr char MAGIC[4] = {'T', 'R', 'P', 'L'};
+// 2: seeds are for RandomEngine. Version 1 files could have been recorded
+// with a different standard library's std::default_random_engine
+static constexpr uint16_t FORMAT_VERSION = 2;
+static constexpr size_t WEIGHT_COUNT = sizeof(Weights) / sizeof(double);
+static constexpr size_t HEADER_SIZE = 4 + 2 + 2 + 4 + 2 + 1 + WEIGHT_COUNT * 8;
+
+std::string replay_path (const std::string& directory, uint32_t seed) {
+    return directory + "/replay_" + std::to_string(seed) + ".trp";
+}
+
+uint8_t pack_input (const Input& input) {
+    return input.move_left |
+        input.move_right << 1 |
+        input.rot_clockwise << 2 |
+        input.rot_count_clockwise << 3 |
+        input.soft_drop << 4 |
+        input.hard_drop << 5 |
+        input.hold_piece << 6;
+}
+
+Input unpack_input (uint8_t bits) {
+    return {
+        .move_left = (bits & 1) != 0,
+        .move_right = (bits & 2) != 0,
+        .rot_clockwise = (bits & 4) != 0,
+        .rot_count_clockwise = (bits & 8) != 0,
+        .soft_drop = (bits & 16) != 0,
+        .hard_drop = (bits & 32) != 0,
+        .hold_piece = (bits & 64) != 0
+    };
+}
+
+ReplayRecorder::ReplayRecorder ()
+    : m_writer()
+    , m_last_ticks(0)
+{}
+
+bool ReplayRecorder::start (const std::string& path, const ReplayHeader& header) {
+    finish();
+    if (!m_writer.open(path)) {
+        std::cout << "ERR: Could not open replay " << path << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> out(MAGIC, MAGIC + sizeof(MAGIC));
+    put_le(out, FORMAT_VERSION, 2);
+    put_le(out, header.rules_version, 2);
+    put_le(out, header.seed, 4);
+    put_le(out, header.fall_rate, 2);
+    put_le(out, header.has_weights, 1);
+    double weights[WEIGHT_COUNT];
+    std::memcpy(weights, &header.weights, sizeof(weights));
+    for (double weight : weights) {
+        uint64_t bits;
+        std::memcpy(&bits, &weight, sizeof(bits));
+        put_le(out, bits, 8);
+    }
+    m_writer.write(out.data(), out.size());
+    m_last_ticks = 0;
+    return true;
+}
+
+void ReplayRecorder::update (Board& board, Input& input, uint32_t ticks) {
+    bool spawns = board.get_falling_piece() == 0;
+    uint32_t fall_ticks = board.get_next_fall_ticks();
+    board.update(input, ticks);
+    if (!m_writer.is_open())
+        return;
+
+    // Without inputs, an update only does something if a piece spawned or fell
+    uint8_t bits = pack_input(input);
+    if (bits == 0 && !spawns && board.get_next_fall_ticks() == fall_ticks)
+        return;
+
+    // Ticks only go up, so the difference is small and fits in a byte or two
+    uint8_t event[6];
+    size_t size = 0;
+    uint32_t delta = ticks - m_last_ticks;
+    do {
+        event[size++] = (delta & 0x7F) | (delta > 0x7F ? 0x80 : 0);
+        delta >>= 7;
+    } while (delta > 0);
+    event[size++] = bits;
+    m_writer.write(event, size);
+    m_last_ticks = ticks;
+}
+
+bool ReplayRecorder::finish () {
+    if (!m_writer.is_open())
+        return true;
+    bool written = m_writer.close();
+    if (!written)
+        std::cout << "ERR: Could not write replay" << std::endl;
+    return written;
+}
+
+bool ReplayRecorder::is_recording () const {
+    return m_writer.is_open();
+}
+
+ReplayPlayer::ReplayPlayer ()
+    : m_header()
+    , m_next_event(0)
+{}
+
+bool ReplayPlayer::load (const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cout << "ERR: Could not open replay " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> data(
+        (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>()
+    );
+    return load(data);
+}
+
+bool ReplayPlayer::load (const std::vector<uint8_t>& data) {
+    if (data.size() < HEADER_SIZE || std::memcmp(data.data(), MAGIC, 4) != 0) {
+        std::cout << "ERR: Not a replay" << std::endl;
+        return false;
+    }
+    if (get_le(&data[4], 2) != FORMAT_VERSION) {
+        std::cout << "ERR: Unknown replay format" << std::endl;
+        return false;
+    }
+
+    m_header.rules_version = get_le(&data[6], 2);
+    m_header.seed = get_le(&data[8], 4);
+    m_header.fall_rate = get_le(&data[12], 2);
+    m_header.has_weights = data[14] != 0;
+    double weights[WEIGHT_COUNT];
+    for (size_t i = 0; i < WEIGHT_COUNT; i++) {
+        uint64_t bits = get_le(&data[15 + i * 8], 8);
+        std::memcpy(&weights[i], &bits, sizeof(bits));
+    }
+    std::memcpy(&m_header.weights, weights, sizeof(weights));
+    if (m_header.rules_version != Board::RULES_VERSION) {
+        std::cout << "ERR: Replay was recorded with rules version "
+                  << m_header.rules_version << ", this is version "
+                  << Board::RULES_VERSION << std::endl;
+        return false;
+    }
+
+    // A recording that was cut off can end partway through an update,
+    // which just gets dropped
+    m_events.clear();
+    uint32_t ticks = 0;
+    size_t pos = HEADER_SIZE;
+    while (pos < data.size()) {
+        uint32_t delta = 0;
+        uint8_t shift = 0;
+        while (pos < data.size() && (data[pos] & 0x80) && shift < 28) {
+            delta |= (uint32_t) (data[pos++] & 0x7F) << shift;
+            shift += 7;
+        }
+        if (pos + 1 >= data.size())
+            break;
+        delta |= (uint32_t) data[pos++] << shift;
+        ticks += delta;
+        m_events.push_back({ticks, unpack_input(data[pos++])});
+    }
+
+    restart();
+    return true;
+}
+
+void ReplayPlayer::restart () {
+    m_random.seed(m_header.seed);
+    m_board = std::make_unique<Board>(m_header.fall_rate, m_random);
+    m_next_event = 0;
+}
+
+bool ReplayPlayer::step () {
+    if (finished())
+        return false;
+    ReplayEvent& event = m_events[m_next_event++];
+    Input input = event.input;
+    m_board->update(input, event.ticks);
+    return true;
+}
+
+void ReplayPlayer::play_to_ticks (uint32_t ticks) {
+    while (!finished() && m_events[m_next_event].ticks <= ticks)
+        step();
+}
+
+void ReplayPlayer::seek_piece (size_t pieces) {
+    if (m_board->get_pieces_placed() > pieces)
+        restart();
+    while (!finished() && m_board->get_pieces_placed() < pieces)
+        step();
+}
+
+uint32_t ReplayPlayer::get_next_ticks () const {
+    if (m_events.empty())
+        return 0;
+    if (finished())
+        return m_events.back().ticks;
+    return m_events[m_next_event].ticks;
+}
+
+bool ReplayPlayer::finished () const {
+    return m_next_event >= m_events.size();
+}
+
+const ReplayHeader& ReplayPlayer::get_header () const {
+    return m_header;
+}
+
+Board& ReplayPlayer::get_board () {
+    return *m_board;
+}
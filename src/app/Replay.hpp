@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../ai/genetic/eval.hpp"
+#include "../game/Board.hpp"
+#include "../util/BufferedWriter.hpp"
+
+/*
+ * Replays store everything needed to play a game again exactly: a header
+ * with the seed, the rules version, the fall rate and the agent's weights,
+ * then every Board::update() that did something, as its tick and inputs.
+ * Updates without inputs only matter when gravity moves the piece, so the
+ * rest are left out.
+ *
+ * File layout, little endian:
+ *   "TRPL", format version (u16), rules version (u16),
+ *   seed for RandomEngine (u32), fall rate (u16), has weights (u8),
+ *   weights (6 x f64),
+ *   then per update: ticks since the last update (LEB128), inputs (u8).
+ */
+
+/* What a replay needs to set the game up again */
+struct ReplayHeader {
+    uint32_t seed;
+    uint16_t fall_rate;
+    uint16_t rules_version;
+    bool has_weights;
+    Weights weights;
+};
+
+/* One update of the board */
+struct ReplayEvent {
+    uint32_t ticks;
+    Input input;
+};
+
+/**
+ * @param directory The directory replays are saved to.
+ * @param seed The seed of the game.
+ * @return Where the replay of that game goes.
+ */
+std::string replay_path (const std::string& directory, uint32_t seed);
+
+/**
+ * @param input Some inputs.
+ * @return The inputs as bits, move_left first.
+ */
+uint8_t pack_input (const Input& input);
+
+/**
+ * @param bits Inputs from pack_input().
+ * @return The inputs.
+ */
+Input unpack_input (uint8_t bits);
+
+/*
+ * Records a game as it's played. Use update() in place of Board::update().
+ * Writes go through a BufferedWriter, so recording doesn't wait on the disk.
+ */
+class ReplayRecorder {
+public:
+    ReplayRecorder ();
+
+    /**
+     * Starts recording a new game, finishing the one before.
+     * @param path Where to write the replay.
+     * @param header How the game was set up.
+     * @return True if the file could be opened, false otherwise.
+     */
+    bool start (const std::string& path, const ReplayHeader& header);
+
+    /**
+     * Updates the board and records the update if it did anything.
+     * @param board The board being recorded.
+     * @param input The player's inputs.
+     * @param ticks The number of milliseconds since initialization.
+     */
+    void update (Board& board, Input& input, uint32_t ticks);
+
+    /**
+     * Writes the rest of the replay and closes it.
+     * @return True if the whole replay was written, false otherwise.
+     */
+    bool finish ();
+
+    /**
+     * @return True if a game is being recorded.
+     */
+    [[nodiscard]] bool is_recording () const;
+
+private:
+    BufferedWriter m_writer;
+    uint32_t m_last_ticks;
+};
+
+/*
+ * Plays a replay back on a board of its own, as fast as it's asked to.
+ * Seeking backwards starts the game over and plays it up to that point,
+ * which only takes a few milliseconds even for long games.
+ */
+class ReplayPlayer {
+public:
+    ReplayPlayer ();
+
+    /**
+     * Reads a replay and sets its game up.
+     * @param path Where the replay is.
+     * @return True if the replay could be read and played with these rules,
+     * false otherwise.
+     */
+    bool load (const std::string& path);
+
+    /**
+     * Reads a replay from memory and sets its game up.
+     * @param data The contents of a replay file.
+     * @return True if the replay could be played with these rules, false
+     * otherwise.
+     */
+    bool load (const std::vector<uint8_t>& data);
+
+    /**
+     * Starts the game over from before the first update.
+     */
+    void restart ();
+
+    /**
+     * Does the next update.
+     * @return False if there were none left, true otherwise.
+     */
+    bool step ();
+
+    /**
+     * Plays every update up to and including a tick.
+     * @param ticks The tick to play up to.
+     */
+    void play_to_ticks (uint32_t ticks);
+
+    /**
+     * Plays until a number of pieces have been placed, or the replay ends.
+     * Starts over first if the game is already past that.
+     * @param pieces How many pieces should be placed.
+     */
+    void seek_piece (size_t pieces);
+
+    /**
+     * @return The tick of the next update, or of the last one if there are
+     * none left.
+     */
+    [[nodiscard]] uint32_t get_next_ticks () const;
+
+    /**
+     * @return True if every update has been played.
+     */
+    [[nodiscard]] bool finished () const;
+
+    /**
+     * @return How the game was set up.
+     */
+    [[nodiscard]] const ReplayHeader& get_header () const;
+
+    /**
+     * @return The board the replay plays on.
+     */
+    [[nodiscard]] Board& get_board ();
+
+    ReplayPlayer (const ReplayPlayer&) = delete;
+    ReplayPlayer& operator= (const ReplayPlayer&) = delete;
+
+private:
+    ReplayHeader m_header;
+    std::vector<ReplayEvent> m_events;
+    size_t m_next_event;
+
+    RandomEngine m_random;
+    std::unique_ptr<Board> m_board;
+};
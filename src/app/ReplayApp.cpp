@@ -0,0 +1,97 @@
+#include <algorithm>
+
+#include <SDL3/SDL.h>
+
+#include "ReplayApp.hpp"
+#include "../util/trace.hpp"
+
+ReplayApp::ReplayApp ()
+    : m_window()
+    , m_player()
+    , m_snapshot()
+    , m_snapshot_count(0)
+    , m_drawn_generation(UINT64_MAX)
+    , m_paused(false)
+    , m_speed(1)
+    , m_base_ticks(0)
+    , m_base_ns(0)
+{}
+
+bool ReplayApp::init (const std::string& path) {
+    return m_player.load(path) && m_window.init();
+}
+
+void ReplayApp::sync_clock (uint64_t now_ns) {
+    m_base_ns = now_ns;
+    // The board doesn't keep its tick, the next update's is close enough
+    m_base_ticks = m_player.get_next_ticks();
+    m_drawn_generation = UINT64_MAX;
+}
+
+void ReplayApp::handle_key (SDL_Keycode key, uint64_t now_ns) {
+    size_t pieces = m_player.get_board().get_pieces_placed();
+    switch (key) {
+        case SDLK_SPACE:
+            m_paused = !m_paused;
+            break;
+        case SDLK_RIGHT:
+            m_player.seek_piece(pieces + SEEK_PIECES);
+            break;
+        case SDLK_LEFT:
+            m_player.seek_piece(pieces > SEEK_PIECES ? pieces - SEEK_PIECES : 0);
+            break;
+        case SDLK_UP:
+            m_speed = std::min(m_speed * 2, 64.0);
+            break;
+        case SDLK_DOWN:
+            m_speed = std::max(m_speed / 2, 1.0 / 8);
+            break;
+        case SDLK_HOME:
+            m_player.restart();
+            break;
+        default:
+            return;
+    }
+    sync_clock(now_ns);
+}
+
+void ReplayApp::run () {
+    TRACE_THREAD_NAME("main");
+    const uint32_t frame_ms = m_window.get_frame_interval_ms();
+    sync_clock(SDL_GetTicksNS());
+
+    bool end = false;
+    while (!end) {
+        TRACE_SCOPE("frame", "frame");
+        uint64_t now_ns = SDL_GetTicksNS();
+
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_EVENT_QUIT)
+                end = true;
+            if (event.type == SDL_EVENT_WINDOW_EXPOSED)
+                m_drawn_generation = UINT64_MAX;
+            if (event.type == SDL_EVENT_KEY_DOWN)
+                handle_key(event.key.key, now_ns);
+        }
+
+        if (m_paused) {
+            sync_clock(now_ns);
+        } else {
+            auto elapsed_ms = (uint64_t) ((now_ns - m_base_ns) * m_speed / SDL_NS_PER_MS);
+            m_player.play_to_ticks(m_base_ticks + (uint32_t) elapsed_ms);
+        }
+
+        // Same as App::run(), only draw when the board changed
+        Board& board = m_player.get_board();
+        if (board.get_generation() != m_drawn_generation) {
+            TRACE_SCOPE("render", "frame");
+            m_drawn_generation = board.get_generation();
+            m_snapshot.capture(board, ++m_snapshot_count);
+            m_window.draw(m_snapshot);
+        } else {
+            TRACE_SCOPE("idle", "frame");
+            SDL_WaitEventTimeout(nullptr, (Sint32) frame_ms);
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+
+#include "Replay.hpp"
+#include "../game/BoardSnapshot.hpp"
+#include "gfx/Window.hpp"
+
+/*
+ * Watches a replay in real time.
+ * Space pauses, left and right jump 10 pieces back or ahead, up and down
+ * double or halve the speed and Home starts over. Everything happens on the
+ * main thread: replaying is so much cheaper than drawing that a separate
+ * simulation thread wouldn't buy anything.
+ */
+class ReplayApp {
+public:
+    /**
+     * Creates a new ReplayApp.
+     * Run init() afterwards.
+     */
+    ReplayApp ();
+
+    /**
+     * Loads the replay and opens the window.
+     * @param path Where the replay is.
+     * @return True if everything goes well, false otherwise.
+     */
+    bool init (const std::string& path);
+
+    /**
+     * Plays the replay.
+     * Only exits when the window is closed by the user.
+     */
+    void run ();
+
+    // How many pieces the arrow keys skip
+    static constexpr size_t SEEK_PIECES = 10;
+
+private:
+    /**
+     * Makes the replay clock continue from where the board is now.
+     * @param now_ns The current time from SDL_GetTicksNS().
+     */
+    void sync_clock (uint64_t now_ns);
+
+    /**
+     * Handles a key press.
+     * @param key Which key was pressed.
+     * @param now_ns The current time from SDL_GetTicksNS().
+     */
+    void handle_key (SDL_Keycode key, uint64_t now_ns);
+
+    GameWindow m_window;
+    ReplayPlayer m_player;
+    BoardSnapshot m_snapshot;
+    uint64_t m_snapshot_count;
+    uint64_t m_drawn_generation;
+
+    bool m_paused;
+    double m_speed;
+    // Replay ticks at the moment the clock last synced, and when that was
+    uint32_t m_base_ticks;
+    uint64_t m_base_ns;
+};
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <chrono>
+
+#include <SDL3/SDL.h>
+
+#include "SpectatorApp.hpp"
+#include "../util/trace.hpp"
+
+// Longest a worker sleeps for, even with nothing due
+constexpr uint64_t MAX_WAIT_NS = 100 * SDL_NS_PER_MS;
+
+SpectatorApp::SpectatorApp (
+    const std::vector<Weights>& population, bool unthrottled
+)
+    : m_window()
+    , m_unthrottled(unthrottled)
+    , m_seed((uint32_t) std::chrono::system_clock::now().time_since_epoch().count())
+    , m_running(false)
+    , m_restarts(0)
+{
+    for (const Weights& weights : population) {
+        m_games.push_back(std::make_unique<Game>());
+        m_games.back()->weights = weights;
+    }
+}
+
+bool SpectatorApp::init () {
+    if (!m_window.init())
+        return false;
+
+    uint64_t now_ns = SDL_GetTicksNS();
+    for (size_t i = 0; i < m_games.size(); i++)
+        new_game(*m_games[i], m_seed + i, now_ns);
+    return true;
+}
+
+void SpectatorApp::new_game (Game& game, uint32_t seed, uint64_t now_ns) {
+    game.random.seed(seed);
+    game.board = std::make_unique<Board>(250, game.random);
+    game.agent = std::make_unique<Agent>(true, game.weights);
+    game.start_ns = now_ns;
+    game.next_ai_input_ns = now_ns;
+    // The new board starts counting generations again
+    game.published_generation = UINT64_MAX;
+}
+
+uint64_t SpectatorApp::step (Game& game, uint64_t now_ns) const {
+    Board& board = *game.board;
+
+    bool ai_input_due = !board.game_over() &&
+        (m_unthrottled || now_ns >= game.next_ai_input_ns);
+    if (ai_input_due && !m_unthrottled) {
+        // Skip any inputs we were too late for, keeping the same cadence
+        const uint64_t interval_ns = AI_INPUT_INTERVAL_MS * SDL_NS_PER_MS;
+        game.next_ai_input_ns +=
+            ((now_ns - game.next_ai_input_ns) / interval_ns + 1) * interval_ns;
+    }
+
+    Input input = {};
+    if (ai_input_due)
+        input = game.agent->gen_input(&board);
+    auto ticks = (uint32_t) ((now_ns - game.start_ns) / SDL_NS_PER_MS);
+    board.update(input, ticks);
+
+    if (board.get_generation() != game.published_generation) {
+        game.published_generation = board.get_generation();
+        BoardSnapshot& snapshot = game.snapshots.write_buffer();
+        snapshot.capture(board, ++game.snapshot_count);
+        game.snapshots.publish();
+    }
+
+    // Finished games only change when they're restarted
+    if (board.game_over())
+        return UINT64_MAX;
+    if (board.get_falling_piece() == 0)
+        return now_ns;
+
+    uint64_t fall_ns = game.start_ns + board.get_next_fall_ticks() * SDL_NS_PER_MS;
+    uint64_t input_ns = m_unthrottled ? now_ns : game.next_ai_input_ns;
+    return std::min(fall_ns, input_ns);
+}
+
+void SpectatorApp::work (size_t first_game, size_t worker_count) {
+    TRACE_THREAD_NAME("spectator worker");
+    uint32_t restarts = m_restarts.load();
+
+    while (m_running.load(std::memory_order_relaxed)) {
+        TRACE_SCOPE("step", "sim");
+        uint64_t now_ns = SDL_GetTicksNS();
+        uint32_t requested = m_restarts.load(std::memory_order_relaxed);
+        bool restart = requested != restarts;
+        restarts = requested;
+
+        uint64_t deadline_ns = now_ns + MAX_WAIT_NS;
+        for (size_t i = first_game; i < m_games.size(); i += worker_count) {
+            Game& game = *m_games[i];
+            if (restart)
+                new_game(game, m_seed + restarts * m_games.size() + i, now_ns);
+            deadline_ns = std::min(deadline_ns, step(game, now_ns));
+        }
+
+        now_ns = SDL_GetTicksNS();
+        if (deadline_ns > now_ns)
+            SDL_DelayNS(deadline_ns - now_ns);
+    }
+}
+
+void SpectatorApp::run () {
+    TRACE_THREAD_NAME("main");
+    m_running = true;
+
+    // Leave a core for the main thread
+    size_t worker_count = std::thread::hardware_concurrency();
+    worker_count = worker_count > 1 ? worker_count - 1 : 1;
+    worker_count = std::min(worker_count, std::max<size_t>(m_games.size(), 1));
+    for (size_t i = 0; i < worker_count; i++)
+        m_workers.emplace_back(&SpectatorApp::work, this, i, worker_count);
+
+    std::vector<const BoardSnapshot*> boards(m_games.size());
+    const uint32_t frame_ms = m_window.get_frame_interval_ms();
+    // Draw the first frame even if no game has started yet
+    bool redraw = true;
+    bool end = false;
+    while (!end) {
+        TRACE_SCOPE("frame", "frame");
+
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_EVENT_QUIT)
+                end = true;
+            if (event.type == SDL_EVENT_WINDOW_EXPOSED)
+                redraw = true;
+            if (event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_R)
+                m_restarts++;
+        }
+
+        for (size_t i = 0; i < m_games.size(); i++) {
+            redraw |= m_games[i]->snapshots.update();
+            boards[i] = &m_games[i]->snapshots.read_buffer();
+        }
+
+        // Same as App::run(), only draw when a board changed
+        if (redraw) {
+            TRACE_SCOPE("render", "frame");
+            m_window.draw_grid(boards);
+            redraw = false;
+        } else {
+            TRACE_SCOPE("idle", "frame");
+            SDL_WaitEventTimeout(nullptr, (Sint32) frame_ms);
+        }
+    }
+
+    m_running = false;
+    for (std::thread& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+}
+
+SpectatorApp::~SpectatorApp () {
+    m_running = false;
+    for (std::thread& worker : m_workers) {
+        if (worker.joinable())
+            worker.join();
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../ai/genetic/Agent.hpp"
+#include "../game/Board.hpp"
+#include "../game/BoardSnapshot.hpp"
+#include "../util/TripleBuffer.hpp"
+#include "gfx/Window.hpp"
+
+/*
+ * Shows many agents playing at once, each on its own board, in a grid.
+ * The games are split between a few worker threads, which publish a snapshot
+ * of a board whenever it changes. The main thread handles SDL events and
+ * draws the newest snapshot of every board.
+ */
+class SpectatorApp {
+public:
+    /**
+     * Creates a new SpectatorApp.
+     * @param population The weights of each agent to watch, one board each.
+     * @param unthrottled Whether the agents get to give inputs as fast as
+     * they can, instead of once every AI_INPUT_INTERVAL_MS.
+     *
+     * Run init() afterwards.
+     */
+    explicit SpectatorApp (
+        const std::vector<Weights>& population, bool unthrottled = false
+    );
+
+    /**
+     * Initializes the window and starts the first games.
+     * @return True if everything goes well, false otherwise.
+     */
+    bool init ();
+
+    /**
+     * Starts running the games.
+     * Only exits when the window is closed by the user.
+     */
+    void run ();
+
+    // Time between each agent's inputs
+    static constexpr uint32_t AI_INPUT_INTERVAL_MS = 20;
+
+    /**
+     * Destructor: stops the worker threads.
+     */
+    ~SpectatorApp ();
+
+private:
+    /* One agent playing on one board, only touched by its worker thread */
+    struct Game {
+        Weights weights;
+        RandomEngine random;
+        std::unique_ptr<Board> board;
+        std::unique_ptr<Agent> agent;
+        uint64_t start_ns;
+        uint64_t next_ai_input_ns;
+        uint64_t published_generation;
+        uint64_t snapshot_count;
+        TripleBuffer<BoardSnapshot> snapshots;
+    };
+
+    /**
+     * Starts a new game on a board with a fresh agent.
+     * @param game The game to reset.
+     * @param seed The seed for the piece randomizer.
+     * @param now_ns The current time from SDL_GetTicksNS().
+     */
+    static void new_game (Game& game, uint32_t seed, uint64_t now_ns);
+
+    /**
+     * Advances one game: asks the agent for input if it's due, updates the
+     * board and publishes a snapshot if anything changed.
+     * @param game The game to advance.
+     * @param now_ns The current time from SDL_GetTicksNS().
+     * @return When the game needs to be advanced next.
+     */
+    uint64_t step (Game& game, uint64_t now_ns) const;
+
+    /**
+     * A worker thread's loop.
+     * Advances every worker_count-th game starting at first_game until the
+     * app closes.
+     * @param first_game The index of the worker's first game.
+     * @param worker_count How many workers there are.
+     */
+    void work (size_t first_game, size_t worker_count);
+
+    GameWindow m_window;
+    bool m_unthrottled;
+    // Game i of restart r is seeded with m_seed + r * m_games.size() + i
+    uint32_t m_seed;
+    std::vector<std::unique_ptr<Game>> m_games;
+
+    std::vector<std::thread> m_workers;
+    std::atomic<bool> m_running;
+    // Bumped by the main thread to make the workers start every game again
+    std::atomic<uint32_t> m_restarts;
+};
@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "datagen.hpp"
+#include "../ai/PackedPosition.hpp"
+#include "../ai/genetic/Agent.hpp"
+#include "../util/ShardWriter.hpp"
+#include "../util/mix.hpp"
+#include "../util/trace.hpp"
+
+namespace
+{
+    constexpr const char* INDEX_NAME = "index.txt";
+    constexpr auto REPORT_INTERVAL = std::chrono::seconds(1);
+    // How often to check whether the workers are done
+    constexpr auto POLL_INTERVAL = std::chrono::milliseconds(50);
+
+    /* Where a worker is up to, from the index */
+    struct WorkerProgress {
+        uint32_t next_shard;
+        uint64_t next_game;
+        size_t positions;
+    };
+
+    /* Shared by the workers and the thread reporting on them */
+    struct Datagen {
+        const Weights& weights;
+        const DatagenSettings& settings;
+        size_t workers;
+
+        std::mutex index_mutex;
+        std::ofstream index;
+
+        std::atomic<size_t> games{0};
+        std::atomic<size_t> pieces{0};
+        std::atomic<size_t> positions{0};
+        std::atomic<size_t> finished_workers{0};
+        std::atomic<bool> failed{false};
+
+        Datagen (const Weights& weights, const DatagenSettings& settings, size_t workers)
+            : weights(weights)
+            , settings(settings)
+            , workers(workers)
+        {}
+    };
+
+    uint32_t game_seed (uint32_t seed, size_t worker, uint64_t game) {
+        return (uint32_t) mix(mix(mix(seed) + worker) + game);
+    }
+
+    std::string shard_path (const std::string& directory, size_t worker, uint32_t shard) {
+        return directory + "/shard_" + std::to_string(worker) + "_" +
+            std::to_string(shard) + ".tsh";
+    }
+
+    /* The first line of the index, runs can only carry on with the same one */
+    std::string index_header (const DatagenSettings& settings, size_t workers) {
+        std::ostringstream header;
+        header << "seed " << settings.seed << " workers " << workers
+               << " every " << settings.sample_every
+               << " reservoir " << settings.reservoir
+               << " pieces " << settings.max_pieces;
+        return header.str();
+    }
+
+    /**
+     * Reads where each worker got to, and opens the index to add to it.
+     * @param data The run.
+     * @param progress Set to each worker's progress.
+     * @return False if the index is from different settings or can't be
+     * opened.
+     */
+    bool open_index (Datagen& data, std::vector<WorkerProgress>& progress) {
+        const std::string path = std::string(data.settings.directory) + "/" + INDEX_NAME;
+        const std::string header = index_header(data.settings, data.workers);
+        progress.assign(data.workers, {});
+
+        std::ifstream existing(path);
+        std::string line;
+        bool resuming = (bool) std::getline(existing, line);
+        if (resuming && line != header) {
+            std::cout << "ERR: " << path << " was made with different settings ("
+                      << line << ")" << std::endl;
+            return false;
+        }
+        // One line per closed shard: worker, shard, positions, next game
+        while (std::getline(existing, line)) {
+            std::istringstream fields(line);
+            size_t worker, positions;
+            uint32_t shard;
+            uint64_t next_game;
+            if (!(fields >> worker >> shard >> positions >> next_game) ||
+                worker >= data.workers)
+                continue;
+            progress[worker].next_shard = shard + 1;
+            progress[worker].next_game = next_game;
+            progress[worker].positions += positions;
+        }
+        existing.close();
+
+        data.index.open(path, std::ios::app);
+        if (!data.index.is_open()) {
+            std::cout << "ERR: Could not open " << path << std::endl;
+            return false;
+        }
+        if (!resuming)
+            data.index << header << std::endl;
+        return true;
+    }
+
+    /* A position waiting for its game to end so it gets an outcome */
+    struct Sample {
+        PackedPosition position;
+        size_t lines_cleared;
+    };
+
+    /**
+     * Plays one game and samples positions from it.
+     * @param data The run.
+     * @param seed The seed for the piece randomizer and the sampling.
+     * @param samples Set to the sampled positions, labelled.
+     * @return How many pieces were placed.
+     */
+    size_t play_game (const Datagen& data, uint32_t seed, std::vector<Sample>& samples) {
+        TRACE_SCOPE("game", "datagen");
+        const DatagenSettings& settings = data.settings;
+        RandomEngine random_engine(seed);
+        RandomEngine sampler(mix(seed));
+        Board board(250, random_engine);
+        Agent agent(true, data.weights);
+        samples.clear();
+
+        uint32_t ticks = 0;
+        Input input = {};
+        board.update(input, ticks);
+        uint64_t decisions = 0;
+        size_t seen = 0;
+        bool held = false;
+        while (!board.game_over() && board.get_pieces_placed() < settings.max_pieces) {
+            input = agent.gen_input(&board);
+
+            DecisionStats stats = agent.get_decision_stats();
+            if (stats.decisions != decisions) {
+                decisions = stats.decisions;
+                // After a hold the agent decides again, on a board that
+                // can't hold, which a packed position can't tell apart
+                bool after_hold = held;
+                held = agent.get_last_move().hold;
+                if (!after_hold) {
+                    Sample sample = {PackedPosition::pack(board), board.get_lines_cleared()};
+                    sample.position.set_move(agent.get_last_move());
+                    sample.position.set_score((float) agent.get_last_score());
+
+                    if (settings.sample_every > 0) {
+                        if (seen % settings.sample_every == 0)
+                            samples.push_back(sample);
+                    } else if (samples.size() < settings.reservoir) {
+                        samples.push_back(sample);
+                    } else {
+                        // Every position so far has the same odds of being kept
+                        size_t slot = sampler() % (seen + 1);
+                        if (slot < samples.size())
+                            samples[slot] = sample;
+                    }
+                    seen++;
+                }
+            }
+
+            board.update(input, ++ticks);
+        }
+
+        for (Sample& sample : samples)
+            sample.position.set_outcome(
+                (uint32_t) (board.get_lines_cleared() - sample.lines_cleared)
+            );
+        return board.get_pieces_placed();
+    }
+
+    /**
+     * A worker thread's loop.
+     * Plays games until the worker has its share of the positions.
+     * @param data The run.
+     * @param worker Which worker this is.
+     * @param progress Where the worker is up to.
+     */
+    void work (Datagen& data, size_t worker, WorkerProgress progress) {
+        TRACE_THREAD_NAME("datagen worker");
+        const DatagenSettings& settings = data.settings;
+        const size_t quota = (settings.positions + data.workers - 1) / data.workers;
+        ShardWriter writer(PackedPosition::BYTES);
+        std::vector<Sample> samples;
+        size_t shard_positions = 0;
+
+        while (progress.positions < quota && !data.failed) {
+            if (!writer.is_open() &&
+                !writer.open(shard_path(settings.directory, worker, progress.next_shard))) {
+                data.failed = true;
+                break;
+            }
+
+            data.pieces += play_game(
+                data, game_seed(settings.seed, worker, progress.next_game++), samples
+            );
+            // Workers can wait for the disk, a dropped record would cost
+            // the whole shard
+            for (const Sample& sample : samples)
+                writer.write_blocking(&sample.position);
+            shard_positions += samples.size();
+            progress.positions += samples.size();
+            data.games++;
+            data.positions += samples.size();
+
+            if (shard_positions < settings.shard_positions && progress.positions < quota)
+                continue;
+            // A shard that lost records or didn't get written isn't logged,
+            // so a resumed run writes it again
+            if (!writer.close()) {
+                std::cout << "ERR: Could not finish "
+                          << shard_path(settings.directory, worker, progress.next_shard)
+                          << ", " << writer.get_dropped() << " records dropped" << std::endl;
+                data.failed = true;
+                break;
+            }
+            std::lock_guard lock(data.index_mutex);
+            data.index << worker << " " << progress.next_shard << " "
+                       << shard_positions << " " << progress.next_game << std::endl;
+            progress.next_shard++;
+            shard_positions = 0;
+        }
+        data.finished_workers++;
+    }
+}
+
+bool generate_dataset (const Weights& weights, const DatagenSettings& settings) {
+    size_t workers = settings.threads;
+    if (workers == 0)
+        workers = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    Datagen data(weights, settings, workers);
+
+    std::error_code error;
+    std::filesystem::create_directories(settings.directory, error);
+    std::vector<WorkerProgress> progress;
+    if (!open_index(data, progress))
+        return false;
+
+    size_t resumed = 0;
+    for (const WorkerProgress& worker : progress)
+        resumed += worker.positions;
+    data.positions = resumed;
+    if (resumed > 0)
+        std::cout << "Carrying on from " << resumed << " positions" << std::endl;
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < workers; i++)
+        threads.emplace_back(work, std::ref(data), i, progress[i]);
+
+    // Report until every worker is done
+    auto last_report = std::chrono::steady_clock::now();
+    size_t last_positions = resumed, last_games = 0, last_pieces = 0;
+    while (data.finished_workers < workers) {
+        std::this_thread::sleep_for(POLL_INTERVAL);
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report < REPORT_INTERVAL)
+            continue;
+        double seconds = std::chrono::duration<double>(now - last_report).count();
+        size_t positions = data.positions, games = data.games, pieces = data.pieces;
+        std::cout << positions << "/" << settings.positions << " positions, "
+                  << (size_t) ((positions - last_positions) / seconds) << " positions/s, "
+                  << (size_t) ((pieces - last_pieces) / seconds) << " pieces/s, "
+                  << (size_t) ((games - last_games) / seconds) << " games/s"
+                  << std::endl;
+        last_report = now;
+        last_positions = positions;
+        last_games = games;
+        last_pieces = pieces;
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    std::cout << "Wrote " << (data.positions - resumed) << " positions in "
+              << data.games << " games to " << settings.directory << std::endl;
+    return !data.failed;
+}
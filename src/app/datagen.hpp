@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../ai/genetic/eval.hpp"
+
+/* What generate_dataset() makes */
+struct DatagenSettings {
+    const char* directory;
+    size_t positions;          // Stop once the dataset has this many
+    uint32_t sample_every;     // Keep every nth position, 0 to use reservoir
+    uint32_t reservoir;        // With reservoir sampling, positions per game
+    size_t max_pieces;         // Stop a game after this many pieces
+    size_t shard_positions;    // Start a new shard after this many
+    uint32_t seed;
+    size_t threads;            // 0 for one per core
+};
+
+/**
+ * Plays agent games on every core and saves positions sampled from them as
+ * PackedPositions, each with the move the agent played, its score and the
+ * lines the game went on to clear from there.
+ * Every worker thread plays its own games, seeded from the settings' seed,
+ * the worker and the game number, and writes its own shards. Whole games go
+ * into a shard, and a shard is listed in the directory's index once it's
+ * closed. Running again with the same settings carries on after the last
+ * shards in the index, making the same dataset as a run that never stopped.
+ * @param weights The agent's weights.
+ * @param settings What to make and where to put it.
+ * @return True if every shard was written, false otherwise.
+ */
+bool generate_dataset (const Weights& weights, const DatagenSettings& settings);
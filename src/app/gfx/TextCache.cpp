@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "TextCache.hpp"
+
+namespace
+{
+    constexpr SDL_Color WHITE = {255, 255, 255, 255};
+    // Enough digits for any size_t
+    constexpr size_t MAX_DIGITS = 20;
+}
+
+TextCache::TextCache ()
+    : m_renderer(nullptr)
+    , m_font(nullptr)
+    , m_digits(nullptr)
+    , m_digit_rects()
+    , m_digit_h(0)
+    , m_atlas_w(0)
+    , m_draw_calls(0)
+{}
+
+bool TextCache::init (SDL_Renderer* renderer, TTF_Font* font) {
+    m_renderer = renderer;
+    m_font = font;
+    if (m_font == nullptr) {
+        std::cout << "Failed to load font" << std::endl;
+        std::cout << "SDL_TTF ERR: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    // Render each digit on its own so their widths are known
+    SDL_Surface* glyphs[10] = {};
+    int atlas_w = 0, atlas_h = 0;
+    bool rendered = true;
+    for (int i = 0; i < 10; i++) {
+        char digit = '0' + i;
+        glyphs[i] = TTF_RenderText_Blended(m_font, &digit, 1, WHITE);
+        if (glyphs[i] == nullptr) {
+            rendered = false;
+            break;
+        }
+        atlas_w += glyphs[i]->w;
+        atlas_h = std::max(atlas_h, glyphs[i]->h);
+    }
+
+    SDL_Surface* atlas = nullptr;
+    if (rendered)
+        atlas = SDL_CreateSurface(atlas_w, atlas_h, SDL_PIXELFORMAT_ARGB8888);
+
+    if (atlas != nullptr) {
+        int x = 0;
+        for (int i = 0; i < 10; i++) {
+            // Copy the glyph's alpha as is instead of blending it onto nothing
+            SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE);
+            SDL_Rect dst = {x, 0, glyphs[i]->w, glyphs[i]->h};
+            SDL_BlitSurface(glyphs[i], nullptr, atlas, &dst);
+            m_digit_rects[i] = {
+                (float) x, 0.0f, (float) glyphs[i]->w, (float) glyphs[i]->h
+            };
+            x += glyphs[i]->w;
+        }
+        m_digit_h = (float) atlas_h;
+        m_atlas_w = (float) atlas_w;
+        m_digits = SDL_CreateTextureFromSurface(m_renderer, atlas);
+        SDL_DestroySurface(atlas);
+    }
+
+    for (SDL_Surface* glyph : glyphs)
+        SDL_DestroySurface(glyph);
+
+    if (m_digits == nullptr) {
+        std::cout << "Failed to initialize digit atlas" << std::endl;
+        return false;
+    }
+    SDL_SetTextureBlendMode(m_digits, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+void TextCache::preload (const char* txt) {
+    find_label(txt);
+}
+
+const TextCache::Label* TextCache::find_label (const char* txt) {
+    for (const Label& label : m_labels) {
+        if (std::strcmp(label.txt.c_str(), txt) == 0)
+            return label.texture == nullptr ? nullptr : &label;
+    }
+
+    // Cache failures too so they're only reported once
+    Label label = {txt, nullptr, 0.0f, 0.0f};
+    SDL_Surface* surface = nullptr;
+    if (m_font != nullptr)
+        surface = TTF_RenderText_Blended(m_font, txt, 0, WHITE);
+
+    if (surface == nullptr) {
+        std::cout << "Failed to initialize text surface" << std::endl;
+    } else {
+        label.texture = SDL_CreateTextureFromSurface(m_renderer, surface);
+        label.w = (float) surface->w;
+        label.h = (float) surface->h;
+        SDL_DestroySurface(surface);
+        if (label.texture == nullptr)
+            std::cout << "Failed to initialize text texture" << std::endl;
+    }
+
+    m_labels.push_back(label);
+    return label.texture == nullptr ? nullptr : &m_labels.back();
+}
+
+void TextCache::tint (SDL_Texture* texture, SDL_Color color) {
+    SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+    SDL_SetTextureAlphaMod(texture, color.a);
+}
+
+float TextCache::align_left (float x, float width, Align align) {
+    switch (align) {
+        case Align::LEFT:
+            return x;
+        case Align::RIGHT:
+            return x - width;
+        default:
+            return x - width / 2;
+    }
+}
+
+void TextCache::draw (
+    float x, float y, const char* txt, SDL_Color color, Align align
+) {
+    const Label* label = find_label(txt);
+    if (label == nullptr)
+        return;
+
+    SDL_FRect dst = {
+        align_left(x, label->w, align), y - label->h / 2, label->w, label->h
+    };
+    tint(label->texture, color);
+    SDL_RenderTexture(m_renderer, label->texture, nullptr, &dst);
+    m_draw_calls++;
+}
+
+uint8_t TextCache::split_digits (
+    size_t number, uint8_t* digits, float& width
+) const {
+    // Digits come out backwards
+    uint8_t count = 0;
+    do {
+        digits[count++] = number % 10;
+        number /= 10;
+    } while (number > 0);
+
+    width = 0;
+    for (uint8_t i = 0; i < count; i++)
+        width += m_digit_rects[digits[i]].w;
+    return count;
+}
+
+void TextCache::draw_number (
+    float x, float y, size_t number, SDL_Color color, Align align
+) {
+    queue_number(x, y, number, color, align);
+    flush();
+}
+
+void TextCache::queue_number (
+    float x, float y, size_t number, SDL_Color color, Align align
+) {
+    if (m_digits == nullptr)
+        return;
+
+    uint8_t digits[MAX_DIGITS];
+    float width;
+    uint8_t count = split_digits(number, digits, width);
+
+    SDL_FColor fcolor = {
+        color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f
+    };
+    float left = align_left(x, width, align);
+    float top = y - m_digit_h / 2;
+    for (uint8_t i = count; i-- > 0;) {
+        const SDL_FRect& src = m_digit_rects[digits[i]];
+        // Texture coordinates go from 0 to 1 across the atlas
+        float u0 = src.x / m_atlas_w;
+        float u1 = (src.x + src.w) / m_atlas_w;
+        int first = (int) m_vertices.size();
+        m_vertices.push_back({{left, top}, fcolor, {u0, 0.0f}});
+        m_vertices.push_back({{left + src.w, top}, fcolor, {u1, 0.0f}});
+        m_vertices.push_back({{left + src.w, top + m_digit_h}, fcolor, {u1, 1.0f}});
+        m_vertices.push_back({{left, top + m_digit_h}, fcolor, {u0, 1.0f}});
+
+        const int corners[6] = {0, 1, 2, 0, 2, 3};
+        for (int corner : corners)
+            m_indices.push_back(first + corner);
+        left += src.w;
+    }
+}
+
+void TextCache::flush () {
+    if (!m_indices.empty()) {
+        // Vertex colors do the tinting
+        tint(m_digits, {255, 255, 255, 255});
+        SDL_RenderGeometry(
+            m_renderer, m_digits,
+            m_vertices.data(), (int) m_vertices.size(),
+            m_indices.data(), (int) m_indices.size()
+        );
+        m_draw_calls++;
+    }
+    m_vertices.clear();
+    m_indices.clear();
+}
+
+uint32_t TextCache::take_draw_calls () {
+    uint32_t draw_calls = m_draw_calls;
+    m_draw_calls = 0;
+    return draw_calls;
+}
+
+void TextCache::clear () {
+    if (m_digits != nullptr)
+        SDL_DestroyTexture(m_digits);
+    m_digits = nullptr;
+
+    for (Label& label : m_labels) {
+        if (label.texture != nullptr)
+            SDL_DestroyTexture(label.texture);
+    }
+    m_labels.clear();
+}
+
+TextCache::~TextCache () {
+    clear();
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <SDL3/SDL.h>
+#include <SDL3_ttf/SDL_ttf.h>
+
+/*
+ * Keeps text for one font on the GPU so drawing it doesn't need any new
+ * surfaces or textures.
+ * Digits live in a single atlas texture so any number can be drawn from it,
+ * other text is rendered once the first time it's drawn and reused after.
+ * Everything is rendered in white and tinted with a color mod when drawn.
+ */
+class TextCache {
+public:
+    /* Which part of the text goes at the x coordinate it's drawn at */
+    enum class Align {
+        CENTER,
+        LEFT,
+        RIGHT
+    };
+
+    /**
+     * Constructor: creates an empty cache.
+     * Run init() afterwards.
+     */
+    TextCache ();
+
+    /**
+     * Builds the digit atlas.
+     * @param renderer The renderer the text is drawn with.
+     * @param font What SDL font to use.
+     * @return True if everything goes well, false otherwise.
+     */
+    bool init (SDL_Renderer* renderer, TTF_Font* font);
+
+    /**
+     * Renders text ahead of time so its first draw() doesn't have to.
+     * @param txt The text to render.
+     */
+    void preload (const char* txt);
+
+    /**
+     * Draw some text to the screen.
+     * @param x The x position to align the text to.
+     * @param y The y position to center the text.
+     * @param txt The text to draw.
+     * @param color What color the text should be.
+     * @param align Which part of the text goes at x.
+     */
+    void draw (
+        float x, float y, const char* txt, SDL_Color color,
+        Align align = Align::CENTER
+    );
+
+    /**
+     * Draw a number to the screen using the digit atlas.
+     * Draws anything queued with queue_number() too.
+     * @param x The x position to align the number to.
+     * @param y The y position to center the number.
+     * @param number The number to draw.
+     * @param color What color the number should be.
+     * @param align Which part of the number goes at x.
+     */
+    void draw_number (
+        float x, float y, size_t number, SDL_Color color,
+        Align align = Align::CENTER
+    );
+
+    /**
+     * Like draw_number(), but only adds the number to a batch.
+     * Nothing is drawn until flush(), which draws every queued number in a
+     * single draw call.
+     * @param x The x position to align the number to.
+     * @param y The y position to center the number.
+     * @param number The number to draw.
+     * @param color What color the number should be.
+     * @param align Which part of the number goes at x.
+     */
+    void queue_number (
+        float x, float y, size_t number, SDL_Color color,
+        Align align = Align::CENTER
+    );
+
+    /**
+     * Draws every number queued since the last call.
+     */
+    void flush ();
+
+    /**
+     * @return How many draw calls the cache has made since the last call.
+     */
+    uint32_t take_draw_calls ();
+
+    /**
+     * Destroys all the textures.
+     * Has to run before the renderer is destroyed.
+     */
+    void clear ();
+
+    /**
+     * Destructor: destroys anything clear() hasn't.
+     */
+    ~TextCache ();
+
+    TextCache (const TextCache&) = delete;
+    TextCache& operator= (const TextCache&) = delete;
+
+private:
+    /* A piece of text rendered to its own texture */
+    struct Label {
+        std::string txt;
+        SDL_Texture* texture;
+        float w;
+        float h;
+    };
+
+    /**
+     * Finds text in the cache, rendering it if it isn't there yet.
+     * @param txt The text to find.
+     * @return The cached text, or nullptr if it couldn't be rendered.
+     */
+    const Label* find_label (const char* txt);
+
+    /**
+     * Splits a number into digits.
+     * @param number The number to split.
+     * @param digits Filled with the digits, least significant first.
+     * @param width Set to how wide the number is when drawn.
+     * @return How many digits there are.
+     */
+    uint8_t split_digits (size_t number, uint8_t* digits, float& width) const;
+
+    /**
+     * Applies a color to a white texture.
+     * @param texture The texture to tint.
+     * @param color What color it should be drawn in.
+     */
+    static void tint (SDL_Texture* texture, SDL_Color color);
+
+    /**
+     * @param x The x coordinate to align to.
+     * @param width The width of what's being drawn.
+     * @param align Which part of it goes at x.
+     * @return Where its left edge goes.
+     */
+    static float align_left (float x, float width, Align align);
+
+    SDL_Renderer* m_renderer;
+    TTF_Font* m_font;
+
+    // The digits 0-9 side by side in one texture
+    SDL_Texture* m_digits;
+    SDL_FRect m_digit_rects[10];
+    float m_digit_h;
+    float m_atlas_w;
+
+    // Digits waiting for flush()
+    std::vector<SDL_Vertex> m_vertices;
+    std::vector<int> m_indices;
+
+    std::vector<Label> m_labels;
+    uint32_t m_draw_calls;
+};
@@ -1,5 +1,6 @@
+#include <algorithm>
 #include <iostream>
-#include <string>
+#include <iterator>
 
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
@@ -13,18 +14,68 @@
 #endif
 
 #include "Window.hpp"
+#include "../../util/instrument.hpp"
+#include "../../util/trace.hpp"
 
 
 constexpr uint16_t WINDOW_W = 1280;
 constexpr uint16_t WINDOW_H = 960;
 
+constexpr uint8_t SQUARE_SIZE = 45;
+
+constexpr int BOARD_SCREEN_W = Board::WIDTH * SQUARE_SIZE;
+constexpr int BOARD_SCREEN_H = Board::VISIBLE_HEIGHT * SQUARE_SIZE;
+
+constexpr int BOARD_OFFSET_X = (WINDOW_W - BOARD_SCREEN_W) / 2;
+constexpr int BOARD_OFFSET_Y = (WINDOW_H - BOARD_SCREEN_H) / 2;
+
+// offsets are so the blocks don't overlap with the border
+constexpr SDL_FRect BOARD_OUTLINE = {
+    (float) BOARD_OFFSET_X - 1,
+    (float) BOARD_OFFSET_Y - 1,
+    (float) BOARD_SCREEN_W + 2,
+    (float) BOARD_SCREEN_H + 2
+};
+
+// Room above a grid of boards for the legend
+constexpr float GRID_HEADER_H = 40;
+// Space around each board in a grid
+constexpr float GRID_PADDING = 4;
+// Height of one line of numbers under each board in a grid
+constexpr float GRID_LINE_H = 20;
+
+constexpr SDL_Color GRID_SCORE_COLOR = {255, 255, 255, 255};
+constexpr SDL_Color GRID_LINES_COLOR = {150, 150, 150, 255};
+
+// Where the performance overlay goes
+constexpr SDL_FRect OVERLAY_PANEL = {10, 10, 280, 260};
+constexpr float OVERLAY_LINE_H = 20;
+constexpr float OVERLAY_GRAPH_H = 60;
+// Frame times that fill the whole height of the graph
+constexpr float OVERLAY_GRAPH_MAX_MS = 1000.0f / 30;
+
+constexpr SDL_Color OVERLAY_TXT_COLOR = {230, 230, 230, 255};
+
+// Every visible cell plus the ghost, held and queued pieces
+constexpr size_t MAX_SQUARES = 
+    Board::WIDTH * Board::VISIBLE_HEIGHT + 4 * (2 + BoardSnapshot::QUEUE_SIZE);
+
 
 GameWindow::GameWindow ()
     : m_renderer(nullptr)
     , m_window(nullptr)
+    , m_surface(nullptr)
     , m_font28(nullptr)
     , m_font40(nullptr)
-{}
+    , m_font16(nullptr)
+    , m_background(nullptr)
+    , m_grid()
+    , m_draw_calls(0)
+    , m_last_frame_ns(0)
+{
+    m_vertices.reserve(4 * MAX_SQUARES);
+    m_indices.reserve(6 * MAX_SQUARES);
+}
 
 bool GameWindow::unix_scaling () {
     int rw = 0, rh = 0;
@@ -69,10 +120,12 @@ bool GameWindow::init () {
     );
 
     m_renderer = SDL_CreateRenderer(m_window, nullptr);
-    SDL_SetRenderDrawBlendMode(m_renderer, SDL_BLENDMODE_BLEND);
+    // The game runs on its own thread, so there's no point drawing faster
+    // than the display can show
+    SDL_SetRenderVSync(m_renderer, 1);
 
-    m_font28 = TTF_OpenFont("Retro Gaming.ttf", 28);
-    m_font40 = TTF_OpenFont("Retro Gaming.ttf", 40);
+    if (!init_renderer())
+        return false;
 
 #ifdef __unix__
     if (!unix_scaling())
@@ -82,6 +135,89 @@ bool GameWindow::init () {
     return true;
 }
 
+bool GameWindow::init_offscreen () {
+    // No video subsystem, so this works on machines without a display
+    if (!SDL_Init(0)) {
+        std::cout << "SDL FAILED TO INITIALIZE: " << SDL_GetError()
+                  << std::endl;
+        return false;
+    }
+
+    TTF_Init();
+
+    // RGBA32 is R, G, B, A in memory whatever the byte order
+    m_surface = SDL_CreateSurface(WINDOW_W, WINDOW_H, SDL_PIXELFORMAT_RGBA32);
+    if (m_surface == nullptr) {
+        std::cout << "Failed to initialize offscreen surface: "
+                  << SDL_GetError() << std::endl;
+        return false;
+    }
+    m_renderer = SDL_CreateSoftwareRenderer(m_surface);
+    if (m_renderer == nullptr) {
+        std::cout << "Failed to initialize software renderer: "
+                  << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    return init_renderer();
+}
+
+bool GameWindow::read_pixels (
+    std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height
+) {
+    if (m_surface == nullptr)
+        return false;
+
+    width = m_surface->w;
+    height = m_surface->h;
+    const size_t row_size = (size_t) width * 4;
+    rgba.resize(row_size * height);
+
+    SDL_LockSurface(m_surface);
+    const auto* pixels = (const uint8_t*) m_surface->pixels;
+    for (uint32_t y = 0; y < height; y++) {
+        std::copy_n(
+            pixels + (size_t) y * m_surface->pitch, row_size,
+            rgba.data() + y * row_size
+        );
+    }
+    SDL_UnlockSurface(m_surface);
+    return true;
+}
+
+bool GameWindow::init_renderer () {
+    SDL_SetRenderDrawBlendMode(m_renderer, SDL_BLENDMODE_BLEND);
+
+    if (!build_background())
+        return false;
+
+    {
+        TRACE_SCOPE("load fonts", "io");
+        m_font28 = TTF_OpenFont("Retro Gaming.ttf", 28);
+        m_font40 = TTF_OpenFont("Retro Gaming.ttf", 40);
+        m_font16 = TTF_OpenFont("Retro Gaming.ttf", 16);
+    }
+
+    // Render all the text up front so frames don't create any textures
+    m_text28.init(m_renderer, m_font28);
+    m_text40.init(m_renderer, m_font40);
+    m_text16.init(m_renderer, m_font16);
+    const char* labels[] = {
+        "HOLD", "UP NEXT", "SCORE", "LINES", "Press R to Restart"
+    };
+    for (const char* label : labels)
+        m_text28.preload(label);
+    m_text40.preload("GAME OVER");
+    const char* overlay_labels[] = {
+        "FPS", "BEST MOVE US", "BEST MOVE P99 US", "SEARCH AVG US", "PIECES/S",
+        "CANDIDATES", "SEARCH DEPTH", "DRAW CALLS"
+    };
+    for (const char* label : overlay_labels)
+        m_text16.preload(label);
+
+    return true;
+}
+
 static SDL_Color convert_hex (uint32_t hex) {
     SDL_Color color;
     // Bitwise right (>>) cuts off last x number of bits
@@ -95,37 +231,173 @@ static SDL_Color convert_hex (uint32_t hex) {
     return color;
 }
 
-void GameWindow::draw (Board* current_board) {
-    // int startTime = SDL_GetTicks();
-    static uint8_t square_size = 45;
-
-    static int board_screen_w = Board::WIDTH * square_size;
-    static int board_screen_h = Board::VISIBLE_HEIGHT * square_size;
-
-    static int board_offset_x = (WINDOW_W - board_screen_w) / 2;
-    static int board_offset_y = (WINDOW_H - board_screen_h) / 2;
+uint32_t GameWindow::get_frame_interval_ms () const {
+    const SDL_DisplayMode* mode = SDL_GetCurrentDisplayMode(
+        SDL_GetDisplayForWindow(m_window)
+    );
+    // Unknown refresh rates are reported as 0
+    if (mode == nullptr || mode->refresh_rate <= 0.0f)
+        return 1000 / 60;
+    return std::max(1, (int) (1000.0f / mode->refresh_rate));
+}
 
-    // offsets are so the blocks don't overlap with the border
-    SDL_FRect board_outline = {
-        (float) board_offset_x - 1,
-        (float) board_offset_y - 1,
-        (float) board_screen_w + 2,
-        (float) board_screen_h + 2
-    };
+bool GameWindow::build_background () {
+    m_background = SDL_CreateTexture(
+        m_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+        WINDOW_W, WINDOW_H
+    );
+    if (m_background == nullptr) {
+        std::cout << "Failed to initialize background texture: "
+                  << SDL_GetError() << std::endl;
+        return false;
+    }
 
+    SDL_SetRenderTarget(m_renderer, m_background);
     SDL_SetRenderDrawColor(m_renderer, 18, 18, 18, 255);
     SDL_RenderClear(m_renderer);
 
     SDL_SetRenderDrawColor(m_renderer, 93, 93, 93, 255);
-    SDL_RenderRect(m_renderer, &board_outline);
+    SDL_RenderRect(m_renderer, &BOARD_OUTLINE);
+    SDL_SetRenderTarget(m_renderer, nullptr);
+    return true;
+}
+
+void GameWindow::push_square (float x, float y, uint8_t sq_size, SDL_Color color) {
+    push_rect({x, y, (float) sq_size, (float) sq_size}, color);
+}
+
+void GameWindow::push_rect (const SDL_FRect& rect, SDL_Color color) {
+    SDL_FColor fcolor = {
+        color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f
+    };
+    int first = (int) m_vertices.size();
+    m_vertices.push_back({{rect.x, rect.y}, fcolor, {0, 0}});
+    m_vertices.push_back({{rect.x + rect.w, rect.y}, fcolor, {0, 0}});
+    m_vertices.push_back({{rect.x + rect.w, rect.y + rect.h}, fcolor, {0, 0}});
+    m_vertices.push_back({{rect.x, rect.y + rect.h}, fcolor, {0, 0}});
+
+    const int corners[6] = {0, 1, 2, 0, 2, 3};
+    for (int corner : corners)
+        m_indices.push_back(first + corner);
+}
+
+void GameWindow::draw_squares () {
+    if (!m_indices.empty()) {
+        SDL_RenderGeometry(
+            m_renderer, nullptr,
+            m_vertices.data(), (int) m_vertices.size(),
+            m_indices.data(), (int) m_indices.size()
+        );
+        m_draw_calls++;
+    }
+    m_vertices.clear();
+    m_indices.clear();
+}
+
+void GameWindow::present (const OverlayStats* overlay) {
+    uint32_t draw_calls = m_draw_calls + m_text28.take_draw_calls() +
+        m_text40.take_draw_calls() + m_text16.take_draw_calls();
+    m_draw_calls = 0;
+
+    uint64_t now_ns = SDL_GetTicksNS();
+    if (m_last_frame_ns != 0)
+        m_frame_ms.add((now_ns - m_last_frame_ns) / 1e6f);
+    m_last_frame_ns = now_ns;
+
+    if (overlay != nullptr) {
+        draw_overlay(*overlay, draw_calls);
+        // Left out of the next frame's count
+        m_draw_calls = 0;
+        m_text16.take_draw_calls();
+    }
+
+    SDL_RenderPresent(m_renderer);
+}
 
-    if (current_board->get_falling_piece() > 0) {
+void GameWindow::draw_overlay (const OverlayStats& stats, uint32_t draw_calls) {
+    push_rect(OVERLAY_PANEL, {0, 0, 0, 180});
+
+    // Frame time graph along the bottom, newest on the right
+    const float graph_bottom = OVERLAY_PANEL.y + OVERLAY_PANEL.h - 10;
+    const float bar_w = (OVERLAY_PANEL.w - 20) / 120;
+    for (size_t i = 0; i < m_frame_ms.size(); i++) {
+        float ms = m_frame_ms.newest(i);
+        float bar_h = std::min(ms / OVERLAY_GRAPH_MAX_MS, 1.0f) * OVERLAY_GRAPH_H;
+        // Green for 60 fps, yellow for missing it, red for under 30 fps
+        SDL_Color color = {80, 200, 80, 255};
+        if (ms > 1000.0f / 30)
+            color = {220, 60, 60, 255};
+        else if (ms > 1000.0f / 55)
+            color = {220, 200, 60, 255};
+        float x = OVERLAY_PANEL.x + OVERLAY_PANEL.w - 10 - (i + 1) * bar_w;
+        push_rect({x, graph_bottom - bar_h, bar_w, bar_h}, color);
+    }
+    // Where 60 fps is
+    float line_y = graph_bottom - 
+        (1000.0f / 60) / OVERLAY_GRAPH_MAX_MS * OVERLAY_GRAPH_H;
+    push_rect(
+        {OVERLAY_PANEL.x + 10, line_y, OVERLAY_PANEL.w - 20, 1},
+        {150, 150, 150, 255}
+    );
+    draw_squares();
+
+    float total_ms = 0;
+    for (size_t i = 0; i < m_frame_ms.size(); i++)
+        total_ms += m_frame_ms.newest(i);
+    size_t fps = 0;
+    if (total_ms > 0)
+        fps = (size_t) (m_frame_ms.size() * 1000 / total_ms + 0.5f);
+
+    const char* labels[] = {
+        "FPS", "BEST MOVE US", "BEST MOVE P99 US", "SEARCH AVG US", "PIECES/S",
+        "CANDIDATES", "SEARCH DEPTH", "DRAW CALLS"
+    };
+    size_t values[] = {
+        fps,
+        (size_t) (stats.best_move_last_ns / 1000),
+        (size_t) (stats.best_move_p99_ns / 1000),
+        (size_t) (stats.search_avg_ns / 1000),
+        (size_t) (stats.pieces_per_sec + 0.5),
+        stats.candidates,
+        stats.search_depth,
+        draw_calls
+    };
+    const float left = OVERLAY_PANEL.x + 10;
+    const float right = OVERLAY_PANEL.x + OVERLAY_PANEL.w - 10;
+    for (size_t i = 0; i < std::size(labels); i++) {
+        float y = OVERLAY_PANEL.y + 10 + OVERLAY_LINE_H * (i + 0.5f);
+        m_text16.draw(left, y, labels[i], OVERLAY_TXT_COLOR, TextCache::Align::LEFT);
+        m_text16.queue_number(
+            right, y, values[i], OVERLAY_TXT_COLOR, TextCache::Align::RIGHT
+        );
+    }
+    m_text16.flush();
+}
+
+void GameWindow::draw (
+    const BoardSnapshot& current_board, const OverlayStats* overlay
+) {
+    INSTRUMENT_SCOPE(WINDOW_DRAW);
+    // int startTime = SDL_GetTicks();
+    const uint8_t square_size = SQUARE_SIZE;
+
+    const int board_screen_w = BOARD_SCREEN_W;
+    const int board_screen_h = BOARD_SCREEN_H;
+
+    const int board_offset_x = BOARD_OFFSET_X;
+    const int board_offset_y = BOARD_OFFSET_Y;
+
+    SDL_FRect screen = {0.0f, 0.0f, (float) WINDOW_W, (float) WINDOW_H};
+    SDL_RenderTexture(m_renderer, m_background, nullptr, &screen);
+    m_draw_calls++;
+
+    if (current_board.falling_piece > 0) {
         draw_ghost_piece(
             current_board,
             board_offset_x,
             board_offset_y,
-            current_board->get_falling_piece(),
-            current_board->get_falling_piece_rot(),
+            current_board.falling_piece,
+            current_board.falling_piece_rot,
             square_size
         );
     }
@@ -136,34 +408,21 @@ void GameWindow::draw (Board* current_board) {
         for (int x = 0; x < Board::WIDTH; x++) {
             int absx = x * square_size + board_offset_x;
 
-            int8_t sq = current_board->get_square(x, y + OFFSCREEN_ROWS);
+            int8_t sq = current_board.get_square(x, y + OFFSCREEN_ROWS);
             if (sq == 0)
                 continue;
 
-            SDL_FRect sqRect = {
-                (float) absx,
-                (float) absy,
-                (float) square_size,
-                (float) square_size
-            };
-
             unsigned int hex = tetromino_data::HEX_CODES[abs(sq) - 1];
-            SDL_Color color = convert_hex(hex);
-            SDL_SetRenderDrawColor(
-                m_renderer, 
-                color.r, color.g, color.b,
-                color.a
-            );
-            SDL_RenderFillRect(m_renderer, &sqRect);
+            push_square(absx, absy, square_size, convert_hex(hex));
         }
     }
 
-    SDL_Color txt_color = {255, 255, 255};
+    SDL_Color txt_color = {255, 255, 255, 255};
 
-    uint8_t held_piece = current_board->get_held_piece();
+    const int held_piece_offset_x = board_offset_x - 6 * square_size;
+    const int held_piece_offset_y = board_offset_y + 2 * square_size;
+    uint8_t held_piece = current_board.held_piece;
     if (held_piece > 0) {
-        const int held_piece_offset_x = board_offset_x - 6 * square_size;
-        const int held_piece_offset_y = board_offset_y + 2 * square_size;
         draw_piece(
             held_piece_offset_x, 
             held_piece_offset_y,
@@ -171,32 +430,37 @@ void GameWindow::draw (Board* current_board) {
             0,
             square_size
         );
-        draw_txt(
-            held_piece_offset_x + 2 * square_size,
-            held_piece_offset_y - square_size,
-            "HOLD",
-            m_font28,
-            txt_color
-        );
     }
 
     // Draw up next
     const int up_next_offset_x = board_offset_x + board_screen_w + 2 * square_size;
     const int up_next_offset_y = board_offset_y + 2 * square_size;
-    for (int i = 0; i < 3; i++) {
+    for (int i = 0; i < BoardSnapshot::QUEUE_SIZE; i++) {
         draw_piece(
             up_next_offset_x, 
             up_next_offset_y + 3 * i * square_size,
-            current_board->nth_piece(i),
+            current_board.queue[i],
             0,
             square_size
         );
     }
-    draw_txt(
+
+    // Every square is in, the rest of the frame is text
+    draw_squares();
+
+    if (held_piece > 0) {
+        m_text28.draw(
+            held_piece_offset_x + 2 * square_size,
+            held_piece_offset_y - square_size,
+            "HOLD",
+            txt_color
+        );
+    }
+
+    m_text28.draw(
         up_next_offset_x + 2 * square_size,
         up_next_offset_y - square_size,
         "UP NEXT",
-        m_font28, 
         txt_color
     );
 
@@ -208,8 +472,8 @@ void GameWindow::draw (Board* current_board) {
         score_offset_y,
         square_size,
         "SCORE",
-        current_board->get_score(),
-        m_font28,
+        current_board.score,
+        m_text28,
         txt_color
     );
     uint16_t lines_offset_y = score_offset_y + square_size*2 + 20;
@@ -219,13 +483,13 @@ void GameWindow::draw (Board* current_board) {
         lines_offset_y,
         square_size,
         "LINES",
-        current_board->get_lines_cleared(),
-        m_font28,
+        current_board.lines_cleared,
+        m_text28,
         txt_color
     );
 
     // Game Over screen
-    if (current_board->game_over()) {
+    if (current_board.game_over) {
         /*
         board_outline =
         {
@@ -236,20 +500,19 @@ void GameWindow::draw (Board* current_board) {
         };
         */
         SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 150);
-        SDL_RenderFillRect(m_renderer, &board_outline);
-        SDL_Color gameover_txt_color = {217, 59, 59};
-        draw_txt(
+        SDL_RenderFillRect(m_renderer, &BOARD_OUTLINE);
+        m_draw_calls++;
+        SDL_Color gameover_txt_color = {217, 59, 59, 255};
+        m_text40.draw(
             board_offset_x + board_screen_w / 2,
             board_offset_y + board_screen_h / 2 - 20,
             "GAME OVER", 
-            m_font40,
             gameover_txt_color
         );
-        draw_txt(
+        m_text28.draw(
             board_offset_x + board_screen_w / 2,
             board_offset_y + board_screen_h / 2 + 20,
             "Press R to Restart",
-            m_font28, 
             gameover_txt_color
         );
     }
@@ -257,7 +520,7 @@ void GameWindow::draw (Board* current_board) {
     /*
     // Draw anchor square
     // Use for debugging
-    int anchor = current_board->get_falling_piece_anchor() - OFFSCREEN_SQUARES;
+    int anchor = current_board.falling_piece_anchor - OFFSCREEN_SQUARES;
     int x = (anchor % 10)*square_size + board_offset_x;
     int y = (anchor / 10)*square_size + board_offset_y;
 
@@ -272,7 +535,85 @@ void GameWindow::draw (Board* current_board) {
     SDL_RenderFillRect(m_renderer, &anchor_sq);
     /* */
 
-    SDL_RenderPresent(m_renderer);
+    present(overlay);
+}
+
+void GameWindow::update_grid_layout (size_t count) {
+    if (count == m_grid.count)
+        return;
+
+    // Try every number of columns and keep the one with the biggest squares
+    m_grid = {count, 1, 1, (float) WINDOW_W, WINDOW_H - GRID_HEADER_H};
+    for (size_t cols = 1; cols <= count; cols++) {
+        size_t rows = (count + cols - 1) / cols;
+        float cell_w = (float) WINDOW_W / cols;
+        float cell_h = (WINDOW_H - GRID_HEADER_H) / rows;
+        float fit_w = (cell_w - 2 * GRID_PADDING) / Board::WIDTH;
+        float fit_h = 
+            (cell_h - 2 * GRID_PADDING - 2 * GRID_LINE_H) / Board::VISIBLE_HEIGHT;
+        int sq_size = (int) std::min(fit_w, fit_h);
+        if (sq_size > m_grid.sq_size || cols == 1) {
+            m_grid = {
+                count, (uint16_t) cols, (uint8_t) std::clamp(sq_size, 1, 255),
+                cell_w, cell_h
+            };
+        }
+    }
+    m_outlines.reserve(count);
+}
+
+void GameWindow::draw_grid (const std::vector<const BoardSnapshot*>& boards) {
+    INSTRUMENT_SCOPE(WINDOW_DRAW);
+    update_grid_layout(boards.size());
+    const uint8_t sq_size = m_grid.sq_size;
+    const float board_w = Board::WIDTH * sq_size;
+    const float board_h = Board::VISIBLE_HEIGHT * sq_size;
+
+    SDL_SetRenderDrawColor(m_renderer, 18, 18, 18, 255);
+    SDL_RenderClear(m_renderer);
+    m_draw_calls++;
+
+    m_text28.draw(WINDOW_W / 2 - 80, GRID_HEADER_H / 2, "SCORE", GRID_SCORE_COLOR);
+    m_text28.draw(WINDOW_W / 2 + 80, GRID_HEADER_H / 2, "LINES", GRID_LINES_COLOR);
+
+    m_outlines.clear();
+    for (size_t i = 0; i < boards.size(); i++) {
+        const BoardSnapshot& board = *boards[i];
+        float x = (i % m_grid.cols) * m_grid.cell_w + (m_grid.cell_w - board_w) / 2;
+        float y = GRID_HEADER_H + (i / m_grid.cols) * m_grid.cell_h + GRID_PADDING;
+        m_outlines.push_back({x - 1, y - 1, board_w + 2, board_h + 2});
+
+        for (int sq_y = 0; sq_y < Board::VISIBLE_HEIGHT; sq_y++) {
+            for (int sq_x = 0; sq_x < Board::WIDTH; sq_x++) {
+                int8_t sq = board.get_square(sq_x, sq_y + OFFSCREEN_ROWS);
+                if (sq == 0)
+                    continue;
+                unsigned int hex = tetromino_data::HEX_CODES[abs(sq) - 1];
+                push_square(
+                    x + sq_x * sq_size, y + sq_y * sq_size, sq_size,
+                    convert_hex(hex)
+                );
+            }
+        }
+        if (board.game_over)
+            push_rect({x, y, board_w, board_h}, {0, 0, 0, 150});
+
+        float text_x = x + board_w / 2;
+        float text_y = y + board_h + GRID_LINE_H / 2;
+        m_text16.queue_number(text_x, text_y, board.score, GRID_SCORE_COLOR);
+        m_text16.queue_number(
+            text_x, text_y + GRID_LINE_H, board.lines_cleared, GRID_LINES_COLOR
+        );
+    }
+
+    // One draw call each for the outlines, the squares and the numbers
+    SDL_SetRenderDrawColor(m_renderer, 93, 93, 93, 255);
+    SDL_RenderRects(m_renderer, m_outlines.data(), (int) m_outlines.size());
+    m_draw_calls++;
+    draw_squares();
+    m_text16.flush();
+
+    present(nullptr);
 }
 
 void GameWindow::draw_piece (
@@ -287,105 +628,51 @@ void GameWindow::draw_piece (
         int delta = tetromino_data::get_piece_map(piece, rot, i);
         int r = Board::row(delta);
         int c = Board::col(delta);
-        SDL_FRect piece_sq = {
-            (float) x + c * sq_size,
-            (float) y + r * sq_size,
-            (float) sq_size,
-            (float) sq_size
-        };
-
         unsigned int hex = tetromino_data::HEX_CODES[piece - 1];
-        SDL_Color color = convert_hex(hex);
-        SDL_SetRenderDrawColor(m_renderer, color.r, color.g, color.b, color.a);
-        SDL_RenderFillRect(m_renderer, &piece_sq);
+        push_square(x + c * sq_size, y + r * sq_size, sq_size, convert_hex(hex));
     }
 }
 
 
 void GameWindow::draw_ghost_piece (
-    Board* current_board, uint16_t x_offset, uint16_t y_offset, 
+    const BoardSnapshot& current_board, uint16_t x_offset, uint16_t y_offset,
     uint8_t piece, uint8_t rot, uint8_t sq_size
 ) {
     for (int i = 0; i < 4; i++)
     {
         int delta = tetromino_data::get_piece_map(piece, rot, i);
-        int ghost_idx = current_board->get_ghost();
+        int ghost_idx = current_board.ghost_anchor;
         ghost_idx -= OFFSCREEN_SQUARES;
         int r = Board::row(ghost_idx + delta);
         int c = Board::col(ghost_idx + delta);
-        SDL_FRect piece_sq = {
-            (float) c * sq_size + x_offset,
-            (float) r * sq_size + y_offset,
-            (float) sq_size,
-            (float) sq_size
-        };
-
         unsigned int hex = tetromino_data::HEX_CODES[piece - 1];
         SDL_Color color = convert_hex(hex);
         color.a = 75;
-        SDL_SetRenderDrawColor(m_renderer, color.r, color.g, color.b, color.a);
-        SDL_RenderFillRect(m_renderer, &piece_sq);
+        push_square(c * sq_size + x_offset, r * sq_size + y_offset, sq_size, color);
     }
 }
 
 void GameWindow::draw_labeled_number (
     uint16_t x, uint16_t y, uint8_t offset, const char* label, 
-    size_t number, TTF_Font* font, SDL_Color color
+    size_t number, TextCache& text, SDL_Color color
 ) {
-    draw_txt(x, y, label, font, color);
-    std::string num_string = std::to_string(number);
-    char const* num_chars = num_string.c_str();
-    draw_txt(x, y + offset, num_chars, m_font28, color);
-}
-
-void GameWindow::draw_txt (
-    uint16_t x, uint16_t y, const char* txt,TTF_Font* font, SDL_Color color
-) {
-    if (font == nullptr) {
-        std::cout << "Failed to load font" << std::endl;
-        std::cout << "SDL_TTF ERR: " << SDL_GetError() << std::endl;
-        return;
-    }
-    SDL_Surface* text_surface = TTF_RenderText_Blended(font, txt, 0, color);
-
-    if (text_surface == nullptr) {
-        std::cout << "Failed to initialize text surface" << std::endl;
-        return;
-    }
-
-    SDL_Texture* text_texture = SDL_CreateTextureFromSurface(
-        m_renderer, 
-        text_surface
-    );
-
-    if (text_texture == nullptr) {
-        std::cout << "Failed to initialize text texture" << std::endl;
-        return;
-    }
-
-    SDL_FRect src = {
-        0.0, 
-        0.0, 
-        (float) text_surface->w, 
-        (float) text_surface->h
-    };
-    SDL_FRect dst = {
-        (float) x - src.w / 2, 
-        (float) y - src.h / 2, 
-        (float) src.w, 
-        (float) src.h
-    };
-
-    SDL_RenderTexture(m_renderer, text_texture, &src, &dst);
-    SDL_DestroySurface(text_surface);
-    SDL_DestroyTexture(text_texture);
+    text.draw(x, y, label, color);
+    text.draw_number(x, y + offset, number, color);
 }
 
 GameWindow::~GameWindow () {
+    // The textures belong to the renderer
+    m_text28.clear();
+    m_text40.clear();
+    m_text16.clear();
+    if (m_background != nullptr)
+        SDL_DestroyTexture(m_background);
     SDL_DestroyRenderer(m_renderer);
     SDL_DestroyWindow(m_window);
+    SDL_DestroySurface(m_surface);
     TTF_CloseFont(m_font28);
     TTF_CloseFont(m_font40);
+    TTF_CloseFont(m_font16);
 
     TTF_Quit();
     SDL_Quit();
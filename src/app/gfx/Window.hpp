@@ -1,9 +1,24 @@
 #pragma once
 
+#include <vector>
+
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
 
 #include "../../game/Board.hpp"
+#include "../../game/BoardSnapshot.hpp"
+#include "../../util/RollingWindow.hpp"
+#include "TextCache.hpp"
+
+/* Numbers from the simulation for the performance overlay */
+struct OverlayStats {
+    uint64_t best_move_last_ns;
+    uint64_t best_move_p99_ns;
+    uint64_t search_avg_ns;    // Search time per piece over the whole game
+    uint32_t candidates;       // Moves looked at for the last piece
+    uint8_t search_depth;      // Pieces ahead the last search looked
+    double pieces_per_sec;
+};
 
 /* Draws the game of Tetris to the screen. */
 class GameWindow {
@@ -26,11 +41,50 @@ public:
      */
     bool init ();
 
+    /**
+     * Initializes the window without showing anything, for machines without
+     * a display. Frames are drawn by SDL's software renderer to a surface
+     * and read back with read_pixels().
+     * Use instead of init().
+     * @return True if everything goes well, false otherwise.
+     */
+    bool init_offscreen ();
+
+    /**
+     * Copies the last frame drawn offscreen.
+     * @param rgba Filled with the pixels, 4 bytes each, row by row.
+     * @param width Set to the width of the frame in pixels.
+     * @param height Set to the height of the frame in pixels.
+     * @return False if the window wasn't initialized with init_offscreen().
+     */
+    bool read_pixels (
+        std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height
+    );
+
     /**
      * Draw a frame to the screen.
-     * @param current_board The current game board.
+     * @param current_board A snapshot of the current game board.
+     * @param overlay Numbers for the performance overlay, or nullptr to
+     * leave it out.
+     */
+    void draw (
+        const BoardSnapshot& current_board,
+        const OverlayStats* overlay = nullptr
+    );
+
+    /**
+     * Draw a frame with many boards side by side, scaled down to fit the
+     * window. Only the squares, the score and the lines of each board are
+     * drawn.
+     * @param boards Snapshots of the boards to draw, in grid order.
      */
-    void draw (Board* current_board);
+    void draw_grid (const std::vector<const BoardSnapshot*>& boards);
+
+    /**
+     * @return How long one refresh of the display the window is on takes,
+     * in milliseconds.
+     */
+    uint32_t get_frame_interval_ms () const;
 
     /**
      * Destructor: safely closes and exits the window..
@@ -45,7 +99,67 @@ private:
     bool unix_scaling ();
 
     /**
-     * Draw a piece not on the board in a specific spot on the screen.
+     * Sets up everything drawing needs once the renderer exists: blending,
+     * the background, the fonts and the text caches.
+     * @return True if everything goes well, false otherwise.
+     */
+    bool init_renderer ();
+
+    /**
+     * Draws everything that never changes (the background and the board
+     * outline) to a texture so frames can copy it in one go.
+     * @return True if everything goes well, false otherwise.
+     */
+    bool build_background ();
+
+    /**
+     * Adds a square to this frame's batch of squares.
+     * Nothing is drawn until draw_squares().
+     * @param x The x coordinate of the top left corner.
+     * @param y The y coordinate of the top left corner.
+     * @param sq_size The size of the square.
+     * @param color What color the square should be.
+     */
+    void push_square (float x, float y, uint8_t sq_size, SDL_Color color);
+
+    /**
+     * Adds a rectangle to this frame's batch of squares.
+     * @param rect Where the rectangle goes.
+     * @param color What color the rectangle should be.
+     */
+    void push_rect (const SDL_FRect& rect, SDL_Color color);
+
+    /**
+     * Works out the biggest boards that still fit a grid of them in the
+     * window. Does nothing if the number of boards hasn't changed.
+     * @param count How many boards the grid has.
+     */
+    void update_grid_layout (size_t count);
+
+    /**
+     * Draws every square pushed since the last call in a single draw call.
+     */
+    void draw_squares ();
+
+    /**
+     * Finishes a frame: adds the performance overlay if there is one, and
+     * shows the frame.
+     * @param overlay Numbers for the overlay, or nullptr to leave it out.
+     */
+    void present (const OverlayStats* overlay);
+
+    /**
+     * Draws the performance overlay in the top left corner.
+     * Everything comes from the text caches, so it costs the same few draw
+     * calls every frame and doesn't change the numbers it shows.
+     * @param stats Numbers from the simulation.
+     * @param draw_calls How many draw calls the frame took without the
+     * overlay.
+     */
+    void draw_overlay (const OverlayStats& stats, uint32_t draw_calls);
+
+    /**
+     * Add a piece not on the board in a specific spot to the batch of squares.
      * Centers I and O.
      * @param x The x coordinate to begin drawing the piece.
      * @param y The y coordinate to begin drawing the piece.
@@ -58,8 +172,8 @@ private:
     );
 
     /**
-     * Draws the ghost piece (where the piece would land on a hard drop) at the bottom of the screen.
-     * @param current_board The current game board.
+     * Adds the ghost piece (where the piece would land on a hard drop) to the batch of squares.
+     * @param current_board A snapshot of the current game board.
      * @param x_offset The x position of the board itself on the screen.
      * @param y_offset The y position of the board itself on the screen.
      * @param piece What kind of piece to draw.
@@ -67,7 +181,7 @@ private:
      * @param sq_size The size of each square in the piece
      */
     void draw_ghost_piece (
-        Board* current_board, uint16_t x_offset, uint16_t y_offset,
+        const BoardSnapshot& current_board, uint16_t x_offset, uint16_t y_offset,
         uint8_t piece, uint8_t rot, uint8_t sq_size
     );
 
@@ -78,30 +192,46 @@ private:
      * @param offset How far the value should be from the label.
      * @param label The label to draw.
      * @param number The value to draw.
-     * @param font What SDL font to use.
+     * @param text The cached font to draw with.
      * @param color What color the text should be.
      */
     void draw_labeled_number (
         uint16_t x, uint16_t y, uint8_t offset, const char* label,
-        size_t number, TTF_Font* font, SDL_Color color
-    );
-
-    /**
-     * Draw some text to the screen.
-     * @param x The x position to center the text.
-     * @param y The y position to center the text.
-     * @param txt The text to draw.
-     * @param font What SDL font to use.
-     * @param color What color the text should be.
-     */
-    void draw_txt (
-        uint16_t x, uint16_t y, const char* txt, TTF_Font* font, SDL_Color color
+        size_t number, TextCache& text, SDL_Color color
     );
 
     void draw_score (int x, int y);
 
     SDL_Renderer* m_renderer;
     SDL_Window* m_window;
+    // What offscreen frames are drawn to, nullptr when there's a window
+    SDL_Surface* m_surface;
     TTF_Font* m_font28;
     TTF_Font* m_font40;
+    TTF_Font* m_font16;
+    TextCache m_text28;
+    TextCache m_text40;
+    TextCache m_text16;
+
+    SDL_Texture* m_background;
+    // Every square of the frame, drawn together by draw_squares()
+    std::vector<SDL_Vertex> m_vertices;
+    std::vector<int> m_indices;
+
+    /* Where the boards of draw_grid() go */
+    struct GridLayout {
+        size_t count;
+        uint16_t cols;
+        uint8_t sq_size;
+        float cell_w;
+        float cell_h;
+    };
+    GridLayout m_grid;
+    std::vector<SDL_FRect> m_outlines;
+
+    // Draw calls made by the window itself since the last present()
+    uint32_t m_draw_calls;
+    // Time between presents, in milliseconds
+    RollingWindow<float, 120> m_frame_ms;
+    uint64_t m_last_frame_ns;
 };
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <random>
+
+#include "headless.hpp"
+#include "Replay.hpp"
+#include "gfx/Window.hpp"
+#include "../game/BoardSnapshot.hpp"
+#include "../util/trace.hpp"
+
+// Same pace as App
+constexpr uint32_t AI_INPUT_INTERVAL_MS = 20;
+
+bool export_game (Agent& agent, uint32_t seed, const ExportSettings& settings) {
+    TRACE_SCOPE("export game", "task");
+    GameWindow window;
+    if (!window.init_offscreen())
+        return false;
+    FrameExporter exporter(settings.directory, settings.format);
+
+    RandomEngine random_engine(seed);
+    Board board(250, random_engine);
+    ReplayRecorder recorder;
+    if (settings.replay_directory != nullptr) {
+        ReplayHeader header = {
+            .seed = seed,
+            .fall_rate = 250,
+            .rules_version = Board::RULES_VERSION,
+            .has_weights = true,
+            .weights = agent.get_weights()
+        };
+        recorder.start(replay_path(settings.replay_directory, seed), header);
+    }
+    BoardSnapshot snapshot = {};
+    std::vector<uint8_t> pixels;
+    uint32_t width = 0, height = 0;
+
+    auto export_frame = [&] () {
+        snapshot.capture(board, exporter.get_frame_count());
+        window.draw(snapshot);
+        window.read_pixels(pixels, width, height);
+        exporter.add_frame(pixels, width, height);
+    };
+
+    Input input = {};
+    recorder.update(board, input, 0);
+    uint32_t next_input_ms = 0;
+    uint32_t frame_num = 0;
+    for (uint32_t ticks = 0; 
+         !board.game_over() && board.get_pieces_placed() < settings.max_pieces;
+         ticks++) {
+        input = {};
+        if (ticks >= next_input_ms) {
+            input = agent.gen_input(&board);
+            next_input_ms += AI_INPUT_INTERVAL_MS;
+        }
+        recorder.update(board, input, ticks);
+
+        // Frame n shows the game at n / fps seconds
+        if ((uint64_t) ticks * settings.fps >= (uint64_t) frame_num * 1000) {
+            export_frame();
+            frame_num++;
+        }
+    }
+    // Make sure the end of the game is in there
+    export_frame();
+
+    bool written = exporter.finish() && recorder.finish();
+    std::cout << "Exported " << exporter.get_frame_count() << " frames of "
+              << width << "x" << height << " to " << settings.directory
+              << std::endl;
+    return written;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+#include "FrameExporter.hpp"
+#include "../ai/genetic/Agent.hpp"
+
+/* What export_game() records */
+struct ExportSettings {
+    const char* directory;
+    FrameFormat format;
+    uint32_t fps;
+    size_t max_pieces;
+    // Where to save a replay of the game too, or nullptr
+    const char* replay_directory;
+};
+
+/**
+ * Plays a game without a display and saves it as a sequence of frames.
+ * The game runs on a simulated clock at the same pace as App, one agent input
+ * every 20 ms, and a frame is drawn every 1/fps seconds of game time. That
+ * way the frames play back in real time, but get made as fast as they can be
+ * drawn and encoded.
+ * @param agent The Agent playing the game.
+ * @param seed The seed for the piece randomizer.
+ * @param settings Where and how to save the frames.
+ * @return True if every frame was written, false otherwise.
+ */
+bool export_game (Agent& agent, uint32_t seed, const ExportSettings& settings);
@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tetris_env.h"
+#include "../game/BoardBatch.hpp"
+#include "../util/mix.hpp"
+
+static_assert(TETRIS_ENV_WIDTH == Board::WIDTH && TETRIS_ENV_HEIGHT == Board::HEIGHT);
+
+/**
+ * @param action An action from the caller.
+ * @return The move it stands for, out of bounds if the action is out of
+ * range.
+ */
+static BatchMove decode_action (int32_t action) {
+    if (action < 0 || action >= TETRIS_ENV_ACTIONS)
+        return {.rotation = 4, .column = 0, .hold = false};
+    return {
+        .rotation = (uint8_t) (action / TETRIS_ENV_COLUMNS % 4),
+        .column = (int8_t) (action % TETRIS_ENV_COLUMNS - 2),
+        .hold = action >= TETRIS_ENV_ACTIONS / 2
+    };
+}
+
+/* A run of games that one thread steps, in a BoardBatch of their own */
+struct Shard {
+    uint32_t first;
+    BoardBatch batch;
+    std::vector<uint32_t> seeds;
+    // How many games each lane has finished
+    std::vector<uint32_t> games_played;
+    std::vector<size_t> lines_before;
+    std::vector<BatchMove> moves;
+    // Scratch for the legal actions
+    std::vector<uint8_t> pieces;
+    std::vector<int8_t> rows;
+
+    Shard (uint32_t first_game, const uint32_t* game_seeds, uint32_t count)
+        : first(first_game)
+        , batch(count)
+        , seeds(game_seeds, game_seeds + count)
+        , games_played(count, 0)
+        , lines_before(count, 0)
+        , moves(count)
+        , pieces(count)
+        , rows(count)
+    {
+        batch.reset(seeds.data(), count);
+    }
+
+    /**
+     * Starts a lane's next game.
+     * @param lane Which lane.
+     */
+    void next_game (size_t lane) {
+        uint32_t game = ++games_played[lane];
+        batch.restart(lane, (uint32_t) mix(((uint64_t) seeds[lane] << 32) | game));
+    }
+
+    /**
+     * Writes what the games look like.
+     * @param out The caller's buffers.
+     */
+    void observe (const tetris_env_buffers& out) {
+        const size_t lanes = batch.get_count();
+        for (uint8_t y = 0; y < Board::HEIGHT; y++) {
+            const uint16_t* bits = batch.get_row(y);
+            uint16_t* board = out.board + (size_t) first * Board::HEIGHT + y;
+            for (size_t lane = 0; lane < lanes; lane++)
+                board[lane * Board::HEIGHT] = bits[lane];
+        }
+        for (size_t lane = 0; lane < lanes; lane++) {
+            uint8_t* queue = out.queue + (first + lane) * TETRIS_ENV_QUEUE;
+            queue[0] = batch.get_falling_piece(lane);
+            for (uint8_t n = 1; n < TETRIS_ENV_QUEUE; n++)
+                queue[n] = batch.nth_piece(lane, n - 1);
+            out.held[first + lane] = batch.get_held_piece(lane);
+        }
+        if (out.legal != nullptr)
+            observe_legal(out.legal + (size_t) first * TETRIS_ENV_ACTIONS);
+    }
+
+    /**
+     * Drops every action in all the games to see which fit.
+     * @param legal Where this shard's part of the mask goes.
+     */
+    void observe_legal (uint8_t* legal) {
+        const size_t lanes = batch.get_count();
+        for (int32_t action = 0; action < TETRIS_ENV_ACTIONS; action++) {
+            BatchMove move = decode_action(action);
+            for (size_t lane = 0; lane < lanes; lane++) {
+                uint8_t held = batch.get_held_piece(lane);
+                if (held == 0)
+                    held = batch.nth_piece(lane, 0);
+                pieces[lane] = move.hold ? held : batch.get_falling_piece(lane);
+                moves[lane] = move;
+            }
+            batch.drop(pieces.data(), moves.data(), rows.data());
+            for (size_t lane = 0; lane < lanes; lane++)
+                legal[lane * TETRIS_ENV_ACTIONS + action] = rows[lane] >= 0;
+        }
+    }
+
+    /**
+     * Starts every game over.
+     * @param out The caller's buffers.
+     */
+    void reset (const tetris_env_buffers& out) {
+        batch.reset(seeds.data(), seeds.size());
+        std::fill(games_played.begin(), games_played.end(), 0);
+        std::memset(out.reward + first, 0, seeds.size() * sizeof(float));
+        std::memset(out.done + first, 0, seeds.size());
+        observe(out);
+    }
+
+    /**
+     * Plays this shard's actions.
+     * @param actions Every game's action.
+     * @param out The caller's buffers.
+     */
+    void step (const int32_t* actions, const tetris_env_buffers& out) {
+        const size_t lanes = batch.get_count();
+        for (size_t lane = 0; lane < lanes; lane++) {
+            moves[lane] = decode_action(actions[first + lane]);
+            lines_before[lane] = batch.get_lines_cleared(lane);
+        }
+        batch.step(moves.data());
+        for (size_t lane = 0; lane < lanes; lane++) {
+            out.reward[first + lane] = (float) (batch.get_lines_cleared(lane) - lines_before[lane]);
+            out.done[first + lane] = batch.game_over(lane);
+            if (batch.game_over(lane))
+                next_game(lane);
+        }
+        observe(out);
+    }
+};
+
+/*
+ * The games split into shards, and a thread for every shard past the first
+ * that steps it and waits for the next step in between. ThreadPool isn't
+ * used because it queues a task per call, and steps shouldn't allocate.
+ */
+struct tetris_env {
+    uint32_t count;
+    std::vector<Shard> shards;
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    // Increased for every step, so the threads can tell there's a new one
+    uint64_t generation = 0;
+    size_t pending = 0;
+    bool stopping = false;
+    // The step the threads are working on
+    const int32_t* actions = nullptr;
+    const tetris_env_buffers* out = nullptr;
+
+    /**
+     * Steps or resets one shard.
+     * @param shard Which shard.
+     */
+    void run (Shard& shard) const {
+        if (actions == nullptr)
+            shard.reset(*out);
+        else
+            shard.step(actions, *out);
+    }
+
+    /**
+     * Runs every shard, the first one on the calling thread.
+     * @param step_actions The actions, or nullptr to reset.
+     * @param buffers Where to write the observations.
+     */
+    void run_all (const int32_t* step_actions, const tetris_env_buffers* buffers) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            actions = step_actions;
+            out = buffers;
+            pending = threads.size();
+            generation++;
+        }
+        work_ready.notify_all();
+        run(shards[0]);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        work_done.wait(lock, [this] () { return pending == 0; });
+    }
+
+    /**
+     * A thread's loop.
+     * @param shard The shard the thread steps.
+     */
+    void work (Shard& shard) {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            work_ready.wait(lock, [this, seen] () { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            lock.unlock();
+            run(shard);
+            lock.lock();
+            if (--pending == 0)
+                work_done.notify_one();
+        }
+    }
+};
+
+/**
+ * @param out The caller's buffers.
+ * @return Whether every buffer that isn't optional is there.
+ */
+static bool valid_buffers (const tetris_env_buffers* out) {
+    return out != nullptr && out->board != nullptr && out->queue != nullptr &&
+        out->held != nullptr && out->reward != nullptr && out->done != nullptr;
+}
+
+uint32_t tetris_env_version (void) {
+    return TETRIS_ENV_VERSION;
+}
+
+tetris_env* tetris_env_create (uint32_t count, const uint32_t* seeds, uint32_t threads) {
+    if (count == 0 || seeds == nullptr)
+        return nullptr;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, count);
+
+    // Nothing can be thrown across the C interface
+    tetris_env* env = nullptr;
+    try {
+        env = new tetris_env;
+        env->count = count;
+        env->shards.reserve(threads);
+        // Split as evenly as possible, the first shards get the extra games
+        uint32_t first = 0;
+        for (uint32_t i = 0; i < threads; i++) {
+            uint32_t shard_count = count / threads + (i < count % threads);
+            env->shards.emplace_back(first, seeds + first, shard_count);
+            first += shard_count;
+        }
+        for (size_t i = 1; i < env->shards.size(); i++)
+            env->threads.emplace_back(&tetris_env::work, env, std::ref(env->shards[i]));
+    } catch (const std::exception&) {
+        tetris_env_destroy(env);
+        return nullptr;
+    }
+    return env;
+}
+
+void tetris_env_destroy (tetris_env* env) {
+    if (env == nullptr)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(env->mutex);
+        env->stopping = true;
+    }
+    env->work_ready.notify_all();
+    for (std::thread& thread : env->threads)
+        thread.join();
+    delete env;
+}
+
+uint32_t tetris_env_count (const tetris_env* env) {
+    return env->count;
+}
+
+int tetris_env_reset (tetris_env* env, const tetris_env_buffers* out) {
+    if (!valid_buffers(out))
+        return -1;
+    env->run_all(nullptr, out);
+    return 0;
+}
+
+int tetris_env_step (tetris_env* env, const int32_t* actions, const tetris_env_buffers* out) {
+    if (actions == nullptr || !valid_buffers(out))
+        return -1;
+    env->run_all(actions, out);
+    return 0;
+}
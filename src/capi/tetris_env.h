@@ -0,0 +1,125 @@
+#pragma once
+
+/*
+ * A C interface to many games at once, for driving the engine from other
+ * languages and tools (reinforcement learning, dashboards, ...).
+ * Built as the tetris_env shared library. Everything here is plain C so the
+ * interface stays the same from one compiler to the next; bump
+ * TETRIS_ENV_VERSION whenever it changes.
+ *
+ * An environment holds count games. Every step takes one action per game
+ * and writes what every game looks like afterwards into buffers the caller
+ * owns, laid out game after game. Steps don't allocate, and nothing is
+ * copied besides what's written to those buffers.
+ *
+ * A game that ends is reported as done and a new one starts in its place
+ * right away, so the observation written for it is the new game's first.
+ * Game n of an environment is seeded with its seed for n = 0, and with a
+ * seed mixed from it and n after that. The first game is the same game
+ * Board plays with an engine seeded the same way.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#define TETRIS_ENV_API __declspec(dllexport)
+#elif defined(__GNUC__)
+#define TETRIS_ENV_API __attribute__((visibility("default")))
+#else
+#define TETRIS_ENV_API
+#endif
+
+#define TETRIS_ENV_VERSION 1
+
+/* Board size, the top rows are the buffer and the vanish zone */
+#define TETRIS_ENV_WIDTH 10
+#define TETRIS_ENV_HEIGHT 25
+/* The falling piece, then the pieces coming up */
+#define TETRIS_ENV_QUEUE 6
+/* Columns a piece's 4x4 box can start at, from -2 to 8 */
+#define TETRIS_ENV_COLUMNS 11
+/* Actions are hold * 44 + rotation * 11 + (column + 2) */
+#define TETRIS_ENV_ACTIONS (2 * 4 * TETRIS_ENV_COLUMNS)
+
+/* Pieces are numbered I = 1, J, L, O, S, Z, T = 7, and 0 is none */
+
+/*
+ * Where steps write what the games look like. Every buffer holds one entry
+ * (or row of entries) per game, in the order of the games.
+ */
+typedef struct tetris_env_buffers {
+    /* TETRIS_ENV_HEIGHT rows per game, top first. Bit x is set if column x
+     * is filled. The falling piece isn't in it */
+    uint16_t* board;
+    /* TETRIS_ENV_QUEUE pieces per game, the falling piece first */
+    uint8_t* queue;
+    /* The held piece of each game */
+    uint8_t* held;
+    /* Lines each game cleared in the step */
+    float* reward;
+    /* 1 if the game ended in the step, and a new one took its place */
+    uint8_t* done;
+    /* Optional, NULL to skip it. TETRIS_ENV_ACTIONS per game, 1 for the
+     * actions that fit the board. The others end the game */
+    uint8_t* legal;
+} tetris_env_buffers;
+
+typedef struct tetris_env tetris_env;
+
+/**
+ * @return TETRIS_ENV_VERSION of the library, to check it against the header.
+ */
+TETRIS_ENV_API uint32_t tetris_env_version (void);
+
+/**
+ * Creates an environment and starts its first games.
+ * @param count How many games to play at once.
+ * @param seeds The seed of each game's piece randomizer.
+ * @param threads How many threads to split the games over, 0 for one per
+ * core. With 1 everything runs on the calling thread.
+ * @return The environment, or NULL if count is 0 or seeds is NULL.
+ */
+TETRIS_ENV_API tetris_env* tetris_env_create (
+    uint32_t count, const uint32_t* seeds, uint32_t threads
+);
+
+/**
+ * Stops the environment's threads and frees it.
+ * @param env The environment, or NULL.
+ */
+TETRIS_ENV_API void tetris_env_destroy (tetris_env* env);
+
+/**
+ * @param env The environment.
+ * @return How many games the environment plays.
+ */
+TETRIS_ENV_API uint32_t tetris_env_count (const tetris_env* env);
+
+/**
+ * Starts every game over from its seed and writes their first observations.
+ * Rewards and done are set to 0.
+ * @param env The environment.
+ * @param out Where to write the observations.
+ * @return 0, or -1 if a required buffer is NULL.
+ */
+TETRIS_ENV_API int tetris_env_reset (tetris_env* env, const tetris_env_buffers* out);
+
+/**
+ * Places a piece in every game, all at once.
+ * Actions out of range, and ones that don't fit the board, end their game.
+ * @param env The environment.
+ * @param actions One action per game.
+ * @param out Where to write the observations.
+ * @return 0, or -1 if actions or a required buffer is NULL.
+ */
+TETRIS_ENV_API int tetris_env_step (
+    tetris_env* env, const int32_t* actions, const tetris_env_buffers* out
+);
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,6 +4,7 @@
 
 #include "Board.hpp"
 #include "tetrominoes.hpp"
+#include "../util/instrument.hpp"
 
 uint16_t Board::convert_idx (uint8_t x, uint8_t y) {
     return y * WIDTH + x;
@@ -17,7 +18,7 @@ uint8_t Board::col (uint16_t idx) {
     return idx % WIDTH;
 }
 
-Board::Board (uint16_t fall_rate, std::default_random_engine& random_generator) // NOLINT(*-msc51-cpp)
+Board::Board (uint16_t fall_rate, RandomEngine& random_generator) // NOLINT(*-msc51-cpp)
     : m_gameover(false)
     , m_ticks(0)
     , m_last_ticks(0)
@@ -33,12 +34,31 @@ Board::Board (uint16_t fall_rate, std::default_random_engine& random_generator)
     , m_current_highest(HEIGHT)
     , m_score(0)
     , m_lines_cleared(0)
-    , m_randomgen(random_generator) {
+    , m_pieces_placed(0)
+    , m_generation(0)
+    , m_randomgen(&random_generator) {
     // Initialize each bag in sequential order, then shuffle
     for (auto& bag: m_bags) {
         for (int j = 0; j < 7; j++)
             bag[j] = j + 1;
-        std::shuffle(std::begin(bag), std::end(bag), m_randomgen);
+    }
+    shuffle_bag(0);
+    shuffle_bag(1);
+}
+
+Board::Board (const Board& other, RandomEngine& random_generator)
+    : Board(other) {
+    m_randomgen = &random_generator;
+}
+
+void Board::shuffle_bag (uint8_t bag_num, uint8_t first) {
+    // Fisher-Yates by hand rather than std::shuffle, which gives different
+    // orders on different standard libraries. This way a seed always
+    // produces the same pieces.
+    uint8_t* bag = m_bags[bag_num];
+    for (int i = 6; i > first; i--) {
+        int j = first + (int) ((*m_randomgen)() % (i - first + 1));
+        std::swap(bag[i], bag[j]);
     }
 }
 
@@ -61,10 +81,7 @@ uint8_t Board::get_piece_num () const {
 void Board::next_piece () {
     // If reached the end of the current piece bag, shuffle it and move onto the next;
     if ((m_bag_idx + 1) % 7 == 0) {
-        std::shuffle(
-            std::begin(m_bags[m_bag_idx / 7]), 
-            std::end(m_bags[m_bag_idx / 7]), m_randomgen
-        );
+        shuffle_bag(m_bag_idx / 7);
     }
     m_bag_idx++;
     if (m_bag_idx >= sizeof(m_bags))
@@ -78,11 +95,12 @@ void Board::new_piece () {
 
 
 void Board::new_piece (uint8_t piece) {
+    m_generation++;
     m_falling_piece = piece;
     m_falling_piece_rot = 0;
     // If the highest point is just below the vanish zone
     // Spawn the piece in the vanish zone
-    if (m_current_highest <= VANISH_ZONE_HEIGHT + 2) {
+    if (spawns_high()) {
         m_falling_piece_anchor = convert_idx(3, BUFFER_HEIGHT);
     } else { // Otherwise spawn in visible space
         m_falling_piece_anchor = convert_idx(3, VANISH_ZONE_HEIGHT + BUFFER_HEIGHT);
@@ -126,6 +144,7 @@ void Board::hold_piece () {
 }
 
 void Board::clear_lines () {
+    INSTRUMENT_SCOPE(CLEAR_LINES);
     const uint16_t start = m_falling_piece_anchor;
     const uint8_t start_row = row(start);
     uint8_t lines_cleared = 0;
@@ -152,6 +171,7 @@ void Board::clear_lines () {
     }
 
     if (lines_cleared == 0) return;
+    INSTRUMENT_COUNT(LINES_CLEARED, lines_cleared);
     // Copy down the rest of the lines to
     for (int temp_y = start_row - 1; temp_y >= 0; temp_y--) {
         for (int temp_x = 0; temp_x < 10; temp_x++) {
@@ -213,6 +233,7 @@ uint16_t Board::get_ghost () {
 uint16_t Board::get_ghost (
     uint8_t piece, uint16_t anchor, uint8_t current_rot
 ) {
+    INSTRUMENT_SCOPE(GET_GHOST);
     uint16_t delta = 0;
     while (valid_move(piece, anchor, current_rot, 0, delta + Board::WIDTH))
         delta += Board::WIDTH;
@@ -237,6 +258,11 @@ bool Board::valid_move (
     uint8_t piece, uint16_t anchor, uint8_t current_rot, 
     int8_t rot_delta, int16_t move_delta
 ) {
+    INSTRUMENT_SCOPE(VALID_MOVE);
+    // Anchors are unsigned, so a kick can't move one above the top of the
+    // board even if the squares themselves would still fit
+    if (anchor + move_delta < 0)
+        return false;
     for (int i = 0; i < 4; i++) {
         int old_pos = anchor + tetromino_data::get_piece_map(piece, current_rot, i);
         int new_pos = anchor + move_delta + tetromino_data::get_piece_map(piece, current_rot + rot_delta, i);
@@ -257,7 +283,23 @@ bool Board::valid_move (
     return true;
 }
 
+void Board::place_piece (uint16_t anchor, uint8_t rot, bool hold) {
+    if (m_falling_piece == 0)
+        new_piece();
+    if (m_gameover) return;
+    if (hold)
+        hold_piece();
+    if (m_gameover) return;
+
+    move_piece(
+        rot - m_falling_piece_rot, anchor - m_falling_piece_anchor, true
+    );
+    clear_lines();
+    new_piece();
+}
+
 void Board::move_piece (int8_t rot_delta, int16_t move_delta, bool freeze) {
+    m_generation++;
     for (int i = 3; i >= 0; i--) {
         // get the block with the delta from the map array
         int abs_idx_old = m_falling_piece_anchor + 
@@ -276,6 +318,7 @@ void Board::move_piece (int8_t rot_delta, int16_t move_delta, bool freeze) {
     if (freeze) {
         // The held piece becomes available when the current falling piece is locked
         m_already_held = false;
+        m_pieces_placed++;
 
         // We use > because y is from top down
         if (m_current_highest > row(m_falling_piece_anchor))
@@ -365,6 +408,7 @@ uint8_t Board::get_wall_kick_idx (uint8_t start_rot, uint8_t end_rot)
 
 void Board::update (Input& input, uint32_t ticks)
 {
+    INSTRUMENT_SCOPE(BOARD_UPDATE);
     // m_falling_piece is only assigned 0 at new game
     // every other piece's number is > 0
     if (m_falling_piece == 0) {
@@ -424,11 +468,55 @@ uint8_t Board::get_held_piece () const
     return m_held_piece;
 }
 
+bool Board::can_hold () const
+{
+    return !m_already_held;
+}
+
 uint8_t Board::get_highest_row () const
 {
     return m_current_highest;
 }
 
+bool Board::spawns_high () const
+{
+    return m_current_highest <= VANISH_ZONE_HEIGHT + 2;
+}
+
+void Board::set_square (uint8_t x, uint8_t y, int8_t value)
+{
+    m_board[convert_idx(x, y)] = value;
+    m_generation++;
+    // We use > because y is from top down
+    if (value > 0 && m_current_highest > y)
+        m_current_highest = y;
+}
+
+void Board::set_pieces (const uint8_t* pieces, uint8_t count, uint8_t held)
+{
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t idx = (m_bag_idx + i) % sizeof(m_bags);
+        m_bags[idx / 7][idx % 7] = pieces[i];
+    }
+    m_held_piece = held;
+    m_generation++;
+}
+
+void Board::shuffle_unseen (uint8_t visible)
+{
+    // The rest of the current bag comes first, then all of the other one
+    uint8_t current_bag = m_bag_idx / 7;
+    uint8_t slot = m_bag_idx % 7;
+    uint8_t remaining = 7 - slot;
+    if (visible < remaining) {
+        shuffle_bag(current_bag, slot + visible);
+        shuffle_bag(1 - current_bag);
+    } else if (visible - remaining < 7) {
+        shuffle_bag(1 - current_bag, visible - remaining);
+    }
+    m_generation++;
+}
+
 bool Board::game_over () const
 {
     return m_gameover;
@@ -443,3 +531,28 @@ size_t Board::get_lines_cleared () const
 {
     return m_lines_cleared;
 }
+
+uint32_t Board::get_next_fall_ticks () const
+{
+    return m_last_ticks + m_fall_rate;
+}
+
+uint16_t Board::get_fall_rate () const
+{
+    return m_fall_rate;
+}
+
+size_t Board::get_pieces_placed () const
+{
+    return m_pieces_placed;
+}
+
+uint64_t Board::get_generation () const
+{
+    return m_generation;
+}
+
+RandomEngine& Board::get_random_engine () const
+{
+    return *m_randomgen;
+}
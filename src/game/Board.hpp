@@ -15,6 +15,13 @@ struct Input {
     bool hold_piece;
 };
 
+/*
+ * The engine pieces are drawn with. Pinned instead of
+ * std::default_random_engine, which is a different engine on each standard
+ * library, so a seed gives the same pieces on every platform.
+ */
+using RandomEngine = std::minstd_rand0;
+
 /* Contains the state of the Tetris game */
 class Board {
 public:
@@ -25,6 +32,9 @@ public:
     static constexpr uint8_t BUFFER_SQUARES = BUFFER_HEIGHT*WIDTH;
     static constexpr uint8_t VANISH_ZONE_HEIGHT = HEIGHT - VISIBLE_HEIGHT - BUFFER_HEIGHT;
     static constexpr uint16_t TOTAL_SIZE = WIDTH * HEIGHT;
+    // Bump whenever a change makes the same inputs play out differently,
+    // so old replays are turned away instead of going wrong
+    static constexpr uint16_t RULES_VERSION = 1;
 
     /**
      * Convert typical x, y coordinates to a one-dimensional index.
@@ -53,7 +63,16 @@ public:
 	 * faster).
 	 * @param random_generator The engine to generate random numbers with
 	 */
-    Board (uint16_t fall_rate, std::default_random_engine& random_generator);
+    Board (uint16_t fall_rate, RandomEngine& random_generator);
+
+    /**
+     * Copies a board, but shuffles any new bags with a different engine.
+     * Lets a copy be played ahead without changing the pieces the original
+     * will get, as long as only the copy uses the engine.
+     * @param other The board to copy.
+     * @param random_generator The engine to generate random numbers with.
+     */
+    Board (const Board& other, RandomEngine& random_generator);
 
     /**
      * Update the board.
@@ -77,6 +96,61 @@ public:
      */
     [[nodiscard]] uint16_t get_ghost (uint8_t piece, uint16_t anchor, uint8_t current_rot);
 
+    /**
+     * Checks if a certain move is valid with the current board.
+     * PRECONDITION: The piece is in a valid area to begin with
+     * @param piece What type of piece.
+     * @param anchor Where the piece anchor is initially.
+     * @param current_rot The piece's rotation initially
+     * @param rot_delta How much to rotate the piece
+     * @param move_delta How much to move the piece
+     * @return true If the proposed move is legal
+     */
+    bool valid_move (
+        uint8_t piece, uint16_t anchor, uint8_t current_rot,
+        int8_t rot_delta, int16_t move_delta
+    );
+
+    /**
+     * Places the falling piece directly at its final position and locks it,
+     * the same as steering it there and hard dropping.
+     * Used by headless games and tools that don't go through inputs.
+     * @param anchor The anchor the piece should lock at.
+     * @param rot The rotation the piece should lock with.
+     * @param hold Whether to swap with the held piece first.
+     */
+    void place_piece (uint16_t anchor, uint8_t rot, bool hold);
+
+    /**
+     * Sets a locked square on the board.
+     * Meant for setting up positions before the first update.
+     * @param x The horizontal coordinate.
+     * @param y The vertical coordinate.
+     * @param value The piece type to fill the square with, or 0 to empty it.
+     */
+    void set_square (uint8_t x, uint8_t y, int8_t value);
+
+    /**
+     * Sets the pieces coming up and the held piece.
+     * Meant for setting up positions before the first update, which spawns
+     * the first of the pieces. Pieces past these are whatever the bags
+     * already held, so they won't follow the 7-bag rule anymore.
+     * @param pieces The pieces coming up, next first.
+     * @param count How many pieces there are, up to 7.
+     * @param held The held piece, or 0 for none.
+     */
+    void set_pieces (const uint8_t* pieces, uint8_t count, uint8_t held);
+
+    /**
+     * Reshuffles the pieces a player can't see yet, the ones past the first
+     * few coming up, with the board's engine. Each bag keeps its pieces and
+     * only their order changes, so the pieces still follow the 7-bag rule.
+     * Lets a copy play one of the futures the visible queue allows instead of
+     * the one the original will get.
+     * @param visible How many pieces coming up stay as they are.
+     */
+    void shuffle_unseen (uint8_t visible);
+
     /**
      * Get the square (cell) associated with a certain x, y coordinate.
      * @param x The horizontal coordinate.
@@ -123,6 +197,12 @@ public:
      */
     [[nodiscard]] uint8_t get_held_piece () const;
 
+    /**
+     * @return Whether the falling piece can still be swapped with the held
+     * piece. Once swapped, holding does nothing until the piece locks.
+     */
+    [[nodiscard]] bool can_hold () const;
+
     /**
      * @return The falling piece type
      */
@@ -138,6 +218,12 @@ public:
      */
     [[nodiscard]] uint8_t get_highest_row () const;
 
+    /**
+     * @return True if new pieces spawn up in the vanish zone, because the
+     * stack is right below where they'd spawn otherwise.
+     */
+    [[nodiscard]] bool spawns_high () const;
+
     /**
      * @return True if the game is over, false otherwise.
      */
@@ -153,6 +239,32 @@ public:
      */
     [[nodiscard]] size_t get_lines_cleared() const;
 
+    /**
+     * @return The tick at which the falling piece will next fall by itself.
+     */
+    [[nodiscard]] uint32_t get_next_fall_ticks () const;
+
+    /**
+     * @return How many milliseconds it takes the falling piece to fall a row.
+     */
+    [[nodiscard]] uint16_t get_fall_rate () const;
+
+    /**
+     * @return How many pieces have been locked so far.
+     */
+    [[nodiscard]] size_t get_pieces_placed () const;
+
+    /**
+     * @return A number that changes every time the squares or the falling
+     * piece change, so nothing needs redrawing while it stays the same.
+     */
+    [[nodiscard]] uint64_t get_generation () const;
+
+    /**
+     * @return The engine new bags are shuffled with.
+     */
+    [[nodiscard]] RandomEngine& get_random_engine () const;
+
     //endregion
 
 private:
@@ -169,6 +281,13 @@ private:
      */
     void next_piece ();
 
+    /**
+     * Shuffles one of the two piece bags.
+     * @param bag_num Which bag to shuffle.
+     * @param first The first slot to shuffle, the ones before it stay.
+     */
+    void shuffle_bag (uint8_t bag_num, uint8_t first = 0);
+
     /**
 	 * Creates a new falling piece from the next one up.
 	 */
@@ -200,21 +319,6 @@ private:
      */
     bool valid_move (int8_t rot_delta, int16_t move_delta);
 
-    /**
-     * Checks if a certain move is valid with the current board.
-     * PRECONDITION: The piece is in a valid area to begin with
-     * @param piece What type of piece.
-     * @param anchor Where the piece anchor is initially.
-     * @param current_rot The piece's rotation initially
-     * @param rot_delta How much to rotate the piece
-     * @param move_delta How much to move the piece
-     * @return true If the proposed move is legal
-     */
-    bool valid_move (
-        uint8_t piece, uint16_t anchor, uint8_t current_rot, 
-        int8_t rot_delta, int16_t move_delta
-    );
-
     /**
      * Move/rotate the current piece a certain amount.
      * DOESN'T DO ANY CHECKS,
@@ -273,6 +377,9 @@ private:
 
     size_t m_score;
     size_t m_lines_cleared;
+    size_t m_pieces_placed;
+    uint64_t m_generation;
 
-    std::default_random_engine& m_randomgen;
+    // A pointer so copies can be given their own engine
+    RandomEngine* m_randomgen;
 };
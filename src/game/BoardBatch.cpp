@@ -0,0 +1,378 @@
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#include "BoardBatch.hpp"
+
+/* The rows of every piece's 4x4 box in every rotation, a bit per column with
+ * the left edge of the box at bit 0 */
+static constexpr auto PIECE_ROWS = [] {
+    std::array<std::array<std::array<uint16_t, 4>, 4>, 7> rows = {};
+    for (int piece = 0; piece < 7; piece++) {
+        for (int rot = 0; rot < 4; rot++) {
+            for (int n = 0; n < 4; n++) {
+                uint8_t square = tetromino_data::MAPS[piece][rot][n];
+                rows[piece][rot][square / Board::WIDTH] |= 1 << (square % Board::WIDTH);
+            }
+        }
+    }
+    return rows;
+}();
+
+/**
+ * @param piece Which piece.
+ * @param move The rotation and column of the piece.
+ * @param r Which row of the piece's box.
+ * @return The squares of the piece in that row, a bit per board column.
+ */
+static uint16_t piece_row (uint8_t piece, const BatchMove& move, int r) {
+    uint16_t bits = PIECE_ROWS[piece - 1][move.rotation][r];
+    return move.column >= 0 ? bits << move.column : bits >> -move.column;
+}
+
+BoardBatch::BoardBatch (size_t capacity)
+    : m_capacity(capacity)
+    , m_count(0)
+    , m_running(0)
+    , m_max_pieces(SIZE_MAX)
+    , m_rows((Board::HEIGHT + FLOOR_ROWS) * capacity, 0)
+    , m_heights(Board::WIDTH * capacity, 0)
+    , m_bags(BAG_SLOTS * capacity, 0)
+    , m_bag_idx(capacity, 0)
+    , m_falling_piece(capacity, 0)
+    , m_held_piece(capacity, 0)
+    , m_already_held(capacity, 0)
+    , m_current_highest(capacity, Board::HEIGHT)
+    , m_gameover(capacity, 0)
+    , m_score(capacity, 0)
+    , m_lines_cleared(capacity, 0)
+    , m_pieces_placed(capacity, 0)
+    , m_games(capacity, 0)
+    , m_lanes(capacity, 0)
+    , m_randomgens(capacity)
+    , m_pieces(capacity, 0)
+    , m_landing(capacity, 0)
+    , m_lines(capacity, 0)
+{
+    for (uint8_t y = Board::HEIGHT; y < Board::HEIGHT + FLOOR_ROWS; y++)
+        std::fill_n(row(y), m_capacity, FULL_ROW);
+}
+
+void BoardBatch::reset (const uint32_t* seeds, size_t count, size_t max_pieces) {
+    m_count = std::min(count, m_capacity);
+    m_running = m_count;
+    m_max_pieces = max_pieces;
+    for (size_t lane = 0; lane < m_count; lane++) {
+        m_games[lane] = lane;
+        m_lanes[lane] = lane;
+        restart(lane, seeds[lane]);
+    }
+}
+
+void BoardBatch::restart (size_t lane, uint32_t seed) {
+    m_randomgens[lane].seed(seed);
+    for (uint8_t slot = 0; slot < BAG_SLOTS; slot++)
+        m_bags[slot * m_capacity + lane] = slot % 7 + 1;
+    shuffle_bag(lane, 0);
+    shuffle_bag(lane, 1);
+    m_bag_idx[lane] = 7;
+
+    for (uint8_t y = 0; y < Board::HEIGHT; y++)
+        row(y)[lane] = 0;
+    for (uint8_t x = 0; x < Board::WIDTH; x++)
+        m_heights[x * m_capacity + lane] = 0;
+    m_held_piece[lane] = 0;
+    m_already_held[lane] = false;
+    m_current_highest[lane] = Board::HEIGHT;
+    m_score[lane] = 0;
+    m_lines_cleared[lane] = 0;
+    m_pieces_placed[lane] = 0;
+    // Board spawns its first piece on the first update
+    new_piece(lane, 0);
+}
+
+void BoardBatch::step (const BatchMove* moves) {
+    const size_t lanes = m_running;
+    // Holds go first, they change which piece gets placed
+    for (size_t lane = 0; lane < lanes; lane++) {
+        m_pieces[lane] = 0;
+        if (finished(lane))
+            continue;
+        if (moves[lane].hold)
+            hold_piece(lane);
+        if (!m_gameover[lane])
+            m_pieces[lane] = m_falling_piece[lane];
+    }
+
+    drop(m_pieces.data(), moves, m_landing.data());
+    for (size_t lane = 0; lane < lanes; lane++) {
+        if (m_pieces[lane] == 0)
+            continue;
+        if (m_landing[lane] < 0) {
+            m_gameover[lane] = true;
+            m_pieces[lane] = 0;
+        } else {
+            lock_piece(lane, moves[lane], m_landing[lane]);
+        }
+    }
+
+    // A full row has to have the piece that was just locked in it, so
+    // counting every full row counts the lines the piece cleared
+    uint8_t* lines = m_lines.data();
+    std::fill_n(lines, lanes, 0);
+    for (uint8_t y = 0; y < Board::HEIGHT; y++) {
+        const uint16_t* bits = row(y);
+        for (size_t lane = 0; lane < lanes; lane++)
+            lines[lane] += bits[lane] == FULL_ROW;
+    }
+    for (size_t lane = 0; lane < lanes; lane++) {
+        if (m_pieces[lane] == 0)
+            continue;
+        if (lines[lane] > 0)
+            clear_lines(lane, lines[lane]);
+        new_piece(lane, 0);
+    }
+    update_heights();
+}
+
+void BoardBatch::drop (const uint8_t* pieces, const BatchMove* moves, int8_t* rows) {
+    // Blocks of lanes are worked on in arrays of their own, which the
+    // compiler can tell don't overlap the rows
+    for (size_t first = 0; first < m_running; first += DROP_LANES) {
+        const size_t lanes = std::min(DROP_LANES, m_running - first);
+        uint16_t masks[4][DROP_LANES];
+        uint8_t moving[DROP_LANES];
+        int8_t landing[DROP_LANES];
+        for (size_t i = 0; i < lanes; i++) {
+            const size_t lane = first + i;
+            bool valid = pieces[lane] != 0 && in_bounds(pieces[lane], moves[lane]);
+            for (int r = 0; r < 4; r++)
+                masks[r][i] = valid ? piece_row(pieces[lane], moves[lane], r) : 0;
+            moving[i] = valid;
+            // A row above the start, so the first row down is the start
+            landing[i] = Board::BUFFER_HEIGHT - 1;
+        }
+
+        // Every lane starts at the same row, like generate_moves(), and
+        // moves down with the rest until it's blocked. That way all of them
+        // read the same rows at the same time.
+        for (int y = Board::BUFFER_HEIGHT; y < Board::HEIGHT; y++) {
+            const uint16_t* below[4] = {
+                row(y) + first, row(y + 1) + first, row(y + 2) + first, row(y + 3) + first
+            };
+            uint8_t any_moving = 0;
+            for (size_t i = 0; i < lanes; i++) {
+                uint16_t hit = (below[0][i] & masks[0][i]) | (below[1][i] & masks[1][i]) |
+                    (below[2][i] & masks[2][i]) | (below[3][i] & masks[3][i]);
+                moving[i] &= hit == 0;
+                landing[i] += moving[i];
+                any_moving |= moving[i];
+            }
+            if (!any_moving)
+                break;
+        }
+
+        // Never got to the start, they're out of bounds or don't fit there
+        for (size_t i = 0; i < lanes; i++)
+            rows[first + i] = landing[i] < Board::BUFFER_HEIGHT ? -1 : landing[i];
+    }
+}
+
+size_t BoardBatch::compact () {
+    size_t lane = 0;
+    while (lane < m_running) {
+        if (finished(lane))
+            swap_lanes(lane, --m_running);
+        else
+            lane++;
+    }
+    return m_running;
+}
+
+bool BoardBatch::in_bounds (uint8_t piece, const BatchMove& move) {
+    if (move.rotation >= 4)
+        return false;
+    tetromino_data::Bounds bounds = tetromino_data::get_piece_bounds(piece, move.rotation);
+    return move.column >= bounds.left_bound && move.column <= bounds.right_bound;
+}
+
+uint16_t* BoardBatch::row (uint8_t y) {
+    return &m_rows[y * m_capacity];
+}
+
+void BoardBatch::shuffle_bag (size_t lane, uint8_t bag_num) {
+    // The same Fisher-Yates as Board::shuffle_bag()
+    uint8_t* bag = &m_bags[bag_num * 7 * m_capacity + lane];
+    for (int i = 6; i > 0; i--) {
+        int j = (int) (m_randomgens[lane]() % (i + 1));
+        std::swap(bag[i * m_capacity], bag[j * m_capacity]);
+    }
+}
+
+void BoardBatch::new_piece (size_t lane, uint8_t piece) {
+    if (piece == 0)
+        piece = nth_piece(lane, 0);
+    m_falling_piece[lane] = piece;
+
+    // Move up in the bag
+    uint8_t& bag_idx = m_bag_idx[lane];
+    if ((bag_idx + 1) % 7 == 0)
+        shuffle_bag(lane, bag_idx / 7);
+    if (++bag_idx >= BAG_SLOTS)
+        bag_idx = 0;
+
+    const uint8_t spawn_row = m_current_highest[lane] <= Board::VANISH_ZONE_HEIGHT + 2
+        ? Board::BUFFER_HEIGHT
+        : Board::VANISH_ZONE_HEIGHT + Board::BUFFER_HEIGHT;
+    const BatchMove spawn = {.rotation = 0, .column = 3, .hold = false};
+    bool block_out = false;
+    for (int r = 0; r < 4; r++)
+        block_out |= (row(spawn_row + r)[lane] & piece_row(piece, spawn, r)) != 0;
+    // Assigned rather than set, the same as Board. It's what ends games that
+    // lock out too.
+    m_gameover[lane] = block_out;
+}
+
+void BoardBatch::hold_piece (size_t lane) {
+    if (m_already_held[lane])
+        return;
+    uint8_t prev_held_piece = m_held_piece[lane];
+    m_held_piece[lane] = m_falling_piece[lane];
+    new_piece(lane, prev_held_piece);
+    m_already_held[lane] = true;
+}
+
+void BoardBatch::lock_piece (size_t lane, const BatchMove& move, int8_t y) {
+    const uint8_t piece = m_falling_piece[lane];
+    for (int r = 0; r < 4; r++)
+        row(y + r)[lane] |= piece_row(piece, move, r);
+    m_already_held[lane] = false;
+    m_pieces_placed[lane]++;
+
+    // Board goes by the row of the anchor index, which is the row above for
+    // boxes that start left of the wall
+    const uint8_t anchor_row = Board::row(y * Board::WIDTH + move.column);
+    if (m_current_highest[lane] > anchor_row)
+        m_current_highest[lane] = anchor_row;
+
+}
+
+void BoardBatch::clear_lines (size_t lane, uint8_t lines_cleared) {
+    int copy_y = Board::HEIGHT - 1;
+    for (int current_y = Board::HEIGHT - 1; current_y >= 0; current_y--) {
+        uint16_t bits = row(current_y)[lane];
+        if (bits != FULL_ROW)
+            row(copy_y--)[lane] = bits;
+    }
+    while (copy_y >= 0)
+        row(copy_y--)[lane] = 0;
+    // Board stops filling the top with zeroes one square short, which
+    // leaves the last column of what was the top row
+    row(lines_cleared)[lane] &= 1 << (Board::WIDTH - 1);
+
+    m_current_highest[lane] += lines_cleared;
+    m_lines_cleared[lane] += lines_cleared;
+    static constexpr uint16_t SCORES[5] = {0, 100, 300, 500, 800};
+    m_score[lane] += SCORES[lines_cleared] * m_lines_cleared[lane] / 10;
+}
+
+void BoardBatch::swap_lanes (size_t a, size_t b) {
+    for (uint8_t y = 0; y < Board::HEIGHT; y++)
+        std::swap(row(y)[a], row(y)[b]);
+    for (uint8_t x = 0; x < Board::WIDTH; x++)
+        std::swap(m_heights[x * m_capacity + a], m_heights[x * m_capacity + b]);
+    for (uint8_t slot = 0; slot < BAG_SLOTS; slot++)
+        std::swap(m_bags[slot * m_capacity + a], m_bags[slot * m_capacity + b]);
+    std::swap(m_bag_idx[a], m_bag_idx[b]);
+    std::swap(m_falling_piece[a], m_falling_piece[b]);
+    std::swap(m_held_piece[a], m_held_piece[b]);
+    std::swap(m_already_held[a], m_already_held[b]);
+    std::swap(m_current_highest[a], m_current_highest[b]);
+    std::swap(m_gameover[a], m_gameover[b]);
+    std::swap(m_score[a], m_score[b]);
+    std::swap(m_lines_cleared[a], m_lines_cleared[b]);
+    std::swap(m_pieces_placed[a], m_pieces_placed[b]);
+    std::swap(m_randomgens[a], m_randomgens[b]);
+    std::swap(m_games[a], m_games[b]);
+    m_lanes[m_games[a]] = a;
+    m_lanes[m_games[b]] = b;
+}
+
+void BoardBatch::update_heights () {
+    const size_t lanes = m_running;
+    for (uint8_t x = 0; x < Board::WIDTH; x++)
+        std::fill_n(&m_heights[x * m_capacity], lanes, 0);
+    // From the bottom up, so the last filled square is the top
+    for (int y = Board::HEIGHT - 1; y >= 0; y--) {
+        const uint16_t* bits = row(y);
+        const uint8_t height = Board::HEIGHT - y;
+        for (uint8_t x = 0; x < Board::WIDTH; x++) {
+            uint8_t* heights = &m_heights[x * m_capacity];
+            for (size_t lane = 0; lane < lanes; lane++)
+                heights[lane] = (bits[lane] >> x) & 1 ? height : heights[lane];
+        }
+    }
+}
+
+size_t BoardBatch::get_count () const {
+    return m_count;
+}
+
+size_t BoardBatch::get_running () const {
+    return m_running;
+}
+
+const uint16_t* BoardBatch::get_row (uint8_t y) const {
+    return &m_rows[y * m_capacity];
+}
+
+const uint8_t* BoardBatch::get_heights (uint8_t x) const {
+    return &m_heights[x * m_capacity];
+}
+
+uint32_t BoardBatch::get_game (size_t lane) const {
+    return m_games[lane];
+}
+
+size_t BoardBatch::get_lane (uint32_t game) const {
+    return m_lanes[game];
+}
+
+uint8_t BoardBatch::get_falling_piece (size_t lane) const {
+    return m_falling_piece[lane];
+}
+
+uint8_t BoardBatch::get_held_piece (size_t lane) const {
+    return m_held_piece[lane];
+}
+
+uint8_t BoardBatch::nth_piece (size_t lane, uint8_t n) const {
+    uint8_t idx = m_bag_idx[lane] + n;
+    if (idx >= BAG_SLOTS)
+        idx -= BAG_SLOTS;
+    return m_bags[idx * m_capacity + lane];
+}
+
+uint8_t BoardBatch::get_highest_row (size_t lane) const {
+    return m_current_highest[lane];
+}
+
+bool BoardBatch::game_over (size_t lane) const {
+    return m_gameover[lane];
+}
+
+bool BoardBatch::finished (size_t lane) const {
+    return m_gameover[lane] || m_pieces_placed[lane] >= m_max_pieces;
+}
+
+size_t BoardBatch::get_score (size_t lane) const {
+    return m_score[lane];
+}
+
+size_t BoardBatch::get_lines_cleared (size_t lane) const {
+    return m_lines_cleared[lane];
+}
+
+size_t BoardBatch::get_pieces_placed (size_t lane) const {
+    return m_pieces_placed[lane];
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Board.hpp"
+
+/* One placement for a game in a BoardBatch */
+struct BatchMove {
+    uint8_t rotation;
+    // Column of the left edge of the piece's 4x4 box, between the piece's
+    // tetromino_data::PIECE_BOUNDS, so it can be negative
+    int8_t column;
+    bool hold;
+};
+
+/*
+ * Many games of Tetris played in lock-step, one placement per game every
+ * step, for the trainer and anything else that needs a lot of games at once.
+ * State is kept in structure-of-arrays layout: row y of every game is next
+ * to each other, as are column x's heights, the bags, the scores and so on.
+ * Each game is a lane, and the work of a step is loops over lanes with the
+ * same row for all of them. A Release build (-O3) vectorizes them with the
+ * target's baseline SIMD, SSE2 on x86-64, so nothing here needs AVX2. GCC
+ * leaves them scalar at -O2 and below, which includes the default build
+ * with no CMAKE_BUILD_TYPE. Rows are
+ * bitmasks with a bit per column, and there are FLOOR_ROWS full rows under
+ * the board so dropping never needs a bounds check.
+ * The rules are Board's, placement for placement: the same bags from the
+ * same seed, the same holds, spawns, line clears and score, so a game here
+ * is the game a Board would play with Board::place_piece().
+ */
+class BoardBatch {
+public:
+    // Rows of a game, with every column filled
+    static constexpr uint16_t FULL_ROW = (1 << Board::WIDTH) - 1;
+    // Filled rows under the board
+    static constexpr uint8_t FLOOR_ROWS = 4;
+
+    /**
+     * Makes room for games, without starting any.
+     * @param capacity The most games the batch can hold.
+     */
+    explicit BoardBatch (size_t capacity);
+
+    /**
+     * Starts new games in every lane, replacing any running ones.
+     * Game i is in lane i until compact() moves it.
+     * @param seeds The seed of each game's piece randomizer, like the
+     * engine given to Board.
+     * @param count How many games to start, up to the capacity.
+     * @param max_pieces Games are finished after placing this many pieces.
+     */
+    void reset (const uint32_t* seeds, size_t count, size_t max_pieces = SIZE_MAX);
+
+    /**
+     * Starts a new game in one lane, with the first piece already falling.
+     * The game keeps the lane's game ID.
+     * @param lane Which lane.
+     * @param seed The seed of the game's piece randomizer.
+     */
+    void restart (size_t lane, uint32_t seed);
+
+    /**
+     * Places a piece in every running game and spawns the next.
+     * Moves that are out of bounds or don't fit at the top of the board end
+     * their game, like topping out.
+     * @param moves One move for each lane below get_running().
+     */
+    void step (const BatchMove* moves);
+
+    /**
+     * Finds where pieces land when hard dropped from the top of the board,
+     * like generate_moves() does, for every running lane at once.
+     * @param pieces The piece of each lane.
+     * @param moves The rotation and column of each lane, the holds are
+     * ignored.
+     * @param rows Set to the row of the top of each piece's 4x4 box after the
+     * drop, or -1 if the move is out of bounds or doesn't fit at the top.
+     */
+    void drop (const uint8_t* pieces, const BatchMove* moves, int8_t* rows);
+
+    /**
+     * Moves finished games behind the running ones, so steps only touch
+     * games that are still going. Finished games keep their state.
+     * @return How many games are still running.
+     */
+    size_t compact ();
+
+    /**
+     * @param piece Which piece.
+     * @param move The rotation and column of the piece.
+     * @return Whether the piece fits inside the board's walls there.
+     */
+    static bool in_bounds (uint8_t piece, const BatchMove& move);
+
+    //region const getters
+
+    /**
+     * @return How many games were started.
+     */
+    [[nodiscard]] size_t get_count () const;
+
+    /**
+     * @return How many games are in the first lanes and still running,
+     * after compact(). Before it, finished games can be among them.
+     */
+    [[nodiscard]] size_t get_running () const;
+
+    /**
+     * @param y Which row, 0 at the top.
+     * @return The row in every lane, a bit per column with column 0 the
+     * lowest bit.
+     */
+    [[nodiscard]] const uint16_t* get_row (uint8_t y) const;
+
+    /**
+     * @param x Which column.
+     * @return How many rows from the floor to the top of the column, in
+     * every lane.
+     */
+    [[nodiscard]] const uint8_t* get_heights (uint8_t x) const;
+
+    /**
+     * @param lane Which lane.
+     * @return The index of the game in the lane, in the order reset()
+     * started them.
+     */
+    [[nodiscard]] uint32_t get_game (size_t lane) const;
+
+    /**
+     * @param game The index of a game.
+     * @return The lane the game is in now.
+     */
+    [[nodiscard]] size_t get_lane (uint32_t game) const;
+
+    [[nodiscard]] uint8_t get_falling_piece (size_t lane) const;
+    [[nodiscard]] uint8_t get_held_piece (size_t lane) const;
+
+    /**
+     * @param lane Which lane.
+     * @param n Which piece after the falling one, 0 for the next.
+     * @return The piece.
+     */
+    [[nodiscard]] uint8_t nth_piece (size_t lane, uint8_t n) const;
+
+    /**
+     * @param lane Which lane.
+     * @return The same as Board::get_highest_row().
+     */
+    [[nodiscard]] uint8_t get_highest_row (size_t lane) const;
+
+    [[nodiscard]] bool game_over (size_t lane) const;
+
+    /**
+     * @param lane Which lane.
+     * @return Whether the game topped out or placed its last piece.
+     */
+    [[nodiscard]] bool finished (size_t lane) const;
+
+    [[nodiscard]] size_t get_score (size_t lane) const;
+    [[nodiscard]] size_t get_lines_cleared (size_t lane) const;
+    [[nodiscard]] size_t get_pieces_placed (size_t lane) const;
+
+    //endregion
+
+private:
+    static constexpr uint8_t BAG_SLOTS = 14;
+    // Lanes drop() works on at a time
+    static constexpr size_t DROP_LANES = 64;
+
+    /**
+     * @param y Which row.
+     * @return Row y of every lane.
+     */
+    uint16_t* row (uint8_t y);
+
+    /**
+     * Board::shuffle_bag() for one lane.
+     * @param lane Which lane.
+     * @param bag_num Which of its two bags.
+     */
+    void shuffle_bag (size_t lane, uint8_t bag_num);
+
+    /**
+     * Board::new_piece() for one lane, ending the game if the piece spawns
+     * on the stack.
+     * @param lane Which lane.
+     * @param piece Which piece, or 0 for the next one up.
+     */
+    void new_piece (size_t lane, uint8_t piece);
+
+    /**
+     * Board::hold_piece() for one lane.
+     * @param lane Which lane.
+     */
+    void hold_piece (size_t lane);
+
+    /**
+     * Locks the falling piece of a lane.
+     * @param lane Which lane.
+     * @param move The rotation and column of the piece.
+     * @param y The row the top of the piece's box landed on.
+     */
+    void lock_piece (size_t lane, const BatchMove& move, int8_t y);
+
+    /**
+     * Board::clear_lines() for one lane.
+     * @param lane Which lane.
+     * @param lines_cleared How many full rows the lane has.
+     */
+    void clear_lines (size_t lane, uint8_t lines_cleared);
+
+    /**
+     * Swaps all the state of two lanes.
+     */
+    void swap_lanes (size_t a, size_t b);
+
+    /**
+     * Works out the column heights of every running lane.
+     */
+    void update_heights ();
+
+    size_t m_capacity;
+    size_t m_count;
+    size_t m_running;
+    size_t m_max_pieces;
+
+    // [y * capacity + lane], HEIGHT + FLOOR_ROWS rows
+    std::vector<uint16_t> m_rows;
+    // [x * capacity + lane]
+    std::vector<uint8_t> m_heights;
+    // [slot * capacity + lane], like Board's two bags one after the other
+    std::vector<uint8_t> m_bags;
+    std::vector<uint8_t> m_bag_idx;
+
+    std::vector<uint8_t> m_falling_piece;
+    std::vector<uint8_t> m_held_piece;
+    std::vector<uint8_t> m_already_held;
+    std::vector<uint8_t> m_current_highest;
+    std::vector<uint8_t> m_gameover;
+
+    std::vector<size_t> m_score;
+    std::vector<size_t> m_lines_cleared;
+    std::vector<size_t> m_pieces_placed;
+
+    std::vector<uint32_t> m_games;
+    std::vector<uint32_t> m_lanes;
+    std::vector<RandomEngine> m_randomgens;
+
+    // Scratch for step()
+    std::vector<uint8_t> m_pieces;
+    std::vector<int8_t> m_landing;
+    std::vector<uint8_t> m_lines;
+};
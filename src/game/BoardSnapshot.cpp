@@ -0,0 +1,21 @@
+#include "BoardSnapshot.hpp"
+
+void BoardSnapshot::capture (Board& board, uint64_t sequence_num) {
+    for (uint16_t idx = 0; idx < Board::TOTAL_SIZE; idx++)
+        squares[idx] = board.get_square(idx);
+
+    falling_piece = board.get_falling_piece();
+    falling_piece_rot = board.get_falling_piece_rot();
+    falling_piece_anchor = board.get_falling_piece_anchor();
+    // There's no falling piece until the first update
+    ghost_anchor = falling_piece > 0 ? board.get_ghost() : falling_piece_anchor;
+
+    for (uint8_t i = 0; i < QUEUE_SIZE; i++)
+        queue[i] = board.nth_piece(i);
+    held_piece = board.get_held_piece();
+    score = board.get_score();
+    lines_cleared = board.get_lines_cleared();
+    game_over = board.game_over();
+    sequence = sequence_num;
+    generation = board.get_generation();
+}
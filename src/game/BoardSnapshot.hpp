@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Board.hpp"
+
+/* A copy of everything needed to draw a Board at one point in time */
+struct BoardSnapshot {
+    static constexpr uint8_t QUEUE_SIZE = 3;
+
+    int8_t squares[Board::TOTAL_SIZE];
+    uint8_t falling_piece;
+    uint8_t falling_piece_rot;
+    uint16_t falling_piece_anchor;
+    uint16_t ghost_anchor;
+    uint8_t queue[QUEUE_SIZE];
+    uint8_t held_piece;
+    size_t score;
+    size_t lines_cleared;
+    bool game_over;
+    // Increases with every snapshot taken, newer snapshots have higher numbers
+    uint64_t sequence;
+    // Board::get_generation() at the time of the snapshot
+    uint64_t generation;
+
+    /**
+     * Copies the state of a board into the snapshot.
+     * @param board The board to copy.
+     * Doesn't modify the board, but get_ghost() isn't const.
+     * @param sequence_num The number of this snapshot.
+     */
+    void capture (Board& board, uint64_t sequence_num);
+
+    /**
+     * Get the square associated with a certain x, y coordinate.
+     * @param x The horizontal coordinate.
+     * @param y The vertical coordinate.
+     * @return The value of the square.
+     */
+    [[nodiscard]] int8_t get_square (uint8_t x, uint8_t y) const {
+        return squares[Board::convert_idx(x, y)];
+    }
+};
@@ -13,7 +13,7 @@
 namespace tetromino_data
 {
     // Piece maps, where to place squares relative to a piece's anchor.
-    const uint8_t MAPS[7][4][4] =
+    constexpr uint8_t MAPS[7][4][4] =
         {
             { // I
                 {10, 11, 12, 13}, {2, 12, 22, 32}, {20, 21, 22, 23}, {1, 11, 21, 31}
@@ -1,12 +1,171 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 #include "ai/genetic/Agent.hpp"
+#include "ai/ValueNet.hpp"
+#include "ai/genetic/population.hpp"
 #include "ai/genetic/train.hpp"
 #include "app/App.hpp"
+#include "app/datagen.hpp"
+#include "app/headless.hpp"
+#include "app/ReplayApp.hpp"
+#include "app/SpectatorApp.hpp"
+
+/**
+ * Watches many agents at once in a grid.
+ * @param weights The agent to fill the grid with if there's no population.
+ * @param grid_size How many boards to show, 0 for one per agent in the
+ * population.
+ * @param population_path A population file to take the agents from, or
+ * nullptr.
+ * @param unthrottled Whether the agents play as fast as they can.
+ * @return The exit code.
+ */
+int spectate (
+    const Weights& weights, size_t grid_size, const char* population_path,
+    bool unthrottled
+) {
+    std::vector<Weights> population = {weights};
+    if (population_path != nullptr && 
+        (!load_population(population_path, population) || population.empty())) {
+        std::cout << "ERR: Could not load population" << std::endl;
+        return 1;
+    }
+
+    // Fill the grid by going around the population as many times as it takes
+    if (grid_size == 0)
+        grid_size = population.size();
+    std::vector<Weights> agents;
+    for (size_t i = 0; i < grid_size; i++)
+        agents.push_back(population[i % population.size()]);
+
+    SpectatorApp app (agents, unthrottled);
+    if (!app.init()) {
+        std::cout << "ERR: Could not initialize" << std::endl;
+        return 1;
+    }
+
+    app.run();
+    return 0;
+}
+
+/**
+ * Watches a recorded game.
+ * @param path Where the replay is.
+ * @return The exit code.
+ */
+int watch_replay (const char* path) {
+    ReplayApp app;
+    if (!app.init(path)) {
+        std::cout << "ERR: Could not initialize" << std::endl;
+        return 1;
+    }
+
+    app.run();
+    return 0;
+}
 
 int main (int argc, char** argv) {
     Weights weights = {-20.0, -10.0, 50.0, -1.0, -20.0, -10.0};
-    if (strcmp(argv[1], "train") == 0) {
+    bool train_agent = false;
+    bool datagen = false;
+    bool unthrottled = false;
+    uint8_t max_depth = 1;
+    uint16_t fall_rate = 250;
+    bool grid = false;
+    size_t grid_size = 0;
+    const char* population_path = nullptr;
+    const char* replay_path = nullptr;
+    const char* net_path = nullptr;
+    size_t rollouts = 0;
+    uint64_t budget_us = 0;
+    size_t max_pieces = 0;
+    DatagenSettings datagen_settings = {
+        .directory = "dataset",
+        .positions = 1000000,
+        .sample_every = 1,
+        .reservoir = 0,
+        .max_pieces = 10000,
+        .shard_positions = 1000000,
+        .seed = 0,
+        .threads = 0
+    };
+    ExportSettings export_settings = {
+        .directory = nullptr,
+        .format = FrameFormat::PNG,
+        .fps = 60,
+        .max_pieces = 500,
+        .replay_directory = nullptr
+    };
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "train") == 0) {
+            train_agent = true;
+        } else if (strcmp(argv[i], "datagen") == 0) {
+            datagen = true;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            datagen_settings.directory = argv[++i];
+        } else if (strcmp(argv[i], "--positions") == 0 && i + 1 < argc) {
+            datagen_settings.positions = std::strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--every") == 0 && i + 1 < argc) {
+            datagen_settings.sample_every = std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--reservoir") == 0 && i + 1 < argc) {
+            datagen_settings.sample_every = 0;
+            datagen_settings.reservoir = std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            datagen_settings.seed = std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            datagen_settings.threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--unthrottled") == 0) {
+            unthrottled = true;
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            max_depth = (uint8_t) std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--gravity") == 0 && i + 1 < argc) {
+            fall_rate = (uint16_t) std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            grid = true;
+            grid_size = std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--population") == 0 && i + 1 < argc) {
+            grid = true;
+            population_path = argv[++i];
+        } else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            export_settings.directory = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            i++;
+            export_settings.format = strcmp(argv[i], "rgba") == 0 ? 
+                FrameFormat::RGBA : FrameFormat::PNG;
+        } else if (strcmp(argv[i], "--pieces") == 0 && i + 1 < argc) {
+            max_pieces = std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            export_settings.replay_directory = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--net") == 0 && i + 1 < argc) {
+            net_path = argv[++i];
+        } else if (strcmp(argv[i], "--rollouts") == 0 && i + 1 < argc) {
+            rollouts = std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            budget_us = std::strtoull(argv[++i], nullptr, 10);
+        }
+    }
+
+    if (max_pieces > 0) {
+        export_settings.max_pieces = max_pieces;
+        datagen_settings.max_pieces = max_pieces;
+    }
+
+    if (replay_path != nullptr)
+        return watch_replay(replay_path);
+
+    std::shared_ptr<ValueNet> net;
+    if (net_path != nullptr) {
+        net = std::make_shared<ValueNet>();
+        if (!net->load(net_path))
+            return 1;
+    }
+
+    if (train_agent) {
         Agent best_agent = train({
             .POPULATION_SIZE = 500,
             .PARENT_RATIO = 50,
@@ -17,9 +176,34 @@ int main (int argc, char** argv) {
         weights = best_agent.get_weights();
     }
 
-    App app (
-        new Agent (true, weights)
-    );
+    if (datagen)
+        return generate_dataset(weights, datagen_settings) ? 0 : 1;
+
+    std::shared_ptr<RolloutEvaluator> rollout_evaluator;
+    if (rollouts > 0) {
+        RolloutSettings rollout_settings = RolloutEvaluator::DEFAULT_SETTINGS;
+        rollout_settings.rollouts = rollouts;
+        rollout_evaluator = std::make_shared<RolloutEvaluator>(weights, rollout_settings);
+    }
+
+    if (export_settings.directory != nullptr) {
+        Agent agent (true, weights);
+        agent.set_value_net(net);
+        agent.set_rollouts(rollout_evaluator);
+        auto seed = (uint32_t) std::chrono::system_clock::now().time_since_epoch().count();
+        return export_game(agent, seed, export_settings) ? 0 : 1;
+    }
+
+    if (grid)
+        return spectate(weights, grid_size, population_path, unthrottled);
+
+    auto* agent = new Agent (true, weights, true, max_depth);
+    agent->set_value_net(net);
+    agent->set_rollouts(rollout_evaluator);
+    agent->set_compute_budget(budget_us * 1000);
+    App app (agent, unthrottled, fall_rate);
+    if (export_settings.replay_directory != nullptr)
+        app.record_replays(export_settings.replay_directory, &weights);
 
     if (!app.init()) {
         std::cout << "ERR: Could not initialize" << std::endl;
@@ -1,9 +1,32 @@
-﻿#include <iostream>
+﻿#include <cstring>
+#include <iostream>
 
 #include "app/App.hpp"
+#include "app/ReplayApp.hpp"
 
 int main (int argc, char** argv) {
+    const char* record_directory = nullptr;
+    const char* replay_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            record_directory = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replay_path = argv[++i];
+    }
+
+    if (replay_path != nullptr) {
+        ReplayApp replay;
+        if (!replay.init(replay_path)) {
+            std::cout << "ERR: Could not initialize" << std::endl;
+            return 1;
+        }
+        replay.run();
+        return 0;
+    }
+
     App app;
+    if (record_directory != nullptr)
+        app.record_replays(record_directory, nullptr);
 
     if (!app.init()) {
         std::cout << "ERR: Could not initialize" << std::endl;
@@ -0,0 +1,64 @@
+#include "BufferedWriter.hpp"
+#include "trace.hpp"
+
+BufferedWriter::BufferedWriter (size_t buffer_size)
+    : m_buffer_size(buffer_size)
+    , m_open(false)
+    , m_failed(false)
+    , m_thread(1)
+{
+    m_buffer.reserve(m_buffer_size);
+}
+
+bool BufferedWriter::open (const std::string& path) {
+    close();
+    // Nothing's queued after close(), so the file is ours for now
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    m_failed = !m_file.is_open();
+    m_open = m_file.is_open();
+    return m_open;
+}
+
+void BufferedWriter::write (const void* data, size_t size) {
+    if (!m_open)
+        return;
+    auto bytes = (const uint8_t*) data;
+    m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+    if (m_buffer.size() >= m_buffer_size)
+        flush();
+}
+
+void BufferedWriter::flush () {
+    if (m_buffer.empty())
+        return;
+    m_thread.submit([this, chunk = std::move(m_buffer)] () {
+        TRACE_SCOPE("write", "io");
+        m_file.write((const char*) chunk.data(), (std::streamsize) chunk.size());
+        if (!m_file)
+            m_failed = true;
+    });
+    m_buffer = {};
+    m_buffer.reserve(m_buffer_size);
+}
+
+bool BufferedWriter::close () {
+    if (!m_open)
+        return !m_failed;
+    flush();
+    m_thread.submit([this] () {
+        m_file.close();
+        if (!m_file)
+            m_failed = true;
+    });
+    m_thread.wait();
+    m_open = false;
+    return !m_failed;
+}
+
+bool BufferedWriter::is_open () const {
+    return m_open;
+}
+
+BufferedWriter::~BufferedWriter () {
+    close();
+}
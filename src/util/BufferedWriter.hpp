@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+/*
+ * Writes a file through a memory buffer. Full buffers are handed to a
+ * background thread, so whoever calls write() never waits for the disk.
+ */
+class BufferedWriter {
+public:
+    /**
+     * @param buffer_size How many bytes to collect before writing them.
+     */
+    explicit BufferedWriter (size_t buffer_size = 64 * 1024);
+
+    /**
+     * Opens a file, replacing anything already there.
+     * Closes the file that was open before, if any.
+     * @param path Where to write.
+     * @return True if the file could be opened, false otherwise.
+     */
+    bool open (const std::string& path);
+
+    /**
+     * Adds bytes to the end of the file.
+     * @param data The bytes to write.
+     * @param size How many there are.
+     */
+    void write (const void* data, size_t size);
+
+    /**
+     * Writes everything still buffered and closes the file.
+     * Blocks until the background thread is done with it.
+     * @return True if every byte was written, false otherwise.
+     */
+    bool close ();
+
+    /**
+     * @return True if a file is open.
+     */
+    [[nodiscard]] bool is_open () const;
+
+    /**
+     * Destructor: closes the file.
+     */
+    ~BufferedWriter ();
+
+    BufferedWriter (const BufferedWriter&) = delete;
+    BufferedWriter& operator= (const BufferedWriter&) = delete;
+
+private:
+    /**
+     * Hands the buffer to the background thread.
+     */
+    void flush ();
+
+    size_t m_buffer_size;
+    std::vector<uint8_t> m_buffer;
+    bool m_open;
+
+    // Only touched by the background thread once opened
+    std::ofstream m_file;
+    std::atomic<bool> m_failed;
+
+    // Last, so it's destroyed (and finishes its writes) before the rest
+    ThreadPool m_thread;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+/**
+ * Keeps the last few values of something, like latencies, for quick stats
+ * over recent history.
+ * @tparam T What's being kept.
+ * @tparam CAPACITY How many of the newest values are kept.
+ */
+template <typename T, size_t CAPACITY>
+class RollingWindow {
+public:
+    /**
+     * Adds a value, dropping the oldest if the window is full.
+     * @param value The value to add.
+     */
+    void add (const T& value) {
+        m_values[m_next] = value;
+        m_next = (m_next + 1) % CAPACITY;
+        m_size = std::min(m_size + 1, CAPACITY);
+    }
+
+    /**
+     * @return How many values are in the window.
+     */
+    [[nodiscard]] size_t size () const {
+        return m_size;
+    }
+
+    /**
+     * @param n How far back to go, 0 for the newest.
+     * @return The nth newest value, must be less than size().
+     */
+    [[nodiscard]] const T& newest (size_t n = 0) const {
+        return m_values[(m_next + CAPACITY - 1 - n) % CAPACITY];
+    }
+
+    /**
+     * @param percent Between 0 and 100, like 99 for p99.
+     * @return The value at that percentile of the window, or T() if empty.
+     */
+    [[nodiscard]] T percentile (double percent) const {
+        if (m_size == 0)
+            return T();
+        T sorted[CAPACITY];
+        std::copy(m_values, m_values + m_size, sorted);
+        size_t rank = (size_t) (percent / 100.0 * (m_size - 1) + 0.5);
+        std::nth_element(sorted, sorted + rank, sorted + m_size);
+        return sorted[rank];
+    }
+
+    /* Empties the window */
+    void clear () {
+        m_next = 0;
+        m_size = 0;
+    }
+
+private:
+    T m_values[CAPACITY]{};
+    size_t m_next = 0;
+    size_t m_size = 0;
+};
@@ -0,0 +1,201 @@
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32) || defined(WIN32)
+
+#include <windows.h>
+
+#define OS_WINDOWS
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+#include "ShardReader.hpp"
+#include "bytes.hpp"
+#include "lz.hpp"
+
+/**
+ * Maps a whole file into memory, read only.
+ * @param path The file to map.
+ * @param size Set to the size of the file.
+ * @return The mapping, or nullptr if it couldn't be mapped.
+ */
+static const uint8_t* map_file (const std::string& path, size_t& size) {
+#ifdef OS_WINDOWS
+    HANDLE file = CreateFileA(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+    LARGE_INTEGER file_size;
+    const uint8_t* data = nullptr;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        size = (size_t) file_size.QuadPart;
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr) {
+            data = (const uint8_t*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            // The view keeps the mapping alive
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+    return data;
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return nullptr;
+    struct stat info = {};
+    void* data = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0) {
+        size = (size_t) info.st_size;
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    // The mapping keeps the file alive
+    ::close(file);
+    if (data == MAP_FAILED)
+        return nullptr;
+    // Blocks are read front to back
+    madvise(data, size, MADV_SEQUENTIAL);
+    return (const uint8_t*) data;
+#endif
+}
+
+ShardReader::ShardReader ()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_record_size(0)
+    , m_record_count(0)
+{}
+
+bool ShardReader::open (const std::string& path) {
+    close();
+    m_data = map_file(path, m_size);
+    if (m_data == nullptr) {
+        std::cout << "ERR: Could not map shard " << path << std::endl;
+        return false;
+    }
+
+    if (m_size < shard::HEADER_SIZE ||
+        std::memcmp(m_data, shard::MAGIC, sizeof(shard::MAGIC)) != 0) {
+        std::cout << "ERR: Not a shard" << std::endl;
+        close();
+        return false;
+    }
+    auto version = (uint16_t) get_le(m_data + 4, 2);
+    if (version != shard::FORMAT_VERSION) {
+        std::cout << "ERR: Shard format version " << version
+                  << " isn't supported" << std::endl;
+        close();
+        return false;
+    }
+    m_record_size = (uint16_t) get_le(m_data + 6, 2);
+
+    if (!read_index())
+        scan_blocks();
+    return true;
+}
+
+bool ShardReader::add_block (uint64_t offset) {
+    if (offset > m_size || m_size - offset < shard::BLOCK_HEADER_SIZE)
+        return false;
+    const uint8_t* header = m_data + offset;
+    BlockInfo block = {
+        .data = header + shard::BLOCK_HEADER_SIZE,
+        .stored_size = (uint32_t) get_le(header + 4, 4),
+        .records = (uint32_t) get_le(header, 4),
+        .compressed = header[8] != 0
+    };
+    if (m_size - offset - shard::BLOCK_HEADER_SIZE < block.stored_size)
+        return false;
+    if (!block.compressed && block.stored_size != (uint64_t) block.records * m_record_size)
+        return false;
+
+    m_blocks.push_back(block);
+    m_record_count += block.records;
+    return true;
+}
+
+bool ShardReader::read_index () {
+    if (m_size < shard::HEADER_SIZE + shard::INDEX_FOOTER_SIZE)
+        return false;
+    const uint8_t* footer = m_data + m_size - shard::INDEX_FOOTER_SIZE;
+    if (std::memcmp(footer + 12, shard::INDEX_MAGIC, sizeof(shard::INDEX_MAGIC)) != 0)
+        return false;
+    uint64_t record_count = get_le(footer, 8);
+    uint64_t block_count = get_le(footer + 8, 4);
+    if (block_count > (m_size - shard::HEADER_SIZE - shard::INDEX_FOOTER_SIZE) / 8)
+        return false;
+
+    const uint8_t* offsets = footer - block_count * 8;
+    for (uint64_t i = 0; i < block_count; i++) {
+        if (!add_block(get_le(offsets + i * 8, 8))) {
+            m_blocks.clear();
+            m_record_count = 0;
+            return false;
+        }
+    }
+    if (m_record_count != record_count) {
+        m_blocks.clear();
+        m_record_count = 0;
+        return false;
+    }
+    return true;
+}
+
+void ShardReader::scan_blocks () {
+    uint64_t offset = shard::HEADER_SIZE;
+    while (add_block(offset))
+        offset += shard::BLOCK_HEADER_SIZE + m_blocks.back().stored_size;
+}
+
+void ShardReader::close () {
+    if (m_data != nullptr) {
+#ifdef OS_WINDOWS
+        UnmapViewOfFile(m_data);
+#else
+        munmap((void*) m_data, m_size);
+#endif
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_record_size = 0;
+    m_record_count = 0;
+    m_blocks.clear();
+}
+
+uint16_t ShardReader::get_record_size () const {
+    return m_record_size;
+}
+
+size_t ShardReader::get_record_count () const {
+    return m_record_count;
+}
+
+size_t ShardReader::get_block_count () const {
+    return m_blocks.size();
+}
+
+const uint8_t* ShardReader::read_block (
+    size_t n, std::vector<uint8_t>& buffer, uint32_t& records
+) const {
+    const BlockInfo& block = m_blocks[n];
+    records = block.records;
+    if (!block.compressed)
+        return block.data;
+
+    buffer.resize((size_t) block.records * m_record_size);
+    if (!lz::decompress(block.data, block.stored_size, buffer.data(), buffer.size()))
+        return nullptr;
+    return buffer.data();
+}
+
+ShardReader::~ShardReader () {
+    close();
+}
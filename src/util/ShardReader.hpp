@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ShardWriter.hpp"
+
+/*
+ * Reads a shard written by ShardWriter by mapping it into memory.
+ * Blocks stored as they are are read straight from the mapping without
+ * copying, compressed ones are decompressed into a buffer the caller keeps,
+ * so a loop over the shard allocates nothing after its first block.
+ */
+class ShardReader {
+public:
+    ShardReader ();
+
+    /**
+     * Maps a shard and finds its blocks, from the index if it has one or by
+     * walking through them if it was cut short.
+     * Closes the shard that was open before, if any.
+     * @param path Where the shard is.
+     * @return True if the shard could be mapped and is one, false otherwise.
+     */
+    bool open (const std::string& path);
+
+    /**
+     * Unmaps the shard.
+     */
+    void close ();
+
+    /**
+     * @return How many bytes each record takes.
+     */
+    [[nodiscard]] uint16_t get_record_size () const;
+
+    /**
+     * @return How many records there are in all the blocks.
+     */
+    [[nodiscard]] size_t get_record_count () const;
+
+    /**
+     * @return How many blocks there are.
+     */
+    [[nodiscard]] size_t get_block_count () const;
+
+    /**
+     * Gets a block's records.
+     * @param n Which block to read.
+     * @param buffer Where compressed blocks are decompressed to.
+     * @param records Set to how many records there are.
+     * @return The first record, or nullptr if the block is corrupt.
+     */
+    const uint8_t* read_block (
+        size_t n, std::vector<uint8_t>& buffer, uint32_t& records
+    ) const;
+
+    /**
+     * Calls a function with every record, in order.
+     * @param visit Called with a pointer to each record. Records stay valid
+     * until the block after theirs is read.
+     * @return False if a block was corrupt, true otherwise.
+     */
+    template <typename Visit>
+    bool for_each_record (Visit visit) const {
+        std::vector<uint8_t> buffer;
+        for (size_t n = 0; n < m_blocks.size(); n++) {
+            uint32_t records;
+            const uint8_t* record = read_block(n, buffer, records);
+            if (record == nullptr)
+                return false;
+            for (uint32_t i = 0; i < records; i++, record += m_record_size)
+                visit(record);
+        }
+        return true;
+    }
+
+    /**
+     * Destructor: unmaps the shard.
+     */
+    ~ShardReader ();
+
+    ShardReader (const ShardReader&) = delete;
+    ShardReader& operator= (const ShardReader&) = delete;
+
+private:
+    struct BlockInfo {
+        const uint8_t* data;
+        uint32_t stored_size;
+        uint32_t records;
+        bool compressed;
+    };
+
+    /**
+     * Finds the blocks from the index at the end of the shard.
+     * @return False if there's no usable index.
+     */
+    bool read_index ();
+
+    /**
+     * Finds the blocks by walking from the first one, up to the first one
+     * that doesn't fit in the file.
+     */
+    void scan_blocks ();
+
+    /**
+     * Adds a block to the list.
+     * @param offset Where its header starts.
+     * @return False if the block doesn't fit in the file.
+     */
+    bool add_block (uint64_t offset);
+
+    const uint8_t* m_data;
+    size_t m_size;
+    uint16_t m_record_size;
+    size_t m_record_count;
+    std::vector<BlockInfo> m_blocks;
+};
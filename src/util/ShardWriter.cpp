@@ -0,0 +1,198 @@
+#include <iostream>
+
+#include "ShardWriter.hpp"
+#include "bytes.hpp"
+#include "lz.hpp"
+#include "trace.hpp"
+
+ShardWriter::ShardWriter (uint16_t record_size, uint32_t block_records, bool compress)
+    : m_record_size(record_size)
+    , m_block_records(block_records)
+    , m_compress(compress)
+    , m_open(false)
+    , m_records(0)
+    , m_dropped(0)
+    , m_blocks(BLOCK_COUNT)
+    , m_current(nullptr)
+    , m_signal(0)
+    , m_freed(0)
+    , m_closing(false)
+    , m_offset(0)
+    , m_failed(false)
+{
+    for (Block& block : m_blocks) {
+        block.data.reserve((size_t) record_size * block_records);
+        block.records = 0;
+    }
+}
+
+bool ShardWriter::open (const std::string& path) {
+    close();
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        std::cout << "ERR: Could not open shard " << path << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> header(shard::MAGIC, shard::MAGIC + sizeof(shard::MAGIC));
+    put_le(header, shard::FORMAT_VERSION, 2);
+    put_le(header, m_record_size, 2);
+    m_file.write((const char*) header.data(), (std::streamsize) header.size());
+    m_offset = header.size();
+    m_index.clear();
+    m_failed = !m_file;
+
+    // Every ring was emptied by close()
+    for (Block& block : m_blocks)
+        m_free.push(&block);
+    m_current = nullptr;
+    m_records = 0;
+    m_dropped = 0;
+    m_closing = false;
+    m_open = true;
+    m_thread = std::thread(&ShardWriter::work, this);
+    return true;
+}
+
+bool ShardWriter::write (const void* record) {
+    if (!m_open)
+        return false;
+    if (m_current == nullptr && !m_free.pop(m_current)) {
+        m_dropped++;
+        return false;
+    }
+    append(record);
+    return true;
+}
+
+bool ShardWriter::write_blocking (const void* record) {
+    if (!m_open)
+        return false;
+    if (m_current == nullptr && !m_free.pop(m_current)) {
+        TRACE_SCOPE("wait for block", "io");
+        while (true) {
+            // Read before trying again, so a block handed back in between
+            // still wakes us
+            uint32_t freed = m_freed.load(std::memory_order_acquire);
+            if (m_free.pop(m_current))
+                break;
+            m_freed.wait(freed, std::memory_order_acquire);
+        }
+    }
+    append(record);
+    return true;
+}
+
+void ShardWriter::append (const void* record) {
+    auto bytes = (const uint8_t*) record;
+    m_current->data.insert(m_current->data.end(), bytes, bytes + m_record_size);
+    m_current->records++;
+    m_records++;
+    if (m_current->records == m_block_records)
+        submit();
+}
+
+void ShardWriter::submit () {
+    // Can't fail, there are only BLOCK_COUNT blocks to go around
+    m_full.push(m_current);
+    m_current = nullptr;
+    m_signal.fetch_add(1, std::memory_order_release);
+    m_signal.notify_one();
+}
+
+void ShardWriter::work () {
+    TRACE_THREAD_NAME("shard writer");
+    while (true) {
+        uint32_t signal = m_signal.load(std::memory_order_acquire);
+        bool closing = m_closing.load(std::memory_order_acquire);
+
+        Block* block;
+        while (m_full.pop(block)) {
+            write_block(*block);
+            block->data.clear();
+            block->records = 0;
+            m_free.push(block);
+            m_freed.fetch_add(1, std::memory_order_release);
+            m_freed.notify_one();
+        }
+
+        // Anything submitted before closing has been written by now
+        if (closing)
+            return;
+        m_signal.wait(signal, std::memory_order_acquire);
+    }
+}
+
+void ShardWriter::write_block (const Block& block) {
+    TRACE_SCOPE("write block", "io");
+    const uint8_t* stored = block.data.data();
+    size_t stored_size = block.data.size();
+    bool compressed = false;
+    if (m_compress) {
+        m_compressed.clear();
+        lz::compress(block.data.data(), block.data.size(), m_compressed);
+        if (m_compressed.size() < block.data.size()) {
+            stored = m_compressed.data();
+            stored_size = m_compressed.size();
+            compressed = true;
+        }
+    }
+
+    std::vector<uint8_t> header;
+    put_le(header, block.records, 4);
+    put_le(header, stored_size, 4);
+    put_le(header, compressed, 1);
+    put_le(header, 0, 3);
+    m_file.write((const char*) header.data(), (std::streamsize) header.size());
+    m_file.write((const char*) stored, (std::streamsize) stored_size);
+    if (!m_file)
+        m_failed = true;
+
+    m_index.push_back(m_offset);
+    m_offset += header.size() + stored_size;
+}
+
+bool ShardWriter::close () {
+    if (!m_open)
+        return !m_failed;
+    if (m_current != nullptr && m_current->records > 0)
+        submit();
+
+    m_closing.store(true, std::memory_order_release);
+    m_signal.fetch_add(1, std::memory_order_release);
+    m_signal.notify_one();
+    m_thread.join();
+
+    // The background thread is gone, the file and index are ours again
+    Block* block;
+    while (m_free.pop(block)) {}
+    std::vector<uint8_t> footer;
+    for (uint64_t offset : m_index)
+        put_le(footer, offset, 8);
+    put_le(footer, m_records, 8);
+    put_le(footer, m_index.size(), 4);
+    footer.insert(footer.end(), shard::INDEX_MAGIC, shard::INDEX_MAGIC + sizeof(shard::INDEX_MAGIC));
+    m_file.write((const char*) footer.data(), (std::streamsize) footer.size());
+    m_file.close();
+    if (!m_file)
+        m_failed = true;
+
+    m_open = false;
+    return !m_failed && m_dropped == 0;
+}
+
+bool ShardWriter::is_open () const {
+    return m_open;
+}
+
+size_t ShardWriter::get_records () const {
+    return m_records;
+}
+
+size_t ShardWriter::get_dropped () const {
+    return m_dropped;
+}
+
+ShardWriter::~ShardWriter () {
+    close();
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SpscQueue.hpp"
+
+/*
+ * Shard files hold fixed-size records in blocks, each compressed on its own
+ * so a reader can start at any of them.
+ *
+ * File layout, little endian:
+ *   "TSHD", format version (u16), record size (u16),
+ *   then per block: record count (u32), stored size (u32),
+ *     compressed (u8), 3 bytes padding, the stored bytes,
+ *   then the index: offset of each block (u64), record count (u64),
+ *     block count (u32), "TIDX".
+ * Blocks that don't get smaller when compressed are stored as they are. A
+ * shard cut short, say by a crash, has no index but its whole blocks can
+ * still be read.
+ */
+namespace shard
+{
+    constexpr char MAGIC[4] = {'T', 'S', 'H', 'D'};
+    constexpr char INDEX_MAGIC[4] = {'T', 'I', 'D', 'X'};
+    constexpr uint16_t FORMAT_VERSION = 1;
+    constexpr size_t HEADER_SIZE = 8;
+    constexpr size_t BLOCK_HEADER_SIZE = 12;
+    constexpr size_t INDEX_FOOTER_SIZE = 16;
+}
+
+/*
+ * Writes records to a shard file without making the thread that writes them
+ * wait. Records are collected into blocks, and full blocks go through a ring
+ * to a background thread that compresses and writes them. Block buffers come
+ * back through a second ring, so nothing is allocated once it's running.
+ * If the background thread falls so far behind that every block is in
+ * flight, write() drops records and counts them instead of waiting for it.
+ * Producers that can afford to wait use write_blocking() instead.
+ */
+class ShardWriter {
+public:
+    // How many blocks there are to fill and write
+    static constexpr size_t BLOCK_COUNT = 16;
+
+    /**
+     * @param record_size How many bytes each record takes.
+     * @param block_records How many records go in a block.
+     * @param compress Whether to compress blocks, or store them all as they
+     * are so readers never have to copy them.
+     */
+    explicit ShardWriter (
+        uint16_t record_size, uint32_t block_records = 4096, bool compress = true
+    );
+
+    /**
+     * Opens a shard, replacing anything already there, and starts the
+     * background thread.
+     * Closes the shard that was open before, if any.
+     * @param path Where to write.
+     * @return True if the file could be opened, false otherwise.
+     */
+    bool open (const std::string& path);
+
+    /**
+     * Adds a record to the shard.
+     * @param record The record, record_size bytes.
+     * @return False if it was dropped because every block is still being
+     * written, true otherwise.
+     */
+    bool write (const void* record);
+
+    /**
+     * Adds a record to the shard, waiting for the background thread to hand
+     * a block back if every block is still being written.
+     * @param record The record, record_size bytes.
+     * @return False if no shard is open, true otherwise.
+     */
+    bool write_blocking (const void* record);
+
+    /**
+     * Writes the last block and the index and closes the shard.
+     * Blocks until the background thread is done.
+     * @return True if every record was written, false otherwise.
+     */
+    bool close ();
+
+    /**
+     * @return True if a shard is open.
+     */
+    [[nodiscard]] bool is_open () const;
+
+    /**
+     * @return How many records have been taken since the shard was opened.
+     */
+    [[nodiscard]] size_t get_records () const;
+
+    /**
+     * @return How many records have been dropped since the shard was opened.
+     */
+    [[nodiscard]] size_t get_dropped () const;
+
+    /**
+     * Destructor: closes the shard.
+     */
+    ~ShardWriter ();
+
+    ShardWriter (const ShardWriter&) = delete;
+    ShardWriter& operator= (const ShardWriter&) = delete;
+
+private:
+    struct Block {
+        std::vector<uint8_t> data;
+        uint32_t records;
+    };
+
+    /**
+     * Copies a record into the block being filled, which there must be.
+     * @param record The record, record_size bytes.
+     */
+    void append (const void* record);
+
+    /**
+     * Hands the block being filled to the background thread.
+     */
+    void submit ();
+
+    /**
+     * The background thread's loop.
+     * Writes blocks until the shard is closed and there are none left.
+     */
+    void work ();
+
+    /**
+     * Compresses and writes one block.
+     * BACKGROUND THREAD ONLY.
+     * @param block The block to write.
+     */
+    void write_block (const Block& block);
+
+    uint16_t m_record_size;
+    uint32_t m_block_records;
+    bool m_compress;
+    bool m_open;
+    size_t m_records;
+    size_t m_dropped;
+
+    std::vector<Block> m_blocks;
+    Block* m_current;
+    SpscQueue<Block*, BLOCK_COUNT> m_full;
+    SpscQueue<Block*, BLOCK_COUNT> m_free;
+    // Bumped whenever there's something new for the background thread
+    std::atomic<uint32_t> m_signal;
+    // Bumped whenever the background thread hands a block back
+    std::atomic<uint32_t> m_freed;
+    std::atomic<bool> m_closing;
+
+    // Only touched by the background thread while it runs
+    std::ofstream m_file;
+    uint64_t m_offset;
+    std::vector<uint64_t> m_index;
+    std::vector<uint8_t> m_compressed;
+    std::atomic<bool> m_failed;
+
+    std::thread m_thread;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * A fixed-size queue for one thread pushing and one thread popping,
+ * without locking.
+ * @tparam T What's in the queue.
+ * @tparam CAPACITY How many items fit, must be a power of two.
+ */
+template <typename T, size_t CAPACITY>
+class SpscQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+public:
+    /**
+     * PRODUCER ONLY.
+     * @param item What to add to the back of the queue.
+     * @return False if the queue is full and the item was not added.
+     */
+    bool push (const T& item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == CAPACITY)
+            return false;
+        m_items[head & (CAPACITY - 1)] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * CONSUMER ONLY.
+     * @param item Where to put the item from the front of the queue.
+     * @return False if the queue is empty.
+     */
+    bool pop (T& item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+            return false;
+        item = m_items[tail & (CAPACITY - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T m_items[CAPACITY]{};
+    // Kept on separate cache lines so the two threads don't fight over them
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+};
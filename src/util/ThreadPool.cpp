@@ -0,0 +1,67 @@
+#include <algorithm>
+
+#include "ThreadPool.hpp"
+#include "trace.hpp"
+
+ThreadPool::ThreadPool (size_t thread_count)
+    : m_running_tasks(0)
+    , m_stopping(false)
+{
+    if (thread_count == 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < thread_count; i++)
+        m_threads.emplace_back(&ThreadPool::work, this);
+}
+
+void ThreadPool::submit (std::function<void ()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_task_ready.notify_one();
+}
+
+void ThreadPool::wait () {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] () {
+        return m_tasks.empty() && m_running_tasks == 0;
+    });
+}
+
+size_t ThreadPool::get_thread_count () const {
+    return m_threads.size();
+}
+
+void ThreadPool::work () {
+    TRACE_THREAD_NAME("pool worker");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_task_ready.wait(lock, [this] () {
+            return m_stopping || !m_tasks.empty();
+        });
+        if (m_tasks.empty())
+            return; // Only when stopping
+
+        std::function<void ()> task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        m_running_tasks++;
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        m_running_tasks--;
+        if (m_tasks.empty() && m_running_tasks == 0)
+            m_idle.notify_all();
+    }
+}
+
+ThreadPool::~ThreadPool () {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_task_ready.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
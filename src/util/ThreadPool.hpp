@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * A fixed set of worker threads that run tasks in the order they're
+ * submitted.
+ */
+class ThreadPool {
+public:
+    /**
+     * Starts the worker threads.
+     * @param thread_count How many threads to start, 0 for one per core.
+     */
+    explicit ThreadPool (size_t thread_count = 0);
+
+    /**
+     * Queues a task to run on one of the workers.
+     * @param task What to run.
+     */
+    void submit (std::function<void ()> task);
+
+    /**
+     * Blocks until every submitted task has finished.
+     */
+    void wait ();
+
+    /**
+     * @return How many worker threads there are.
+     */
+    [[nodiscard]] size_t get_thread_count () const;
+
+    /**
+     * Destructor: finishes every queued task, then stops the workers.
+     */
+    ~ThreadPool ();
+
+    ThreadPool (const ThreadPool&) = delete;
+    ThreadPool& operator= (const ThreadPool&) = delete;
+
+private:
+    /**
+     * A worker thread's loop.
+     * Runs tasks until the pool is destroyed and there are none left.
+     */
+    void work ();
+
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void ()>> m_tasks;
+    // Tasks that have been taken off the queue but haven't finished
+    size_t m_running_tasks;
+    bool m_stopping;
+
+    std::mutex m_mutex;
+    std::condition_variable m_task_ready;
+    std::condition_variable m_idle;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Passes the newest copy of a value from one thread to another without
+ * locking. The writer always has a buffer to fill and the reader always has
+ * a complete one to read, the third sits in between holding the newest.
+ * @tparam T What's being passed.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    /**
+     * WRITER ONLY.
+     * @return The buffer to fill in before calling publish().
+     */
+    T& write_buffer () {
+        return m_buffers[m_write];
+    }
+
+    /**
+     * WRITER ONLY.
+     * Makes the write buffer the newest value. Any value published earlier
+     * that the reader hasn't picked up yet is overwritten.
+     */
+    void publish () {
+        uint8_t previous = m_middle.exchange(
+            m_write | FRESH, std::memory_order_acq_rel
+        );
+        m_write = previous & INDEX_MASK;
+    }
+
+    /**
+     * READER ONLY.
+     * Switches the read buffer to the newest published value, if any.
+     * @return True if there was a new value.
+     */
+    bool update () {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0)
+            return false;
+        uint8_t previous = m_middle.exchange(m_read, std::memory_order_acq_rel);
+        m_read = previous & INDEX_MASK;
+        return true;
+    }
+
+    /**
+     * READER ONLY.
+     * @return The value picked up by the last update().
+     */
+    const T& read_buffer () const {
+        return m_buffers[m_read];
+    }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0b011;
+    static constexpr uint8_t FRESH = 0b100;
+
+    T m_buffers[3]{};
+    // Index of the middle buffer, and whether it's newer than the read buffer
+    std::atomic<uint8_t> m_middle{1};
+    uint8_t m_write = 0;
+    uint8_t m_read = 2;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Numbers in files are stored lowest byte first, whatever the machine's own
+ * byte order is.
+ */
+
+/**
+ * Appends a number to a buffer, lowest byte first.
+ * @param out The buffer.
+ * @param value The number.
+ * @param size How many bytes to write.
+ */
+inline void put_le (std::vector<uint8_t>& out, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; i++)
+        out.push_back((uint8_t) (value >> (8 * i)));
+}
+
+/**
+ * Reads a number stored lowest byte first.
+ * @param data Where the number starts.
+ * @param size How many bytes it takes.
+ * @return The number.
+ */
+inline uint64_t get_le (const uint8_t* data, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++)
+        value |= (uint64_t) data[i] << (8 * i);
+    return value;
+}
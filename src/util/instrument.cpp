@@ -0,0 +1,208 @@
+#include "instrument.hpp"
+
+#ifdef TETRIS_INSTRUMENT
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+namespace instrument
+{
+    static const char* PROBE_NAMES[(size_t) Probe::COUNT] =
+    {
+        "Board::update",
+        "Board::valid_move",
+        "Board::get_ghost",
+        "Board::clear_lines",
+        "generate_moves",
+        "analyze_board",
+        "best_move",
+        "Agent::gen_input",
+        "plan_path",
+        "GameWindow::draw",
+    };
+
+    static const char* COUNTER_NAMES[(size_t) Counter::COUNT] =
+    {
+        "candidate moves",
+        "lines cleared",
+    };
+
+    uint16_t Histogram::bucket_index (uint64_t value) {
+        if (value < SUB_BUCKETS)
+            return value;
+        // Position of the highest set bit decides the power of two,
+        // the next few bits decide the bucket inside it
+        uint8_t magnitude = 0;
+        for (uint64_t rest = value >> 1; rest > 0; rest >>= 1)
+            magnitude++;
+        uint8_t shift = magnitude - SUB_BUCKET_BITS;
+        uint16_t sub_bucket = (value >> shift) & (SUB_BUCKETS - 1);
+        return (shift + 1) * SUB_BUCKETS + sub_bucket;
+    }
+
+    uint64_t Histogram::bucket_value (uint16_t idx) {
+        if (idx < SUB_BUCKETS)
+            return idx;
+        uint8_t shift = idx / SUB_BUCKETS - 1;
+        uint64_t sub_bucket = idx % SUB_BUCKETS;
+        uint64_t lowest = (SUB_BUCKETS + sub_bucket) << shift;
+        return lowest + ((uint64_t) 1 << shift) - 1;
+    }
+
+    void Histogram::record (uint64_t value) {
+        m_buckets[bucket_index(value)]++;
+        m_count++;
+        m_total += value;
+        if (value > m_max)
+            m_max = value;
+    }
+
+    void Histogram::merge (const Histogram& other) {
+        for (uint16_t i = 0; i < BUCKET_COUNT; i++)
+            m_buckets[i] += other.m_buckets[i];
+        m_count += other.m_count;
+        m_total += other.m_total;
+        if (other.m_max > m_max)
+            m_max = other.m_max;
+    }
+
+    uint64_t Histogram::percentile (double percent) const {
+        if (m_count == 0)
+            return 0;
+        auto target = (uint64_t) (percent / 100.0 * (double) m_count);
+        if (target == 0)
+            target = 1;
+        uint64_t seen = 0;
+        for (uint16_t i = 0; i < BUCKET_COUNT; i++) {
+            seen += m_buckets[i];
+            if (seen >= target)
+                return std::min(bucket_value(i), m_max);
+        }
+        return m_max;
+    }
+
+    uint64_t Histogram::count () const {
+        return m_count;
+    }
+
+    uint64_t Histogram::total () const {
+        return m_total;
+    }
+
+    uint64_t Histogram::max () const {
+        return m_max;
+    }
+
+    /* Everything one thread has recorded */
+    struct ThreadData {
+        Histogram probes[(size_t) Probe::COUNT];
+        uint64_t counters[(size_t) Counter::COUNT]{};
+
+        void merge (const ThreadData& other) {
+            for (size_t i = 0; i < (size_t) Probe::COUNT; i++)
+                probes[i].merge(other.probes[i]);
+            for (size_t i = 0; i < (size_t) Counter::COUNT; i++)
+                counters[i] += other.counters[i];
+        }
+    };
+
+    /* The merged data of every thread that has exited */
+    class Registry {
+    public:
+        void merge (const ThreadData& data) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_totals.merge(data);
+        }
+
+        ThreadData totals () {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_totals;
+        }
+
+        // The main thread's data is merged before this runs
+        ~Registry () {
+            const char* path = std::getenv("TETRIS_INSTRUMENT_OUT");
+            if (path != nullptr) {
+                std::ofstream file(path);
+                print(file, m_totals);
+            } else {
+                print(std::cerr, m_totals);
+            }
+        }
+
+        static void print (std::ostream& out, const ThreadData& data) {
+            out << std::left << std::setw(20) << "probe"
+                << std::right << std::setw(12) << "calls"
+                << std::setw(12) << "mean ns"
+                << std::setw(12) << "p50 ns"
+                << std::setw(12) << "p99 ns"
+                << std::setw(12) << "p999 ns"
+                << std::setw(12) << "max ns" << "\n";
+            for (size_t i = 0; i < (size_t) Probe::COUNT; i++) {
+                const Histogram& histogram = data.probes[i];
+                if (histogram.count() == 0)
+                    continue;
+                out << std::left << std::setw(20) << PROBE_NAMES[i]
+                    << std::right << std::setw(12) << histogram.count()
+                    << std::setw(12) << histogram.total() / histogram.count()
+                    << std::setw(12) << histogram.percentile(50.0)
+                    << std::setw(12) << histogram.percentile(99.0)
+                    << std::setw(12) << histogram.percentile(99.9)
+                    << std::setw(12) << histogram.max() << "\n";
+            }
+            for (size_t i = 0; i < (size_t) Counter::COUNT; i++) {
+                out << std::left << std::setw(20) << COUNTER_NAMES[i]
+                    << std::right << std::setw(12) << data.counters[i] << "\n";
+            }
+            out.flush();
+        }
+
+    private:
+        std::mutex m_mutex;
+        ThreadData m_totals;
+    };
+
+    static Registry& registry () {
+        static Registry registry;
+        return registry;
+    }
+
+    /* Merges a thread's data into the registry when the thread exits */
+    struct ThreadRecorder {
+        ThreadData data;
+        Registry& owner;
+
+        ThreadRecorder ()
+            : owner(registry())
+        {}
+
+        ~ThreadRecorder () {
+            owner.merge(data);
+        }
+    };
+
+    static ThreadData& thread_data () {
+        thread_local ThreadRecorder recorder;
+        return recorder.data;
+    }
+
+    void record (Probe probe, uint64_t nanoseconds) {
+        thread_data().probes[(size_t) probe].record(nanoseconds);
+    }
+
+    void count (Counter counter, uint64_t amount) {
+        thread_data().counters[(size_t) counter] += amount;
+    }
+
+    void dump (std::ostream& out) {
+        ThreadData data = registry().totals();
+        data.merge(thread_data());
+        Registry::print(out, data);
+    }
+}
+
+#endif
@@ -0,0 +1,148 @@
+#pragma once
+
+/*
+ * Hot path instrumentation: scoped timers and counters.
+ * Only compiled in when CMake is configured with -DTETRIS_INSTRUMENT=ON,
+ * otherwise the macros expand to nothing.
+ *
+ * Every thread records into its own histograms, which are merged when the
+ * thread exits. The totals are printed to stderr when the program exits,
+ * or to the file named by the TETRIS_INSTRUMENT_OUT environment variable.
+ */
+
+#ifdef TETRIS_INSTRUMENT
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace instrument
+{
+    /* Everything that gets timed */
+    enum class Probe : uint8_t {
+        BOARD_UPDATE,
+        VALID_MOVE,
+        GET_GHOST,
+        CLEAR_LINES,
+        GENERATE_MOVES,
+        ANALYZE_BOARD,
+        BEST_MOVE,
+        AGENT_GEN_INPUT,
+        PLAN_PATH,
+        WINDOW_DRAW,
+        COUNT
+    };
+
+    /* Everything that gets counted */
+    enum class Counter : uint8_t {
+        CANDIDATE_MOVES,
+        LINES_CLEARED,
+        COUNT
+    };
+
+    /**
+     * A latency histogram in the style of HdrHistogram.
+     * Each power of two is split into 16 buckets, so any value is
+     * reported within about 6% of what was recorded.
+     */
+    class Histogram {
+    public:
+        static constexpr uint8_t SUB_BUCKET_BITS = 4;
+        static constexpr uint16_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+        static constexpr uint16_t BUCKET_COUNT =
+            (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+        /**
+         * @param value The value to record, in nanoseconds.
+         */
+        void record (uint64_t value);
+
+        /**
+         * Adds all of another histogram's values to this one.
+         */
+        void merge (const Histogram& other);
+
+        /**
+         * @param percent Which percentile to get (0-100).
+         * @return The highest value in the bucket the percentile falls in.
+         */
+        [[nodiscard]] uint64_t percentile (double percent) const;
+
+        [[nodiscard]] uint64_t count () const;
+        [[nodiscard]] uint64_t total () const;
+        [[nodiscard]] uint64_t max () const;
+
+    private:
+        static uint16_t bucket_index (uint64_t value);
+        static uint64_t bucket_value (uint16_t idx);
+
+        uint64_t m_buckets[BUCKET_COUNT]{};
+        uint64_t m_count = 0;
+        uint64_t m_total = 0;
+        uint64_t m_max = 0;
+    };
+
+    /**
+     * Records how long something took on the calling thread.
+     * @param probe What was timed.
+     * @param nanoseconds How long it took.
+     */
+    void record (Probe probe, uint64_t nanoseconds);
+
+    /**
+     * Adds to a counter on the calling thread.
+     * @param counter Which counter.
+     * @param amount How much to add.
+     */
+    void count (Counter counter, uint64_t amount);
+
+    /**
+     * Prints call counts, p50/p99/p999 latencies and counters for every
+     * thread that has exited so far and the calling thread.
+     * @param out Where to print.
+     */
+    void dump (std::ostream& out);
+
+    /* Times its own lifetime */
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer (Probe probe)
+            : m_probe(probe)
+            , m_start(std::chrono::steady_clock::now())
+        {}
+
+        ~ScopedTimer () {
+            auto elapsed = std::chrono::steady_clock::now() - m_start;
+            record(
+                m_probe,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                    .count()
+            );
+        }
+
+        ScopedTimer (const ScopedTimer&) = delete;
+        ScopedTimer& operator= (const ScopedTimer&) = delete;
+
+    private:
+        Probe m_probe;
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
+
+#define INSTRUMENT_CONCAT_INNER(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_INNER(a, b)
+
+// Time the rest of the enclosing scope
+#define INSTRUMENT_SCOPE(probe) \
+    instrument::ScopedTimer INSTRUMENT_CONCAT(instrument_timer_, __LINE__) \
+        (instrument::Probe::probe)
+
+#define INSTRUMENT_COUNT(counter, amount) \
+    instrument::count(instrument::Counter::counter, (amount))
+
+#else
+
+#define INSTRUMENT_SCOPE(probe) ((void) 0)
+#define INSTRUMENT_COUNT(counter, amount) ((void) 0)
+
+#endif
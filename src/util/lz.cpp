@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cstring>
+
+#include "lz.hpp"
+
+namespace
+{
+    constexpr size_t MIN_MATCH = 4;
+    constexpr size_t MAX_OFFSET = 65535;
+    // LZ4 decoders count on blocks ending in literals: the last match starts
+    // at least 12 bytes before the end and stops at least 5 before it
+    constexpr size_t MATCH_LIMIT = 12;
+    constexpr size_t LAST_LITERALS = 5;
+
+    constexpr uint32_t HASH_BITS = 12;
+    constexpr uint32_t HASH_SIZE = 1 << HASH_BITS;
+
+    uint32_t read_u32 (const uint8_t* data) {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash (const uint8_t* data) {
+        return (read_u32(data) * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    /* The part of a length that doesn't fit in the token, 255 at a time */
+    void write_length (std::vector<uint8_t>& out, size_t length) {
+        for (length -= 15; length >= 255; length -= 255)
+            out.push_back(255);
+        out.push_back((uint8_t) length);
+    }
+
+    bool read_length (const uint8_t*& data, const uint8_t* end, size_t& length) {
+        uint8_t byte;
+        do {
+            if (data == end)
+                return false;
+            byte = *data++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    void write_sequence (
+        std::vector<uint8_t>& out, const uint8_t* literals, size_t literal_count,
+        size_t offset, size_t match_length
+    ) {
+        size_t match_code = match_length >= MIN_MATCH ? match_length - MIN_MATCH : 0;
+        out.push_back(
+            (uint8_t) (std::min<size_t>(literal_count, 15) << 4 | std::min<size_t>(match_code, 15))
+        );
+        if (literal_count >= 15)
+            write_length(out, literal_count);
+        out.insert(out.end(), literals, literals + literal_count);
+        // The last sequence stops after its literals
+        if (match_length == 0)
+            return;
+        out.push_back((uint8_t) offset);
+        out.push_back((uint8_t) (offset >> 8));
+        if (match_code >= 15)
+            write_length(out, match_code);
+    }
+}
+
+namespace lz
+{
+    void compress (const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+        // The last position each hash was seen at, plus one so 0 means never
+        uint32_t head[HASH_SIZE] = {};
+        size_t literal_start = 0;
+        size_t pos = 0;
+        while (pos + MATCH_LIMIT <= size) {
+            uint32_t h = hash(data + pos);
+            size_t candidate = head[h];
+            head[h] = (uint32_t) pos + 1;
+            if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET ||
+                read_u32(data + candidate - 1) != read_u32(data + pos)) {
+                pos++;
+                continue;
+            }
+
+            candidate--;
+            size_t length = MIN_MATCH;
+            while (pos + length < size - LAST_LITERALS &&
+                   data[candidate + length] == data[pos + length])
+                length++;
+            write_sequence(
+                out, data + literal_start, pos - literal_start, pos - candidate, length
+            );
+            pos += length;
+            literal_start = pos;
+        }
+        write_sequence(out, data + literal_start, size - literal_start, 0, 0);
+    }
+
+    bool decompress (
+        const uint8_t* data, size_t size, uint8_t* out, size_t out_size
+    ) {
+        const uint8_t* end = data + size;
+        size_t written = 0;
+        while (data < end) {
+            uint8_t token = *data++;
+            size_t literal_count = token >> 4;
+            if (literal_count == 15 && !read_length(data, end, literal_count))
+                return false;
+            if (literal_count > (size_t) (end - data) || literal_count > out_size - written)
+                return false;
+            // out can be null when there's nothing to write
+            if (literal_count > 0)
+                std::memcpy(out + written, data, literal_count);
+            data += literal_count;
+            written += literal_count;
+
+            if (data == end)
+                break;
+            if (end - data < 2)
+                return false;
+            size_t offset = data[0] | data[1] << 8;
+            data += 2;
+            size_t length = token & 15;
+            if (length == 15 && !read_length(data, end, length))
+                return false;
+            length += MIN_MATCH;
+            if (offset == 0 || offset > written || length > out_size - written)
+                return false;
+            // Byte by byte, a match can overlap what it's copying
+            for (size_t i = 0; i < length; i++, written++)
+                out[written] = out[written - offset];
+        }
+        return written == out_size;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * A small LZ77 block compressor in the LZ4 block format, for data that has
+ * to be compressed as fast as it's made.
+ * Every sequence is a token, its literals, then a 2 byte offset back into
+ * what's been decompressed and the match length. The token holds both
+ * lengths in 4 bits each, longer ones carry on in extra bytes. The last
+ * sequence only has literals, and the end of every block follows LZ4's
+ * rules for it (no match in the last 12 bytes, the last 5 are literals), so
+ * any LZ4 decoder can read the blocks.
+ */
+namespace lz
+{
+    /**
+     * @param data The bytes to compress.
+     * @param size How many bytes there are.
+     * @param out The compressed bytes are added to the end.
+     */
+    void compress (const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+    /**
+     * @param data The compressed bytes.
+     * @param size How many compressed bytes there are.
+     * @param out Where to decompress to.
+     * @param out_size How many bytes the data decompresses to.
+     * @return True if the data decompressed to exactly out_size bytes,
+     * false if it's corrupt.
+     */
+    bool decompress (
+        const uint8_t* data, size_t size, uint8_t* out, size_t out_size
+    );
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * SplitMix64, so neighbouring values like counters and indices turn into
+ * unrelated seeds.
+ * @param value What to mix.
+ * @return The mixed value.
+ */
+inline uint64_t mix (uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
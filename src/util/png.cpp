@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <fstream>
+
+#include "png.hpp"
+
+namespace
+{
+    constexpr uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    // Deflate limits
+    constexpr size_t MIN_MATCH = 3;
+    constexpr size_t MAX_MATCH = 258;
+    constexpr size_t WINDOW_SIZE = 32768;
+
+    constexpr uint32_t HASH_BITS = 15;
+    constexpr uint32_t HASH_SIZE = 1 << HASH_BITS;
+
+    // RFC 1951 3.2.5, lengths 3-258 as codes 257-285
+    constexpr uint16_t LENGTH_BASE[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    };
+    constexpr uint8_t LENGTH_EXTRA[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    constexpr uint16_t DISTANCE_BASE[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+        8193, 12289, 16385, 24577
+    };
+    constexpr uint8_t DISTANCE_EXTRA[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+
+    /* Writes a deflate stream, which packs bits starting at the lowest */
+    class BitWriter {
+    public:
+        explicit BitWriter (std::vector<uint8_t>& out) : m_out(out) {}
+
+        /* Values like extra bits go in lowest bit first */
+        void write_bits (uint32_t value, uint8_t count) {
+            m_buffer |= (uint64_t) value << m_count;
+            m_count += count;
+            while (m_count >= 8) {
+                m_out.push_back((uint8_t) m_buffer);
+                m_buffer >>= 8;
+                m_count -= 8;
+            }
+        }
+
+        /* Huffman codes go in highest bit first */
+        void write_code (uint32_t code, uint8_t length) {
+            uint32_t reversed = 0;
+            for (uint8_t i = 0; i < length; i++)
+                reversed |= ((code >> i) & 1) << (length - 1 - i);
+            write_bits(reversed, length);
+        }
+
+        void flush () {
+            if (m_count > 0)
+                m_out.push_back((uint8_t) m_buffer);
+            m_buffer = 0;
+            m_count = 0;
+        }
+
+    private:
+        std::vector<uint8_t>& m_out;
+        uint64_t m_buffer = 0;
+        uint8_t m_count = 0;
+    };
+
+    /* A literal byte or end of block, with the fixed Huffman codes */
+    void write_literal (BitWriter& bits, uint16_t symbol) {
+        if (symbol < 144)
+            bits.write_code(0x30 + symbol, 8);
+        else if (symbol < 256)
+            bits.write_code(0x190 + symbol - 144, 9);
+        else if (symbol < 280)
+            bits.write_code(symbol - 256, 7);
+        else
+            bits.write_code(0xC0 + symbol - 280, 8);
+    }
+
+    void write_match (BitWriter& bits, size_t length, size_t distance) {
+        uint8_t code = 0;
+        while (code < 28 && LENGTH_BASE[code + 1] <= length)
+            code++;
+        write_literal(bits, 257 + code);
+        bits.write_bits(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+        code = 0;
+        while (code < 29 && DISTANCE_BASE[code + 1] <= distance)
+            code++;
+        bits.write_code(code, 5);
+        bits.write_bits(distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+    }
+
+    uint32_t hash (const uint8_t* data) {
+        uint32_t value = data[0] | (data[1] << 8) | (data[2] << 16);
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    /* Deflates data as a single block with the fixed Huffman codes */
+    void deflate (const std::vector<uint8_t>& data, std::vector<uint8_t>& out) {
+        BitWriter bits(out);
+        bits.write_bits(1, 1); // Last block
+        bits.write_bits(1, 2); // Fixed Huffman codes
+
+        // The last position each hash was seen at, plus one so 0 means never
+        std::vector<uint32_t> head(HASH_SIZE, 0);
+        size_t pos = 0;
+        while (pos < data.size()) {
+            size_t best_length = 0, best_distance = 0;
+            if (pos + MIN_MATCH <= data.size()) {
+                uint32_t h = hash(&data[pos]);
+                size_t candidate = head[h];
+                head[h] = (uint32_t) pos + 1;
+                if (candidate > 0 && pos - (candidate - 1) <= WINDOW_SIZE) {
+                    candidate--;
+                    size_t limit = std::min(MAX_MATCH, data.size() - pos);
+                    size_t length = 0;
+                    while (length < limit && data[candidate + length] == data[pos + length])
+                        length++;
+                    if (length >= MIN_MATCH) {
+                        best_length = length;
+                        best_distance = pos - candidate;
+                    }
+                }
+            }
+
+            if (best_length == 0) {
+                write_literal(bits, data[pos]);
+                pos++;
+                continue;
+            }
+
+            write_match(bits, best_length, best_distance);
+            // Remember the positions inside the match too, runs of the
+            // same color keep matching against themselves that way
+            size_t end = pos + best_length;
+            for (pos++; pos < end; pos++) {
+                if (pos + MIN_MATCH <= data.size())
+                    head[hash(&data[pos])] = (uint32_t) pos + 1;
+            }
+        }
+
+        write_literal(bits, 256); // End of block
+        bits.flush();
+    }
+
+    uint32_t adler32 (const std::vector<uint8_t>& data) {
+        // Largest number of bytes before the sums can overflow
+        constexpr size_t CHUNK = 5552;
+        uint32_t a = 1, b = 0;
+        for (size_t start = 0; start < data.size(); start += CHUNK) {
+            size_t end = std::min(start + CHUNK, data.size());
+            for (size_t i = start; i < end; i++) {
+                a += data[i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    void write_u32 (std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back(value >> 24);
+        out.push_back(value >> 16);
+        out.push_back(value >> 8);
+        out.push_back(value);
+    }
+
+    void write_chunk (
+        std::vector<uint8_t>& out, const char* type,
+        const std::vector<uint8_t>& data
+    ) {
+        write_u32(out, (uint32_t) data.size());
+        size_t type_start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        write_u32(out, png::crc32(&out[type_start], out.size() - type_start));
+    }
+}
+
+namespace png
+{
+    uint32_t crc32 (const uint8_t* data, size_t size, uint32_t crc) {
+        static const auto TABLE = [] () {
+            struct { uint32_t entries[256]; } table = {};
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table.entries[n] = c;
+            }
+            return table;
+        }();
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+            crc = TABLE.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    std::vector<uint8_t> encode_rgba (
+        const uint8_t* rgba, uint32_t width, uint32_t height
+    ) {
+        // Each row starts with its filter type, always 0 (none)
+        const size_t stride = (size_t) width * 4;
+        std::vector<uint8_t> raw;
+        raw.reserve((stride + 1) * height);
+        for (uint32_t y = 0; y < height; y++) {
+            raw.push_back(0);
+            raw.insert(raw.end(), rgba + y * stride, rgba + (y + 1) * stride);
+        }
+
+        std::vector<uint8_t> header;
+        write_u32(header, width);
+        write_u32(header, height);
+        header.push_back(8); // Bits per channel
+        header.push_back(6); // RGBA
+        header.push_back(0); // Deflate
+        header.push_back(0); // Adaptive filtering
+        header.push_back(0); // Not interlaced
+
+        // zlib stream: header, deflate data, checksum of the raw data
+        std::vector<uint8_t> image_data = {0x78, 0x01};
+        deflate(raw, image_data);
+        write_u32(image_data, adler32(raw));
+
+        std::vector<uint8_t> file(SIGNATURE, SIGNATURE + sizeof(SIGNATURE));
+        write_chunk(file, "IHDR", header);
+        write_chunk(file, "IDAT", image_data);
+        write_chunk(file, "IEND", {});
+        return file;
+    }
+
+    bool write_rgba (
+        const std::string& path, const uint8_t* rgba,
+        uint32_t width, uint32_t height
+    ) {
+        std::vector<uint8_t> file = encode_rgba(rgba, width, height);
+        std::ofstream out(path, std::ios::binary);
+        out.write((const char*) file.data(), (std::streamsize) file.size());
+        return (bool) out.flush();
+    }
+}
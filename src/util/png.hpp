@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * A small PNG encoder for 8-bit RGBA images, so frames can be saved without
+ * pulling in zlib or libpng.
+ * Image data is deflated with the fixed Huffman codes and a greedy LZ77
+ * matcher, which is enough to shrink the large flat areas of a game frame a
+ * lot, but won't get as small as a real compressor.
+ */
+namespace png
+{
+    /**
+     * @param data The bytes to checksum.
+     * @param size How many bytes there are.
+     * @param crc The checksum of the bytes before these, to continue from.
+     * @return The CRC-32 used by PNG chunks (and zip, gzip, ...).
+     */
+    uint32_t crc32 (const uint8_t* data, size_t size, uint32_t crc = 0);
+
+    /**
+     * Encodes an image as a PNG file.
+     * @param rgba The pixels, 4 bytes each, row by row with no padding.
+     * @param width The width of the image in pixels.
+     * @param height The height of the image in pixels.
+     * @return The contents of the file.
+     */
+    std::vector<uint8_t> encode_rgba (
+        const uint8_t* rgba, uint32_t width, uint32_t height
+    );
+
+    /**
+     * Encodes an image as a PNG file and writes it.
+     * @param path Where to write the file.
+     * @param rgba The pixels, 4 bytes each, row by row with no padding.
+     * @param width The width of the image in pixels.
+     * @param height The height of the image in pixels.
+     * @return True if the whole file was written, false otherwise.
+     */
+    bool write_rgba (
+        const std::string& path, const uint8_t* rgba,
+        uint32_t width, uint32_t height
+    );
+}
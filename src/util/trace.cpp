@@ -0,0 +1,179 @@
+#include "trace.hpp"
+
+#ifdef TETRIS_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace trace
+{
+    // Events per thread that can wait to be written, must be a power of two
+    constexpr uint32_t BUFFER_SIZE = 1 << 14;
+    constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(20);
+
+    /* A complete ('X') event, a whole span in one */
+    struct Event {
+        const char* name;
+        const char* category;
+        uint64_t start_ns;
+        uint64_t end_ns;
+    };
+
+    /*
+     * Single producer, single consumer ring buffer.
+     * The owning thread pushes, the flush thread pops.
+     */
+    struct ThreadBuffer {
+        Event events[BUFFER_SIZE];
+        std::atomic<uint64_t> head{0}; // Next slot to write, only the owner changes it
+        std::atomic<uint64_t> tail{0}; // Next slot to read, only the flusher changes it
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<const char*> name{nullptr};
+        uint32_t id = 0;
+        bool named = false; // Whether the name has been written, flusher only
+
+        void push (const Event& event) {
+            uint64_t current_head = head.load(std::memory_order_relaxed);
+            if (current_head - tail.load(std::memory_order_acquire) >= BUFFER_SIZE) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            events[current_head & (BUFFER_SIZE - 1)] = event;
+            head.store(current_head + 1, std::memory_order_release);
+        }
+    };
+
+    /* Owns every thread's buffer and the thread writing them to disk */
+    class Tracer {
+    public:
+        Tracer ()
+            : m_start(std::chrono::steady_clock::now())
+            , m_stop(false)
+        {
+            const char* path = std::getenv("TETRIS_TRACE_OUT");
+            m_file.open(path != nullptr ? path : "trace.json");
+            m_file << "{\"traceEvents\":[\n";
+            m_file << "{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\","
+                      "\"args\":{\"name\":\"TetrisAI\"}}";
+            m_flusher = std::thread(&Tracer::flush_loop, this);
+        }
+
+        // Runs after every thread_local of the main thread is gone
+        ~Tracer () {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_one();
+            m_flusher.join();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            flush();
+            uint64_t dropped = 0;
+            for (auto& buffer : m_buffers)
+                dropped += buffer->dropped.load();
+            m_file << "\n],\"otherData\":{\"dropped_events\":" << dropped << "}}\n";
+        }
+
+        ThreadBuffer* register_thread () {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_buffers.push_back(std::make_unique<ThreadBuffer>());
+            m_buffers.back()->id = m_buffers.size();
+            return m_buffers.back().get();
+        }
+
+        uint64_t now_ns () const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - m_start
+            ).count();
+        }
+
+    private:
+        void flush_loop () {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!m_stop) {
+                m_wake.wait_for(lock, FLUSH_INTERVAL);
+                flush();
+            }
+        }
+
+        // Call with m_mutex held
+        void flush () {
+            for (auto& buffer : m_buffers) {
+                const char* name = buffer->name.load(std::memory_order_acquire);
+                if (name != nullptr && !buffer->named) {
+                    m_file << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+                           << ",\"name\":\"thread_name\",\"args\":{\"name\":\""
+                           << name << "\"}}";
+                    buffer->named = true;
+                }
+
+                uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+                uint64_t head = buffer->head.load(std::memory_order_acquire);
+                for (; tail != head; tail++) {
+                    const Event& event = buffer->events[tail & (BUFFER_SIZE - 1)];
+                    // Rounding both ends the same way keeps spans inside
+                    // their parents
+                    uint64_t start = event.start_ns / 100, end = event.end_ns / 100;
+                    m_file << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                           << ",\"ts\":";
+                    write_us(start);
+                    m_file << ",\"dur\":";
+                    write_us(end - start);
+                    m_file << ",\"name\":\"" << event.name
+                           << "\",\"cat\":\"" << event.category << "\"}";
+                }
+                buffer->tail.store(tail, std::memory_order_release);
+            }
+            m_file.flush();
+        }
+
+        // Chrome wants microseconds
+        void write_us (uint64_t tenths) {
+            m_file << tenths / 10 << '.' << (char) ('0' + tenths % 10);
+        }
+
+        std::chrono::steady_clock::time_point m_start;
+        std::ofstream m_file;
+        std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        bool m_stop;
+        std::thread m_flusher;
+    };
+
+    static Tracer& tracer () {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    static ThreadBuffer& thread_buffer () {
+        // Buffers belong to the tracer, so events from threads that have
+        // already exited still get written
+        thread_local ThreadBuffer* buffer = tracer().register_thread();
+        return *buffer;
+    }
+
+    uint64_t now_ns () {
+        return tracer().now_ns();
+    }
+
+    void complete (const char* name, const char* category, uint64_t start_ns) {
+        ThreadBuffer& buffer = thread_buffer();
+        buffer.push({name, category, start_ns, tracer().now_ns()});
+    }
+
+    void set_thread_name (const char* name) {
+        thread_buffer().name.store(name, std::memory_order_release);
+    }
+}
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+/*
+ * Timeline tracing in the Chrome trace event format, viewable in
+ * chrome://tracing or ui.perfetto.dev.
+ * Only compiled in when CMake is configured with -DTETRIS_TRACE=ON,
+ * otherwise the macros expand to nothing.
+ *
+ * Each thread writes one complete event per span, with its start and
+ * duration, into its own lock-free ring buffer when the span ends.
+ * A background thread drains the buffers into the trace file, so tracing
+ * can stay on for long runs. If a buffer fills up faster than it's drained,
+ * events are dropped instead of blocking the thread. A span is dropped as a
+ * whole, so the spans that are kept still nest.
+ * The file is trace.json, or the path in the TETRIS_TRACE_OUT environment
+ * variable, and is finished when the program exits.
+ */
+
+#ifdef TETRIS_TRACE
+
+#include <cstdint>
+
+namespace trace
+{
+    /**
+     * @return Nanoseconds since tracing started.
+     */
+    uint64_t now_ns ();
+
+    /**
+     * Records a span that just ended on the calling thread.
+     * @param name What happened. Must be a string literal.
+     * @param category A group to filter by. Must be a string literal.
+     * @param start_ns When the span started, from now_ns().
+     */
+    void complete (const char* name, const char* category, uint64_t start_ns);
+
+    /**
+     * Names the calling thread in the trace.
+     * @param name The thread's name. Must be a string literal.
+     */
+    void set_thread_name (const char* name);
+
+    /* Traces its own lifetime */
+    class Scope {
+    public:
+        Scope (const char* name, const char* category)
+            : m_name(name)
+            , m_category(category)
+            , m_start_ns(now_ns())
+        {}
+
+        ~Scope () {
+            complete(m_name, m_category, m_start_ns);
+        }
+
+        Scope (const Scope&) = delete;
+        Scope& operator= (const Scope&) = delete;
+
+    private:
+        const char* m_name;
+        const char* m_category;
+        uint64_t m_start_ns;
+    };
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+// Trace the rest of the enclosing scope
+#define TRACE_SCOPE(name, category) \
+    trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name, category)
+
+#define TRACE_THREAD_NAME(name) trace::set_thread_name(name)
+
+#else
+
+#define TRACE_SCOPE(name, category) ((void) 0)
+#define TRACE_THREAD_NAME(name) ((void) 0)
+
+#endif
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include "../bench/weights.hpp"
+#include "../src/ai/genetic/batch.hpp"
+#include "../src/ai/genetic/train.hpp"
+
+/**
+ * @param move A move from generate_moves().
+ * @param piece The piece the move is with.
+ * @return The same move for a BoardBatch.
+ */
+static BatchMove to_batch_move (const Move& move, uint8_t piece) {
+    // Anchors left of the wall wrap around to the end of the row above
+    auto column = (int8_t) Board::col(move.position);
+    if (column > tetromino_data::get_piece_bounds(piece, move.rotation).right_bound)
+        column -= Board::WIDTH;
+    return {(uint8_t) move.rotation, column, move.hold};
+}
+
+/**
+ * Checks that a game in a batch is in the same state as a board.
+ * @param board The board.
+ * @param batch The batch.
+ * @param lane The lane of the game.
+ */
+static void check_lane (const Board& board, const BoardBatch& batch, size_t lane) {
+    for (uint8_t y = 0; y < Board::HEIGHT; y++) {
+        for (uint8_t x = 0; x < Board::WIDTH; x++) {
+            bool filled = board.get_square(x, y) > 0;
+            ASSERT_EQ(filled, (bool) ((batch.get_row(y)[lane] >> x) & 1)) << (int) x << ", " << (int) y;
+        }
+    }
+    EXPECT_EQ(board.game_over(), batch.game_over(lane));
+    EXPECT_EQ(board.get_falling_piece(), batch.get_falling_piece(lane));
+    EXPECT_EQ(board.get_held_piece(), batch.get_held_piece(lane));
+    for (uint8_t n = 0; n < 7; n++)
+        EXPECT_EQ(board.nth_piece(n), batch.nth_piece(lane, n));
+    EXPECT_EQ(board.get_highest_row(), batch.get_highest_row(lane));
+    EXPECT_EQ(board.get_score(), batch.get_score(lane));
+    EXPECT_EQ(board.get_lines_cleared(), batch.get_lines_cleared(lane));
+    EXPECT_EQ(board.get_pieces_placed(), batch.get_pieces_placed(lane));
+}
+
+/* Every placement does what Board::place_piece() does. Half of the games
+ * are played randomly, for stacks that top out */
+TEST(TestBoardBatch, StepMatchesBoard) {
+    constexpr size_t GAMES = 8, MAX_PIECES = 300;
+    std::vector<RandomEngine> engines;
+    std::vector<Board> boards;
+    uint32_t seeds[GAMES];
+    engines.reserve(GAMES);
+    for (uint32_t game = 0; game < GAMES; game++) {
+        seeds[game] = game * 7 + 1;
+        engines.emplace_back(seeds[game]);
+        boards.emplace_back(250, engines.back());
+        Input input = {};
+        boards.back().update(input, 0);
+    }
+
+    BoardBatch batch(GAMES);
+    batch.reset(seeds, GAMES, MAX_PIECES);
+    std::mt19937 picker(3);
+    std::vector<BatchMove> moves(GAMES);
+    while (batch.compact() > 0) {
+        for (size_t lane = 0; lane < batch.get_running(); lane++) {
+            uint32_t game = batch.get_game(lane);
+            Board& board = boards[game];
+            check_lane(board, batch, lane);
+
+            uint8_t current = board.get_falling_piece();
+            uint8_t held = board.get_held_piece();
+            if (held == 0)
+                held = board.nth_piece(0);
+            Move move = best_move(&board, TEST_WEIGHTS);
+            if (game % 2 == 1) {
+                std::vector<Move> candidates = generate_moves(&board, current, held);
+                move = candidates[picker() % candidates.size()];
+            }
+            moves[lane] = to_batch_move(move, move.hold ? held : current);
+            board.place_piece(move.position, move.rotation, move.hold);
+        }
+        batch.step(moves.data());
+    }
+
+    size_t topped_out = 0;
+    for (size_t lane = 0; lane < GAMES; lane++) {
+        check_lane(boards[batch.get_game(lane)], batch, lane);
+        topped_out += batch.game_over(lane);
+    }
+    EXPECT_GT(topped_out, 0u);
+}
+
+/* Batched greedy games are the games best_move() plays on a Board */
+TEST(TestBoardBatch, MatchesBestMove) {
+    constexpr size_t GAMES = 12, MAX_PIECES = 400;
+    uint32_t seeds[GAMES];
+    for (uint32_t game = 0; game < GAMES; game++)
+        seeds[game] = 1000 + game;
+
+    std::vector<GameResult> results = play_games(TEST_WEIGHTS, seeds, GAMES, MAX_PIECES);
+    ASSERT_EQ(results.size(), GAMES);
+    for (size_t game = 0; game < GAMES; game++) {
+        RandomEngine random_engine(seeds[game]);
+        Board board(250, random_engine);
+        Input input = {};
+        board.update(input, 0);
+        while (!board.game_over() && board.get_pieces_placed() < MAX_PIECES) {
+            Move move = best_move(&board, TEST_WEIGHTS);
+            board.place_piece(move.position, move.rotation, move.hold);
+        }
+        EXPECT_EQ(results[game].score, board.get_score()) << game;
+        EXPECT_EQ(results[game].lines_cleared, board.get_lines_cleared()) << game;
+        EXPECT_EQ(results[game].pieces_placed, board.get_pieces_placed()) << game;
+    }
+}
+
+/* Moves that don't fit end their game, and compacting keeps track of it */
+TEST(TestBoardBatch, BadMoveEndsGame) {
+    uint32_t seeds[3] = {1, 2, 3};
+    BoardBatch batch(3);
+    batch.reset(seeds, 3);
+
+    // Out of bounds for every piece
+    BatchMove moves[3] = {{0, 3, false}, {0, 9, false}, {1, -3, false}};
+    batch.step(moves);
+    EXPECT_FALSE(batch.game_over(0));
+    EXPECT_TRUE(batch.game_over(1));
+    EXPECT_TRUE(batch.game_over(2));
+    EXPECT_EQ(batch.get_pieces_placed(0), 1u);
+    EXPECT_EQ(batch.get_pieces_placed(1), 0u);
+
+    EXPECT_EQ(batch.compact(), 1u);
+    EXPECT_EQ(batch.get_game(0), 0u);
+    EXPECT_TRUE(batch.game_over(batch.get_lane(1)));
+    EXPECT_TRUE(batch.game_over(batch.get_lane(2)));
+    EXPECT_EQ(batch.get_pieces_placed(batch.get_lane(0)), 1u);
+}
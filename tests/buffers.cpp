@@ -0,0 +1,88 @@
+#include <thread>
+#include <gtest/gtest.h>
+
+#include "../src/util/RollingWindow.hpp"
+#include "../src/util/SpscQueue.hpp"
+#include "../src/util/TripleBuffer.hpp"
+
+/* Everything pushed on one thread comes out in order on the other */
+TEST(TestSpscQueue, KeepsOrderAcrossThreads) {
+    constexpr uint32_t ITEMS = 200000;
+    SpscQueue<uint32_t, 64> queue;
+
+    std::thread producer([&queue] () {
+        for (uint32_t i = 0; i < ITEMS; i++) {
+            while (!queue.push(i))
+                std::this_thread::yield();
+        }
+    });
+
+    uint32_t expected = 0;
+    while (expected < ITEMS) {
+        uint32_t item;
+        if (queue.pop(item)) {
+            ASSERT_EQ(item, expected);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+TEST(TestSpscQueue, FullAndEmpty) {
+    SpscQueue<int, 4> queue;
+    int item;
+    EXPECT_FALSE(queue.pop(item));
+    for (int i = 0; i < 4; i++)
+        EXPECT_TRUE(queue.push(i));
+    EXPECT_FALSE(queue.push(4));
+    EXPECT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 0);
+    EXPECT_TRUE(queue.push(4));
+}
+
+/* The reader never goes backwards and always ends up at the newest value */
+TEST(TestTripleBuffer, ReaderSeesNewestValue) {
+    constexpr uint64_t VALUES = 200000;
+    TripleBuffer<uint64_t> buffer;
+
+    std::thread writer([&buffer] () {
+        for (uint64_t i = 1; i <= VALUES; i++) {
+            buffer.write_buffer() = i;
+            buffer.publish();
+        }
+    });
+
+    uint64_t last = 0;
+    while (last < VALUES) {
+        if (buffer.update()) {
+            uint64_t value = buffer.read_buffer();
+            ASSERT_GT(value, last);
+            last = value;
+        }
+    }
+    writer.join();
+    EXPECT_FALSE(buffer.update());
+}
+
+/* Old values fall out of the window and percentiles only see what's left */
+TEST(TestRollingWindow, KeepsNewest) {
+    RollingWindow<uint32_t, 100> window;
+    EXPECT_EQ(window.percentile(99), 0);
+
+    for (uint32_t i = 1; i <= 1000; i++)
+        window.add(i);
+    EXPECT_EQ(window.size(), 100);
+    EXPECT_EQ(window.newest(), 1000);
+    EXPECT_EQ(window.newest(99), 901);
+    EXPECT_EQ(window.percentile(0), 901);
+    EXPECT_EQ(window.percentile(50), 951);
+    EXPECT_EQ(window.percentile(99), 999);
+    EXPECT_EQ(window.percentile(100), 1000);
+
+    window.clear();
+    window.add(7);
+    EXPECT_EQ(window.size(), 1);
+    EXPECT_EQ(window.percentile(99), 7);
+}
@@ -0,0 +1,111 @@
+#include <cstring>
+#include <filesystem>
+#include <gtest/gtest.h>
+
+#include "../bench/weights.hpp"
+#include "../src/ai/PackedPosition.hpp"
+#include "../src/app/datagen.hpp"
+#include "../src/util/ShardReader.hpp"
+
+static DatagenSettings small_settings (const std::string& directory, size_t positions) {
+    static std::string stored;
+    stored = directory;
+    return {
+        .directory = stored.c_str(),
+        .positions = positions,
+        .sample_every = 3,
+        .reservoir = 0,
+        .max_pieces = 150,
+        .shard_positions = 60,
+        .seed = 17,
+        .threads = 2
+    };
+}
+
+/**
+ * @param directory A dataset.
+ * @param worker Which worker's shards to read.
+ * @return Every position the worker wrote, in order.
+ */
+static std::vector<PackedPosition> read_worker (const std::string& directory, size_t worker) {
+    std::vector<PackedPosition> positions;
+    for (uint32_t shard = 0; ; shard++) {
+        std::string path = directory + "/shard_" + std::to_string(worker) + "_" +
+            std::to_string(shard) + ".tsh";
+        if (!std::filesystem::exists(path))
+            break;
+        ShardReader reader;
+        EXPECT_TRUE(reader.open(path));
+        reader.for_each_record([&] (const uint8_t* record) {
+            positions.emplace_back();
+            std::memcpy(positions.back().bits, record, PackedPosition::BYTES);
+        });
+    }
+    return positions;
+}
+
+static bool same_positions (
+    const std::vector<PackedPosition>& a, const std::vector<PackedPosition>& b
+) {
+    return a.size() == b.size() &&
+        std::memcmp(a.data(), b.data(), a.size() * sizeof(PackedPosition)) == 0;
+}
+
+/* Every position is labelled, and each worker gets its share */
+TEST(TestDatagen, Labels) {
+    auto directory = std::filesystem::temp_directory_path() / "test_datagen_labels";
+    std::filesystem::remove_all(directory);
+    ASSERT_TRUE(generate_dataset(TEST_WEIGHTS, small_settings(directory.string(), 200)));
+
+    for (size_t worker = 0; worker < 2; worker++) {
+        std::vector<PackedPosition> positions = read_worker(directory.string(), worker);
+        EXPECT_GE(positions.size(), 100u);
+        for (const PackedPosition& position : positions) {
+            ASSERT_TRUE(position.has_move());
+            ASSERT_TRUE(position.has_score());
+            ASSERT_TRUE(position.has_outcome());
+        }
+    }
+    std::filesystem::remove_all(directory);
+}
+
+/* Reservoir sampling keeps the same number of positions from every game */
+TEST(TestDatagen, Reservoir) {
+    auto directory = std::filesystem::temp_directory_path() / "test_datagen_reservoir";
+    std::filesystem::remove_all(directory);
+    DatagenSettings settings = small_settings(directory.string(), 40);
+    settings.sample_every = 0;
+    settings.reservoir = 10;
+    settings.threads = 1;
+    ASSERT_TRUE(generate_dataset(TEST_WEIGHTS, settings));
+
+    // 4 games of 150 pieces, 10 positions from each
+    EXPECT_EQ(read_worker(directory.string(), 0).size(), 40u);
+    std::filesystem::remove_all(directory);
+}
+
+/* Stopping half way and carrying on makes the same positions */
+TEST(TestDatagen, Resume) {
+    auto straight = std::filesystem::temp_directory_path() / "test_datagen_straight";
+    auto resumed = std::filesystem::temp_directory_path() / "test_datagen_resumed";
+    std::filesystem::remove_all(straight);
+    std::filesystem::remove_all(resumed);
+
+    ASSERT_TRUE(generate_dataset(TEST_WEIGHTS, small_settings(straight.string(), 300)));
+    ASSERT_TRUE(generate_dataset(TEST_WEIGHTS, small_settings(resumed.string(), 100)));
+    ASSERT_TRUE(generate_dataset(TEST_WEIGHTS, small_settings(resumed.string(), 300)));
+
+    for (size_t worker = 0; worker < 2; worker++) {
+        EXPECT_TRUE(same_positions(
+            read_worker(straight.string(), worker), read_worker(resumed.string(), worker)
+        ));
+    }
+
+    // Different settings can't carry on from there
+    DatagenSettings other = small_settings(resumed.string(), 300);
+    other.sample_every = 4;
+    EXPECT_FALSE(generate_dataset(TEST_WEIGHTS, other));
+
+    std::filesystem::remove_all(straight);
+    std::filesystem::remove_all(resumed);
+}
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <gtest/gtest.h>
+
+#include "../bench/weights.hpp"
+#include "../src/ai/PackedPosition.hpp"
+#include "../src/util/lz.hpp"
+#include "../src/util/ShardReader.hpp"
+#include "../src/util/ShardWriter.hpp"
+
+/**
+ * Plays a game with best_move(), packing every position before its move.
+ * @param seed The seed for the piece randomizer.
+ * @param pieces How many pieces to play.
+ * @return The positions, each with its move.
+ */
+static std::vector<PackedPosition> play_positions (uint32_t seed, size_t pieces) {
+    RandomEngine random_engine(seed);
+    Board board(250, random_engine);
+    Input input = {};
+    board.update(input, 0);
+
+    std::vector<PackedPosition> positions;
+    while (!board.game_over() && positions.size() < pieces) {
+        Move move = best_move(&board, TEST_WEIGHTS);
+        positions.push_back(PackedPosition::pack(board));
+        positions.back().set_move(move);
+        board.place_piece(move.position, move.rotation, move.hold);
+    }
+    return positions;
+}
+
+static std::string temp_path (const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+/* Unpacking gives a board that looks the same to the agent */
+TEST(TestDataset, PackUnpack) {
+    RandomEngine random_engine(7);
+    Board board(250, random_engine);
+    Input input = {};
+    board.update(input, 0);
+    RandomEngine unpack_engine;
+
+    for (int i = 0; i < 60 && !board.game_over(); i++) {
+        PackedPosition position = PackedPosition::pack(board);
+        Board unpacked(250, unpack_engine);
+        position.unpack(unpacked);
+
+        for (uint16_t idx = 0; idx < Board::TOTAL_SIZE; idx++)
+            ASSERT_EQ(board.get_square(idx) > 0, unpacked.get_square(idx) > 0);
+        ASSERT_EQ(unpacked.get_falling_piece(), board.get_falling_piece());
+        ASSERT_EQ(unpacked.get_falling_piece_anchor(), board.get_falling_piece_anchor());
+        ASSERT_EQ(unpacked.get_held_piece(), board.get_held_piece());
+        for (uint8_t n = 0; n < PackedPosition::QUEUE_SIZE; n++)
+            ASSERT_EQ(unpacked.nth_piece(n), board.nth_piece(n));
+
+        Move move = best_move(&board, TEST_WEIGHTS);
+        Move unpacked_move = best_move(&unpacked, TEST_WEIGHTS);
+        ASSERT_EQ(unpacked_move.position, move.position);
+        ASSERT_EQ(unpacked_move.rotation, move.rotation);
+        ASSERT_EQ(unpacked_move.hold, move.hold);
+        board.place_piece(move.position, move.rotation, move.hold);
+    }
+}
+
+TEST(TestDataset, MoveAndOutcome) {
+    PackedPosition position = {};
+    EXPECT_FALSE(position.has_move());
+    EXPECT_FALSE(position.has_outcome());
+
+    position.set_move({.position = -1, .rotation = 3, .hold = true});
+    position.set_outcome(123456789);
+    EXPECT_FALSE(position.has_score());
+    position.set_score(-1234.5f);
+    ASSERT_TRUE(position.has_move());
+    ASSERT_TRUE(position.has_outcome());
+    EXPECT_EQ(position.get_move().position, -1);
+    EXPECT_EQ(position.get_move().rotation, 3);
+    EXPECT_TRUE(position.get_move().hold);
+    EXPECT_EQ(position.get_outcome(), 123456789u);
+    ASSERT_TRUE(position.has_score());
+    EXPECT_EQ(position.get_score(), -1234.5f);
+    // Labels don't spill into the board
+    for (uint8_t y = 0; y < Board::HEIGHT; y++) {
+        for (uint8_t x = 0; x < Board::WIDTH; x++)
+            EXPECT_FALSE(position.get_square(x, y));
+    }
+}
+
+TEST(TestDataset, LzRoundTrip) {
+    RandomEngine random_engine(3);
+    std::vector<std::vector<uint8_t>> inputs = {{}, {42}, std::vector<uint8_t>(100000, 7)};
+    std::vector<uint8_t> noise(5000);
+    for (uint8_t& byte : noise)
+        byte = (uint8_t) random_engine();
+    inputs.push_back(noise);
+    // Repeats far apart and long literal runs
+    std::vector<uint8_t> mixed = noise;
+    mixed.insert(mixed.end(), noise.begin(), noise.begin() + 3000);
+    mixed.insert(mixed.end(), 400, 0);
+    inputs.push_back(mixed);
+
+    for (const std::vector<uint8_t>& input : inputs) {
+        std::vector<uint8_t> compressed;
+        lz::compress(input.data(), input.size(), compressed);
+        std::vector<uint8_t> output(input.size());
+        ASSERT_TRUE(lz::decompress(compressed.data(), compressed.size(), output.data(), output.size()));
+        EXPECT_EQ(output, input);
+        // Blocks end in literals, which LZ4 decoders need
+        if (input.size() >= 5) {
+            EXPECT_TRUE(std::equal(input.end() - 5, input.end(), compressed.end() - 5));
+        }
+    }
+
+    std::vector<uint8_t> compressed;
+    lz::compress(inputs[2].data(), inputs[2].size(), compressed);
+    EXPECT_LT(compressed.size(), 1000u);
+    std::vector<uint8_t> output(inputs[2].size());
+    EXPECT_FALSE(lz::decompress(compressed.data(), compressed.size() - 2, output.data(), output.size()));
+    EXPECT_FALSE(lz::decompress(compressed.data(), compressed.size(), output.data(), output.size() - 1));
+    // An offset from before the start
+    compressed[2] = 0xFF;
+    compressed[3] = 0xFF;
+    EXPECT_FALSE(lz::decompress(compressed.data(), compressed.size(), output.data(), output.size()));
+}
+
+/* Everything written comes back in order, compressed or not */
+TEST(TestDataset, ShardRoundTrip) {
+    std::vector<PackedPosition> positions = play_positions(11, 1000);
+    ASSERT_GT(positions.size(), 100u);
+
+    for (bool compress : {true, false}) {
+        std::string path = temp_path("test_dataset_round_trip.tsh");
+        ShardWriter writer(PackedPosition::BYTES, 64, compress);
+        ASSERT_TRUE(writer.open(path));
+        for (const PackedPosition& position : positions)
+            ASSERT_TRUE(writer.write(&position));
+        ASSERT_TRUE(writer.close());
+        size_t raw_size = positions.size() * PackedPosition::BYTES;
+        if (compress) {
+            EXPECT_LT(std::filesystem::file_size(path), raw_size / 2);
+        }
+
+        ShardReader reader;
+        ASSERT_TRUE(reader.open(path));
+        EXPECT_EQ(reader.get_record_size(), PackedPosition::BYTES);
+        EXPECT_EQ(reader.get_record_count(), positions.size());
+        EXPECT_EQ(reader.get_block_count(), (positions.size() + 63) / 64);
+        size_t i = 0;
+        EXPECT_TRUE(reader.for_each_record([&] (const uint8_t* record) {
+            EXPECT_EQ(std::memcmp(record, positions[i].bits, PackedPosition::BYTES), 0);
+            i++;
+        }));
+        EXPECT_EQ(i, positions.size());
+
+        // Best move agrees with itself, it picked every move
+        DatasetAgreement agreement = dataset_agreement(reader, TEST_WEIGHTS);
+        EXPECT_EQ(agreement.positions, positions.size());
+        EXPECT_EQ(agreement.matches, positions.size());
+        reader.close();
+        std::filesystem::remove(path);
+    }
+}
+
+/* Writing with a full ring waits for blocks instead of dropping records */
+TEST(TestDataset, ShardWriteBlocking) {
+    std::vector<PackedPosition> positions = play_positions(13, 300);
+    std::string path = temp_path("test_dataset_blocking.tsh");
+    // A block per record, so the ring fills up all the time
+    ShardWriter writer(PackedPosition::BYTES, 1);
+    ASSERT_TRUE(writer.open(path));
+    for (int round = 0; round < 10; round++) {
+        for (const PackedPosition& position : positions)
+            ASSERT_TRUE(writer.write_blocking(&position));
+    }
+    EXPECT_EQ(writer.get_dropped(), 0u);
+    ASSERT_TRUE(writer.close());
+
+    ShardReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_EQ(reader.get_record_count(), 10 * positions.size());
+    size_t i = 0;
+    EXPECT_TRUE(reader.for_each_record([&] (const uint8_t* record) {
+        EXPECT_EQ(std::memcmp(record, positions[i % positions.size()].bits, PackedPosition::BYTES), 0);
+        i++;
+    }));
+    EXPECT_EQ(i, 10 * positions.size());
+    reader.close();
+    std::filesystem::remove(path);
+}
+
+/* A shard cut off part way through still gives its whole blocks */
+TEST(TestDataset, TruncatedShard) {
+    std::vector<PackedPosition> positions = play_positions(12, 200);
+    std::string path = temp_path("test_dataset_truncated.tsh");
+    ShardWriter writer(PackedPosition::BYTES, 32);
+    ASSERT_TRUE(writer.open(path));
+    for (const PackedPosition& position : positions)
+        writer.write(&position);
+    ASSERT_TRUE(writer.close());
+
+    ShardReader reader;
+    ASSERT_TRUE(reader.open(path));
+    size_t blocks = reader.get_block_count();
+    reader.close();
+
+    // Drop the index and half of the last block
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    size_t index_size = 8 * blocks + shard::INDEX_FOOTER_SIZE;
+    data.resize(data.size() - index_size - 20);
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(data.data(), (std::streamsize) data.size());
+
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_EQ(reader.get_block_count(), blocks - 1);
+    size_t i = 0;
+    EXPECT_TRUE(reader.for_each_record([&] (const uint8_t* record) {
+        EXPECT_EQ(std::memcmp(record, positions[i].bits, PackedPosition::BYTES), 0);
+        i++;
+    }));
+    EXPECT_EQ(i, reader.get_record_count());
+    reader.close();
+    std::filesystem::remove(path);
+
+    EXPECT_FALSE(reader.open(temp_path("test_dataset_missing.tsh")));
+}
@@ -0,0 +1,640 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "reference/ReferenceBoard.hpp"
+#include "../bench/weights.hpp"
+#include "../src/ai/genetic/Agent.hpp"
+#include "../src/ai/genetic/batch.hpp"
+
+/*
+ * Plays the same games on an engine under test and on the frozen
+ * ReferenceBoard and checks that they agree after every locked piece.
+ * The engines are Board, played with inputs or placements, and BoardBatch,
+ * played with placements. All of them go through the same game loop,
+ * minimizer and reproducer.
+ * The time budget defaults to 2 seconds, split between the tests, and can
+ * be raised for long runs with the TETRIS_DIFF_BUDGET_MS environment
+ * variable.
+ */
+
+namespace
+{
+    constexpr uint16_t FALL_RATE = 250;
+    // Keep games short so reproducers stay short
+    constexpr size_t MAX_PIECES_PER_GAME = 300;
+    // Don't try to shrink reproducers longer than this
+    constexpr size_t MAX_MINIMIZE_STEPS = 4096;
+    // How many tests share the time budget
+    constexpr uint32_t TEST_COUNT = 6;
+
+    enum class Mode {
+        RANDOM_INPUT,
+        AGENT_INPUT,
+        PLACEMENT,
+        AGENT_PLACEMENT
+    };
+
+    /* One thing done to both boards */
+    struct Step {
+        bool placement;
+        // Input steps
+        Input input;
+        uint32_t ticks;
+        // Placement steps
+        uint16_t anchor;
+        uint8_t rot;
+        bool hold;
+        // BoardBatch placements are dropped in a column instead of going to
+        // an anchor
+        int8_t column;
+    };
+
+    /* An engine under test, played next to a ReferenceBoard */
+    class Engine {
+    public:
+        virtual ~Engine () = default;
+
+        /**
+         * Decides the next step of the game by looking at the engine.
+         * @param mode How steps are picked.
+         * @param random For random steps.
+         * @param ticks The time of the last step, moved forward for input steps.
+         * @param step Set to the step.
+         * @return Whether there's a step, false if nothing can be played.
+         */
+        virtual bool next_step (
+            Mode mode, RandomEngine& random, uint32_t& ticks, Step& step
+        ) = 0;
+
+        /**
+         * Plays a step on the engine and on the reference.
+         * @return A description of how they disagreed about the step, or an
+         * empty string.
+         */
+        virtual std::string apply (const Step& step, ReferenceBoard& reference) = 0;
+
+        /**
+         * @return A description of the first difference from the reference,
+         * or an empty string if they agree.
+         */
+        [[nodiscard]] virtual std::string compare (const ReferenceBoard& reference) const = 0;
+
+        [[nodiscard]] virtual bool game_over () const = 0;
+        [[nodiscard]] virtual size_t get_pieces_placed () const = 0;
+
+        /**
+         * @return Code that plays the steps on the engine, to paste into a test.
+         */
+        [[nodiscard]] virtual std::string code (
+            uint32_t seed, const std::vector<Step>& steps
+        ) const = 0;
+    };
+
+    using EngineFactory = std::unique_ptr<Engine> (*) (uint32_t seed);
+
+    /**
+     * Compares a field of the engine and the reference.
+     * @return A description of the difference, or an empty string.
+     */
+    template <typename T, typename U>
+    std::string compare_field (const char* name, T value, U reference) {
+        if (value == reference)
+            return "";
+        std::ostringstream out;
+        out << name << ": board " << (size_t) value << ", reference " << (size_t) reference;
+        return out.str();
+    }
+
+    /* Board, which can be played with inputs or placements */
+    class BoardEngine : public Engine {
+    public:
+        explicit BoardEngine (uint32_t seed)
+            : m_random(seed)
+            , m_board(FALL_RATE, m_random)
+            , m_agent(true, TEST_WEIGHTS)
+        {
+            Input input = {};
+            m_board.update(input, 0);
+        }
+
+        static std::unique_ptr<Engine> make (uint32_t seed) {
+            return std::make_unique<BoardEngine>(seed);
+        }
+
+        bool next_step (
+            Mode mode, RandomEngine& random, uint32_t& ticks, Step& step
+        ) override {
+            step = {};
+            switch (mode) {
+                case Mode::RANDOM_INPUT:
+                    step.input = random_input(random);
+                    // Sometimes jump ahead far enough for gravity to kick in
+                    ticks += random() % 4 == 0 ? FALL_RATE : 1;
+                    step.ticks = ticks;
+                    break;
+                case Mode::AGENT_INPUT:
+                    step.input = m_agent.gen_input(&m_board);
+                    step.ticks = ++ticks;
+                    break;
+                case Mode::PLACEMENT: {
+                    uint8_t held_piece = m_board.get_held_piece();
+                    if (held_piece == 0)
+                        held_piece = m_board.nth_piece(0);
+                    std::vector<Move> move_list = generate_moves(
+                        &m_board, m_board.get_falling_piece(), held_piece
+                    );
+                    step.placement = true;
+                    if (move_list.empty()) {
+                        // Nowhere to go, lock it where it is
+                        step.anchor = m_board.get_falling_piece_anchor();
+                        step.rot = m_board.get_falling_piece_rot();
+                    } else {
+                        const Move& move = move_list[random() % move_list.size()];
+                        step.anchor = move.position;
+                        step.rot = move.rotation;
+                        step.hold = move.hold;
+                    }
+                    break;
+                }
+                case Mode::AGENT_PLACEMENT: {
+                    size_t candidates = 0;
+                    Move move = best_move(&m_board, TEST_WEIGHTS, &candidates);
+                    step.placement = true;
+                    if (candidates == 0) {
+                        step.anchor = m_board.get_falling_piece_anchor();
+                        step.rot = m_board.get_falling_piece_rot();
+                    } else {
+                        step.anchor = move.position;
+                        step.rot = move.rotation;
+                        step.hold = move.hold;
+                    }
+                    break;
+                }
+            }
+            return true;
+        }
+
+        std::string apply (const Step& step, ReferenceBoard& reference) override {
+            if (step.placement) {
+                m_board.place_piece(step.anchor, step.rot, step.hold);
+                reference.place_piece(step.anchor, step.rot, step.hold);
+            } else {
+                // update() takes the input by reference, give each its own copy
+                Input board_input = step.input;
+                Input reference_input = step.input;
+                m_board.update(board_input, step.ticks);
+                reference.update(reference_input, step.ticks);
+            }
+            return "";
+        }
+
+        [[nodiscard]] std::string compare (const ReferenceBoard& reference) const override {
+            std::ostringstream out;
+            for (uint16_t idx = 0; idx < Board::TOTAL_SIZE; idx++) {
+                if (m_board.get_square(idx) != reference.get_square(idx)) {
+                    out << "square (" << (int) Board::col(idx) << ", "
+                        << (int) Board::row(idx) << "): board "
+                        << (int) m_board.get_square(idx) << ", reference "
+                        << (int) reference.get_square(idx);
+                    return out.str();
+                }
+            }
+
+#define COMPARE_FIELD(getter) \
+            { \
+                std::string mismatch = compare_field(#getter, m_board.getter(), reference.getter()); \
+                if (!mismatch.empty()) \
+                    return mismatch; \
+            }
+
+            COMPARE_FIELD(game_over)
+            COMPARE_FIELD(get_score)
+            COMPARE_FIELD(get_lines_cleared)
+            COMPARE_FIELD(get_pieces_placed)
+            COMPARE_FIELD(get_highest_row)
+            COMPARE_FIELD(get_held_piece)
+            COMPARE_FIELD(get_falling_piece)
+            COMPARE_FIELD(get_falling_piece_rot)
+            COMPARE_FIELD(get_falling_piece_anchor)
+            COMPARE_FIELD(get_piece_num)
+#undef COMPARE_FIELD
+
+            // The whole bag, both the current and the next one
+            for (uint8_t n = 0; n < 14; n++) {
+                if (m_board.nth_piece(n) != reference.nth_piece(n)) {
+                    out << "nth_piece(" << (int) n << "): board "
+                        << (int) m_board.nth_piece(n) << ", reference "
+                        << (int) reference.nth_piece(n);
+                    return out.str();
+                }
+            }
+            return "";
+        }
+
+        [[nodiscard]] bool game_over () const override {
+            return m_board.game_over();
+        }
+
+        [[nodiscard]] size_t get_pieces_placed () const override {
+            return m_board.get_pieces_placed();
+        }
+
+        [[nodiscard]] std::string code (
+            uint32_t seed, const std::vector<Step>& steps
+        ) const override {
+            std::ostringstream out;
+            out << "    RandomEngine random_engine(" << seed << ");\n"
+                << "    Board board(" << FALL_RATE << ", random_engine);\n"
+                << "    Input input = {};\n"
+                << "    board.update(input, 0);\n";
+            for (const Step& step : steps) {
+                if (step.placement) {
+                    out << "    board.place_piece(" << step.anchor << ", "
+                        << (int) step.rot << ", " << (step.hold ? "true" : "false")
+                        << ");\n";
+                    continue;
+                }
+                const Input& in = step.input;
+                out << "    input = {" << in.move_left << ", " << in.move_right
+                    << ", " << in.rot_clockwise << ", " << in.rot_count_clockwise
+                    << ", " << in.soft_drop << ", " << in.hard_drop << ", "
+                    << in.hold_piece << "};\n"
+                    << "    board.update(input, " << step.ticks << ");\n";
+            }
+            return out.str();
+        }
+
+    private:
+        static Input random_input (RandomEngine& random) {
+            // Chance out of 100 for each input to be held down
+            auto chance = [&random] (uint32_t percent) {
+                return random() % 100 < percent;
+            };
+            return {
+                .move_left = chance(25),
+                .move_right = chance(25),
+                .rot_clockwise = chance(15),
+                .rot_count_clockwise = chance(15),
+                .soft_drop = chance(10),
+                .hard_drop = chance(3),
+                .hold_piece = chance(3)
+            };
+        }
+
+        RandomEngine m_random;
+        Board m_board;
+        Agent m_agent;
+    };
+
+    /**
+     * Drops a piece on the reference, the way generate_moves() does, to find
+     * where a BoardBatch placement should land without asking BoardBatch.
+     * @param reference The board.
+     * @param piece Which piece.
+     * @param rot The rotation of the piece.
+     * @param column The column of the left edge of the piece's 4x4 box.
+     * @return The anchor the piece lands on, or -1 if it's out of bounds or
+     * doesn't fit at the top.
+     */
+    int reference_drop (
+        const ReferenceBoard& reference, uint8_t piece, uint8_t rot, int8_t column
+    ) {
+        if (piece == 0 || rot >= 4)
+            return -1;
+        tetromino_data::Bounds bounds = tetromino_data::get_piece_bounds(piece, rot);
+        if (column < bounds.left_bound || column > bounds.right_bound)
+            return -1;
+
+        auto fits = [&] (int y) {
+            for (uint8_t n = 0; n < 4; n++) {
+                int idx = y * Board::WIDTH + column + tetromino_data::get_piece_map(piece, rot, n);
+                // Only locked squares are in the way, not the falling piece
+                if (idx >= Board::TOTAL_SIZE || reference.get_square((uint16_t) idx) > 0)
+                    return false;
+            }
+            return true;
+        };
+        int y = Board::BUFFER_HEIGHT;
+        if (!fits(y))
+            return -1;
+        while (fits(y + 1))
+            y++;
+        return y * Board::WIDTH + column;
+    }
+
+    /* BoardBatch with a single game, which can only be played with placements */
+    class BatchEngine : public Engine {
+    public:
+        explicit BatchEngine (uint32_t seed)
+            : m_batch(1)
+        {
+            m_batch.reset(&seed, 1);
+        }
+
+        static std::unique_ptr<Engine> make (uint32_t seed) {
+            return std::make_unique<BatchEngine>(seed);
+        }
+
+        bool next_step (
+            Mode mode, RandomEngine& random, uint32_t&, Step& step
+        ) override {
+            step = {};
+            step.placement = true;
+            BatchMove move = {.rotation = 4, .column = 0, .hold = false};
+            switch (mode) {
+                case Mode::RANDOM_INPUT:
+                case Mode::AGENT_INPUT:
+                    ADD_FAILURE() << "BoardBatch can only be played with placements";
+                    return false;
+                case Mode::PLACEMENT: {
+                    // Every rotation, even the ones generate_moves() skips
+                    // because they're the same squares as another
+                    std::vector<BatchMove> valid;
+                    for (int hold = 0; hold < 2; hold++) {
+                        for (uint8_t rot = 0; rot < 4; rot++) {
+                            for (int8_t column = -3; column < Board::WIDTH; column++) {
+                                BatchMove candidate = {rot, column, hold == 1};
+                                if (drop(candidate) >= 0)
+                                    valid.push_back(candidate);
+                            }
+                        }
+                    }
+                    if (valid.empty())
+                        return false;
+                    move = valid[random() % valid.size()];
+                    break;
+                }
+                case Mode::AGENT_PLACEMENT:
+                    best_moves(m_batch, TEST_WEIGHTS, &move);
+                    if (drop(move) < 0)
+                        return false;
+                    break;
+            }
+            step.rot = move.rotation;
+            step.column = move.column;
+            step.hold = move.hold;
+            return true;
+        }
+
+        std::string apply (const Step& step, ReferenceBoard& reference) override {
+            BatchMove move = {step.rot, step.column, step.hold};
+            int8_t row = drop(move);
+
+            uint8_t piece = reference.get_falling_piece();
+            if (step.hold)
+                piece = reference.get_held_piece() != 0 ? reference.get_held_piece() : reference.nth_piece(0);
+            int anchor = reference_drop(reference, piece, step.rot, step.column);
+            int reference_row = anchor < 0 ? -1 : (anchor - step.column) / Board::WIDTH;
+
+            if (row != reference_row) {
+                std::ostringstream out;
+                out << "landing row: board " << (int) row << ", reference " << reference_row;
+                return out.str();
+            }
+            // Neither can play it, which happens to steps of a shrunk game
+            if (row < 0)
+                return "";
+
+            m_batch.step(&move);
+            reference.place_piece((uint16_t) anchor, step.rot, step.hold);
+            return "";
+        }
+
+        [[nodiscard]] std::string compare (const ReferenceBoard& reference) const override {
+            std::ostringstream out;
+            for (uint8_t y = 0; y < Board::HEIGHT; y++) {
+                for (uint8_t x = 0; x < Board::WIDTH; x++) {
+                    bool filled = (m_batch.get_row(y)[0] >> x) & 1;
+                    bool reference_filled = reference.get_square(x, y) > 0;
+                    if (filled != reference_filled) {
+                        out << "square (" << (int) x << ", " << (int) y << "): board "
+                            << filled << ", reference " << reference_filled;
+                        return out.str();
+                    }
+                }
+            }
+
+#define COMPARE_FIELD(getter) \
+            { \
+                std::string mismatch = compare_field(#getter, m_batch.getter(0), reference.getter()); \
+                if (!mismatch.empty()) \
+                    return mismatch; \
+            }
+
+            COMPARE_FIELD(game_over)
+            COMPARE_FIELD(get_score)
+            COMPARE_FIELD(get_lines_cleared)
+            COMPARE_FIELD(get_pieces_placed)
+            COMPARE_FIELD(get_highest_row)
+            COMPARE_FIELD(get_held_piece)
+            COMPARE_FIELD(get_falling_piece)
+#undef COMPARE_FIELD
+
+            for (uint8_t n = 0; n < 14; n++) {
+                if (m_batch.nth_piece(0, n) != reference.nth_piece(n)) {
+                    out << "nth_piece(" << (int) n << "): board "
+                        << (int) m_batch.nth_piece(0, n) << ", reference "
+                        << (int) reference.nth_piece(n);
+                    return out.str();
+                }
+            }
+            return "";
+        }
+
+        [[nodiscard]] bool game_over () const override {
+            return m_batch.game_over(0);
+        }
+
+        [[nodiscard]] size_t get_pieces_placed () const override {
+            return m_batch.get_pieces_placed(0);
+        }
+
+        [[nodiscard]] std::string code (
+            uint32_t seed, const std::vector<Step>& steps
+        ) const override {
+            std::ostringstream out;
+            out << "    uint32_t seed = " << seed << ";\n"
+                << "    BoardBatch batch(1);\n"
+                << "    batch.reset(&seed, 1);\n"
+                << "    BatchMove move;\n";
+            for (const Step& step : steps) {
+                out << "    move = {" << (int) step.rot << ", " << (int) step.column
+                    << ", " << (step.hold ? "true" : "false") << "};\n"
+                    << "    batch.step(&move);\n";
+            }
+            return out.str();
+        }
+
+    private:
+        /**
+         * @return The row the move lands on, or -1 if it can't be played.
+         */
+        int8_t drop (const BatchMove& move) {
+            uint8_t piece = m_batch.get_falling_piece(0);
+            if (move.hold) {
+                piece = m_batch.get_held_piece(0) != 0 ?
+                    m_batch.get_held_piece(0) : m_batch.nth_piece(0, 0);
+            }
+            int8_t row;
+            m_batch.drop(&piece, &move, &row);
+            return row;
+        }
+
+        BoardBatch m_batch;
+    };
+
+    /* The engine under test and the reference, which needs its own random engine */
+    struct Game {
+        std::unique_ptr<Engine> engine;
+        RandomEngine reference_random;
+        ReferenceBoard reference;
+
+        Game (EngineFactory make_engine, uint32_t seed)
+            : engine(make_engine(seed))
+            , reference_random(seed)
+            , reference(FALL_RATE, reference_random)
+        {
+            Input input = {};
+            reference.update(input, 0);
+        }
+
+        /**
+         * Plays a step on both boards and compares them if a piece locked.
+         * @return The first difference found, or an empty string.
+         */
+        std::string play (const Step& step) {
+            size_t pieces = engine->get_pieces_placed();
+            std::string mismatch = engine->apply(step, reference);
+            if (!mismatch.empty())
+                return mismatch;
+            if (engine->get_pieces_placed() == pieces && !engine->game_over())
+                return "";
+            return engine->compare(reference);
+        }
+    };
+
+    /**
+     * Plays steps from the start of a game.
+     * @param make_engine The engine under test.
+     * @param seed The seed of the game.
+     * @param steps What to do to the boards.
+     * @return The first difference found after a lock, or an empty string.
+     */
+    std::string replay (EngineFactory make_engine, uint32_t seed, const std::vector<Step>& steps) {
+        Game game(make_engine, seed);
+        for (const Step& step : steps) {
+            std::string mismatch = game.play(step);
+            if (!mismatch.empty())
+                return mismatch;
+        }
+        return game.engine->compare(game.reference);
+    }
+
+    /**
+     * Shrinks a failing game by dropping every step the failure doesn't need.
+     * Steps are dropped from the end first, since they come after the failure.
+     */
+    std::vector<Step> minimize (EngineFactory make_engine, uint32_t seed, std::vector<Step> steps) {
+        if (steps.size() > MAX_MINIMIZE_STEPS)
+            return steps;
+        for (size_t i = steps.size(); i-- > 0;) {
+            std::vector<Step> candidate;
+            candidate.reserve(steps.size());
+            for (size_t j = 0; j < steps.size(); j++) {
+                if (j != i)
+                    candidate.push_back(steps[j]);
+            }
+            if (!replay(make_engine, seed, candidate).empty())
+                steps.swap(candidate);
+        }
+        return steps;
+    }
+
+    /* Prints a failing game as code that can be pasted into a test */
+    std::string reproducer (
+        const Engine& engine, uint32_t seed, const std::vector<Step>& steps,
+        const std::string& mismatch
+    ) {
+        std::ostringstream out;
+        out << "Mismatch: " << mismatch << "\n"
+            << "Reproducer (" << steps.size() << " steps):\n"
+            << engine.code(seed, steps);
+        return out.str();
+    }
+
+    uint32_t budget_ms () {
+        const char* env = std::getenv("TETRIS_DIFF_BUDGET_MS");
+        if (env != nullptr)
+            return (uint32_t) std::strtoul(env, nullptr, 10);
+        return 2000;
+    }
+
+    /**
+     * Plays games of an engine in one mode until the time budget runs out.
+     * Fails the test with a reproducer on the first mismatch.
+     */
+    void run_mode (EngineFactory make_engine, Mode mode, uint32_t first_seed, uint32_t time_ms) {
+        RandomEngine random(first_seed);
+        auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(time_ms);
+
+        size_t games = 0, steps_played = 0, locks = 0;
+        for (uint32_t seed = first_seed;
+             std::chrono::steady_clock::now() < deadline; seed++) {
+            Game game(make_engine, seed);
+            std::vector<Step> steps;
+            uint32_t ticks = 0;
+
+            while (!game.engine->game_over() &&
+                   game.engine->get_pieces_placed() < MAX_PIECES_PER_GAME) {
+                Step step;
+                if (!game.engine->next_step(mode, random, ticks, step))
+                    break;
+                steps.push_back(step);
+
+                std::string mismatch = game.play(step);
+                if (!mismatch.empty()) {
+                    std::vector<Step> small = minimize(make_engine, seed, steps);
+                    std::string small_mismatch = replay(make_engine, seed, small);
+                    FAIL() << reproducer(*game.engine, seed, small, small_mismatch);
+                }
+            }
+            games++;
+            steps_played += steps.size();
+            locks += game.engine->get_pieces_placed();
+        }
+
+        std::cout << "[          ] " << games << " games, " << steps_played
+                  << " steps, " << locks << " locks" << std::endl;
+    }
+}
+
+TEST(TestDifferential, RandomInputs) {
+    run_mode(BoardEngine::make, Mode::RANDOM_INPUT, 1, budget_ms() / TEST_COUNT);
+}
+
+TEST(TestDifferential, AgentInputs) {
+    run_mode(BoardEngine::make, Mode::AGENT_INPUT, 100000, budget_ms() / TEST_COUNT);
+}
+
+TEST(TestDifferential, Placements) {
+    run_mode(BoardEngine::make, Mode::PLACEMENT, 200000, budget_ms() / TEST_COUNT);
+}
+
+TEST(TestDifferential, AgentPlacements) {
+    run_mode(BoardEngine::make, Mode::AGENT_PLACEMENT, 300000, budget_ms() / TEST_COUNT);
+}
+
+TEST(TestDifferential, BatchPlacements) {
+    run_mode(BatchEngine::make, Mode::PLACEMENT, 400000, budget_ms() / TEST_COUNT);
+}
+
+TEST(TestDifferential, BatchAgentPlacements) {
+    run_mode(BatchEngine::make, Mode::AGENT_PLACEMENT, 500000, budget_ms() / TEST_COUNT);
+}
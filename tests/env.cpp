@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+
+#include "../bench/weights.hpp"
+#include "../src/ai/genetic/eval.hpp"
+#include "../src/capi/tetris_env.h"
+
+/* Buffers for a number of games, and the struct pointing into them */
+struct EnvBuffers {
+    std::vector<uint16_t> board;
+    std::vector<uint8_t> queue;
+    std::vector<uint8_t> held;
+    std::vector<float> reward;
+    std::vector<uint8_t> done;
+    std::vector<uint8_t> legal;
+    tetris_env_buffers out;
+
+    explicit EnvBuffers (size_t count)
+        : board(count * TETRIS_ENV_HEIGHT)
+        , queue(count * TETRIS_ENV_QUEUE)
+        , held(count)
+        , reward(count)
+        , done(count)
+        , legal(count * TETRIS_ENV_ACTIONS)
+        , out{board.data(), queue.data(), held.data(), reward.data(), done.data(), legal.data()}
+    {}
+};
+
+/**
+ * @param move A move from generate_moves().
+ * @param piece The piece the move is with.
+ * @return The action for the same move.
+ */
+static int32_t to_action (const Move& move, uint8_t piece) {
+    // Anchors left of the wall wrap around to the end of the row above
+    int column = Board::col(move.position);
+    if (column > tetromino_data::get_piece_bounds(piece, move.rotation).right_bound)
+        column -= Board::WIDTH;
+    return move.hold * TETRIS_ENV_ACTIONS / 2 + move.rotation * TETRIS_ENV_COLUMNS + column + 2;
+}
+
+/**
+ * Checks that a game's observation matches a board.
+ * @param board The board.
+ * @param buffers The observations.
+ * @param game Which game.
+ */
+static void check_game (const Board& board, const EnvBuffers& buffers, size_t game) {
+    for (uint8_t y = 0; y < Board::HEIGHT; y++) {
+        uint16_t bits = buffers.board[game * TETRIS_ENV_HEIGHT + y];
+        for (uint8_t x = 0; x < Board::WIDTH; x++)
+            ASSERT_EQ(board.get_square(x, y) > 0, (bool) ((bits >> x) & 1)) << (int) x << ", " << (int) y;
+    }
+    EXPECT_EQ(buffers.queue[game * TETRIS_ENV_QUEUE], board.get_falling_piece());
+    for (uint8_t n = 1; n < TETRIS_ENV_QUEUE; n++)
+        EXPECT_EQ(buffers.queue[game * TETRIS_ENV_QUEUE + n], board.nth_piece(n - 1));
+    EXPECT_EQ(buffers.held[game], board.get_held_piece());
+}
+
+/* Observations follow Boards playing the same moves */
+TEST(TestEnv, MatchesBoard) {
+    constexpr uint32_t GAMES = 5;
+    uint32_t seeds[GAMES] = {4, 8, 15, 16, 23};
+    tetris_env* env = tetris_env_create(GAMES, seeds, 2);
+    ASSERT_NE(env, nullptr);
+    EXPECT_EQ(tetris_env_count(env), GAMES);
+    EXPECT_EQ(tetris_env_version(), (uint32_t) TETRIS_ENV_VERSION);
+
+    std::vector<RandomEngine> engines;
+    std::vector<Board> boards;
+    engines.reserve(GAMES);
+    for (uint32_t seed : seeds) {
+        engines.emplace_back(seed);
+        boards.emplace_back(250, engines.back());
+        Input input = {};
+        boards.back().update(input, 0);
+    }
+
+    EnvBuffers buffers(GAMES);
+    ASSERT_EQ(tetris_env_reset(env, &buffers.out), 0);
+    int32_t actions[GAMES];
+    size_t lines[GAMES];
+    for (int step = 0; step < 200; step++) {
+        for (size_t game = 0; game < GAMES; game++) {
+            Board& board = boards[game];
+            check_game(board, buffers, game);
+
+            uint8_t current = board.get_falling_piece();
+            uint8_t held = board.get_held_piece();
+            if (held == 0)
+                held = board.nth_piece(0);
+            // Every move generate_moves() has for the falling piece is legal
+            uint8_t rotations = current == O_PIECE ? 1 :
+                current == I_PIECE || current == S_PIECE || current == Z_PIECE ? 2 : 4;
+            size_t legal = 0;
+            for (int action = 0; action < rotations * TETRIS_ENV_COLUMNS; action++)
+                legal += buffers.legal[game * TETRIS_ENV_ACTIONS + action];
+            EXPECT_EQ(legal, generate_moves(&board, current, current).size());
+
+            Move move = best_move(&board, TEST_WEIGHTS);
+            actions[game] = to_action(move, move.hold ? held : current);
+            EXPECT_TRUE(buffers.legal[game * TETRIS_ENV_ACTIONS + actions[game]]);
+            lines[game] = board.get_lines_cleared();
+            board.place_piece(move.position, move.rotation, move.hold);
+        }
+        ASSERT_EQ(tetris_env_step(env, actions, &buffers.out), 0);
+        for (size_t game = 0; game < GAMES; game++) {
+            EXPECT_EQ(buffers.reward[game], (float) (boards[game].get_lines_cleared() - lines[game]));
+            EXPECT_EQ(buffers.done[game], boards[game].game_over());
+        }
+    }
+    for (size_t game = 0; game < GAMES; game++)
+        check_game(boards[game], buffers, game);
+    tetris_env_destroy(env);
+}
+
+/* Games that end start over in the same step */
+TEST(TestEnv, DoneStartsNewGame) {
+    uint32_t seeds[3] = {1, 2, 3};
+    tetris_env* env = tetris_env_create(3, seeds, 1);
+    EnvBuffers buffers(3);
+    ASSERT_EQ(tetris_env_reset(env, &buffers.out), 0);
+
+    // Hold, rotation 0 at column 4 fits every piece. Out of range doesn't
+    int32_t actions[3] = {4 + 2, -1, TETRIS_ENV_ACTIONS};
+    ASSERT_EQ(tetris_env_step(env, actions, &buffers.out), 0);
+    EXPECT_EQ(buffers.done[0], 0);
+    EXPECT_EQ(buffers.done[1], 1);
+    EXPECT_EQ(buffers.done[2], 1);
+    for (size_t game = 0; game < 3; game++) {
+        EXPECT_EQ(buffers.reward[game], 0);
+        uint16_t filled = 0;
+        for (uint8_t y = 0; y < TETRIS_ENV_HEIGHT; y++)
+            filled |= buffers.board[game * TETRIS_ENV_HEIGHT + y];
+        EXPECT_EQ(filled != 0, game == 0);
+    }
+
+    // And carry on from there
+    actions[1] = actions[2] = actions[0];
+    ASSERT_EQ(tetris_env_step(env, actions, &buffers.out), 0);
+    EXPECT_EQ(buffers.done[1], 0);
+    EXPECT_EQ(buffers.done[2], 0);
+    EXPECT_EQ(tetris_env_step(env, nullptr, &buffers.out), -1);
+    tetris_env_destroy(env);
+}
+
+/* Splitting the games over threads doesn't change them */
+TEST(TestEnv, SameOnAnyThreadCount) {
+    constexpr uint32_t GAMES = 13;
+    uint32_t seeds[GAMES];
+    for (uint32_t game = 0; game < GAMES; game++)
+        seeds[game] = game * 31;
+    tetris_env* one = tetris_env_create(GAMES, seeds, 1);
+    tetris_env* four = tetris_env_create(GAMES, seeds, 4);
+    EnvBuffers a(GAMES), b(GAMES);
+    ASSERT_EQ(tetris_env_reset(one, &a.out), 0);
+    ASSERT_EQ(tetris_env_reset(four, &b.out), 0);
+
+    // Random legal moves, for games that top out and start over
+    std::mt19937 picker(9);
+    int32_t actions[GAMES];
+    size_t done = 0;
+    for (int step = 0; step < 300; step++) {
+        for (size_t game = 0; game < GAMES; game++) {
+            do {
+                actions[game] = (int32_t) (picker() % TETRIS_ENV_ACTIONS);
+            } while (!a.legal[game * TETRIS_ENV_ACTIONS + actions[game]]);
+        }
+        ASSERT_EQ(tetris_env_step(one, actions, &a.out), 0);
+        ASSERT_EQ(tetris_env_step(four, actions, &b.out), 0);
+        ASSERT_EQ(a.board, b.board);
+        ASSERT_EQ(a.queue, b.queue);
+        ASSERT_EQ(a.held, b.held);
+        ASSERT_EQ(a.reward, b.reward);
+        ASSERT_EQ(a.done, b.done);
+        ASSERT_EQ(a.legal, b.legal);
+        for (uint8_t game_done : a.done)
+            done += game_done;
+    }
+    EXPECT_GT(done, 0u);
+    tetris_env_destroy(one);
+    tetris_env_destroy(four);
+}
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+
+#include "../bench/corpus.hpp"
+#include "../src/ai/genetic/finesse.hpp"
+
+/**
+ * Gives a board every input of a path, without gravity.
+ * @return True if the piece ended up where each step said it would.
+ */
+static bool follow_path (Board& board, const std::vector<PathStep>& path) {
+    uint32_t ticks = board.get_next_fall_ticks() - board.get_fall_rate();
+    for (PathStep step : path) {
+        board.update(step.input, ticks);
+        if (board.get_falling_piece_anchor() != step.anchor ||
+            board.get_falling_piece_rot() != step.rotation)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @return The fewest updates that can turn and shift a piece there if
+ * nothing is in the way, with a rotation and a shift in the same update.
+ */
+static size_t open_path_length (Board& board, const Move& move) {
+    uint8_t piece = board.get_falling_piece();
+    int8_t offset = tetromino_data::get_piece_bounds(piece, 0).left_bound;
+    int8_t target_offset = 
+        tetromino_data::get_piece_bounds(piece, move.rotation).left_bound;
+    // Rotating in place keeps the anchor, so only the anchor has to move
+    int shifts = std::abs(
+        (Board::col(move.position - target_offset) + target_offset) -
+        (Board::col(board.get_falling_piece_anchor() - offset) + offset)
+    );
+    int turns = move.rotation == 3 ? 1 : move.rotation;
+    return std::max(shifts, turns);
+}
+
+/* On an empty board every placement comes from the table, as short as can be */
+TEST(TestFinesse, EmptyBoardTable) {
+    bool tested[8] = {};
+    for (uint32_t seed = 0; std::count(tested + 1, tested + 8, true) < 7; seed++) {
+        RandomEngine random_engine(seed);
+        Board board(250, random_engine);
+        corpus::load(board, corpus::LAYOUTS[0]);
+        uint8_t piece = board.get_falling_piece();
+        if (tested[piece])
+            continue;
+        tested[piece] = true;
+
+        for (const Move& move : generate_moves(&board, piece, piece)) {
+            std::vector<PathStep> table_path, searched_path;
+            ASSERT_TRUE(finesse_path(&board, move, table_path))
+                << "piece " << (int) piece << " rot " << move.rotation;
+            ASSERT_TRUE(search_path(&board, move, searched_path));
+            EXPECT_EQ(table_path.size(), searched_path.size());
+            EXPECT_EQ(table_path.size(), open_path_length(board, move))
+                << "piece " << (int) piece << " rot " << move.rotation
+                << " position " << move.position;
+
+            Board steered = board;
+            ASSERT_TRUE(follow_path(steered, table_path));
+            EXPECT_EQ(steered.get_falling_piece_rot(), move.rotation);
+            EXPECT_EQ(steered.get_ghost(), move.position);
+        }
+    }
+}
+
+/* On stacked boards the paths still lead where the moves go */
+TEST(TestFinesse, StackedBoards) {
+    for (const corpus::Layout& layout : corpus::LAYOUTS) {
+        for (uint32_t seed = 0; seed < 7; seed++) {
+            RandomEngine random_engine(seed);
+            Board board(250, random_engine);
+            corpus::load(board, layout);
+            uint8_t piece = board.get_falling_piece();
+
+            for (const Move& move : generate_moves(&board, piece, piece)) {
+                std::vector<PathStep> path;
+                if (!plan_path(&board, move, path))
+                    continue;
+                Board steered = board;
+                ASSERT_TRUE(follow_path(steered, path)) << layout.name;
+                EXPECT_EQ(steered.get_falling_piece_rot(), move.rotation);
+                EXPECT_EQ(steered.get_ghost(), move.position) << layout.name;
+            }
+        }
+    }
+}
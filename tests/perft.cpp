@@ -0,0 +1,132 @@
+#include <cstring>
+#include <set>
+#include <tuple>
+#include <gtest/gtest.h>
+
+#include "../bench/corpus.hpp"
+#include "../src/ai/genetic/eval.hpp"
+
+/* A starting position for perft and its known leaf counts */
+struct PerftPosition {
+    const char* layout;
+    uint32_t seed;
+    size_t nodes[4]; // Depth 1 to 4
+};
+
+// Counts were generated with the first implementation of perft and must
+// only change together with a deliberate change to move generation.
+static const PerftPosition PERFT_POSITIONS[] =
+{
+    {"empty",  1, {34, 1156,  51731, 1989765}},
+    {"empty",  9, {43, 2074, 106930, 4293962}},
+    {"mid",    3, {26, 1190,  58667, 2323849}},
+    {"high",   4, {51, 2890, 123114, 4313598}},
+    {"danger", 5, {51, 2890, 126734, 5280921}},
+};
+
+static void load_position (Board& board, const PerftPosition& position) {
+    for (const corpus::Layout& layout : corpus::LAYOUTS) {
+        if (std::strcmp(layout.name, position.layout) == 0) {
+            corpus::load(board, layout);
+            return;
+        }
+    }
+    FAIL() << "No layout named " << position.layout;
+}
+
+/* Perft counts up to depth 3 for every position */
+TEST(TestPerft, ShallowCounts) {
+    for (const PerftPosition& position : PERFT_POSITIONS) {
+        RandomEngine random_engine(position.seed);
+        Board board(250, random_engine);
+        load_position(board, position);
+
+        for (uint8_t depth = 1; depth <= 3; depth++) {
+            EXPECT_EQ(perft(&board, depth), position.nodes[depth - 1])
+                << position.layout << " seed " << position.seed
+                << " depth " << (int) depth;
+        }
+    }
+}
+
+/* Depth 4 is slow in debug builds, so only run it on one position */
+TEST(TestPerft, DeepCount) {
+    const PerftPosition& position = PERFT_POSITIONS[2];
+    RandomEngine random_engine(position.seed);
+    Board board(250, random_engine);
+    load_position(board, position);
+
+    EXPECT_EQ(perft(&board, 4), position.nodes[3]);
+}
+
+/* A seed has to produce the same pieces on every platform */
+TEST(TestPerft, SeededQueue) {
+    const uint8_t expected[14] = {3, 7, 6, 2, 4, 5, 1, 7, 3, 4, 5, 6, 2, 1};
+    RandomEngine random_engine(7);
+    Board board(250, random_engine);
+    for (uint8_t n = 0; n < 14; n++)
+        ASSERT_EQ(board.nth_piece(n), expected[n]) << (int) n;
+}
+
+/* Perft plays the placements out on copies and leaves the board alone */
+TEST(TestPerft, LeavesEngineAlone) {
+    RandomEngine random_engine(5);
+    Board board(250, random_engine);
+    Input input = {};
+    board.update(input, 0);
+    // Play up to the end of a bag, so the placements searched shuffle one
+    while (board.get_piece_num() % 7 != 6) {
+        Move move = generate_moves(&board, board.get_falling_piece(), board.get_falling_piece())[0];
+        board.place_piece(move.position, move.rotation, move.hold);
+    }
+
+    RandomEngine before = random_engine;
+    uint8_t queue[14];
+    for (uint8_t n = 0; n < 14; n++)
+        queue[n] = board.nth_piece(n);
+    EXPECT_GT(perft(&board, 2), 0u);
+    EXPECT_EQ(random_engine, before);
+    for (uint8_t n = 0; n < 14; n++)
+        EXPECT_EQ(board.nth_piece(n), queue[n]);
+}
+
+/* generate_moves should never return the same placement twice */
+TEST(TestPerft, NoDuplicateMoves) {
+    for (const PerftPosition& position : PERFT_POSITIONS) {
+        RandomEngine random_engine(position.seed);
+        Board board(250, random_engine);
+        load_position(board, position);
+
+        uint8_t held_piece = board.nth_piece(0);
+        std::vector<Move> move_list = generate_moves(
+            &board, board.get_falling_piece(), held_piece
+        );
+
+        std::set<std::tuple<int, int, bool>> seen;
+        for (const Move& move : move_list) {
+            bool inserted = seen.insert(
+                {move.position, move.rotation, move.hold}
+            ).second;
+            EXPECT_TRUE(inserted)
+                << position.layout << " position " << move.position
+                << " rotation " << move.rotation;
+        }
+    }
+}
+
+/* Once the piece was swapped, holding again isn't a move */
+TEST(TestPerft, NoHoldAfterHold) {
+    RandomEngine random_engine(3);
+    Board board(250, random_engine);
+    Input input = {};
+    board.update(input, 0);
+    input.hold_piece = true;
+    board.update(input, 1);
+    ASSERT_FALSE(board.can_hold());
+
+    uint8_t current_piece = board.get_falling_piece();
+    std::vector<Move> move_list = generate_moves(&board, current_piece, board.get_held_piece());
+    EXPECT_EQ(move_list.size(), generate_moves(&board, current_piece, current_piece).size());
+    for (const Move& move : move_list)
+        EXPECT_FALSE(move.hold);
+}
@@ -0,0 +1,271 @@
+#include <random>
+#include <gtest/gtest.h>
+
+#include "../src/util/png.hpp"
+
+namespace
+{
+    uint32_t read_u32 (const std::vector<uint8_t>& data, size_t pos) {
+        return (data[pos] << 24) | (data[pos + 1] << 16) |
+            (data[pos + 2] << 8) | data[pos + 3];
+    }
+
+    // The deflate length and distance codes, straight from RFC 1951
+    constexpr uint16_t LENGTH_BASE[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    };
+    constexpr uint8_t LENGTH_EXTRA[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    constexpr uint16_t DISTANCE_BASE[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+        8193, 12289, 16385, 24577
+    };
+    constexpr uint8_t DISTANCE_EXTRA[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+
+    /*
+     * Just enough of an inflater to read back what encode_rgba() writes:
+     * stored blocks and blocks with the fixed Huffman codes.
+     */
+    class Inflater {
+    public:
+        explicit Inflater (const std::vector<uint8_t>& data) : m_data(data) {}
+
+        /**
+         * @param out The inflated bytes are added to the end.
+         * @return False if the stream is cut short or uses anything else.
+         */
+        bool inflate (std::vector<uint8_t>& out) {
+            bool last = false;
+            while (!last && !m_failed) {
+                last = bits(1) == 1;
+                uint32_t type = bits(2);
+                if (type == 0)
+                    stored_block(out);
+                else if (type == 1)
+                    fixed_block(out);
+                else
+                    return false;
+            }
+            return !m_failed;
+        }
+
+        /**
+         * @return Where the byte after the stream is.
+         */
+        size_t end () const {
+            return (m_bit + 7) / 8;
+        }
+
+    private:
+        /* Values like extra bits come lowest bit first */
+        uint32_t bits (uint8_t count) {
+            uint32_t value = 0;
+            for (uint8_t i = 0; i < count; i++, m_bit++) {
+                if (m_bit / 8 >= m_data.size()) {
+                    m_failed = true;
+                    return 0;
+                }
+                value |= ((m_data[m_bit / 8] >> (m_bit % 8)) & 1) << i;
+            }
+            return value;
+        }
+
+        /* Huffman codes come highest bit first */
+        uint32_t code (uint8_t count, uint32_t prefix = 0) {
+            for (uint8_t i = 0; i < count; i++)
+                prefix = (prefix << 1) | bits(1);
+            return prefix;
+        }
+
+        uint16_t literal () {
+            uint32_t value = code(7);
+            if (value < 0x18)
+                return 256 + value;
+            value = code(1, value);
+            if (value >= 0x30 && value < 0xC0)
+                return value - 0x30;
+            if (value >= 0xC0 && value < 0xC8)
+                return 280 + value - 0xC0;
+            return 144 + code(1, value) - 0x190;
+        }
+
+        void stored_block (std::vector<uint8_t>& out) {
+            m_bit = end() * 8;
+            uint32_t length = bits(16);
+            uint32_t inverse = bits(16);
+            if (m_failed || (length ^ 0xFFFF) != inverse || end() + length > m_data.size()) {
+                m_failed = true;
+                return;
+            }
+            out.insert(out.end(), m_data.begin() + end(), m_data.begin() + end() + length);
+            m_bit += length * 8;
+        }
+
+        void fixed_block (std::vector<uint8_t>& out) {
+            while (!m_failed) {
+                uint16_t symbol = literal();
+                if (symbol < 256) {
+                    out.push_back((uint8_t) symbol);
+                    continue;
+                }
+                if (symbol == 256)
+                    return;
+                if (symbol > 285) {
+                    m_failed = true;
+                    return;
+                }
+                size_t length = LENGTH_BASE[symbol - 257] + bits(LENGTH_EXTRA[symbol - 257]);
+                uint32_t distance_code = code(5);
+                if (distance_code >= 30) {
+                    m_failed = true;
+                    return;
+                }
+                size_t distance = DISTANCE_BASE[distance_code] +
+                    bits(DISTANCE_EXTRA[distance_code]);
+                if (distance > out.size()) {
+                    m_failed = true;
+                    return;
+                }
+                for (size_t i = 0; i < length; i++)
+                    out.push_back(out[out.size() - distance]);
+            }
+        }
+
+        const std::vector<uint8_t>& m_data;
+        size_t m_bit = 0;
+        bool m_failed = false;
+    };
+
+    /**
+     * Decodes a file from encode_rgba() back into its pixels.
+     * @param file The PNG file.
+     * @param rgba Set to the pixels.
+     * @return False if any part of the file is wrong.
+     */
+    bool decode_rgba (const std::vector<uint8_t>& file, std::vector<uint8_t>& rgba) {
+        uint32_t width = 0, height = 0;
+        std::vector<uint8_t> stream;
+        for (size_t pos = 8; pos + 12 <= file.size();) {
+            uint32_t length = read_u32(file, pos);
+            std::string type(file.begin() + pos + 4, file.begin() + pos + 8);
+            if (type == "IHDR") {
+                width = read_u32(file, pos + 8);
+                height = read_u32(file, pos + 12);
+            } else if (type == "IDAT") {
+                stream.insert(stream.end(), file.begin() + pos + 8, file.begin() + pos + 8 + length);
+            }
+            pos += 12 + length;
+        }
+
+        // zlib header, deflate data, then the Adler-32 of what was inflated
+        if (stream.size() < 6 || (stream[0] & 0x0F) != 8 || (stream[0] << 8 | stream[1]) % 31 != 0)
+            return false;
+        std::vector<uint8_t> deflated(stream.begin() + 2, stream.end());
+        Inflater inflater(deflated);
+        std::vector<uint8_t> raw;
+        if (!inflater.inflate(raw) || inflater.end() + 4 != deflated.size())
+            return false;
+        uint32_t a = 1, b = 0;
+        for (uint8_t byte : raw) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        if (read_u32(deflated, inflater.end()) != (b << 16 | a))
+            return false;
+
+        // Every row starts with its filter type
+        const size_t stride = (size_t) width * 4;
+        if (raw.size() != height * (stride + 1))
+            return false;
+        rgba.clear();
+        for (size_t y = 0; y < height; y++) {
+            if (raw[y * (stride + 1)] != 0)
+                return false;
+            auto row = raw.begin() + (std::ptrdiff_t) (y * (stride + 1) + 1);
+            rgba.insert(rgba.end(), row, row + (std::ptrdiff_t) stride);
+        }
+        return true;
+    }
+}
+
+/* The standard CRC-32 check values */
+TEST(TestPng, Crc32) {
+    const char* check = "123456789";
+    EXPECT_EQ(png::crc32((const uint8_t*) check, 9), 0xCBF43926u);
+    EXPECT_EQ(png::crc32((const uint8_t*) "IEND", 4), 0xAE426082u);
+    // Checksums can be continued
+    uint32_t crc = png::crc32((const uint8_t*) check, 4);
+    EXPECT_EQ(png::crc32((const uint8_t*) check + 4, 5, crc), 0xCBF43926u);
+}
+
+/* Every chunk is well formed and flat images get a lot smaller */
+TEST(TestPng, Structure) {
+    const uint32_t width = 64, height = 48;
+    std::vector<uint8_t> rgba(width * height * 4);
+    for (size_t i = 0; i < rgba.size(); i += 4) {
+        rgba[i] = 18;
+        rgba[i + 1] = (i / 4 / width) < height / 2 ? 18 : 200;
+        rgba[i + 2] = 18;
+        rgba[i + 3] = 255;
+    }
+    std::vector<uint8_t> file = png::encode_rgba(rgba.data(), width, height);
+
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    ASSERT_GT(file.size(), 8);
+    ASSERT_TRUE(std::equal(signature, signature + 8, file.begin()));
+
+    std::vector<std::string> types;
+    size_t pos = 8;
+    while (pos + 12 <= file.size()) {
+        uint32_t length = read_u32(file, pos);
+        ASSERT_LE(pos + 12 + length, file.size());
+        types.emplace_back(file.begin() + pos + 4, file.begin() + pos + 8);
+        EXPECT_EQ(
+            png::crc32(&file[pos + 4], length + 4), read_u32(file, pos + 8 + length)
+        ) << types.back();
+
+        if (types.back() == "IHDR") {
+            EXPECT_EQ(read_u32(file, pos + 8), width);
+            EXPECT_EQ(read_u32(file, pos + 12), height);
+            EXPECT_EQ(file[pos + 16], 8); // Bits per channel
+            EXPECT_EQ(file[pos + 17], 6); // RGBA
+        }
+        pos += 12 + length;
+    }
+    EXPECT_EQ(pos, file.size());
+    EXPECT_EQ(types, std::vector<std::string>({"IHDR", "IDAT", "IEND"}));
+    EXPECT_LT(file.size(), rgba.size() / 20);
+}
+
+/* Inflating the image data gives back exactly the pixels encoded */
+TEST(TestPng, RoundTrip) {
+    const uint32_t width = 97, height = 61;
+    std::mt19937 random_engine(5);
+    std::vector<uint8_t> rgba(width * height * 4);
+    for (size_t i = 0; i < rgba.size(); i++) {
+        size_t x = i / 4 % width, y = i / 4 / width;
+        // Flat areas for long matches, noise for literals, and stripes
+        if (y < height / 3)
+            rgba[i] = i % 4 == 3 ? 255 : 40;
+        else if (y < 2 * height / 3)
+            rgba[i] = (uint8_t) random_engine();
+        else
+            rgba[i] = (uint8_t) (x / 3 * 17 + i % 4);
+    }
+
+    std::vector<uint8_t> decoded;
+    ASSERT_TRUE(decode_rgba(png::encode_rgba(rgba.data(), width, height), decoded));
+    EXPECT_EQ(decoded, rgba);
+
+    // Images too small to have any matches
+    std::vector<uint8_t> pixel = {1, 2, 3, 4};
+    ASSERT_TRUE(decode_rgba(png::encode_rgba(pixel.data(), 1, 1), decoded));
+    EXPECT_EQ(decoded, pixel);
+}
@@ -0,0 +1,45 @@
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "../src/ai/genetic/population.hpp"
+
+/* Weights come back exactly as they were written */
+TEST(TestPopulation, RoundTrip) {
+    std::string path = ::testing::TempDir() + "population_round_trip.txt";
+    std::vector<Weights> population = {
+        {-20.0, -10.0, 50.0, -1.0, -20.0, -10.0},
+        {0.1, -1.0 / 3.0, 1e-9, 12345.678, -0.0, 2.5},
+    };
+    ASSERT_TRUE(save_population(path, population));
+
+    std::vector<Weights> loaded;
+    ASSERT_TRUE(load_population(path, loaded));
+    ASSERT_EQ(loaded.size(), population.size());
+    for (size_t i = 0; i < population.size(); i++) {
+        EXPECT_EQ(loaded[i].holes_count, population[i].holes_count);
+        EXPECT_EQ(loaded[i].aggregate_height, population[i].aggregate_height);
+        EXPECT_EQ(loaded[i].complete_lines, population[i].complete_lines);
+        EXPECT_EQ(loaded[i].height_std_dev, population[i].height_std_dev);
+        EXPECT_EQ(loaded[i].highest_point, population[i].highest_point);
+        EXPECT_EQ(loaded[i].blocks_over_holes, population[i].blocks_over_holes);
+    }
+}
+
+/* Comments and blank lines are skipped, short or long lines are errors */
+TEST(TestPopulation, Parsing) {
+    std::string path = ::testing::TempDir() + "population_parsing.txt";
+    std::vector<Weights> loaded;
+
+    std::ofstream(path) << "# comment\n\n  1 2 3 4 5 6\r\n";
+    ASSERT_TRUE(load_population(path, loaded));
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(loaded[0].blocks_over_holes, 6.0);
+
+    std::ofstream(path) << "1 2 3 4 5\n";
+    EXPECT_FALSE(load_population(path, loaded));
+
+    std::ofstream(path) << "1 2 3 4 5 6 7\n";
+    EXPECT_FALSE(load_population(path, loaded));
+
+    EXPECT_FALSE(load_population(path + ".missing", loaded));
+}
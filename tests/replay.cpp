@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <gtest/gtest.h>
+
+#include "../bench/weights.hpp"
+#include "../src/ai/genetic/Agent.hpp"
+#include "../src/app/Replay.hpp"
+
+static bool same_squares (const Board& a, const Board& b) {
+    for (uint16_t i = 0; i < Board::TOTAL_SIZE; i++) {
+        if (a.get_square(i) != b.get_square(i))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Records an agent playing a game the same way export_game() does.
+ * @param path Where to write the replay.
+ * @param board Set to the board at the end of the game.
+ */
+static void record_game (
+    const std::string& path, uint32_t seed, size_t pieces,
+    RandomEngine& random_engine, std::unique_ptr<Board>& board
+) {
+    random_engine.seed(seed);
+    board = std::make_unique<Board>(250, random_engine);
+    Agent agent(true, TEST_WEIGHTS);
+
+    ReplayRecorder recorder;
+    ASSERT_TRUE(recorder.start(path, {
+        .seed = seed,
+        .fall_rate = 250,
+        .rules_version = Board::RULES_VERSION,
+        .has_weights = true,
+        .weights = TEST_WEIGHTS
+    }));
+    // Spawn the first piece before the agent looks at the board
+    Input spawn = {};
+    recorder.update(*board, spawn, 0);
+    for (uint32_t ticks = 1; !board->game_over() && board->get_pieces_placed() < pieces; ticks++) {
+        Input input = {};
+        if (ticks % 20 == 0)
+            input = agent.gen_input(board.get());
+        recorder.update(*board, input, ticks);
+    }
+    ASSERT_TRUE(recorder.finish());
+}
+
+static std::string temp_path (const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+/* Playing a recording back ends on exactly the same board */
+TEST(TestReplay, PlaybackMatchesGame) {
+    std::string path = temp_path("test_replay_playback.trp");
+    RandomEngine random_engine;
+    std::unique_ptr<Board> played;
+    record_game(path, 1234, 200, random_engine, played);
+
+    ReplayPlayer player;
+    ASSERT_TRUE(player.load(path));
+    EXPECT_EQ(player.get_header().seed, 1234u);
+    EXPECT_TRUE(player.get_header().has_weights);
+    EXPECT_EQ(player.get_header().weights.holes_count, TEST_WEIGHTS.holes_count);
+    while (player.step()) {}
+
+    Board& replayed = player.get_board();
+    EXPECT_TRUE(player.finished());
+    EXPECT_EQ(replayed.get_pieces_placed(), played->get_pieces_placed());
+    EXPECT_EQ(replayed.get_score(), played->get_score());
+    EXPECT_EQ(replayed.get_falling_piece(), played->get_falling_piece());
+    EXPECT_TRUE(same_squares(replayed, *played));
+    std::filesystem::remove(path);
+}
+
+/* Seeking either way lands on the same board as playing straight there */
+TEST(TestReplay, SeekMatchesPlayback) {
+    std::string path = temp_path("test_replay_seek.trp");
+    RandomEngine random_engine;
+    std::unique_ptr<Board> played;
+    record_game(path, 99, 120, random_engine, played);
+
+    ReplayPlayer player, reference;
+    ASSERT_TRUE(player.load(path));
+    ASSERT_TRUE(reference.load(path));
+
+    for (size_t pieces : {80, 30, 100, 100, 0, 60}) {
+        player.seek_piece(pieces);
+        reference.restart();
+        reference.seek_piece(pieces);
+        // The game might have ended before getting that far
+        EXPECT_EQ(
+            player.get_board().get_pieces_placed(),
+            std::min(pieces, played->get_pieces_placed())
+        );
+        EXPECT_EQ(player.get_next_ticks(), reference.get_next_ticks());
+        EXPECT_TRUE(same_squares(player.get_board(), reference.get_board()));
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(TestReplay, PackInput) {
+    // One bit for each of the 7 inputs
+    for (uint8_t bits = 0; bits < 128; bits++)
+        EXPECT_EQ(pack_input(unpack_input(bits)), bits);
+    EXPECT_EQ(pack_input({}), 0);
+    Input hold = {};
+    hold.hold_piece = true;
+    EXPECT_TRUE(unpack_input(pack_input(hold)).hold_piece);
+}
+
+/* Replays from other rules or that aren't replays at all aren't played */
+TEST(TestReplay, RejectsForeignFiles) {
+    std::string path = temp_path("test_replay_reject.trp");
+    RandomEngine random_engine;
+    std::unique_ptr<Board> played;
+    record_game(path, 5, 10, random_engine, played);
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data(
+        (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()
+    );
+    file.close();
+    std::filesystem::remove(path);
+
+    ReplayPlayer player;
+    EXPECT_TRUE(player.load(data));
+
+    std::vector<uint8_t> other_rules = data;
+    other_rules[6]++;
+    EXPECT_FALSE(player.load(other_rules));
+
+    std::vector<uint8_t> not_replay = data;
+    not_replay[0] = 'X';
+    EXPECT_FALSE(player.load(not_replay));
+
+    EXPECT_FALSE(player.load(std::vector<uint8_t>(data.begin(), data.begin() + 8)));
+}
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../bench/corpus.hpp"
+#include "../bench/weights.hpp"
+#include "../src/ai/genetic/Agent.hpp"
+#include "../src/ai/genetic/RolloutEvaluator.hpp"
+#include "../src/game/BoardSnapshot.hpp"
+
+/**
+ * @param rollouts Most rollouts per candidate.
+ * @return Settings short enough for tests.
+ */
+static RolloutSettings test_settings (size_t rollouts) {
+    RolloutSettings settings = RolloutEvaluator::DEFAULT_SETTINGS;
+    settings.rollouts = rollouts;
+    settings.batch = 4;
+    settings.pieces = 8;
+    settings.seed = 11;
+    return settings;
+}
+
+/* The move is one of the ranked candidates, within the rollout budget */
+TEST(TestRollouts, PicksRankedCandidate) {
+    RandomEngine random_engine(2);
+    Board board(250, random_engine);
+    corpus::load(board, corpus::LAYOUTS[2]);
+
+    RolloutSettings settings = test_settings(16);
+    RolloutEvaluator evaluator(TEST_WEIGHTS, settings, 2);
+    RolloutResult result = evaluator.evaluate(&board);
+    std::vector<ScoredMove> ranked = rank_moves(&board, TEST_WEIGHTS, settings.candidates);
+
+    EXPECT_EQ(result.candidates, ranked.size());
+    EXPECT_GE(result.rollouts, 2 * settings.batch);
+    EXPECT_LE(result.rollouts, settings.candidates * settings.rollouts);
+    EXPECT_GE(result.survival, 0.0);
+    EXPECT_LE(result.survival, 1.0);
+    bool found = false;
+    for (const ScoredMove& scored : ranked) {
+        found |= scored.move.position == result.move.position &&
+            scored.move.rotation == result.move.rotation &&
+            scored.move.hold == result.move.hold;
+    }
+    EXPECT_TRUE(found);
+
+    // The best ranked move is the one best_move() picks
+    Move move = best_move(&board, TEST_WEIGHTS);
+    EXPECT_EQ(ranked[0].move.position, move.position);
+    EXPECT_EQ(ranked[0].move.rotation, move.rotation);
+}
+
+/* Rollouts are seeded by their number, not by the thread that runs them */
+TEST(TestRollouts, SameOnAnyThreadCount) {
+    for (const corpus::Layout& layout : corpus::LAYOUTS) {
+        RandomEngine random_engine(5);
+        Board board(250, random_engine);
+        corpus::load(board, layout);
+
+        RolloutEvaluator one(TEST_WEIGHTS, test_settings(12), 1);
+        RolloutEvaluator three(TEST_WEIGHTS, test_settings(12), 3);
+        for (int i = 0; i < 2; i++) {
+            RolloutResult a = one.evaluate(&board);
+            RolloutResult b = three.evaluate(&board);
+            EXPECT_EQ(a.move.position, b.move.position) << layout.name;
+            EXPECT_EQ(a.move.rotation, b.move.rotation) << layout.name;
+            EXPECT_EQ(a.rollouts, b.rollouts) << layout.name;
+            EXPECT_EQ(a.score, b.score) << layout.name;
+        }
+    }
+}
+
+/* With a single candidate there's nothing to play out */
+TEST(TestRollouts, SingleCandidate) {
+    RandomEngine random_engine(2);
+    Board board(250, random_engine);
+    corpus::load(board, corpus::LAYOUTS[0]);
+
+    RolloutSettings settings = test_settings(16);
+    settings.candidates = 1;
+    RolloutEvaluator evaluator(TEST_WEIGHTS, settings, 1);
+    RolloutResult result = evaluator.evaluate(&board);
+    Move move = best_move(&board, TEST_WEIGHTS);
+    EXPECT_EQ(result.rollouts, 0u);
+    EXPECT_EQ(result.move.position, move.position);
+    EXPECT_EQ(result.move.rotation, move.rotation);
+}
+
+/* A cancelled evaluation plays nothing out and lets go of the evaluator */
+TEST(TestRollouts, Cancelled) {
+    RandomEngine random_engine(2);
+    Board board(250, random_engine);
+    corpus::load(board, corpus::LAYOUTS[2]);
+
+    RolloutEvaluator evaluator(TEST_WEIGHTS, test_settings(16), 2);
+    std::atomic<bool> cancel(true);
+    RolloutResult result = evaluator.evaluate(&board, &cancel);
+    Move move = best_move(&board, TEST_WEIGHTS);
+    EXPECT_EQ(result.rollouts, 0u);
+    EXPECT_EQ(result.move.position, move.position);
+    EXPECT_EQ(result.move.rotation, move.rotation);
+
+    // The next evaluation doesn't wait on it
+    EXPECT_GT(evaluator.evaluate(&board).rollouts, 0u);
+}
+
+/* Copies with different seeds keep the visible queue and the 7-bag rule, but
+ * play different pieces after it, wherever the game is in its bags */
+TEST(TestRollouts, SamplesUnseenPieces) {
+    constexpr uint8_t VISIBLE = BoardSnapshot::QUEUE_SIZE;
+    RandomEngine random_engine(4);
+    Board board(250, random_engine);
+    Input input = {};
+    board.update(input, 0);
+
+    for (int placed = 0; placed < 14; placed++) {
+        RandomEngine first_engine(1), second_engine(2);
+        Board first(board, first_engine), second(board, second_engine);
+        first.shuffle_unseen(VISIBLE);
+        second.shuffle_unseen(VISIBLE);
+
+        const uint8_t remaining = 7 - board.get_piece_num() % 7;
+        bool differ = false;
+        for (uint8_t n = 0; n < remaining + 7; n++) {
+            if (n < VISIBLE) {
+                EXPECT_EQ(first.nth_piece(n), board.nth_piece(n));
+                EXPECT_EQ(second.nth_piece(n), board.nth_piece(n));
+            } else {
+                differ |= first.nth_piece(n) != second.nth_piece(n);
+            }
+        }
+        EXPECT_TRUE(differ) << placed << " pieces placed";
+
+        // The rest of the current bag has the same pieces, and the next bag
+        // has all seven
+        for (const Board* copy : {&first, &second}) {
+            std::vector<uint8_t> rest, expected_rest, next;
+            for (uint8_t n = 0; n < remaining; n++) {
+                rest.push_back(copy->nth_piece(n));
+                expected_rest.push_back(board.nth_piece(n));
+            }
+            for (uint8_t n = remaining; n < remaining + 7; n++)
+                next.push_back(copy->nth_piece(n));
+            std::sort(rest.begin(), rest.end());
+            std::sort(expected_rest.begin(), expected_rest.end());
+            std::sort(next.begin(), next.end());
+            EXPECT_EQ(rest, expected_rest);
+            EXPECT_EQ(next, std::vector<uint8_t>({1, 2, 3, 4, 5, 6, 7}));
+        }
+
+        Move move = best_move(&board, TEST_WEIGHTS);
+        board.place_piece(move.position, move.rotation, move.hold);
+    }
+}
+
+/* An agent that decides with rollouts plays a whole game */
+TEST(TestRollouts, Agent) {
+    RandomEngine random_engine(3);
+    Board board(250, random_engine);
+    Agent agent(true, TEST_WEIGHTS);
+    agent.set_rollouts(std::make_shared<RolloutEvaluator>(TEST_WEIGHTS, test_settings(4), 2));
+
+    Input input = {};
+    board.update(input, 0);
+    uint32_t ticks = 0;
+    while (!board.game_over() && board.get_pieces_placed() < 20) {
+        input = agent.gen_input(&board);
+        board.update(input, ticks += 20);
+    }
+    EXPECT_EQ(board.get_pieces_placed(), 20u);
+    EXPECT_EQ(agent.get_decision_stats().last_depth, test_settings(4).pieces + 1);
+}
@@ -0,0 +1,138 @@
+#include <chrono>
+#include <gtest/gtest.h>
+
+#include "../bench/corpus.hpp"
+#include "../bench/weights.hpp"
+#include "../src/ai/genetic/Agent.hpp"
+#include "../src/ai/genetic/eval.hpp"
+
+/* Starts a game and plays a few pieces so the board isn't empty */
+static void set_up_board (Board& board) {
+    Input input = {};
+    board.update(input, 0);
+    for (int i = 0; i < 6; i++) {
+        Move move = best_move(&board, TEST_WEIGHTS);
+        board.place_piece(move.position, move.rotation, move.hold);
+    }
+}
+
+/* Even without any time left there's a move, the same one best_move() picks */
+TEST(TestAnytimeSearch, DepthOneWithoutTime) {
+    RandomEngine random_engine(2);
+    Board board(250, random_engine);
+    set_up_board(board);
+
+    SearchResult result = anytime_search(
+        &board, TEST_WEIGHTS, 4, std::chrono::steady_clock::now()
+    );
+    Move move = best_move(&board, TEST_WEIGHTS);
+    EXPECT_EQ(result.depth, 1);
+    EXPECT_EQ(result.move.position, move.position);
+    EXPECT_EQ(result.move.rotation, move.rotation);
+    EXPECT_EQ(result.move.hold, move.hold);
+    EXPECT_EQ(result.nodes, result.candidates);
+}
+
+/* With plenty of time the search finishes at its max depth */
+TEST(TestAnytimeSearch, ReachesMaxDepth) {
+    RandomEngine random_engine(2);
+    Board board(250, random_engine);
+    set_up_board(board);
+
+    SearchResult result = anytime_search(
+        &board, TEST_WEIGHTS, 2,
+        std::chrono::steady_clock::now() + std::chrono::hours(1)
+    );
+    EXPECT_EQ(result.depth, 2);
+    EXPECT_GT(result.nodes, result.candidates * result.candidates / 2);
+}
+
+/* A deep search stops soon after its deadline, keeping a finished depth */
+TEST(TestAnytimeSearch, StopsAtDeadline) {
+    RandomEngine random_engine(2);
+    Board board(250, random_engine);
+    set_up_board(board);
+
+    auto start = std::chrono::steady_clock::now();
+    SearchResult result = anytime_search(
+        &board, TEST_WEIGHTS, 7, start + std::chrono::milliseconds(5)
+    );
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(result.depth, 1);
+    EXPECT_LT(result.depth, 7);
+    EXPECT_LT(elapsed, std::chrono::milliseconds(200));
+}
+
+/* Searching places pieces on copies, which mustn't shuffle the real bags */
+TEST(TestAnytimeSearch, KeepsRandomEngine) {
+    RandomEngine random_engine(2);
+    Board board(250, random_engine);
+    set_up_board(board);
+
+    RandomEngine before = random_engine;
+    anytime_search(
+        &board, TEST_WEIGHTS, 3,
+        std::chrono::steady_clock::now() + std::chrono::hours(1)
+    );
+    EXPECT_TRUE(random_engine == before);
+}
+
+/* Danger grows with the stack and its holes */
+TEST(TestAdaptiveDepth, Danger) {
+    double last = -1;
+    for (const corpus::Layout& layout : corpus::LAYOUTS) {
+        RandomEngine random_engine(2);
+        Board board(250, random_engine);
+        corpus::load(board, layout);
+        double danger = Agent::danger(&board);
+        EXPECT_GE(danger, last) << layout.name;
+        last = danger;
+    }
+    EXPECT_EQ(last, 1.0);
+
+    RandomEngine random_engine(2);
+    Board board(250, random_engine);
+    corpus::load(board, corpus::LAYOUTS[0]);
+    EXPECT_EQ(Agent::danger(&board), 0.0);
+}
+
+/* With a budget, the depth follows the danger */
+TEST(TestAdaptiveDepth, FollowsDanger) {
+    for (size_t layout : {size_t(0), corpus::LAYOUT_COUNT - 1}) {
+        RandomEngine random_engine(2);
+        Board board(250, random_engine);
+        corpus::load(board, corpus::LAYOUTS[layout]);
+
+        Agent agent(true, TEST_WEIGHTS, false, 3);
+        agent.set_compute_budget(100000000);
+        uint64_t budget_ns;
+        uint8_t depth = agent.choose_depth(&board, agent.credit_bank(0), budget_ns);
+        EXPECT_EQ(depth, layout == 0 ? 1 : 3) << corpus::LAYOUTS[layout].name;
+        EXPECT_LE(budget_ns, 100000000u);
+
+        // How deep the search gets in that time depends on the machine
+        agent.gen_input(&board);
+        DecisionStats stats = agent.get_decision_stats();
+        EXPECT_GE(stats.last_depth, 1);
+        EXPECT_LE(stats.last_depth, depth);
+        EXPECT_GT(stats.total_search_ns, 0u);
+    }
+}
+
+/* Once the time bank is spent, only the current piece is searched */
+TEST(TestAdaptiveDepth, SpentBank) {
+    RandomEngine random_engine(2);
+    Board board(250, random_engine);
+    corpus::load(board, corpus::LAYOUTS[corpus::LAYOUT_COUNT - 1]);
+
+    Agent agent(true, TEST_WEIGHTS, false, 4);
+    agent.set_compute_budget(1);
+    Input input = {};
+    uint32_t ticks = 0;
+    while (!board.game_over() && board.get_pieces_placed() < 10) {
+        input = agent.gen_input(&board);
+        EXPECT_EQ(agent.get_decision_stats().last_depth, 1);
+        board.update(input, ticks += 20);
+    }
+    EXPECT_GE(agent.get_decision_stats().decisions, 1u);
+}
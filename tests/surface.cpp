@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include "../bench/corpus.hpp"
+#include "../bench/weights.hpp"
+#include "../src/ai/genetic/surface.hpp"
+
+/**
+ * Checks every candidate on a board against analyze_board().
+ * @param board The board.
+ * @param fallbacks Increased by how many candidates analyze_surface() had to
+ * leave to analyze_board().
+ * @return How many candidates there were.
+ */
+static size_t check_candidates (Board& board, size_t& fallbacks) {
+    uint8_t piece = board.get_falling_piece();
+    uint8_t held = board.get_held_piece();
+    if (held == 0)
+        held = board.nth_piece(0);
+
+    Surface surface = read_surface(&board);
+    std::vector<Move> moves = generate_moves(&board, piece, held);
+    for (const Move& move : moves) {
+        int move_piece = move.hold ? held : piece;
+        BoardAnalysis expected = analyze_board(
+            &board, move.position, move_piece, move.rotation
+        );
+        BoardAnalysis analysis;
+        if (!analyze_surface(surface, move.position, move_piece, move.rotation, analysis)) {
+            fallbacks++;
+            continue;
+        }
+        EXPECT_EQ(analysis.holes_count, expected.holes_count);
+        EXPECT_EQ(analysis.aggregate_height, expected.aggregate_height);
+        EXPECT_EQ(analysis.complete_lines, expected.complete_lines);
+        EXPECT_DOUBLE_EQ(analysis.height_std_dev, expected.height_std_dev);
+        EXPECT_EQ(analysis.highest_point, expected.highest_point);
+        EXPECT_EQ(analysis.blocks_over_holes, expected.blocks_over_holes);
+    }
+    return moves.size();
+}
+
+/* The table agrees with dropping pieces by hand */
+TEST(TestSurface, Fits) {
+    // A flat floor
+    uint8_t flat[4] = {3, 3, 3, 3};
+    SurfaceFit fit = surface_fit(I_PIECE, 0, flat);
+    EXPECT_EQ(fit.landing, 0);
+    EXPECT_EQ(fit.holes, 0);
+    EXPECT_EQ(fit.height_delta, 4);
+    EXPECT_EQ(fit.bumpiness_delta, 0);
+
+    // A T pointing down fits a notch
+    uint8_t notch[3] = {2, 1, 2};
+    fit = surface_fit(T_PIECE, 2, notch);
+    EXPECT_EQ(fit.landing, -1);
+    EXPECT_EQ(fit.holes, 0);
+
+    // A flat T on a step leaves two holes under its low side
+    uint8_t step[3] = {2, 2, 3};
+    fit = surface_fit(T_PIECE, 0, step);
+    EXPECT_EQ(fit.landing, 1);
+    EXPECT_EQ(fit.holes, 2);
+    EXPECT_EQ(fit.height_delta, 6);
+    EXPECT_EQ(fit.bumpiness_delta, 1);
+
+    // Past the clamp, worked out the same way
+    uint8_t cliff[2] = {0, 12};
+    fit = surface_fit(O_PIECE, 0, cliff);
+    EXPECT_EQ(fit.landing, 12);
+    EXPECT_EQ(fit.holes, 12);
+    EXPECT_EQ(fit.bumpiness_delta, -12);
+}
+
+/* Same heuristics as analyze_board() on every corpus board */
+TEST(TestSurface, MatchesCorpus) {
+    for (const corpus::Layout& layout : corpus::LAYOUTS) {
+        RandomEngine random_engine(4);
+        Board board(250, random_engine);
+        corpus::load(board, layout);
+        size_t fallbacks = 0;
+        check_candidates(board, fallbacks);
+    }
+}
+
+/* And on every board of some games, with few falling back. Half of them
+ * are played randomly, for boards full of holes and cliffs */
+TEST(TestSurface, MatchesGames) {
+    size_t candidates = 0, fallbacks = 0;
+    for (uint32_t seed = 0; seed < 6; seed++) {
+        RandomEngine random_engine(seed);
+        Board board(250, random_engine);
+        Input input = {};
+        board.update(input, 0);
+        for (int pieces = 0; pieces < 300 && !board.game_over(); pieces++) {
+            candidates += check_candidates(board, fallbacks);
+            Move move = best_move(&board, TEST_WEIGHTS);
+            if (seed % 2 == 1) {
+                uint8_t held = board.get_held_piece();
+                std::vector<Move> moves = generate_moves(
+                    &board, board.get_falling_piece(),
+                    held == 0 ? board.nth_piece(0) : held
+                );
+                move = moves[random_engine() % moves.size()];
+            }
+            board.place_piece(move.position, move.rotation, move.hold);
+        }
+    }
+    EXPECT_GT(candidates, 1000u);
+    EXPECT_LT(fallbacks * 100, candidates);
+}
@@ -1,11 +1,12 @@
 #include <cmath>
+#include <cstring>
 #include <gtest/gtest.h>
 
 #include "../src/ai/genetic/Agent.hpp"
 
 /* This test verifies that Agent.gen_input() moves the piece correctly */
 TEST(TestGenInput, BasicAssertions) {
-    std::default_random_engine random_engine(0);
+    RandomEngine random_engine(0);
     Board board(250, random_engine);
     // weights shouldn't matter as long as they're consistent
     Weights weights = {-20.0, -10.0, 50.0, -1.0, -20.0, -10.0};
@@ -60,3 +61,48 @@ TEST(TestGenInput, BasicAssertions) {
         board.update(input, 1);
     }
 }
+
+/* Thinking ahead should only change when moves are searched, never which */
+TEST(TestGenInput, ThinkAheadSameMoves) {
+    RandomEngine random_engine(3), ahead_random_engine(3);
+    Board board(250, random_engine);
+    Board ahead_board(250, ahead_random_engine);
+    Weights weights = {-20.0, -10.0, 50.0, -1.0, -20.0, -10.0};
+    Agent agent(true, weights);
+    Agent ahead_agent(true, weights, true);
+
+    Input input = {};
+    board.update(input, 0);
+    ahead_board.update(input, 0);
+    for (uint32_t ticks = 1; ticks < 5000 && !board.game_over(); ticks++) {
+        input = agent.gen_input(&board);
+        Input ahead_input = ahead_agent.gen_input(&ahead_board);
+        ASSERT_EQ(memcmp(&input, &ahead_input, sizeof(Input)), 0) << ticks;
+        board.update(input, ticks);
+        ahead_board.update(ahead_input, ticks);
+    }
+
+    ASSERT_EQ(board.get_pieces_placed(), ahead_board.get_pieces_placed());
+    ASSERT_EQ(board.get_score(), ahead_board.get_score());
+    // Nearly every piece lands where it was predicted to
+    DecisionStats stats = ahead_agent.get_decision_stats();
+    ASSERT_GT(stats.predicted, stats.decisions / 2);
+}
+
+/* Before the first piece spawns there's nothing to search */
+TEST(TestGenInput, NoFallingPiece) {
+    RandomEngine random_engine(3);
+    Board board(250, random_engine);
+    Weights weights = {-20.0, -10.0, 50.0, -1.0, -20.0, -10.0};
+    Agent agent(true, weights);
+
+    Input input = agent.gen_input(&board);
+    Input none = {};
+    EXPECT_EQ(memcmp(&input, &none, sizeof(Input)), 0);
+    EXPECT_EQ(agent.get_decision_stats().decisions, 0u);
+
+    // And the first piece is still planned once it's there
+    board.update(input, 0);
+    agent.gen_input(&board);
+    EXPECT_EQ(agent.get_decision_stats().decisions, 1u);
+}
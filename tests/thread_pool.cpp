@@ -0,0 +1,31 @@
+#include <atomic>
+#include <gtest/gtest.h>
+
+#include "../src/util/ThreadPool.hpp"
+
+/* Every task runs exactly once and wait() only returns after all of them */
+TEST(TestThreadPool, RunsEveryTask) {
+    constexpr size_t TASKS = 10000;
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.get_thread_count(), 4);
+
+    std::vector<std::atomic<uint32_t>> runs(TASKS);
+    for (size_t round = 1; round <= 3; round++) {
+        for (size_t i = 0; i < TASKS; i++)
+            pool.submit([&runs, i] () { runs[i]++; });
+        pool.wait();
+        for (size_t i = 0; i < TASKS; i++)
+            ASSERT_EQ(runs[i], round);
+    }
+}
+
+/* Tasks still queued when the pool is destroyed get run */
+TEST(TestThreadPool, DestructorFinishesTasks) {
+    std::atomic<uint32_t> runs = 0;
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < 1000; i++)
+            pool.submit([&runs] () { runs++; });
+    }
+    EXPECT_EQ(runs, 1000);
+}
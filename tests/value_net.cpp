@@ -0,0 +1,149 @@
+#include <cstdio>
+#include <gtest/gtest.h>
+
+#include "../bench/corpus.hpp"
+#include "../src/ai/ValueNet.hpp"
+#include "../src/ai/genetic/eval.hpp"
+
+// Where the height, holes and lines features are, see ValueNet::features()
+constexpr size_t LINES_FEATURE = 3 * Board::WIDTH - 1;
+
+/**
+ * Gets the features of every move on a layout.
+ * @param layout The layout to load.
+ * @param moves Set to the moves.
+ * @return INPUTS bytes of features per move.
+ */
+static std::vector<uint8_t> layout_features (
+    const corpus::Layout& layout, std::vector<Move>& moves
+) {
+    RandomEngine random_engine(3);
+    Board board(250, random_engine);
+    corpus::load(board, layout);
+
+    uint8_t piece = board.get_falling_piece();
+    uint8_t held = board.nth_piece(0);
+    moves = generate_moves(&board, piece, held);
+    uint16_t rows[Board::HEIGHT];
+    ValueNet::board_rows(board, rows);
+    std::vector<uint8_t> inputs(moves.size() * ValueNet::INPUTS);
+    for (size_t i = 0; i < moves.size(); i++) {
+        ValueNet::features(
+            rows, moves[i].position, moves[i].hold ? held : piece,
+            moves[i].rotation, &inputs[i * ValueNet::INPUTS]
+        );
+    }
+    return inputs;
+}
+
+/* The features agree with analyze_board() on lines, and on holes when
+ * nothing clears */
+TEST(TestValueNet, FeaturesMatchAnalysis) {
+    for (const corpus::Layout& layout : corpus::LAYOUTS) {
+        std::vector<Move> moves;
+        std::vector<uint8_t> inputs = layout_features(layout, moves);
+
+        RandomEngine random_engine(3);
+        Board board(250, random_engine);
+        corpus::load(board, layout);
+        uint8_t piece = board.get_falling_piece();
+        uint8_t held = board.nth_piece(0);
+        for (size_t i = 0; i < moves.size(); i++) {
+            const uint8_t* features = &inputs[i * ValueNet::INPUTS];
+            BoardAnalysis analysis = analyze_board(
+                &board, moves[i].position,
+                moves[i].hold ? held : piece, moves[i].rotation
+            );
+            EXPECT_EQ(features[LINES_FEATURE], analysis.complete_lines)
+                << layout.name << " move " << i;
+            if (analysis.complete_lines > 0)
+                continue;
+
+            int holes = 0;
+            for (int x = 0; x < Board::WIDTH; x++)
+                holes += features[2 * x + 1];
+            EXPECT_EQ(holes, analysis.holes_count) << layout.name << " move " << i;
+            for (size_t f = ValueNet::FEATURES; f < ValueNet::INPUTS; f++)
+                EXPECT_EQ(features[f], 0);
+        }
+    }
+}
+
+/* The batched kernels give exactly the scores of the scalar path */
+TEST(TestValueNet, BatchMatchesScalar) {
+    RandomEngine random_engine(5);
+    ValueNet net;
+    net.randomize(random_engine);
+    for (const corpus::Layout& layout : corpus::LAYOUTS) {
+        std::vector<Move> moves;
+        std::vector<uint8_t> inputs = layout_features(layout, moves);
+
+        std::vector<float> batch(moves.size()), scalar(moves.size());
+        net.evaluate(inputs.data(), moves.size(), batch.data());
+        net.evaluate_scalar(inputs.data(), moves.size(), scalar.data());
+        for (size_t i = 0; i < moves.size(); i++)
+            EXPECT_EQ(batch[i], scalar[i]) << layout.name << " move " << i;
+    }
+}
+
+/* A saved network loads back scoring the same, and a new one scores 0 */
+TEST(TestValueNet, SaveAndLoad) {
+    std::vector<Move> moves;
+    std::vector<uint8_t> inputs = layout_features(corpus::LAYOUTS[2], moves);
+    std::vector<float> scores(moves.size()), loaded_scores(moves.size());
+
+    ValueNet zero;
+    zero.evaluate(inputs.data(), moves.size(), scores.data());
+    for (float score : scores)
+        EXPECT_EQ(score, 0.0f);
+
+    RandomEngine random_engine(7);
+    ValueNet net;
+    net.randomize(random_engine);
+    const std::string path = ::testing::TempDir() + "value_net.tvnn";
+    ASSERT_TRUE(net.save(path));
+
+    ValueNet loaded;
+    ASSERT_TRUE(loaded.load(path));
+    net.evaluate(inputs.data(), moves.size(), scores.data());
+    loaded.evaluate(inputs.data(), moves.size(), loaded_scores.data());
+    for (size_t i = 0; i < moves.size(); i++)
+        EXPECT_EQ(scores[i], loaded_scores[i]);
+
+    // Anything else isn't a network
+    ASSERT_TRUE(zero.save(path));
+    std::FILE* file = std::fopen(path.c_str(), "ab");
+    ASSERT_NE(file, nullptr);
+    std::fputc(0, file);
+    std::fclose(file);
+    EXPECT_FALSE(loaded.load(path));
+    std::remove(path.c_str());
+}
+
+/* Searching with a network picks the best scoring candidate */
+TEST(TestValueNet, BestMove) {
+    RandomEngine random_engine(9);
+    ValueNet net;
+    net.randomize(random_engine);
+
+    std::vector<Move> moves;
+    std::vector<uint8_t> inputs = layout_features(corpus::LAYOUTS[2], moves);
+    std::vector<float> scores(moves.size());
+    net.evaluate(inputs.data(), moves.size(), scores.data());
+
+    RandomEngine board_engine(3);
+    Board board(250, board_engine);
+    corpus::load(board, corpus::LAYOUTS[2]);
+    size_t candidates = 0;
+    double score = 0;
+    Move move = best_move_net(&board, net, &candidates, &score);
+    EXPECT_EQ(candidates, moves.size());
+    EXPECT_EQ(score, *std::max_element(scores.begin(), scores.end()));
+
+    bool found = false;
+    for (const Move& candidate : moves) {
+        found |= candidate.position == move.position &&
+            candidate.rotation == move.rotation && candidate.hold == move.hold;
+    }
+    EXPECT_TRUE(found);
+}